@@ -45,7 +45,8 @@ def logical_category(id):
          or id == AP_STATUS_PACKET_V6 or id == AP_STATUS_PACKET_V7:
         return 'ap'
     elif id == SYSTEM_HEALTH_PACKET_V2 or id == SYSTEM_HEALTH_PACKET_V3 \
-         or id == SYSTEM_HEALTH_PACKET_V4 or id == SYSTEM_HEALTH_PACKET_V5:
+         or id == SYSTEM_HEALTH_PACKET_V4 or id == SYSTEM_HEALTH_PACKET_V5 \
+         or id == SYSTEM_HEALTH_PACKET_V6:
         return 'health'
     elif id == PAYLOAD_PACKET_V1 or id == PAYLOAD_PACKET_V2 \
          or id == PAYLOAD_PACKET_V3:
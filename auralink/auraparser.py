@@ -5,6 +5,7 @@ sys.path.append("../src")
 from comms.packet_id import *
 import comms.packer
 import comms.serial_parser
+import comms.telemetry_codec
 
 parser = None
 f = None
@@ -17,7 +18,15 @@ def init():
 def update(ser):
     global parser
     pkt_id = parser.read(ser)
-    if pkt_id >= 0:
+    if pkt_id == TELEMETRY_DELTA_V1:
+        # restore the original packet, the log keeps the standard
+        # formats
+        result = comms.telemetry_codec.decode(parser.payload)
+        if result is not None:
+            (pkt_id, payload) = result
+            parse_msg(pkt_id, payload)
+            f.write(comms.packer.wrap_packet(pkt_id, payload))
+    elif pkt_id >= 0:
         parse_msg(pkt_id, parser.payload)
         log_msg(f, pkt_id, parser.pkt_len, parser.payload,
                 parser.cksum_lo, parser.cksum_hi)
@@ -116,6 +125,8 @@ def parse_msg(id, buf):
         index = comms.packer.unpack_system_health_v4(buf)
     elif id == SYSTEM_HEALTH_PACKET_V5:
         index = comms.packer.unpack_system_health_v5(buf)
+    elif id == SYSTEM_HEALTH_PACKET_V6:
+        index = comms.packer.unpack_system_health_v6(buf)
     elif id == PAYLOAD_PACKET_V1:
         index = comms.packer.unpack_payload_v1(buf)
     elif id == PAYLOAD_PACKET_V2:
@@ -177,6 +188,11 @@ def file_read(buf):
 
     if validate_cksum(id, size, savebuf, cksum0, cksum1):
         # print "check sum passed"
+        if id == TELEMETRY_DELTA_V1:
+            result = comms.telemetry_codec.decode(savebuf)
+            if result is None:
+                return (-1, -1, counter)
+            (id, savebuf) = result
         index = parse_msg(id, savebuf)
         return (id, index, counter)
 
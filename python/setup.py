@@ -13,13 +13,20 @@ setup(name='auracore',
       ext_modules=[
           Extension('auracore.wgs84',
                     define_macros=[('HAVE_PYBIND11', '1')],
-                    sources=['util/wgs84.cxx'],
-                    depends=['util/wgs84.hxx']
+                    sources=['util/wgs84.cxx', '../src/util/wgs84.cxx'],
+                    depends=['util/wgs84.hxx', '../src/util/wgs84.hxx']
           ),
           Extension('auracore.windtri',
                     define_macros=[('HAVE_PYBIND11', '1')],
-                    sources=['util/windtri.cxx'],
-                    depends=['util/windtri.hxx']
+                    sources=['util/windtri.cxx', '../src/util/windtri.cxx'],
+                    depends=['util/windtri.hxx', '../src/util/windtri.hxx']
+          ),
+          Extension('auracore.survey',
+                    define_macros=[('HAVE_PYBIND11', '1')],
+                    sources=['util/survey.cxx', '../src/util/survey_plan.cxx',
+                             '../src/util/wgs84.cxx'],
+                    depends=['util/survey.hxx', '../src/util/survey_plan.hxx',
+                             '../src/util/wgs84.hxx']
           )
       ]
       )
@@ -0,0 +1,37 @@
+#ifdef HAVE_PYBIND11
+  #include <pybind11/pybind11.h>
+  namespace py = pybind11;
+#endif
+
+#include "../../src/util/survey_plan.hxx"
+
+#include "survey.hxx"
+
+py::list py_survey_plan( py::list area, double advance_deg, double step_m,
+                         double extend_m, double turn_radius_m )
+{
+    vector<SurveyPoint> poly;
+    for ( auto item : area ) {
+        py::sequence p = item.cast<py::sequence>();
+        SurveyPoint sp = { p[0].cast<double>(), p[1].cast<double>() };
+        poly.push_back( sp );
+    }
+    vector<SurveyPoint> route = survey_plan( poly, advance_deg, step_m,
+                                             extend_m, turn_radius_m );
+    py::list result;
+    for ( unsigned int i = 0; i < route.size(); i++ ) {
+        result.append( py::make_tuple(route[i].x, route[i].y) );
+    }
+    return result;
+}
+
+
+#ifdef HAVE_PYBIND11
+  PYBIND11_PLUGIN(survey) {
+      py::module m("survey", "survey route planning for python");
+      m.def("plan", &py_survey_plan,
+            py::arg("area"), py::arg("advance_deg"), py::arg("step_m"),
+            py::arg("extend_m"), py::arg("turn_radius_m") = 0.0);
+      return m.ptr();
+  }
+#endif // HAVE_PYBIND11
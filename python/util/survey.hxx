@@ -0,0 +1,12 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+namespace py = pybind11;
+
+// given a survey area as a list of (lon_deg, lat_deg) points, the
+// compass direction the survey lines advance in, the line spacing, the
+// line end extension, and (optionally) the aircraft turn radius
+// (meters), return the survey route as a list of (lon_deg, lat_deg)
+// waypoints.
+py::list py_survey_plan( py::list area, double advance_deg, double step_m,
+                         double extend_m, double turn_radius_m );
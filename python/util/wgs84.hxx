@@ -1,8 +1,13 @@
 #pragma once
 
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 namespace py = pybind11;
 
+// numpy arrays of doubles (converted only if the caller passes another
+// dtype or a non-contiguous view)
+typedef py::array_t<double, py::array::c_style | py::array::forcecast> py_darray;
+
 // given, lla, az1 and distance (s), return (lat2, lon2) and modify
 // *az2 (starting return heading.)  Lat, lon, and azimuth are in
 // degrees, distance in meters.
@@ -12,3 +17,23 @@ py::tuple py_geo_direct_wgs84 ( double lat1, double lon1, double az1, double s )
 // az1, az2 and distance (s).  Lat, lon, and azimuth are in degrees.
 // distance in meters
 py::tuple py_geo_inverse_wgs84( double lat1, double lon1, double lat2, double lon2 );
+
+// array versions: every argument is an array of the same size (the
+// ned reference point is a scalar), results are new arrays of the
+// same shape.
+
+py::tuple py_geo_direct_wgs84_array( py_darray lat1, py_darray lon1,
+                                     py_darray az1, py_darray s );
+py::tuple py_geo_inverse_wgs84_array( py_darray lat1, py_darray lon1,
+                                      py_darray lat2, py_darray lon2 );
+
+// lat, lon (degrees), alt (meters) <-> ecef x, y, z (meters)
+py::tuple py_geod2ecef_wgs84( py_darray lat, py_darray lon, py_darray alt );
+py::tuple py_ecef2geod_wgs84( py_darray x, py_darray y, py_darray z );
+
+// ecef <-> north, east, down (meters) about a reference lat, lon, alt
+py::tuple py_ecef2ned_wgs84( double ref_lat, double ref_lon, double ref_alt,
+                             py_darray x, py_darray y, py_darray z );
+py::tuple py_ned2ecef_wgs84( double ref_lat, double ref_lon, double ref_alt,
+                             py_darray north, py_darray east,
+                             py_darray down );
@@ -8,5 +8,5 @@ namespace py = pybind11;
 // fly to achieve the desired course in the given wind.  Also compute the
 // estimated ground speed.
 
-py::tuple wind_course( double ws_kt, double tas_kt, double wd_deg,
-                       double crs_deg );
+py::tuple py_wind_course( double ws_kt, double tas_kt, double wd_deg,
+                          double crs_deg );
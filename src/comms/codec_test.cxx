@@ -0,0 +1,261 @@
+// Round trip test for the telemetry delta codec.
+//
+// usage: codec_test [flight.dat]
+//
+// With no arguments a synthetic flight is generated.  Given an
+// (uncompressed) flight log, every packet in it is pushed through the
+// encoder and decoder instead.  A few percent of the encoded packets
+// are dropped to exercise the resync path.  Every packet that
+// decodes must match the original to within the field quantization,
+// and the packets lost with a keyframe must not outnumber the ones
+// lost on the link.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+using std::vector;
+
+#include "packet_id.h"
+#include "telemetry_codec.hxx"
+
+static int wrap( int id, const uint8_t *payload, int len, uint8_t *out ) {
+    out[0] = 147;
+    out[1] = 224;
+    out[2] = id;
+    out[3] = len;
+    memcpy( out + 4, payload, len );
+    uint8_t c0 = 0, c1 = 0;
+    for ( int i = 2; i < len + 4; i++ ) {
+        c0 += out[i];
+        c1 += c0;
+    }
+    out[len + 4] = c0;
+    out[len + 5] = c1;
+    return len + 6;
+}
+
+// little endian payload builder
+struct payload_t {
+    uint8_t buf[255];
+    int len;
+    payload_t(): len(0) {}
+    void B( int v ) { buf[len++] = v; }
+    void h( int v ) { int16_t x = v; memcpy(buf + len, &x, 2); len += 2; }
+    void H( int v ) { uint16_t x = v; memcpy(buf + len, &x, 2); len += 2; }
+    void f( double v ) { float x = v; memcpy(buf + len, &x, 4); len += 4; }
+    void d( double v ) { memcpy(buf + len, &v, 8); len += 8; }
+};
+
+// compare field by field, floats to within half their resolution
+static bool compare( const uint8_t *a, const uint8_t *b, int len,
+                     const char *fmt, const double *scale )
+{
+    int off = 0;
+    int fi = 0;
+    for ( const char *c = fmt; *c; c++ ) {
+        if ( *c == 'f' || *c == 'd' ) {
+            double va, vb;
+            if ( *c == 'f' ) {
+                float x, y; memcpy(&x, a + off, 4); memcpy(&y, b + off, 4);
+                va = x; vb = y; off += 4;
+            } else {
+                memcpy(&va, a + off, 8); memcpy(&vb, b + off, 8); off += 8;
+            }
+            double tol = 0.5 / scale[fi++] + fabs(va) * 1e-7;
+            if ( fabs(va - vb) > tol ) {
+                return false;
+            }
+        } else {
+            int n = (*c == 'B') ? 1 : 2;
+            if ( memcmp(a + off, b + off, n) != 0 ) {
+                return false;
+            }
+            off += n;
+        }
+    }
+    return off == len;
+}
+
+struct check_format {
+    int id;
+    const char *fmt;
+    double scale[12];
+};
+
+static const check_format formats[] = {
+    { GPS_PACKET_V4, "BfddfhhhdBHHHB", { 1e3, 1e7, 1e7, 1e2, 1e3 } },
+    { IMU_PACKET_V4, "BffffffffffhB",
+      { 1e3, 1e4, 1e4, 1e4, 1e3, 1e3, 1e3, 1e3, 1e3, 1e3 } },
+    { AIRDATA_PACKET_V6, "BfHhhffhHBBB", { 1e3, 1e2, 1e2 } },
+    { FILTER_PACKET_V4, "BfddfhhhhhhhhhhhhBB", { 1e3, 1e7, 1e7, 1e2 } },
+    { ACTUATOR_PACKET_V3, "BfhhHhhhhhB", { 1e3 } },
+    { PILOT_INPUT_PACKET_V3, "BfhhhhhhhhB", { 1e3 } },
+    { AP_STATUS_PACKET_V7, "BfBhhHhhhHHddHHBHB", { 1e3, 1e7, 1e7 } },
+    { SYSTEM_HEALTH_PACKET_V6, "BfHHHHHHHHHHHHHH", { 1e3 } },
+};
+
+static const check_format *find_format( int id ) {
+    for ( unsigned int i = 0; i < sizeof(formats)/sizeof(formats[0]); i++ ) {
+        if ( formats[i].id == id ) {
+            return &formats[i];
+        }
+    }
+    return NULL;
+}
+
+// synthetic flight: a 100hz imu + filter, 10hz actuators, 5hz gps,
+// 1hz health over a slow circle with some sensor noise
+static void make_flight( vector< vector<uint8_t> > *packets,
+                         vector<double> *times )
+{
+    uint8_t pkt[261];
+    double lat0 = 44.9, lon0 = -93.2;
+    for ( int i = 0; i < 60 * 100; i++ ) {
+        double t = 100.0 + i * 0.01;
+        double psi = t * 0.05;
+        double noise = drand48() - 0.5;
+        payload_t p;
+        p.B(0); p.f(t);
+        p.f(0.01 * noise); p.f(0.02 * noise); p.f(0.05 + 0.01 * noise);
+        p.f(0.3 * noise); p.f(-0.2 * noise); p.f(-9.81 + 0.5 * noise);
+        p.f(0.3); p.f(0.1); p.f(-0.4);
+        p.h(321); p.B(0);
+        packets->push_back( vector<uint8_t>(pkt, pkt + wrap(IMU_PACKET_V4, p.buf, p.len, pkt)) );
+        times->push_back(t);
+
+        payload_t fl;
+        fl.B(0); fl.f(t);
+        fl.d(lat0 + 0.002 * sin(psi)); fl.d(lon0 + 0.003 * cos(psi));
+        fl.f(300.0 + 5.0 * sin(t * 0.1));
+        fl.h(1500 * cos(psi)); fl.h(-1500 * sin(psi)); fl.h(10 * noise);
+        fl.h(250); fl.h(30 + 3 * noise); fl.h(fmod(psi * 573.0, 3600.0));
+        for ( int k = 0; k < 6; k++ ) fl.h(k * 10);
+        fl.B(7); fl.B(0);
+        packets->push_back( vector<uint8_t>(pkt, pkt + wrap(FILTER_PACKET_V4, fl.buf, fl.len, pkt)) );
+        times->push_back(t);
+
+        if ( i % 10 == 0 ) {
+            payload_t a;
+            a.B(0); a.f(t);
+            a.h(2000 * sin(t)); a.h(1000 * cos(t)); a.H(40000);
+            for ( int k = 0; k < 5; k++ ) a.h(0);
+            a.B(0);
+            packets->push_back( vector<uint8_t>(pkt, pkt + wrap(ACTUATOR_PACKET_V3, a.buf, a.len, pkt)) );
+            times->push_back(t);
+        }
+        if ( i % 20 == 0 ) {
+            payload_t g;
+            g.B(0); g.f(t);
+            g.d(lat0 + 0.002 * sin(psi)); g.d(lon0 + 0.003 * cos(psi));
+            g.f(300.0 + 5.0 * sin(t * 0.1));
+            g.h(1500 * cos(psi)); g.h(-1500 * sin(psi)); g.h(0);
+            g.d(1.5e9 + t); g.B(12); g.H(150); g.H(250); g.H(120); g.B(3);
+            packets->push_back( vector<uint8_t>(pkt, pkt + wrap(GPS_PACKET_V4, g.buf, g.len, pkt)) );
+            times->push_back(t);
+        }
+        if ( i % 100 == 0 ) {
+            payload_t s;
+            s.B(0); s.f(t);
+            for ( int k = 0; k < 14; k++ ) s.H(1000 + k);
+            packets->push_back( vector<uint8_t>(pkt, pkt + wrap(SYSTEM_HEALTH_PACKET_V6, s.buf, s.len, pkt)) );
+            times->push_back(t);
+        }
+    }
+}
+
+// split a raw flight log into packets, using the leading timestamp
+// (when there is one) as the send time
+static void load_flight( const char *file, vector< vector<uint8_t> > *packets,
+                         vector<double> *times )
+{
+    FILE *fp = fopen(file, "rb");
+    if ( fp == NULL ) {
+        printf("cannot open %s\n", file);
+        exit(1);
+    }
+    vector<uint8_t> data;
+    uint8_t chunk[4096];
+    int n;
+    while ( (n = fread(chunk, 1, sizeof(chunk), fp)) > 0 ) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(fp);
+
+    double t = 0.0;
+    unsigned int i = 0;
+    while ( i + 6 <= data.size() ) {
+        if ( data[i] != 147 || data[i+1] != 224 ) {
+            i++;
+            continue;
+        }
+        unsigned int size = data[i+3] + 6;
+        if ( i + size > data.size() ) {
+            break;
+        }
+        if ( find_format(data[i+2]) != NULL ) {
+            float ts;
+            memcpy( &ts, &data[i+5], 4 );
+            if ( ts > t ) {
+                t = ts;
+            }
+            packets->push_back( vector<uint8_t>(&data[i], &data[i] + size) );
+            times->push_back(t);
+        }
+        i += size;
+    }
+}
+
+int main( int argc, char **argv ) {
+    vector< vector<uint8_t> > packets;
+    vector<double> times;
+    if ( argc > 1 ) {
+        load_flight( argv[1], &packets, &times );
+    } else {
+        make_flight( &packets, &times );
+    }
+
+    TelemetryCodec encoder;
+    TelemetryCodec decoder;
+    uint8_t enc[263];
+    uint8_t dec[263];
+    int failures = 0;
+    int decoded = 0;
+    int lost = 0;
+    srand48(1);
+    for ( unsigned int i = 0; i < packets.size(); i++ ) {
+        vector<uint8_t> &pkt = packets[i];
+        int esize = encoder.encode( pkt.data(), pkt.size(), times[i], enc );
+        if ( drand48() < 0.02 ) {
+            lost++;
+            continue;
+        }
+        int dsize = decoder.decode( enc, esize, dec );
+        if ( dsize == 0 ) {
+            continue;
+        }
+        decoded++;
+        const check_format *f = find_format( pkt[2] );
+        if ( dsize != (int)pkt.size() || dec[2] != pkt[2]
+             || !compare( pkt.data() + 4, dec + 4, pkt[3], f->fmt, f->scale ) )
+        {
+            printf("mismatch: packet %d id %d\n", i, pkt[2]);
+            failures++;
+        }
+    }
+
+    printf("packets: %d  lost: %d  decoded: %d  keyframe lost: %d\n",
+           (int)packets.size(), lost, decoded, decoder.dropped);
+    printf("keyframes: %d  deltas: %d\n", encoder.keyframes, encoder.deltas);
+    printf("bytes in: %lu  bytes out: %lu  ratio: %.2f\n",
+           (unsigned long)encoder.bytes_in, (unsigned long)encoder.bytes_out,
+           (double)encoder.bytes_in / encoder.bytes_out);
+    if ( failures || decoded == 0 || (int)decoder.dropped > lost ) {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}
@@ -0,0 +1,411 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include "packet_id.h"
+#include "columnlog.hxx"
+
+#define START_OF_MSG0 147
+#define START_OF_MSG1 224
+
+// Layouts of the packet versions currently written by packer.py.
+// Field names and divisors follow the matching unpack_*() functions.
+static alc_schema schemas[] = {
+    { GPS_PACKET_V4, "gps", "BfddfhhhdBHHHB",
+      "index,timestamp,latitude_deg,longitude_deg,altitude_m,"
+      "vn_ms/100,ve_ms/100,vd_ms/100,unix_time_sec,satellites,"
+      "horiz_accuracy_m/100,vert_accuracy_m/100,pdop/100,fixType" },
+    { IMU_PACKET_V4, "imu", "BffffffffffhB",
+      "index,timestamp,p_rad_sec,q_rad_sec,r_rad_sec,"
+      "ax_mps_sec,ay_mps_sec,az_mps_sec,hx,hy,hz,temp_C/10,status" },
+    { AIRDATA_PACKET_V6, "airdata", "BfHhhffhHBBB",
+      "index,timestamp,pressure_mbar/10,temp_C/100,"
+      "airspeed_smoothed_kt/100,altitude_smoothed_m,altitude_true_m,"
+      "pressure_vertical_speed_fps/600,wind_dir_deg/100,"
+      "wind_speed_kt/4,pitot_scale_factor/100,status" },
+    { FILTER_PACKET_V4, "filter", "BfddfhhhhhhhhhhhhBB",
+      "index,timestamp,latitude_deg,longitude_deg,altitude_m,"
+      "vn_ms/100,ve_ms/100,vd_ms/100,roll_deg/10,pitch_deg/10,"
+      "heading_deg/10,p_bias/10000,q_bias/10000,r_bias/10000,"
+      "ax_bias/1000,ay_bias/1000,az_bias/1000,sequence_num,status" },
+    { ACTUATOR_PACKET_V3, "act", "BfhhHhhhhhB",
+      "index,timestamp,aileron/20000,elevator/20000,throttle/60000,"
+      "rudder/20000,channel5/20000,flaps/20000,channel7/20000,"
+      "channel8/20000,status" },
+    { PILOT_INPUT_PACKET_V3, "pilot", "BfhhhhhhhhB",
+      "index,timestamp,channel0/20000,channel1/20000,channel2/20000,"
+      "channel3/20000,channel4/20000,channel5/20000,channel6/20000,"
+      "channel7/20000,status" },
+    { AP_STATUS_PACKET_V7, "ap", "BfBhhHhhhHHddHHBHB",
+      "index,timestamp,flags,groundtrack_deg/10,roll_deg/10,"
+      "altitude_msl_ft,altitude_ground_m,pitch_deg/10,airspeed_kt/10,"
+      "flight_timer,target_waypoint_idx,wp_longitude_deg,"
+      "wp_latitude_deg,wp_index,route_size,task_id,task_attribute,"
+      "sequence_num" },
+    { SYSTEM_HEALTH_PACKET_V6, "health", "BfHHHHHHHHHHHHHH",
+      "index,timestamp,system_load_avg/100,avionics_vcc/1000,"
+      "main_vcc/1000,cell_vcc/1000,main_amps/1000,total_mah/0.1,"
+      "accel_band0_rms/1000,accel_band1_rms/1000,accel_band2_rms/1000,"
+      "accel_peak_hz/10,gyro_band0_rms/10000,gyro_band1_rms/10000,"
+      "gyro_band2_rms/10000,gyro_peak_hz/10" },
+    { PAYLOAD_PACKET_V3, "payload", "BfH",
+      "index,timestamp,trigger_num" },
+    { RAVEN_PACKET_V1, "raven", "BdHHHHHHHHHHffffB",
+      "index,timestamp,pot0,pot1,pot2,pot3,pot4,pot5,pot6,pot7,pot8,"
+      "pot9,diff_pa,pressure_mbar,rpm0,rpm1,status" },
+};
+static const int num_schemas = sizeof(schemas) / sizeof(schemas[0]);
+static bool schemas_ready = false;
+
+
+int alc_type_size( char c ) {
+    switch ( c ) {
+    case 'B': case 'b': return 1;
+    case 'H': case 'h': return 2;
+    case 'L': case 'l': case 'f': return 4;
+    case 'd': return 8;
+    default: return 0;
+    }
+}
+
+
+double alc_get_value( char type, const uint8_t *col, int i ) {
+    switch ( type ) {
+    case 'B': return col[i];
+    case 'b': return (int8_t)col[i];
+    case 'H': { uint16_t v; memcpy(&v, col + 2*i, 2); return v; }
+    case 'h': { int16_t v; memcpy(&v, col + 2*i, 2); return v; }
+    case 'L': { uint32_t v; memcpy(&v, col + 4*i, 4); return v; }
+    case 'l': { int32_t v; memcpy(&v, col + 4*i, 4); return v; }
+    case 'f': { float v; memcpy(&v, col + 4*i, 4); return v; }
+    case 'd': { double v; memcpy(&v, col + 8*i, 8); return v; }
+    default: return 0.0;
+    }
+}
+
+
+bool alc_schema::parse() {
+    field_names.clear();
+    divisors.clear();
+    offsets.clear();
+    size = 0;
+    for ( unsigned int i = 0; i < fmt.length(); i++ ) {
+        int n = alc_type_size(fmt[i]);
+        if ( n == 0 ) {
+            return false;
+        }
+        offsets.push_back(size);
+        size += n;
+    }
+    size_t start = 0;
+    while ( start <= fields.length() ) {
+        size_t end = fields.find(',', start);
+        if ( end == string::npos ) {
+            end = fields.length();
+        }
+        string field = fields.substr(start, end - start);
+        size_t slash = field.find('/');
+        double div = 1.0;
+        if ( slash != string::npos ) {
+            div = atof( field.substr(slash + 1).c_str() );
+            field = field.substr(0, slash);
+        }
+        field_names.push_back(field);
+        divisors.push_back(div);
+        start = end + 1;
+    }
+    // every layout leads with the sensor index and a timestamp
+    return field_names.size() == fmt.length() && fmt.length() >= 2
+        && (fmt[1] == 'f' || fmt[1] == 'd');
+}
+
+
+const alc_schema *alc_find_schema( int packet_id ) {
+    if ( !schemas_ready ) {
+        for ( int i = 0; i < num_schemas; i++ ) {
+            if ( !schemas[i].parse() ) {
+                fprintf( stderr, "columnlog: bad layout for %s\n",
+                         schemas[i].name.c_str() );
+                schemas[i].packet_id = -1;
+            }
+        }
+        schemas_ready = true;
+    }
+    for ( int i = 0; i < num_schemas; i++ ) {
+        if ( schemas[i].packet_id == packet_id ) {
+            return &schemas[i];
+        }
+    }
+    return NULL;
+}
+
+
+bool alc_compress( const uint8_t *raw, int raw_size, int elem_size,
+                   vector<uint8_t> *out, uint8_t *codec )
+{
+    // byte shuffle: all the low bytes, then the next byte, ...
+    vector<uint8_t> shuffled;
+    const uint8_t *src = raw;
+    if ( elem_size > 1 ) {
+        shuffled.resize(raw_size);
+        int n = raw_size / elem_size;
+        for ( int b = 0; b < elem_size; b++ ) {
+            for ( int i = 0; i < n; i++ ) {
+                shuffled[b * n + i] = raw[i * elem_size + b];
+            }
+        }
+        src = shuffled.data();
+    }
+    uLongf len = compressBound(raw_size);
+    out->resize(len);
+    if ( compress2( out->data(), &len, src, raw_size, Z_BEST_SPEED ) != Z_OK ) {
+        return false;
+    }
+    if ( (int)len >= raw_size ) {
+        // incompressible, store it
+        out->assign(raw, raw + raw_size);
+        *codec = ALC_RAW;
+        return true;
+    }
+    out->resize(len);
+    *codec = elem_size > 1 ? ALC_SHUFFLE_DEFLATE : ALC_DEFLATE;
+    return true;
+}
+
+
+bool alc_decompress( const uint8_t *comp, int comp_size, uint8_t codec,
+                     int elem_size, uint8_t *raw, int raw_size )
+{
+    if ( codec == ALC_RAW ) {
+        if ( comp_size != raw_size ) {
+            return false;
+        }
+        memcpy( raw, comp, raw_size );
+        return true;
+    }
+    vector<uint8_t> tmp;
+    uint8_t *dst = raw;
+    if ( codec == ALC_SHUFFLE_DEFLATE ) {
+        tmp.resize(raw_size);
+        dst = tmp.data();
+    }
+    uLongf len = raw_size;
+    if ( uncompress( dst, &len, comp, comp_size ) != Z_OK
+         || (int)len != raw_size )
+    {
+        return false;
+    }
+    if ( codec == ALC_SHUFFLE_DEFLATE ) {
+        int n = raw_size / elem_size;
+        for ( int b = 0; b < elem_size; b++ ) {
+            for ( int i = 0; i < n; i++ ) {
+                raw[i * elem_size + b] = tmp[b * n + i];
+            }
+        }
+    }
+    return true;
+}
+
+
+ColumnLogWriter::ColumnLogWriter():
+    packets(0),
+    skipped(0),
+    fp(NULL),
+    file_pos(0),
+    chunk_rows(4096),
+    threaded(false),
+    done(false)
+{
+}
+
+ColumnLogWriter::~ColumnLogWriter() {
+    close();
+}
+
+
+bool ColumnLogWriter::open( const char *path, int rows, bool use_thread ) {
+    fp = fopen( path, "wb" );
+    if ( fp == NULL ) {
+        fprintf( stderr, "columnlog: cannot open %s\n", path );
+        return false;
+    }
+    fwrite( "AURACOL1", 8, 1, fp );
+    file_pos = 8;
+    chunk_rows = rows > 0 ? rows : 4096;
+    threaded = use_thread;
+    done = false;
+    if ( threaded ) {
+        worker = std::thread( &ColumnLogWriter::worker_main, this );
+    }
+    return true;
+}
+
+
+void ColumnLogWriter::log_packet( const uint8_t *pkt, int size ) {
+    if ( fp == NULL || size < 6 ) {
+        return;
+    }
+    int id = pkt[2];
+    int len = pkt[3];
+    const alc_schema *schema = alc_find_schema(id);
+    if ( schema == NULL || len != schema->size || size != len + 6 ) {
+        skipped++;
+        return;
+    }
+    const uint8_t *payload = pkt + 4;
+    int key = (id << 8) | payload[0];
+    map<int, stream_buffer>::iterator it = streams.find(key);
+    if ( it == streams.end() ) {
+        stream_buffer s;
+        s.schema = schema;
+        s.index = payload[0];
+        s.columns.resize( schema->fmt.length() );
+        s.rows = 0;
+        s.t_first = s.t_last = 0.0;
+        it = streams.insert( std::make_pair(key, s) ).first;
+    }
+    stream_buffer &s = it->second;
+
+    double t = alc_get_value( schema->fmt[1], payload + schema->offsets[1], 0 );
+    if ( s.rows == 0 ) {
+        s.t_first = t;
+    }
+    s.t_last = t;
+    for ( unsigned int i = 0; i < s.columns.size(); i++ ) {
+        int n = alc_type_size( schema->fmt[i] );
+        const uint8_t *p = payload + schema->offsets[i];
+        s.columns[i].insert( s.columns[i].end(), p, p + n );
+    }
+    s.rows++;
+    packets++;
+
+    if ( s.rows >= chunk_rows ) {
+        flush_stream( key, s );
+    }
+}
+
+
+// hand each column of a stream off as a chunk
+void ColumnLogWriter::flush_stream( int key, stream_buffer &s ) {
+    if ( s.rows == 0 ) {
+        return;
+    }
+    for ( unsigned int i = 0; i < s.columns.size(); i++ ) {
+        chunk_job *job = new chunk_job;
+        memset( &job->header, 0, sizeof(job->header) );
+        memcpy( job->header.magic, "CHNK", 4 );
+        job->header.stream = key;
+        job->header.column = i;
+        job->header.type = s.schema->fmt[i];
+        job->header.rows = s.rows;
+        job->header.raw_size = s.columns[i].size();
+        job->header.t_first = s.t_first;
+        job->header.t_last = s.t_last;
+        job->elem_size = alc_type_size( s.schema->fmt[i] );
+        job->data.swap( s.columns[i] );
+        s.columns[i].reserve( job->data.size() );
+        if ( threaded ) {
+            std::lock_guard<std::mutex> guard(lock);
+            jobs.push_back(job);
+        } else {
+            write_chunk(job);
+        }
+    }
+    if ( threaded ) {
+        cond.notify_one();
+    }
+    s.rows = 0;
+}
+
+
+void ColumnLogWriter::write_chunk( chunk_job *job ) {
+    vector<uint8_t> comp;
+    uint8_t codec = ALC_RAW;
+    if ( !alc_compress( job->data.data(), job->data.size(), job->elem_size,
+                        &comp, &codec ) )
+    {
+        comp = job->data;
+        codec = ALC_RAW;
+    }
+    job->header.codec = codec;
+    job->header.comp_size = comp.size();
+    job->header.crc = crc32( 0L, comp.data(), comp.size() );
+
+    alc_index_entry entry;
+    entry.header = job->header;
+    entry.offset = file_pos + sizeof(alc_chunk_header);
+    fwrite( &job->header, sizeof(job->header), 1, fp );
+    fwrite( comp.data(), comp.size(), 1, fp );
+    file_pos += sizeof(job->header) + comp.size();
+    index.push_back(entry);
+    delete job;
+}
+
+
+void ColumnLogWriter::worker_main() {
+    std::unique_lock<std::mutex> guard(lock);
+    while ( true ) {
+        while ( jobs.empty() && !done ) {
+            cond.wait(guard);
+        }
+        if ( jobs.empty() && done ) {
+            break;
+        }
+        chunk_job *job = jobs.front();
+        jobs.pop_front();
+        guard.unlock();
+        write_chunk(job);
+        guard.lock();
+    }
+}
+
+
+static void write_string( FILE *fp, const string &s ) {
+    uint16_t len = s.length();
+    fwrite( &len, 2, 1, fp );
+    fwrite( s.c_str(), len, 1, fp );
+}
+
+void ColumnLogWriter::close() {
+    if ( fp == NULL ) {
+        return;
+    }
+    map<int, stream_buffer>::iterator it;
+    for ( it = streams.begin(); it != streams.end(); it++ ) {
+        flush_stream( it->first, it->second );
+    }
+    if ( threaded ) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            done = true;
+        }
+        cond.notify_one();
+        worker.join();
+    }
+
+    // footer: schema of every stream seen, then the chunk index
+    uint64_t footer_pos = file_pos;
+    uint32_t count = streams.size();
+    fwrite( "SCHM", 4, 1, fp );
+    fwrite( &count, 4, 1, fp );
+    for ( it = streams.begin(); it != streams.end(); it++ ) {
+        uint16_t key = it->first;
+        fwrite( &key, 2, 1, fp );
+        write_string( fp, it->second.schema->name );
+        write_string( fp, it->second.schema->fmt );
+        write_string( fp, it->second.schema->fields );
+    }
+    count = index.size();
+    fwrite( "INDX", 4, 1, fp );
+    fwrite( &count, 4, 1, fp );
+    if ( count ) {
+        fwrite( index.data(), sizeof(alc_index_entry), count, fp );
+    }
+    fwrite( &footer_pos, 8, 1, fp );
+    fwrite( "AURAIDX1", 8, 1, fp );
+    fclose(fp);
+    fp = NULL;
+    streams.clear();
+    index.clear();
+}
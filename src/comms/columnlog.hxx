@@ -0,0 +1,154 @@
+#pragma once
+
+// Columnar flight log format ("flight.alc")
+//
+// Packets are split into their struct fields and each field (column)
+// of each stream (packet id + sensor index) is buffered separately.
+// Every chunk_rows rows, each column is written as an independently
+// compressed chunk, so one channel of a long flight can be pulled out
+// without touching the rest of the file.  A footer holds the stream
+// schema (names, struct formats, scaling) and an index of every
+// chunk with its file offset and time range.
+//
+// File layout (little endian):
+//   "AURACOL1"
+//   chunk: chunk_header, compressed column data ...
+//   footer: "SCHM" schema, "INDX" index entries
+//   trailer: uint64 footer offset, "AURAIDX1"
+//
+// The footer is only written by close().  A log cut short by a crash
+// is still readable: aura-logexport walks the chunk headers to rebuild
+// the index and takes the schema from the built in layouts.
+//
+// Compression is zlib (already a dependency); multi byte columns are
+// byte shuffled first which helps a lot on slowly varying floats.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using std::deque;
+using std::map;
+using std::string;
+using std::vector;
+
+enum alc_codec {
+    ALC_RAW = 0,
+    ALC_DEFLATE = 1,
+    ALC_SHUFFLE_DEFLATE = 2
+};
+
+#pragma pack(push, 1)
+struct alc_chunk_header {
+    char magic[4];              // "CHNK"
+    uint16_t stream;            // packet id << 8 | sensor index
+    uint16_t column;
+    uint8_t type;               // python struct code of the column
+    uint8_t codec;
+    uint16_t reserved;
+    uint32_t rows;
+    uint32_t raw_size;
+    uint32_t comp_size;
+    uint32_t crc;               // crc32 of the compressed data
+    double t_first;
+    double t_last;
+};
+
+struct alc_index_entry {
+    alc_chunk_header header;
+    uint64_t offset;            // file offset of the compressed data
+};
+#pragma pack(pop)
+
+// a packet layout: struct format plus field names and scaling
+struct alc_schema {
+    int packet_id;
+    string name;                // stream base name (e.g. "imu")
+    string fmt;                 // python struct codes, no byte order
+    string fields;              // "name[/divisor],..." per field
+
+    // derived
+    vector<string> field_names;
+    vector<double> divisors;
+    vector<int> offsets;
+    int size;
+
+    bool parse();
+};
+
+// packet layouts for the current packet versions
+const alc_schema *alc_find_schema( int packet_id );
+
+// bytes per element for a struct code (0 if unsupported)
+int alc_type_size( char c );
+
+// element i of a raw column as a double (before scaling)
+double alc_get_value( char type, const uint8_t *col, int i );
+
+// compress / decompress one column
+bool alc_compress( const uint8_t *raw, int raw_size, int elem_size,
+                   vector<uint8_t> *out, uint8_t *codec );
+bool alc_decompress( const uint8_t *comp, int comp_size, uint8_t codec,
+                     int elem_size, uint8_t *raw, int raw_size );
+
+
+class ColumnLogWriter {
+
+public:
+
+    ColumnLogWriter();
+    ~ColumnLogWriter();
+
+    // threaded: compress and write from a background thread so the
+    // caller never waits on zlib or the file system
+    bool open( const char *path, int chunk_rows, bool threaded );
+    void close();
+    inline bool is_open() { return fp != NULL; }
+
+    // add one wrapped packet (sync, id, len, payload, cksum).  Packets
+    // with no known layout are counted and skipped.
+    void log_packet( const uint8_t *pkt, int size );
+
+    uint32_t packets;
+    uint32_t skipped;
+
+private:
+
+    struct stream_buffer {
+        const alc_schema *schema;
+        int index;
+        vector< vector<uint8_t> > columns;
+        int rows;
+        double t_first;
+        double t_last;
+    };
+
+    struct chunk_job {
+        alc_chunk_header header;
+        int elem_size;
+        vector<uint8_t> data;
+    };
+
+    FILE *fp;
+    uint64_t file_pos;
+    int chunk_rows;
+    map<int, stream_buffer> streams;
+    vector<alc_index_entry> index;
+
+    bool threaded;
+    bool done;
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable cond;
+    deque<chunk_job *> jobs;
+
+    void flush_stream( int key, stream_buffer &s );
+    void write_chunk( chunk_job *job );
+    void worker_main();
+};
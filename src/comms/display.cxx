@@ -6,53 +6,27 @@ pyModuleDisplay::pyModuleDisplay()
 {
 }
 
-bool pyModuleDisplay::show(const char *message)
+bool pyModuleDisplay::init(const char *import_name)
 {
-    if (pModuleObj == NULL) {
-	printf("ERROR: events.init() failed\n");
-	return false;
-    }
-    PyObject *pFuncLog = PyObject_GetAttrString(pModuleObj, "show");
-    if ( pFuncLog == NULL || ! PyCallable_Check(pFuncLog) ) {
-	if ( PyErr_Occurred() ) PyErr_Print();
-	printf("ERROR: cannot find function 'show()'\n");
-	return false;
-    }
+    bool result = pyModuleBase::init(import_name);
+    show_func.bind(pModuleObj, "show", 1);
+    status_summary_func.bind(pModuleObj, "status_summary", 0);
+    return result;
+}
 
-    // FIXME decref pFuncLog
-    
-    PyObject *pValue = PyObject_CallFunction(pFuncLog, (char *)"s", message);
-    if (pValue != NULL) {
-	bool result = PyObject_IsTrue(pValue);
-	Py_DECREF(pValue);
-	return result;
-    } else {
-	PyErr_Print();
-	printf("ERROR: call failed\n");
-	return false;
+bool pyModuleDisplay::show(const char *message)
+{
+    PyObject *pMessage = PyUnicode_FromString(message);
+    if ( pMessage == NULL ) {
+        PyErr_Clear();
+        return false;
     }
-    return false;
+    bool result = show_func.call_bool(&pMessage);
+    Py_DECREF(pMessage);
+    return result;
 }
 
 
 void pyModuleDisplay::status_summary() {
-    if (pModuleObj == NULL) {
-	printf("ERROR: import logging module failed\n");
-	return;
-    }
-    PyObject *pFuncLog = PyObject_GetAttrString(pModuleObj, "status_summary");
-    if ( pFuncLog == NULL || ! PyCallable_Check(pFuncLog) ) {
-	if ( PyErr_Occurred() ) PyErr_Print();
-	printf("ERROR: cannot find function 'status_summary()'\n");
-	return;
-    }
-    PyObject *pResult = PyObject_CallFunction(pFuncLog, NULL);
-    if (pResult != NULL) {
-	Py_DECREF(pResult);
-	return;
-    } else {
-	PyErr_Print();
-	printf("ERROR: call failed\n");
-	return;
-    }
+    status_summary_func.call_void(NULL);
 }
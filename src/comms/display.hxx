@@ -6,6 +6,8 @@
 
 #include <pymodule.hxx>
 
+#include "pycallable.hxx"
+
 extern bool display_on;
 
 class pyModuleDisplay: public pyModuleBase {
@@ -16,6 +18,12 @@ public:
     pyModuleDisplay();
     ~pyModuleDisplay() {}
 
+    bool init(const char *import_name);
     bool show(const char *message);
     void status_summary();
+
+private:
+
+    pyCallable show_func;
+    pyCallable status_summary_func;
 };
@@ -4,30 +4,25 @@ pyModuleEventLog::pyModuleEventLog()
 {
 }
 
-bool pyModuleEventLog::log(const char *header, const char *message)
+bool pyModuleEventLog::init(const char *import_name)
 {
-    if (pModuleObj == NULL) {
-	printf("ERROR: events.init() failed\n");
-	return false;
-    }
-    PyObject *pFuncLog = PyObject_GetAttrString(pModuleObj, "log");
-    if ( pFuncLog == NULL || ! PyCallable_Check(pFuncLog) ) {
-	if ( PyErr_Occurred() ) PyErr_Print();
-	printf("ERROR: cannot find function 'log()'\n");
-	return false;
-    }
+    bool result = pyModuleBase::init(import_name);
+    log_func.bind(pModuleObj, "log", 2);
+    return result;
+}
 
-    // FIXME decref pFuncLog
-    
-    PyObject *pValue = PyObject_CallFunction(pFuncLog, (char *)"ss", header, message);
-    if (pValue != NULL) {
-	bool result = PyObject_IsTrue(pValue);
-	Py_DECREF(pValue);
-	return result;
+bool pyModuleEventLog::log(const char *header, const char *message)
+{
+    PyObject *args[2];
+    args[0] = PyUnicode_FromString(header);
+    args[1] = PyUnicode_FromString(message);
+    bool result = false;
+    if ( args[0] != NULL && args[1] != NULL ) {
+        result = log_func.call_bool(args);
     } else {
-	PyErr_Print();
-	printf("ERROR: call failed\n");
-	return false;
+        PyErr_Clear();
     }
-    return false;
+    Py_XDECREF(args[0]);
+    Py_XDECREF(args[1]);
+    return result;
 }
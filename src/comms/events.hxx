@@ -6,6 +6,8 @@
 
 #include <pymodule.hxx>
 
+#include "pycallable.hxx"
+
 class pyModuleEventLog: public pyModuleBase {
 
 public:
@@ -14,5 +16,10 @@ public:
     pyModuleEventLog();
     ~pyModuleEventLog() {}
 
+    bool init(const char *import_name);
     bool log(const char *header, const char *message);
+
+private:
+
+    pyCallable log_func;
 };
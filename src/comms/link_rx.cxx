@@ -0,0 +1,204 @@
+#include <errno.h>		// errno
+#include <stdio.h>		// printf() et. al.
+#include <string.h>		// strerror()
+#include <unistd.h>		// read()
+
+#include "util/timing.h"
+
+#include "packet_id.h"
+#include "link_rx.hxx"
+
+#define START_OF_MSG0 147
+#define START_OF_MSG1 224
+
+// commands arrive a few per second at most, anything beyond this is a
+// flood and the oldest entries are dropped
+static const unsigned int max_queue_len = 16;
+
+// bound the work done per frame even if the uart never runs dry
+static const int max_read_per_update = 2048;
+
+
+RemoteLinkRx::RemoteLinkRx():
+    fd(-1),
+    state(STATE_SYNC0),
+    pkt_id(0),
+    pkt_len(0),
+    counter(0),
+    cksum_A(0),
+    cksum_B(0),
+    cksum_lo(0),
+    last_sequence(-1),
+    bytes(0),
+    packets(0),
+    cksum_errors(0),
+    bad_commands(0),
+    duplicates(0),
+    queue_drops(0),
+    read_errors(0),
+    last_stats_time(0.0)
+{
+}
+
+
+void RemoteLinkRx::set_fd( int link_fd ) {
+    fd = link_fd;
+    rx_node = pyGetNode("/comms/remote_link/rx", true);
+}
+
+
+int RemoteLinkRx::update() {
+    if ( fd < 0 ) {
+        return 0;
+    }
+    unsigned int start_len = queue.size();
+    uint8_t buf[512];
+    int total = 0;
+    while ( total < max_read_per_update ) {
+        int len = read( fd, buf, sizeof(buf) );
+        if ( len > 0 ) {
+            parse( buf, len );
+            total += len;
+            if ( len < (int)sizeof(buf) ) {
+                // drained
+                break;
+            }
+        } else {
+            if ( len < 0 && errno != EAGAIN && errno != EWOULDBLOCK
+                 && errno != EINTR )
+            {
+                if ( read_errors == 0 ) {
+                    printf("remote link: read error - %s\n", strerror(errno));
+                }
+                read_errors++;
+            }
+            break;
+        }
+    }
+    int result = (int)queue.size() - (int)start_len;
+    return result > 0 ? result : 0;
+}
+
+
+void RemoteLinkRx::parse( const uint8_t *buf, int len ) {
+    bytes += len;
+    for ( int i = 0; i < len; i++ ) {
+        uint8_t c = buf[i];
+        switch ( state ) {
+        case STATE_SYNC0:
+            if ( c == START_OF_MSG0 ) {
+                state = STATE_SYNC1;
+            }
+            break;
+        case STATE_SYNC1:
+            if ( c == START_OF_MSG1 ) {
+                state = STATE_ID;
+            } else if ( c != START_OF_MSG0 ) {
+                state = STATE_SYNC0;
+            }
+            break;
+        case STATE_ID:
+            pkt_id = c;
+            cksum_A = c;
+            cksum_B = c;
+            state = STATE_LEN;
+            break;
+        case STATE_LEN:
+            pkt_len = c;
+            cksum_A += c;
+            cksum_B += cksum_A;
+            counter = 0;
+            state = pkt_len > 0 ? STATE_PAYLOAD : STATE_SYNC0;
+            break;
+        case STATE_PAYLOAD:
+            payload[counter++] = c;
+            cksum_A += c;
+            cksum_B += cksum_A;
+            if ( counter >= pkt_len ) {
+                state = STATE_CKSUM0;
+            }
+            break;
+        case STATE_CKSUM0:
+            cksum_lo = c;
+            state = STATE_CKSUM1;
+            break;
+        case STATE_CKSUM1:
+            if ( cksum_A == cksum_lo && cksum_B == c ) {
+                packets++;
+                process_packet();
+            } else {
+                cksum_errors++;
+            }
+            state = STATE_SYNC0;
+            break;
+        }
+    }
+}
+
+
+// validate a command packet (sequence, length, ascii text) and queue
+// it if it isn't a repeat of the last one
+void RemoteLinkRx::process_packet() {
+    if ( pkt_id != COMMAND_PACKET_V1 ) {
+        return;
+    }
+    if ( pkt_len < 2 || payload[1] != pkt_len - 2 ) {
+        bad_commands++;
+        return;
+    }
+    int sequence = payload[0];
+    int size = payload[1];
+    const char *text = (const char *)(payload + 2);
+    for ( int i = 0; i < size; i++ ) {
+        if ( text[i] < 32 || text[i] > 126 ) {
+            bad_commands++;
+            return;
+        }
+    }
+
+    // the ground station resends until it sees the sequence number
+    // echoed back, ignore the repeats
+    if ( sequence == last_sequence ) {
+        duplicates++;
+        return;
+    }
+    last_sequence = sequence;
+
+    if ( queue.size() >= max_queue_len ) {
+        queue.pop_front();
+        queue_drops++;
+    }
+    command_t cmd;
+    cmd.sequence = sequence;
+    cmd.message.assign( text, size );
+    queue.push_back(cmd);
+}
+
+
+bool RemoteLinkRx::pop( command_t *cmd ) {
+    if ( queue.empty() ) {
+        return false;
+    }
+    *cmd = queue.front();
+    queue.pop_front();
+    return true;
+}
+
+
+void RemoteLinkRx::publish_stats() {
+    if ( fd < 0 ) {
+        return;
+    }
+    double current_time = get_Time();
+    if ( current_time < last_stats_time + 1.0 ) {
+        return;
+    }
+    last_stats_time = current_time;
+    rx_node.setLong("bytes", bytes);
+    rx_node.setLong("packets", packets);
+    rx_node.setLong("cksum_errors", cksum_errors);
+    rx_node.setLong("bad_commands", bad_commands);
+    rx_node.setLong("duplicates", duplicates);
+    rx_node.setLong("queue_drops", queue_drops);
+    rx_node.setLong("read_errors", read_errors);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+// Native uplink receiver for the remote (ground station) link.
+//
+// Drains the uplink with bulk non-blocking reads, frames and
+// checksums packets in C++, and queues only fully validated, de-duped
+// commands for execution.  Nothing here ever waits on the uart, so
+// uplink traffic (or line noise) can't stall the control frame.
+
+#include <pyprops.hxx>
+
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+using std::deque;
+using std::string;
+
+class RemoteLinkRx {
+
+public:
+
+    struct command_t {
+        int sequence;
+        string message;
+    };
+
+    RemoteLinkRx();
+    ~RemoteLinkRx() {}
+
+    // share the (already open, non-blocking) link file descriptor
+    void set_fd( int fd );
+    inline bool is_open() { return fd >= 0; }
+
+    // read everything available and parse it, returns number of new
+    // commands queued
+    int update();
+
+    // feed raw bytes through the framing state machine
+    void parse( const uint8_t *buf, int len );
+
+    // pop the next validated command, false if none pending
+    bool pop( command_t *cmd );
+    inline int pending() { return queue.size(); }
+
+    // publish receive statistics (at most once per second)
+    void publish_stats();
+
+private:
+
+    enum parse_state {
+        STATE_SYNC0, STATE_SYNC1, STATE_ID, STATE_LEN, STATE_PAYLOAD,
+        STATE_CKSUM0, STATE_CKSUM1
+    };
+
+    int fd;
+
+    parse_state state;
+    uint8_t pkt_id;
+    uint8_t pkt_len;
+    uint8_t payload[256];
+    int counter;
+    uint8_t cksum_A, cksum_B;
+    uint8_t cksum_lo;
+
+    deque<command_t> queue;
+    int last_sequence;
+
+    uint32_t bytes;
+    uint32_t packets;
+    uint32_t cksum_errors;
+    uint32_t bad_commands;
+    uint32_t duplicates;
+    uint32_t queue_drops;
+    uint32_t read_errors;
+    double last_stats_time;
+    pyPropertyNode rx_node;
+
+    void process_packet();
+};
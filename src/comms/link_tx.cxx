@@ -0,0 +1,473 @@
+#include <errno.h>		// errno
+#include <fcntl.h>		// open()
+#include <stdio.h>		// printf() et. al.
+#include <string.h>		// memcpy(), strerror()
+#include <termios.h>		// tcgetattr() et. al.
+#include <unistd.h>		// write()
+
+#include "util/timing.h"
+
+#include "packet_id.h"
+#include "link_tx.hxx"
+
+#define START_OF_MSG0 147
+#define START_OF_MSG1 224
+
+// oldest a pending message may get before it is sent ahead of higher
+// priority traffic (keeps low priority types from starving)
+static const double max_age_sec = 1.0;
+
+static const int max_fifo_len = 16;
+
+
+// map a numeric baud rate to the termios speed constant
+static speed_t baud_bits( int baud ) {
+    switch ( baud ) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 500000: return B500000;
+    case 921600: return B921600;
+    default:
+        printf("remote link: unsupported baud rate = %d, using 115200\n", baud);
+        return B115200;
+    }
+}
+
+
+RemoteLinkTx::RemoteLinkTx():
+    fd(-1),
+    rate(0.0),
+    burst(0.0),
+    tokens(0.0),
+    last_time(0.0),
+    last_stats_time(0.0),
+    partial_size(0),
+    delta_encoding(false),
+    write_errors(0),
+    eagain_count(0),
+    total_bytes(0),
+    last_total_bytes(0)
+{
+    for ( int i = 0; i < 256; i++ ) {
+        type_map[i] = -1;
+    }
+}
+
+RemoteLinkTx::~RemoteLinkTx() {
+    close();
+}
+
+
+int RemoteLinkTx::add_type( const char *name, int priority, bool latest_value )
+{
+    message_type t;
+    t.name = name;
+    t.priority = priority;
+    t.latest_value = latest_value;
+    t.rr_next = 0;
+    t.sent = 0;
+    t.replaced = 0;
+    t.dropped = 0;
+    t.last_sent = 0;
+    t.bytes = 0;
+
+    // allow the default priority to be changed from the config
+    pyPropertyNode prio_node = pyGetNode("/config/remote_link/priority", true);
+    if ( prio_node.hasChild(name) ) {
+        t.priority = prio_node.getLong(name);
+    }
+    string path = "/comms/remote_link/tx/" + t.name;
+    t.node = pyGetNode(path, true);
+
+    types.push_back(t);
+    return types.size() - 1;
+}
+
+
+void RemoteLinkTx::map_id( int packet_id, int type_index ) {
+    type_map[packet_id & 0xff] = type_index;
+}
+
+
+bool RemoteLinkTx::open( const char *device, int baud,
+                         double link_bytes_per_sec )
+{
+    fd = ::open( device, O_RDWR | O_NOCTTY | O_NONBLOCK );
+    if ( fd < 0 ) {
+        fprintf( stderr, "remote link: unable to open %s - %s\n",
+                 device, strerror(errno) );
+	return false;
+    }
+
+    struct termios config;
+    memset(&config, 0, sizeof(config));
+    speed_t bits = baud_bits( baud );
+    config.c_cflag = bits | CS8 | CLOCAL | CREAD;
+    config.c_iflag = IGNPAR;
+    config.c_oflag = 0;
+    config.c_lflag = 0;
+    config.c_cc[VTIME] = 0;
+    config.c_cc[VMIN] = 0;
+    cfsetispeed( &config, bits );
+    cfsetospeed( &config, bits );
+    if ( tcsetattr( fd, TCSANOW, &config ) < 0 ) {
+        fprintf( stderr, "remote link: error configuring %s - %s\n",
+                 device, strerror(errno) );
+    }
+
+    // 10 bits on the wire per byte (8n1)
+    rate = link_bytes_per_sec > 0.0 ? link_bytes_per_sec : baud / 10.0;
+    burst = rate * 0.1;
+    if ( burst < 2 * MAX_PACKET ) {
+        burst = 2 * MAX_PACKET;
+    }
+    tokens = 0.0;
+    last_time = get_Time();
+    last_stats_time = last_time;
+
+    tx_node = pyGetNode("/comms/remote_link/tx", true);
+    tx_node.setDouble("link_bytes_per_sec", rate);
+
+    // message types, ordered by default priority
+    types.clear();
+    int t;
+    t = add_type("event", 0, false);
+    map_id(EVENT_PACKET_V1, t);
+    t = add_type("ap", 1, true);
+    map_id(AP_STATUS_PACKET_V4, t);
+    map_id(AP_STATUS_PACKET_V5, t);
+    map_id(AP_STATUS_PACKET_V6, t);
+    map_id(AP_STATUS_PACKET_V7, t);
+    t = add_type("filter", 1, true);
+    map_id(FILTER_PACKET_V1, t);
+    map_id(FILTER_PACKET_V2, t);
+    map_id(FILTER_PACKET_V3, t);
+    map_id(FILTER_PACKET_V4, t);
+    t = add_type("gps", 2, true);
+    map_id(GPS_PACKET_V1, t);
+    map_id(GPS_PACKET_V2, t);
+    map_id(GPS_PACKET_V3, t);
+    map_id(GPS_PACKET_V4, t);
+    t = add_type("airdata", 2, true);
+    map_id(AIRDATA_PACKET_V3, t);
+    map_id(AIRDATA_PACKET_V4, t);
+    map_id(AIRDATA_PACKET_V5, t);
+    map_id(AIRDATA_PACKET_V6, t);
+    t = add_type("health", 2, true);
+    map_id(SYSTEM_HEALTH_PACKET_V2, t);
+    map_id(SYSTEM_HEALTH_PACKET_V3, t);
+    map_id(SYSTEM_HEALTH_PACKET_V4, t);
+    map_id(SYSTEM_HEALTH_PACKET_V5, t);
+    map_id(SYSTEM_HEALTH_PACKET_V6, t);
+    t = add_type("act", 3, true);
+    map_id(ACTUATOR_PACKET_V1, t);
+    map_id(ACTUATOR_PACKET_V2, t);
+    map_id(ACTUATOR_PACKET_V3, t);
+    t = add_type("pilot", 3, true);
+    map_id(PILOT_INPUT_PACKET_V1, t);
+    map_id(PILOT_INPUT_PACKET_V2, t);
+    map_id(PILOT_INPUT_PACKET_V3, t);
+    t = add_type("imu", 3, true);
+    map_id(IMU_PACKET_V1, t);
+    map_id(IMU_PACKET_V2, t);
+    map_id(IMU_PACKET_V3, t);
+    map_id(IMU_PACKET_V4, t);
+    t = add_type("payload", 3, true);
+    map_id(PAYLOAD_PACKET_V1, t);
+    map_id(PAYLOAD_PACKET_V2, t);
+    map_id(PAYLOAD_PACKET_V3, t);
+    t = add_type("raven", 3, true);
+    map_id(RAVEN_PACKET_V1, t);
+    // anything else goes out in order with the events
+
+    printf("remote link: native transmitter on %s, %.0f bytes/sec\n",
+           device, rate);
+
+    return true;
+}
+
+
+void RemoteLinkTx::set_delta_encoding( double keyframe_sec,
+                                       int keyframe_count )
+{
+    delta_encoding = true;
+    codec.set_keyframe_interval( keyframe_sec, keyframe_count );
+    printf("remote link: delta telemetry encoding, keyframe every %.1f sec / %d packets\n",
+           keyframe_sec, keyframe_count);
+}
+
+
+void RemoteLinkTx::close() {
+    if ( fd >= 0 ) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+
+bool RemoteLinkTx::send_message( const uint8_t *buf, int size ) {
+    if ( fd < 0 || size < 6 || size > MAX_PACKET ) {
+        return false;
+    }
+
+    int id = buf[2];
+    int type_index = type_map[id];
+    if ( type_index < 0 ) {
+        type_index = 0;         // "event" / in order traffic
+    }
+    message_type &t = types[type_index];
+    double now = get_Time();
+
+    if ( t.latest_value ) {
+        // current packet formats lead the payload with the sensor index
+        unsigned int index = buf[4];
+        if ( index >= t.slots.size() ) {
+            message_slot empty;
+            empty.size = 0;
+            empty.pending = false;
+            empty.queued_time = 0.0;
+            t.slots.resize(index + 1, empty);
+        }
+        message_slot &slot = t.slots[index];
+        if ( slot.pending ) {
+            // a newer sample supersedes the one still waiting
+            t.replaced++;
+        } else {
+            slot.queued_time = now;
+        }
+        memcpy( slot.data, buf, size );
+        slot.size = size;
+        slot.pending = true;
+    } else {
+        if ( (int)t.fifo.size() >= max_fifo_len ) {
+            t.dropped++;
+            return false;
+        }
+        t.fifo.push_back( vector<uint8_t>(buf, buf + size) );
+    }
+
+    return true;
+}
+
+
+void RemoteLinkTx::send_packets( const uint8_t *buf, int len ) {
+    int i = 0;
+    while ( i + 6 <= len ) {
+        if ( buf[i] != START_OF_MSG0 || buf[i+1] != START_OF_MSG1 ) {
+            i++;
+            continue;
+        }
+        int size = buf[i+3] + 6;
+        if ( i + size > len ) {
+            break;
+        }
+        send_message( buf + i, size );
+        i += size;
+    }
+}
+
+
+// pick the next message to send: anything that has waited longer than
+// max_age_sec first, then by priority, then oldest first.
+bool RemoteLinkTx::next_message( double max_size, const uint8_t **data,
+                                 int *size, int *type_index )
+{
+    double now = get_Time();
+    int best_type = -1;
+    int best_slot = -1;
+    bool best_starved = false;
+    int best_prio = 0;
+    double best_time = 0.0;
+
+    for ( unsigned int i = 0; i < types.size(); i++ ) {
+        message_type &t = types[i];
+        if ( !t.latest_value ) {
+            if ( t.fifo.empty() ) {
+                continue;
+            }
+            // in order traffic always goes at its own priority
+            if ( best_type < 0 || (!best_starved && t.priority < best_prio) ) {
+                best_type = i;
+                best_slot = -1;
+                best_starved = false;
+                best_prio = t.priority;
+                best_time = 0.0;
+            }
+            continue;
+        }
+        unsigned int n = t.slots.size();
+        for ( unsigned int k = 0; k < n; k++ ) {
+            unsigned int j = (t.rr_next + k) % n;
+            message_slot &slot = t.slots[j];
+            if ( !slot.pending ) {
+                continue;
+            }
+            bool starved = now - slot.queued_time > max_age_sec;
+            bool better = false;
+            if ( best_type < 0 ) {
+                better = true;
+            } else if ( starved != best_starved ) {
+                better = starved;
+            } else if ( !starved && t.priority != best_prio ) {
+                better = t.priority < best_prio;
+            } else {
+                better = slot.queued_time < best_time;
+            }
+            if ( better ) {
+                best_type = i;
+                best_slot = j;
+                best_starved = starved;
+                best_prio = t.priority;
+                best_time = slot.queued_time;
+            }
+        }
+    }
+
+    if ( best_type < 0 ) {
+        return false;
+    }
+
+    message_type &t = types[best_type];
+    if ( best_slot < 0 ) {
+        vector<uint8_t> &msg = t.fifo.front();
+        if ( msg.size() > max_size ) {
+            return false;
+        }
+        *data = msg.data();
+        *size = msg.size();
+    } else {
+        message_slot &slot = t.slots[best_slot];
+        if ( slot.size > max_size ) {
+            return false;
+        }
+        *data = slot.data;
+        *size = slot.size;
+        slot.pending = false;
+        t.rr_next = (best_slot + 1) % t.slots.size();
+    }
+    *type_index = best_type;
+    return true;
+}
+
+
+void RemoteLinkTx::flush() {
+    if ( fd < 0 ) {
+        return;
+    }
+
+    double now = get_Time();
+    tokens += rate * (now - last_time);
+    if ( tokens > burst ) {
+        tokens = burst;
+    }
+    last_time = now;
+
+    // assemble the bytes that go out this time: any unfinished
+    // packet first, then whole messages as the budget allows
+    uint8_t stage[sizeof(partial)];
+    int used = 0;
+    if ( partial_size > 0 ) {
+        memcpy( stage, partial, partial_size );
+        used = partial_size;
+        partial_size = 0;
+    }
+    double budget = tokens;
+    if ( budget > sizeof(stage) ) {
+        budget = sizeof(stage);
+    }
+    const uint8_t *data;
+    int size;
+    int type_index;
+    // an encoded packet can be a little larger than the original
+    int margin = delta_encoding ? TelemetryCodec::MAX_GROWTH : 0;
+    uint8_t coded[MAX_PACKET + TelemetryCodec::MAX_GROWTH];
+    while ( next_message( budget - used - margin, &data, &size, &type_index ) ) {
+        if ( delta_encoding ) {
+            // encode at send time so the reference state is what
+            // actually went out on the link
+            size = codec.encode( data, size, now, coded );
+            data = coded;
+        }
+        memcpy( stage + used, data, size );
+        used += size;
+        message_type &t = types[type_index];
+        t.sent++;
+        t.bytes += size;
+        if ( !t.latest_value ) {
+            t.fifo.pop_front();
+        }
+    }
+    if ( used == 0 ) {
+        return;
+    }
+
+    // only write what the token bucket allows, hold the rest
+    int write_len = used;
+    if ( write_len > (int)tokens ) {
+        write_len = (int)tokens;
+    }
+    int len = 0;
+    if ( write_len > 0 ) {
+        len = ::write( fd, stage, write_len );
+        if ( len < 0 ) {
+            if ( errno == EAGAIN || errno == EWOULDBLOCK ) {
+                eagain_count++;
+            } else {
+                write_errors++;
+            }
+            len = 0;
+        }
+    }
+    tokens -= len;
+    total_bytes += len;
+
+    // keep the committed remainder so packets are never interleaved
+    int remain = used - len;
+    if ( remain > 0 ) {
+        memcpy( partial, stage + len, remain );
+    }
+    partial_size = remain;
+}
+
+
+void RemoteLinkTx::publish_stats() {
+    if ( fd < 0 ) {
+        return;
+    }
+
+    double now = get_Time();
+    double dt = now - last_stats_time;
+    if ( dt < 1.0 ) {
+        return;
+    }
+    last_stats_time = now;
+
+    for ( unsigned int i = 0; i < types.size(); i++ ) {
+        message_type &t = types[i];
+        t.node.setLong("sent", t.sent);
+        t.node.setLong("replaced", t.replaced);
+        t.node.setLong("dropped", t.dropped);
+        t.node.setLong("bytes", t.bytes);
+        t.node.setLong("priority", t.priority);
+        t.node.setDouble("rate_hz", (t.sent - t.last_sent) / dt);
+        t.last_sent = t.sent;
+    }
+    tx_node.setDouble("bytes_per_sec", (total_bytes - last_total_bytes) / dt);
+    last_total_bytes = total_bytes;
+    tx_node.setLong("eagain", eagain_count);
+    tx_node.setLong("write_errors", write_errors);
+    tx_node.setLong("pending_bytes", partial_size);
+    if ( delta_encoding ) {
+        tx_node.setLong("keyframes", codec.keyframes);
+        tx_node.setLong("deltas", codec.deltas);
+        if ( codec.bytes_out > 0 ) {
+            tx_node.setDouble("compression_ratio",
+                              (double)codec.bytes_in / codec.bytes_out);
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+// Native telemetry transmitter for the remote (ground station) link.
+//
+// Outbound packets are sorted into per message type slots.  Periodic
+// state packets use latest-value semantics: a newer packet of the
+// same type (and sensor index) replaces a stale one that hasn't gone
+// out yet, so the link always carries the freshest state rather than
+// a backlog.  Event style packets (command replies, log events) are
+// queued in order.  Output is paced by a token bucket sized to the
+// real link byte rate and staged into a single non-blocking write()
+// per flush.
+
+#include <pyprops.hxx>
+
+#include "telemetry_codec.hxx"
+
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+using std::deque;
+using std::string;
+using std::vector;
+
+class RemoteLinkTx {
+
+public:
+
+    RemoteLinkTx();
+    ~RemoteLinkTx();
+
+    // open and configure the output device.  link_bytes_per_sec is
+    // the sustained radio throughput (0 = derive from baud.)
+    bool open( const char *device, int baud, double link_bytes_per_sec );
+    void close();
+    inline bool is_open() { return fd >= 0; }
+    inline int get_fd() { return fd; }
+
+    // send state packets delta encoded (see telemetry_codec.hxx)
+    void set_delta_encoding( double keyframe_sec, int keyframe_count );
+
+    // queue one complete, wrapped packet (sync, id, len, payload, cksum)
+    bool send_message( const uint8_t *buf, int size );
+
+    // queue a byte stream of back to back wrapped packets
+    void send_packets( const uint8_t *buf, int len );
+
+    // write as much queued data as the token bucket allows
+    void flush();
+
+    // publish per message type statistics
+    void publish_stats();
+
+private:
+
+    // max wrapped packet size: 2 sync + id + len + 255 + 2 cksum
+    static const int MAX_PACKET = 261;
+
+    struct message_slot {
+        uint8_t data[MAX_PACKET];
+        int size;
+        bool pending;
+        double queued_time;
+    };
+
+    struct message_type {
+        string name;
+        int priority;           // 0 = highest
+        bool latest_value;      // replace stale vs. queue in order
+        vector<message_slot> slots; // per sensor index (latest value)
+        deque< vector<uint8_t> > fifo; // in order messages
+        unsigned int rr_next;   // round robin position in slots
+        // statistics
+        uint32_t sent;
+        uint32_t replaced;
+        uint32_t dropped;
+        uint32_t last_sent;
+        uint64_t bytes;
+        pyPropertyNode node;
+    };
+
+    int fd;
+    double rate;                // bytes per second
+    double burst;               // token bucket depth (bytes)
+    double tokens;
+    double last_time;
+    double last_stats_time;
+
+    vector<message_type> types;
+    int type_map[256];          // packet id -> types[] index
+
+    // committed bytes (possibly a partial packet) that must go out
+    // before anything new
+    uint8_t partial[4 * MAX_PACKET];
+    int partial_size;
+
+    bool delta_encoding;
+    TelemetryCodec codec;
+
+    uint32_t write_errors;
+    uint32_t eagain_count;
+    uint64_t total_bytes;
+    uint64_t last_total_bytes;
+    pyPropertyNode tx_node;
+
+    int add_type( const char *name, int priority, bool latest_value );
+    void map_id( int packet_id, int type_index );
+    bool next_message( double max_size, const uint8_t **data, int *size,
+                       int *type_index );
+};
@@ -1,112 +1,124 @@
 #include <pyprops.hxx>
 #include "util/sg_path.hxx"
+#include "util/timing.h"
 
 #include "logging.hxx"
 
 
-pyModuleLogging::pyModuleLogging()
+pyModuleLogging::pyModuleLogging():
+    last_stats_time(0.0)
 {
 }
 
-bool pyModuleLogging::open(const char *path)
+bool pyModuleLogging::init(const char *import_name)
 {
-    if (pModuleObj == NULL) {
-	printf("ERROR: events.init() failed\n");
-	return false;
+    bool result = pyModuleBase::init(import_name);
+    open_func.bind(pModuleObj, "open", 1);
+    open_data_func.bind(pModuleObj, "open_data", 0);
+    update_func.bind(pModuleObj, "update", 0);
+    log_message_func.bind(pModuleObj, "log_message", 1);
+    write_configs_func.bind(pModuleObj, "write_configs", 0);
+    close_func.bind(pModuleObj, "close", 0);
+
+    // the python module has created the flight directory by now
+    pyPropertyNode logging_node = pyGetNode( "/config/logging", true );
+    string flight_dir = logging_node.getString("flight_dir");
+    status_node = pyGetNode( "/status/logging", true );
+
+    // crash safe segments replace the python flight.dat.gz stream
+    if ( logging_node.getBool("segments") && flight_dir != "" ) {
+        double segment_mb = 16.0;
+        if ( logging_node.hasChild("segment_mb") ) {
+            segment_mb = logging_node.getDouble("segment_mb");
+        }
+        double flush_sec = 1.0;
+        if ( logging_node.hasChild("flush_sec") ) {
+            flush_sec = logging_node.getDouble("flush_sec");
+        }
+        if ( segments.open( flight_dir.c_str(), segment_mb * 1024 * 1024,
+                            64 * 1024, flush_sec,
+                            logging_node.getBool("direct_io") ) )
+        {
+            printf("segment log: %s/flight-NNNN.seg\n", flight_dir.c_str());
+        } else {
+            printf("segment log failed, falling back to flight.dat.gz\n");
+        }
     }
-    PyObject *pFuncOpen = PyObject_GetAttrString(pModuleObj, "open");
-    if ( pFuncOpen == NULL || ! PyCallable_Check(pFuncOpen) ) {
-	if ( PyErr_Occurred() ) PyErr_Print();
-	printf("ERROR: cannot find function 'open()'\n");
-	return false;
+    status_node.setBool("segments_open", segments.is_open());
+    open_data_func.call_bool(NULL);
+
+    if ( logging_node.getBool("columnar") && flight_dir != "" ) {
+        SGPath file = flight_dir;
+        file.append( "flight.alc" );
+        int chunk_rows = 4096;
+        if ( logging_node.hasChild("chunk_rows") ) {
+            chunk_rows = logging_node.getLong("chunk_rows");
+        }
+        if ( columns.open( file.c_str(), chunk_rows, true ) ) {
+            printf("columnar log: %s\n", file.c_str());
+        }
     }
+    return result;
+}
 
-    // FIXME decref pFuncOpen
-    
-    PyObject *pValue = PyObject_CallFunction(pFuncOpen, (char *)"s", path);
-    if (pValue != NULL) {
-	bool result = PyObject_IsTrue(pValue);
-	Py_DECREF(pValue);
-	return result;
-    } else {
-	PyErr_Print();
-	printf("ERROR: call failed\n");
-	return false;
+bool pyModuleLogging::open(const char *path)
+{
+    PyObject *pPath = PyUnicode_FromString(path);
+    if ( pPath == NULL ) {
+        PyErr_Clear();
+        return false;
     }
-    return false;
+    bool result = open_func.call_bool(&pPath);
+    Py_DECREF(pPath);
+    return result;
 }
 
 void pyModuleLogging::update() {
-    if (pModuleObj == NULL) {
-	printf("ERROR: import logging module failed\n");
-	return;
-    }
-    PyObject *pFuncLog = PyObject_GetAttrString(pModuleObj, "update");
-    if ( pFuncLog == NULL || ! PyCallable_Check(pFuncLog) ) {
-	if ( PyErr_Occurred() ) PyErr_Print();
-	printf("ERROR: cannot find function 'update_configs()'\n");
-	return;
-    }
-    PyObject *pResult = PyObject_CallFunction(pFuncLog, NULL);
-    if (pResult != NULL) {
-	Py_DECREF(pResult);
-	return;
-    } else {
-	PyErr_Print();
-	printf("ERROR: call failed\n");
-	return;
+    update_func.call_void(NULL);
+
+    if ( segments.is_open() ) {
+        segments.update();
+        double now = get_Time();
+        if ( now >= last_stats_time + 1.0 ) {
+            last_stats_time = now;
+            status_node.setLong("segment", segments.segment);
+            status_node.setLong("blocks_written", segments.blocks_written);
+            status_node.setLong("bytes_written", segments.bytes_written);
+            status_node.setLong("queued_blocks", segments.queued());
+            status_node.setLong("dropped_blocks", segments.dropped_blocks);
+            status_node.setLong("write_errors", segments.write_errors);
+            status_node.setDouble("max_write_ms",
+                                  segments.max_write_usec / 1000.0);
+        }
     }
 }
 
 
-// FIXME: close log file!
 bool pyModuleLogging::close()
 {
-    return true;
+    segments.close();
+    columns.close();
+    return close_func.call_bool(NULL);
 }
 
 void pyModuleLogging::log_message( uint8_t *buf, int size ) {
-    if (pModuleObj == NULL) {
-	printf("ERROR: import logging module failed\n");
-	return;
+    if ( segments.is_open() ) {
+        segments.write( buf, size );
     }
-    PyObject *pFuncLog = PyObject_GetAttrString(pModuleObj, "log_message");
-    if ( pFuncLog == NULL || ! PyCallable_Check(pFuncLog) ) {
-	if ( PyErr_Occurred() ) PyErr_Print();
-	printf("ERROR: cannot find function 'log_message()'\n");
-	return;
+    if ( columns.is_open() ) {
+        columns.log_packet( buf, size );
     }
-    PyObject *pResult = PyObject_CallFunction(pFuncLog, (char *)"y#", buf, size);
-    if (pResult != NULL) {
-	Py_DECREF(pResult);
-	return;
-    } else {
-	PyErr_Print();
-	printf("ERROR: call failed\n");
-	return;
+    PyObject *pBuf = PyBytes_FromStringAndSize((const char *)buf, size);
+    if ( pBuf == NULL ) {
+        PyErr_Clear();
+        return;
     }
+    log_message_func.call_void(&pBuf);
+    Py_DECREF(pBuf);
 }
 
 void pyModuleLogging::write_configs() {
-    if (pModuleObj == NULL) {
-	printf("ERROR: import logging module failed\n");
-	return;
-    }
-    PyObject *pFuncLog = PyObject_GetAttrString(pModuleObj, "write_configs");
-    if ( pFuncLog == NULL || ! PyCallable_Check(pFuncLog) ) {
-	if ( PyErr_Occurred() ) PyErr_Print();
-	printf("ERROR: cannot find function 'write_configs()'\n");
-	return;
-    }
-    PyObject *pResult = PyObject_CallFunction(pFuncLog, NULL);
-    if (pResult != NULL) {
-	Py_DECREF(pResult);
-	return;
-    } else {
-	PyErr_Print();
-	printf("ERROR: call failed\n");
-	return;
-    }
+    write_configs_func.call_void(NULL);
 }
 
 
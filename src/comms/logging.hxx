@@ -8,6 +8,10 @@
 
 #include <pymodule.hxx>
 
+#include "columnlog.hxx"
+#include "pycallable.hxx"
+#include "seglog.hxx"
+
 class pyModuleLogging: public pyModuleBase {
 
 public:
@@ -16,6 +20,7 @@ public:
     pyModuleLogging();
     ~pyModuleLogging() {}
 
+    bool init(const char *import_name);
     bool open(const char *path);
     void update();
     bool close();
@@ -23,6 +28,23 @@ public:
     void log_message( uint8_t *buf, int size );
 
     void write_configs();
+
+private:
+
+    pyCallable open_func;
+    pyCallable open_data_func;
+    pyCallable update_func;
+    pyCallable log_message_func;
+    pyCallable write_configs_func;
+    pyCallable close_func;
+
+    // crash safe flight-NNNN.seg files (instead of flight.dat.gz)
+    SegmentLog segments;
+    pyPropertyNode status_node;
+    double last_stats_time;
+
+    // optional columnar copy of the flight log (flight.alc)
+    ColumnLogWriter columns;
 };
 
 // sort of a hack for now, but pure C let's me pass in a property node
@@ -68,6 +68,20 @@ def init_file_logging():
         print('Error creating:', flight_dir)
         return False
 
+    return True
+
+# open the flight data stream.  Called from the native side once it
+# has tried to open the segment logger (/status/logging/segments_open),
+# the gzip stream is only written when that didn't happen.
+def open_data():
+    global enable_file
+    global fdata
+
+    if flight_dir == '' or fdata != None:
+        return False
+    if getNode('/status/logging', True).getBool('segments_open'):
+        return True
+
     # open the logging files
     file = os.path.join(flight_dir, 'flight.dat.gz')
     try:
@@ -76,6 +90,7 @@ def init_file_logging():
         print('Cannot open:', file)
         return False
 
+    enable_file = True
     return True
 
 def init_udp_logging():
@@ -101,8 +116,7 @@ def init():
     udp_port = logging_node.getInt('port')
     
     if log_path != '':
-        if init_file_logging():
-            enable_file = True      # success
+        init_file_logging()
         # fixme:
         # events->open(flight_dir.c_str())
         # events->log("Log", "Start")
@@ -112,8 +126,11 @@ def init():
     return True
 
 def close():
+    global enable_file
     # close files
-    fdata.close()
+    enable_file = False
+    if fdata != None:
+        fdata.close()
     return True
 
 def log_queue( data ):
@@ -2,77 +2,105 @@
 
 #include <string.h>		// memcpy()
 
+// python pack functions in the same order as the pack_id enum
+static const char *pack_names[] = {
+    "pack_gps_bin",
+    "pack_imu_bin",
+    "pack_airdata_bin",
+    "pack_system_health_bin",
+    "pack_pilot_bin",
+    "pack_act_bin",
+    "pack_filter_bin",
+    "pack_payload_bin",
+    "pack_ap_status_bin",
+    "pack_raven_bin"
+};
+
 pyModulePacker::pyModulePacker()
 {
 }
 
-int pyModulePacker::pack(int index, const char *pack_function, uint8_t *buf) {
-    if (pModuleObj == NULL) {
-	printf("ERROR: import packer failed\n");
-	return 0;
+bool pyModulePacker::init(const char *import_name)
+{
+    bool result = pyModuleBase::init(import_name);
+    for ( int i = 0; i < NUM_PACK_FUNCS; i++ ) {
+        pack_funcs[i].bind(pModuleObj, pack_names[i], 1);
     }
-    PyObject *pFuncLog = PyObject_GetAttrString(pModuleObj, pack_function);
-    if ( pFuncLog == NULL || ! PyCallable_Check(pFuncLog) ) {
-	if ( PyErr_Occurred() ) PyErr_Print();
-	printf("ERROR: cannot find function '%s()'\n", pack_function);
-	return 0;
+    return result;
+}
+
+int pyModulePacker::pack(int index, pyCallable *func, uint8_t *buf) {
+    PyObject *pIndex = PyLong_FromLong(index);
+    if ( pIndex == NULL ) {
+        PyErr_Clear();
+        return 0;
     }
-    PyObject *pResult = PyObject_CallFunction(pFuncLog, (char *)"i", index);
-    if (pResult != NULL) {
-        const char *ptr = PyByteArray_AsString(pResult);
-        Py_ssize_t len = PyByteArray_Size(pResult);
-        if ( ptr != NULL ) {
-            memcpy((char *)buf, ptr, len);
-        } else {
-            PyErr_Print();
-            printf("ERROR: call failed\n");
-        }
-	Py_DECREF(pResult);
-	return len;
+    PyObject *pResult = func->call(&pIndex);
+    Py_DECREF(pIndex);
+    if ( pResult == NULL ) {
+        return 0;
+    }
+    int len = 0;
+    const char *ptr = PyByteArray_AsString(pResult);
+    if ( ptr != NULL ) {
+        len = PyByteArray_Size(pResult);
+        memcpy((char *)buf, ptr, len);
     } else {
-	PyErr_Print();
-	printf("ERROR: call failed\n");
-	return 0;
+        PyErr_Clear();
+        pyCallable::total_errors++;
+    }
+    Py_DECREF(pResult);
+    return len;
+}
+
+// slow path for pack functions not in the bound table
+int pyModulePacker::pack(int index, const char *pack_function, uint8_t *buf) {
+    for ( int i = 0; i < NUM_PACK_FUNCS; i++ ) {
+        if ( strcmp(pack_function, pack_names[i]) == 0 ) {
+            return pack(index, &pack_funcs[i], buf);
+        }
     }
-    return 0;
+    pyCallable func;
+    func.bind(pModuleObj, pack_function, 1);
+    return pack(index, &func, buf);
 }
 
 int pyModulePacker::pack_gps(int index, uint8_t *buf) {
-    return pack(index, "pack_gps_bin", buf);
+    return pack(index, &pack_funcs[PACK_GPS], buf);
 }
 
 int pyModulePacker::pack_imu(int index, uint8_t *buf) {
-    return pack(index, "pack_imu_bin", buf);
+    return pack(index, &pack_funcs[PACK_IMU], buf);
 }
 
 int pyModulePacker::pack_airdata(int index, uint8_t *buf) {
-    return pack(index, "pack_airdata_bin", buf);
+    return pack(index, &pack_funcs[PACK_AIRDATA], buf);
 }
 
 int pyModulePacker::pack_health(int index, uint8_t *buf) {
-    return pack(index, "pack_system_health_bin", buf);
+    return pack(index, &pack_funcs[PACK_HEALTH], buf);
 }
 
 int pyModulePacker::pack_pilot(int index, uint8_t *buf) {
-    return pack(index, "pack_pilot_bin", buf);
+    return pack(index, &pack_funcs[PACK_PILOT], buf);
 }
 
 int pyModulePacker::pack_actuator(int index, uint8_t *buf) {
-    return pack(index, "pack_act_bin", buf);
+    return pack(index, &pack_funcs[PACK_ACTUATOR], buf);
 }
 
 int pyModulePacker::pack_filter(int index, uint8_t *buf) {
-    return pack(index, "pack_filter_bin", buf);
+    return pack(index, &pack_funcs[PACK_FILTER], buf);
 }
 
 int pyModulePacker::pack_payload(int index, uint8_t *buf) {
-    return pack(index, "pack_payload_bin", buf);
+    return pack(index, &pack_funcs[PACK_PAYLOAD], buf);
 }
 
 int pyModulePacker::pack_ap(int index, uint8_t *buf) {
-    return pack(index, "pack_ap_status_bin", buf);
+    return pack(index, &pack_funcs[PACK_AP], buf);
 }
 
 int pyModulePacker::pack_raven(int index, uint8_t *buf) {
-    return pack(index, "pack_raven_bin", buf);
+    return pack(index, &pack_funcs[PACK_RAVEN], buf);
 }
@@ -7,6 +7,8 @@
 #include <pymodule.hxx>
 #include <pyprops.hxx>
 
+#include "pycallable.hxx"
+
 class pyModulePacker: public pyModuleBase {
 
 public:
@@ -15,6 +17,7 @@ public:
     pyModulePacker();
     ~pyModulePacker() {}
 
+    bool init(const char *import_name);
     int pack(int index, const char *pack_function, uint8_t *buf);
     int pack_gps(int index, uint8_t *buf);
     int pack_imu(int index, uint8_t *buf);
@@ -26,4 +29,23 @@ public:
     int pack_payload(int index, uint8_t *buf);
     int pack_ap(int index, uint8_t *buf);
     int pack_raven(int index, uint8_t *buf);
+
+private:
+
+    enum pack_id {
+        PACK_GPS = 0,
+        PACK_IMU,
+        PACK_AIRDATA,
+        PACK_HEALTH,
+        PACK_PILOT,
+        PACK_ACTUATOR,
+        PACK_FILTER,
+        PACK_PAYLOAD,
+        PACK_AP,
+        PACK_RAVEN,
+        NUM_PACK_FUNCS
+    };
+    pyCallable pack_funcs[NUM_PACK_FUNCS];
+
+    int pack(int index, pyCallable *func, uint8_t *buf);
 };
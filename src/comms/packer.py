@@ -85,6 +85,8 @@ system_health_v2_fmt = "<dHHHHH"
 system_health_v3_fmt = "<dHHHHHH"
 system_health_v4_fmt = "<BdHHHHHH"
 system_health_v5_fmt = "<BfHHHHHH"
+system_health_v6_fmt = "<BfHHHHHHHHHHHHHH"
+vibe_node = getNode("/status/vibration", True)
 
 payload_node = getNode("/payload", True)
 payload_v1_fmt = "<dH"
@@ -1208,7 +1210,7 @@ def pack_system_health_bin(index):
     dekamah = int(power_node.getFloat("total_mah") / 10)
     if dekamah < 0: dekamah = 0 # prevent overflowing the structure
     if dekamah > 65535: dekamah = 65535 # prevent overflowing the structure
-    buf = struct.pack(system_health_v5_fmt,
+    buf = struct.pack(system_health_v6_fmt,
                       index,
                       status_node.getFloat('frame_time'),
                       int(status_node.getFloat("system_load_avg") * 100),
@@ -1216,8 +1218,23 @@ def pack_system_health_bin(index):
                       int(power_node.getFloat("main_vcc") * 1000),
                       int(power_node.getFloat("cell_vcc") * 1000),
                       int(power_node.getFloat("main_amps") * 1000),
-                      dekamah)
-    return wrap_packet(SYSTEM_HEALTH_PACKET_V5, buf)
+                      dekamah,
+                      vibe_uint16(vibe_node.getFloatEnum("accel_band_rms", 0) * 1000),
+                      vibe_uint16(vibe_node.getFloatEnum("accel_band_rms", 1) * 1000),
+                      vibe_uint16(vibe_node.getFloatEnum("accel_band_rms", 2) * 1000),
+                      vibe_uint16(vibe_node.getFloat("accel_peak_hz") * 10),
+                      vibe_uint16(vibe_node.getFloatEnum("gyro_band_rms", 0) * 10000),
+                      vibe_uint16(vibe_node.getFloatEnum("gyro_band_rms", 1) * 10000),
+                      vibe_uint16(vibe_node.getFloatEnum("gyro_band_rms", 2) * 10000),
+                      vibe_uint16(vibe_node.getFloat("gyro_peak_hz") * 10))
+    return wrap_packet(SYSTEM_HEALTH_PACKET_V6, buf)
+
+# clamp vibration values into an unsigned 16 bit field
+def vibe_uint16(val):
+    val = int(val)
+    if val < 0: val = 0
+    if val > 65535: val = 65535
+    return val
 
 def pack_system_health_csv(index):
     row = dict()
@@ -1228,8 +1245,19 @@ def pack_system_health_csv(index):
     row['cell_vcc'] = '%.2f' % power_node.getFloat('cell_vcc')
     row['main_amps'] = '%.2f' % power_node.getFloat('main_amps')
     row['total_mah'] = '%.0f' % power_node.getFloat('total_mah')
+    row['accel_band0_rms'] = '%.3f' % vibe_node.getFloatEnum('accel_band_rms', 0)
+    row['accel_band1_rms'] = '%.3f' % vibe_node.getFloatEnum('accel_band_rms', 1)
+    row['accel_band2_rms'] = '%.3f' % vibe_node.getFloatEnum('accel_band_rms', 2)
+    row['accel_peak_hz'] = '%.1f' % vibe_node.getFloat('accel_peak_hz')
+    row['gyro_band0_rms'] = '%.4f' % vibe_node.getFloatEnum('gyro_band_rms', 0)
+    row['gyro_band1_rms'] = '%.4f' % vibe_node.getFloatEnum('gyro_band_rms', 1)
+    row['gyro_band2_rms'] = '%.4f' % vibe_node.getFloatEnum('gyro_band_rms', 2)
+    row['gyro_peak_hz'] = '%.1f' % vibe_node.getFloat('gyro_peak_hz')
     keys = ['timestamp', 'system_load_avg', 'avionics_vcc', 'main_vcc',
-            'cell_vcc', 'main_amps', 'total_mah']
+            'cell_vcc', 'main_amps', 'total_mah',
+            'accel_band0_rms', 'accel_band1_rms', 'accel_band2_rms',
+            'accel_peak_hz', 'gyro_band0_rms', 'gyro_band1_rms',
+            'gyro_band2_rms', 'gyro_peak_hz']
     return row, keys
 
 def unpack_system_health_v2(buf):
@@ -1287,6 +1315,32 @@ def unpack_system_health_v5(buf):
 
     return index
 
+def unpack_system_health_v6(buf):
+    result = struct.unpack(system_health_v6_fmt, buf)
+
+    index = result[0]
+    
+    status_node.setFloat("frame_time", result[1])
+    status_node.setFloat("system_load_avg", result[2] / 100.0)
+    power_node.setFloat("avionics_vcc", result[3] / 1000.0)
+    power_node.setFloat("main_vcc", result[4] / 1000.0)
+    power_node.setFloat("cell_vcc", result[5] / 1000.0)
+    power_node.setFloat("main_amps", result[6] / 1000.0)
+    power_node.setInt("total_mah", result[7] * 10.0)
+    if vibe_node.getLen("accel_band_rms") != 3:
+        vibe_node.setLen("accel_band_rms", 3, 0.0)
+        vibe_node.setLen("gyro_band_rms", 3, 0.0)
+    vibe_node.setFloatEnum("accel_band_rms", 0, result[8] / 1000.0)
+    vibe_node.setFloatEnum("accel_band_rms", 1, result[9] / 1000.0)
+    vibe_node.setFloatEnum("accel_band_rms", 2, result[10] / 1000.0)
+    vibe_node.setFloat("accel_peak_hz", result[11] / 10.0)
+    vibe_node.setFloatEnum("gyro_band_rms", 0, result[12] / 10000.0)
+    vibe_node.setFloatEnum("gyro_band_rms", 1, result[13] / 10000.0)
+    vibe_node.setFloatEnum("gyro_band_rms", 2, result[14] / 10000.0)
+    vibe_node.setFloat("gyro_peak_hz", result[15] / 10.0)
+
+    return index
+
 def pack_payload_bin(index):
     buf = struct.pack(payload_v3_fmt,
                       index,
@@ -0,0 +1,60 @@
+// shared packet id definitions (C/C++ side)
+//
+// These must match comms/packet_id.py, which remains the master list.
+// The id is encoded as a single byte in the binary packet format.
+
+#pragma once
+
+enum aura_packet_id {
+    GPS_PACKET_V1 = 0,
+    GPS_PACKET_V2 = 16,
+    GPS_PACKET_V3 = 26,
+    GPS_PACKET_V4 = 34,
+
+    IMU_PACKET_V1 = 1,
+    IMU_PACKET_V2 = 15,
+    IMU_PACKET_V3 = 17,
+    IMU_PACKET_V4 = 35,
+
+    FILTER_PACKET_V1 = 2,
+    FILTER_PACKET_V2 = 22,
+    FILTER_PACKET_V3 = 31,
+    FILTER_PACKET_V4 = 36,
+
+    ACTUATOR_PACKET_V1 = 3,
+    ACTUATOR_PACKET_V2 = 21,
+    ACTUATOR_PACKET_V3 = 37,
+
+    PILOT_INPUT_PACKET_V1 = 4,
+    PILOT_INPUT_PACKET_V2 = 20,
+    PILOT_INPUT_PACKET_V3 = 38,
+
+    AP_STATUS_PACKET_V4 = 30,
+    AP_STATUS_PACKET_V5 = 32,
+    AP_STATUS_PACKET_V6 = 33,
+    AP_STATUS_PACKET_V7 = 39,
+
+    AIRDATA_PACKET_V3 = 9,
+    AIRDATA_PACKET_V4 = 13,
+    AIRDATA_PACKET_V5 = 18,
+    AIRDATA_PACKET_V6 = 40,
+
+    SYSTEM_HEALTH_PACKET_V2 = 11,
+    SYSTEM_HEALTH_PACKET_V3 = 14,
+    SYSTEM_HEALTH_PACKET_V4 = 19,
+    SYSTEM_HEALTH_PACKET_V5 = 41,
+    SYSTEM_HEALTH_PACKET_V6 = 43,
+
+    PAYLOAD_PACKET_V1 = 12,
+    PAYLOAD_PACKET_V2 = 23,
+    PAYLOAD_PACKET_V3 = 42,
+
+    EVENT_PACKET_V1 = 27,
+
+    COMMAND_PACKET_V1 = 28,
+
+    TELEMETRY_DELTA_V1 = 44,
+
+    RAVEN_PACKET_V1 = 25,
+    REMOTE_JOYSTICK_V1 = 29
+};
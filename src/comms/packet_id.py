@@ -43,14 +43,17 @@ SYSTEM_HEALTH_PACKET_V2 = 11
 SYSTEM_HEALTH_PACKET_V3 = 14
 SYSTEM_HEALTH_PACKET_V4 = 19
 SYSTEM_HEALTH_PACKET_V5 = 41
+SYSTEM_HEALTH_PACKET_V6 = 43
 
 PAYLOAD_PACKET_V1 = 12
 PAYLOAD_PACKET_V2 = 23
-PAYLOAD_PACKET_V3 = 42          # last id assigned
+PAYLOAD_PACKET_V3 = 42
 
 EVENT_PACKET_V1 = 27
 
 COMMAND_PACKET_V1 = 28
 
+TELEMETRY_DELTA_V1 = 44        # last id assigned
+
 RAVEN_PACKET_V1 = 25
 REMOTE_JOYSTICK_V1 = 29
@@ -0,0 +1,118 @@
+#include <stdio.h>
+
+#include "pycallable.hxx"
+
+unsigned long pyCallable::total_errors = 0;
+
+pyCallable::pyCallable():
+    func(NULL),
+    args_tuple(NULL),
+    nargs(0),
+    name(""),
+    errors(0)
+{
+}
+
+pyCallable::~pyCallable() {
+    release();
+}
+
+void pyCallable::release() {
+    Py_CLEAR(func);
+    Py_CLEAR(args_tuple);
+}
+
+bool pyCallable::bind( PyObject *module, const char *func_name, int num_args )
+{
+    release();
+    name = func_name;
+    nargs = num_args;
+    if ( module == NULL ) {
+        return false;
+    }
+    PyObject *f = PyObject_GetAttrString(module, func_name);
+    if ( f == NULL || ! PyCallable_Check(f) ) {
+	if ( PyErr_Occurred() ) PyErr_Print();
+	printf("ERROR: cannot find function '%s()'\n", func_name);
+        Py_XDECREF(f);
+        return false;
+    }
+    func = f;                   // keep our strong reference
+    return true;
+}
+
+void pyCallable::count_error() {
+    errors++;
+    total_errors++;
+    if ( PyErr_Occurred() ) {
+        if ( errors == 1 ) {
+            PyErr_Print();
+            printf("ERROR: call to '%s()' failed (further failures counted)\n",
+                   name.c_str());
+        } else {
+            PyErr_Clear();
+        }
+    }
+}
+
+PyObject *pyCallable::call( PyObject **args ) {
+    if ( func == NULL ) {
+        count_error();
+        return NULL;
+    }
+
+    PyObject *result = NULL;
+
+#if PY_VERSION_HEX >= 0x03090000
+    result = PyObject_Vectorcall(func, args, nargs, NULL);
+#elif PY_VERSION_HEX >= 0x03080000
+    result = _PyObject_Vectorcall(func, args, nargs, NULL);
+#else
+    if ( args_tuple == NULL ) {
+        args_tuple = PyTuple_New(nargs);
+        if ( args_tuple == NULL ) {
+            count_error();
+            return NULL;
+        }
+    }
+    for ( int i = 0; i < nargs; i++ ) {
+        Py_INCREF(args[i]);
+        PyTuple_SET_ITEM(args_tuple, i, args[i]);
+    }
+    result = PyObject_Call(func, args_tuple, NULL);
+    if ( Py_REFCNT(args_tuple) == 1 ) {
+        // nobody else kept the tuple, empty it for the next call
+        for ( int i = 0; i < nargs; i++ ) {
+            PyObject *item = PyTuple_GET_ITEM(args_tuple, i);
+            PyTuple_SET_ITEM(args_tuple, i, NULL);
+            Py_DECREF(item);
+        }
+    } else {
+        Py_CLEAR(args_tuple);
+    }
+#endif
+
+    if ( result == NULL ) {
+        count_error();
+    }
+    return result;
+}
+
+bool pyCallable::call_bool( PyObject **args ) {
+    PyObject *pValue = call(args);
+    if ( pValue == NULL ) {
+        return false;
+    }
+    bool result = PyObject_IsTrue(pValue);
+    Py_DECREF(pValue);
+    return result;
+}
+
+bool pyCallable::call_void( PyObject **args ) {
+    PyObject *pValue = call(args);
+    if ( pValue == NULL ) {
+        return false;
+    }
+    Py_DECREF(pValue);
+    return true;
+}
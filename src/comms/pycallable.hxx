@@ -0,0 +1,57 @@
+#pragma once
+
+// A resolved, strongly referenced python callable.
+//
+// The pyModule wrapper classes bind each python function they use
+// once at init() time instead of looking it up by name (and leaking
+// the reference) on every call.  Calls go through the vectorcall
+// protocol when the python version supports it, otherwise through a
+// preallocated argument tuple that is reused whenever the callee did
+// not hang on to it.  Call failures are counted rather than printed
+// every frame; the first python traceback per function is still
+// printed to help track down the problem.
+
+#include <Python.h>
+
+#include <string>
+using std::string;
+
+class pyCallable {
+
+public:
+
+    pyCallable();
+    ~pyCallable();
+
+    // resolve module.name and verify it is callable.  nargs is the
+    // number of positional arguments every call will pass.
+    bool bind( PyObject *module, const char *name, int nargs );
+    void release();
+
+    inline bool valid() { return func != NULL; }
+    inline const char *get_name() { return name.c_str(); }
+    inline unsigned long get_errors() { return errors; }
+
+    // args are borrowed references, returns a new reference or NULL
+    // on failure (the python error is consumed and counted.)
+    PyObject *call( PyObject **args );
+
+    // call and convert the result to a bool (false on failure)
+    bool call_bool( PyObject **args );
+
+    // call and discard the result, returns false on failure
+    bool call_void( PyObject **args );
+
+    // total failures across all bound callables
+    static unsigned long total_errors;
+
+private:
+
+    PyObject *func;
+    PyObject *args_tuple;       // reused when vectorcall is unavailable
+    int nargs;
+    string name;
+    unsigned long errors;
+
+    void count_error();
+};
@@ -1,109 +1,157 @@
 #include <pyprops.hxx>
 
+#include "init/globals.hxx"
+
 #include "remote_link.hxx"
 
-pyModuleRemoteLink::pyModuleRemoteLink()
+// reactor callback, drain the uplink as it arrives
+static void remote_link_ready( int fd, void *arg ) {
+    ((RemoteLinkRx *)arg)->update();
+}
+
+pyModuleRemoteLink::pyModuleRemoteLink():
+    rx_reactor(false)
 {
 }
 
-void pyModuleRemoteLink::send_message( uint8_t *buf, int size ) {
-    if (pModuleObj == NULL) {
-	printf("ERROR: import logging module failed\n");
-	return;
+bool pyModuleRemoteLink::init(const char *import_name)
+{
+    bool result = pyModuleBase::init(import_name);
+    send_message_func.bind(pModuleObj, "send_message", 1);
+    command_func.bind(pModuleObj, "command", 0);
+    flush_serial_func.bind(pModuleObj, "flush_serial", 0);
+    decode_fcs_update_func.bind(pModuleObj, "decode_fcs_update", 1);
+    take_pending_func.bind(pModuleObj, "take_pending", 0);
+    execute_func.bind(pModuleObj, "execute_remote_command", 2);
+
+    // the native transmitter and receiver take over the link unless
+    // disabled in the config.  Validated commands are still executed
+    // by the python module.
+    pyPropertyNode config_node = pyGetNode("/config/remote_link", true);
+    bool native_tx = true;
+    if ( config_node.hasChild("native_tx") ) {
+        native_tx = config_node.getBool("native_tx");
     }
-    PyObject *pFuncLog = PyObject_GetAttrString(pModuleObj, "send_message");
-    if ( pFuncLog == NULL || ! PyCallable_Check(pFuncLog) ) {
-	if ( PyErr_Occurred() ) PyErr_Print();
-	printf("ERROR: cannot find function 'send_message()'\n");
-	return;
+    if ( result && native_tx && config_node.hasChild("device") ) {
+        string device = config_node.getString("device");
+        int baud = 115200;
+        if ( config_node.hasChild("baud") ) {
+            baud = config_node.getLong("baud");
+        }
+        // sustained radio throughput, either given directly or from
+        // the radio air data rate (10 bits per byte)
+        double link_bytes_per_sec = 0.0;
+        if ( config_node.hasChild("link_bytes_per_sec") ) {
+            link_bytes_per_sec = config_node.getDouble("link_bytes_per_sec");
+        } else if ( config_node.hasChild("air_baud") ) {
+            link_bytes_per_sec = config_node.getDouble("air_baud") / 10.0;
+        }
+        if ( tx.open( device.c_str(), baud, link_bytes_per_sec ) ) {
+            // "delta" sends keyframes plus quantized residuals,
+            // "standard" (default) sends the full packet formats
+            if ( config_node.getString("telemetry_encoding") == "delta" ) {
+                double keyframe_sec = 5.0;
+                int keyframe_count = 50;
+                if ( config_node.hasChild("keyframe_interval_sec") ) {
+                    keyframe_sec = config_node.getDouble("keyframe_interval_sec");
+                }
+                if ( config_node.hasChild("keyframe_count") ) {
+                    keyframe_count = config_node.getLong("keyframe_count");
+                }
+                tx.set_delta_encoding( keyframe_sec, keyframe_count );
+            }
+            bool native_rx = true;
+            if ( config_node.hasChild("native_rx") ) {
+                native_rx = config_node.getBool("native_rx");
+            }
+            if ( native_rx && execute_func.valid() ) {
+                rx.set_fd( tx.get_fd() );
+                rx_reactor = reactor->add( tx.get_fd(), remote_link_ready,
+                                           &rx, "remote_link" );
+            }
+        }
     }
-    PyObject *pResult = PyObject_CallFunction(pFuncLog, (char *)"y#", buf, size);
-    if (pResult != NULL) {
-	Py_DECREF(pResult);
-	return;
-    } else {
-	PyErr_Print();
-	printf("ERROR: call failed\n");
-	return;
+
+    return result;
+}
+
+void pyModuleRemoteLink::send_message( uint8_t *buf, int size ) {
+    if ( tx.is_open() ) {
+        tx.send_message( buf, size );
+        return;
+    }
+    PyObject *pBuf = PyBytes_FromStringAndSize((const char *)buf, size);
+    if ( pBuf == NULL ) {
+        PyErr_Clear();
+        return;
     }
+    send_message_func.call_void(&pBuf);
+    Py_DECREF(pBuf);
 }
 
 bool pyModuleRemoteLink::command()
 {
-    if (pModuleObj == NULL) {
-	printf("ERROR: remote_link.init() failed\n");
-	return false;
-    }
-    PyObject *pFuncOpen = PyObject_GetAttrString(pModuleObj, "command");
-    if ( pFuncOpen == NULL || ! PyCallable_Check(pFuncOpen) ) {
-	if ( PyErr_Occurred() ) PyErr_Print();
-	printf("ERROR: cannot find function 'command()'\n");
-	return false;
+    bool result = false;
+    if ( rx.is_open() ) {
+        if ( !rx_reactor ) {
+            rx.update();
+        }
+        RemoteLinkRx::command_t cmd;
+        while ( rx.pop(&cmd) ) {
+            PyObject *args[2];
+            args[0] = PyLong_FromLong(cmd.sequence);
+            args[1] = PyUnicode_FromStringAndSize(cmd.message.c_str(),
+                                                  cmd.message.length());
+            if ( args[0] != NULL && args[1] != NULL ) {
+                execute_func.call_void(args);
+                result = true;
+            } else {
+                PyErr_Clear();
+            }
+            Py_XDECREF(args[0]);
+            Py_XDECREF(args[1]);
+        }
+        rx.publish_stats();
+    } else {
+        result = command_func.call_bool(NULL);
     }
 
-    // FIXME decref pFuncOpen
-    
-    PyObject *pValue = PyObject_CallFunction(pFuncOpen, NULL);
-    if (pValue != NULL) {
-	bool result = PyObject_IsTrue(pValue);
-	Py_DECREF(pValue);
-	return result;
-    } else {
-	PyErr_Print();
-	printf("ERROR: call failed\n");
-	return false;
+    if ( tx.is_open() ) {
+        // pick up any replies the python command processor queued
+        PyObject *pValue = take_pending_func.call(NULL);
+        if ( pValue != NULL ) {
+            char *ptr = NULL;
+            Py_ssize_t len = 0;
+            if ( PyBytes_AsStringAndSize(pValue, &ptr, &len) == 0 ) {
+                tx.send_packets( (uint8_t *)ptr, len );
+            } else {
+                PyErr_Clear();
+            }
+            Py_DECREF(pValue);
+        }
     }
-    return false;
+
+    return result;
 }
 
 
 bool pyModuleRemoteLink::flush_serial()
 {
-    if (pModuleObj == NULL) {
-	printf("ERROR: remote_link.init() failed\n");
-	return false;
-    }
-    PyObject *pFuncOpen = PyObject_GetAttrString(pModuleObj, "flush_serial");
-    if ( pFuncOpen == NULL || ! PyCallable_Check(pFuncOpen) ) {
-	if ( PyErr_Occurred() ) PyErr_Print();
-	printf("ERROR: cannot find function 'flush_serial()'\n");
-	return false;
+    if ( tx.is_open() ) {
+        tx.flush();
+        tx.publish_stats();
+        return true;
     }
-
-    // FIXME decref pFuncOpen
-    
-    PyObject *pValue = PyObject_CallFunction(pFuncOpen, NULL);
-    if (pValue != NULL) {
-	bool result = PyObject_IsTrue(pValue);
-	Py_DECREF(pValue);
-	return result;
-    } else {
-	PyErr_Print();
-	printf("ERROR: call failed\n");
-	return false;
-    }
-    return false;
+    return flush_serial_func.call_bool(NULL);
 }
 
 bool pyModuleRemoteLink::decode_fcs_update( const char *buf ) {
-    if (pModuleObj == NULL) {
-	printf("ERROR: import logging module failed\n");
-	return false;
-    }
-    PyObject *pFuncLog = PyObject_GetAttrString(pModuleObj, "decode_fcs_update");
-    if ( pFuncLog == NULL || ! PyCallable_Check(pFuncLog) ) {
-	if ( PyErr_Occurred() ) PyErr_Print();
-	printf("ERROR: cannot find function 'decode_fcs_update()'\n");
-	return false;
-    }
-    PyObject *pResult = PyObject_CallFunction(pFuncLog, (char *)"s", buf);
-    if (pResult != NULL) {
-	bool result = PyObject_IsTrue(pResult);
-	Py_DECREF(pResult);
-	return result;
-    } else {
-	PyErr_Print();
-	printf("ERROR: call failed\n");
-	return false;
+    PyObject *pBuf = PyUnicode_FromString(buf);
+    if ( pBuf == NULL ) {
+        PyErr_Clear();
+        return false;
     }
+    bool result = decode_fcs_update_func.call_bool(&pBuf);
+    Py_DECREF(pBuf);
+    return result;
 }
@@ -8,6 +8,10 @@
 
 #include <pymodule.hxx>
 
+#include "link_rx.hxx"
+#include "link_tx.hxx"
+#include "pycallable.hxx"
+
 #include <stdint.h>
 #include <string>
 #include <vector>
@@ -20,6 +24,7 @@ public:
     pyModuleRemoteLink();
     ~pyModuleRemoteLink() {}
 
+    bool init(const char *import_name);
     // bool open();
     void send_message( uint8_t *buf, int size );
     bool command();
@@ -29,4 +34,15 @@ public:
 private:
 
     bool remote_link_on;
+
+    pyCallable send_message_func;
+    pyCallable command_func;
+    pyCallable flush_serial_func;
+    pyCallable decode_fcs_update_func;
+    pyCallable take_pending_func;
+    pyCallable execute_func;
+
+    RemoteLinkTx tx;
+    RemoteLinkRx rx;
+    bool rx_reactor;            // rx is driven by the reactor
 };
@@ -33,8 +33,11 @@ def init():
     global link_open
     
     device = remote_link_config.getString('device')
+    baud = remote_link_config.getInt('baud')
+    if not baud:
+        baud = 115200
     try:
-        ser = serial.Serial(port=device, baudrate=115200, timeout=0, writeTimeout=0)
+        ser = serial.Serial(port=device, baudrate=baud, timeout=0, writeTimeout=0)
         parser = comms.serial_parser.serial_parser()
     except Exception as e:
         print('Opening remote link failed:', device)
@@ -76,6 +79,14 @@ def flush_serial():
             # something was written
             serial_buf = serial_buf[bytes_written:]
 
+# hand over (and clear) any queued output.  Used when the native
+# transmitter owns the output side of the link.
+def take_pending():
+    global serial_buf
+    result = bytes(serial_buf)
+    serial_buf = bytearray()
+    return result
+
 # append the request data to a fifo buffer if space available.  A
 # separate function will flush the data in even chunks to avoid
 # saturating the telemetry link.
@@ -267,20 +278,23 @@ def command():
     
     # ignore repeated commands (including roll over logic)
     if sequence != last_sequence_num:
-	# execute command
-        command = command_bytes.decode()
-        comms.events.log( 'remote command',
-                          "executed: (%d) %s" % (sequence, command) )
-        execute_command( command )
-
-        # register that we've received this message correctly
-        remote_link_node.setInt( 'sequence_num', sequence )
+        execute_remote_command( sequence, command_bytes.decode() )
         last_sequence_num = sequence
-        timestamp = status_node.getFloat('frame_time')
-        remote_link_node.setFloat( 'last_message_sec', timestamp )
 
     return True
 
+# execute a validated (and de-duplicated) command.  Called directly by
+# the native link receiver.
+def execute_remote_command( sequence, command ):
+    comms.events.log( 'remote command',
+                      "executed: (%d) %s" % (sequence, command) )
+    execute_command( command )
+
+    # register that we've received this message correctly
+    remote_link_node.setInt( 'sequence_num', sequence )
+    timestamp = status_node.getFloat('frame_time')
+    remote_link_node.setFloat( 'last_message_sec', timestamp )
+
 def decode_fcs_update(command):
     tokens = command.split(',')
 
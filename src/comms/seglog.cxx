@@ -0,0 +1,364 @@
+#include <errno.h>		// errno
+#include <fcntl.h>		// open(), fallocate(), sync_file_range()
+#include <stddef.h>		// offsetof()
+#include <stdio.h>		// printf() et. al.
+#include <stdlib.h>		// posix_memalign()
+#include <string.h>		// memset(), strerror()
+#include <unistd.h>		// pwrite(), close(), fdatasync()
+
+#include <zlib.h>
+
+#include "util/timing.h"
+
+#include "seglog.hxx"
+
+static const int align = 4096;
+
+// blocks waiting for the writer beyond this are dropped rather than
+// letting memory grow without bound when the storage stalls
+static const int max_queue = 64;
+
+static inline uint64_t align_up( uint64_t n ) {
+    return (n + align - 1) & ~(uint64_t)(align - 1);
+}
+
+static uint32_t header_crc( const seglog_block_header *h ) {
+    return crc32( 0L, (const Bytef *)h, offsetof(seglog_block_header, header_crc) );
+}
+
+
+SegmentLog::SegmentLog():
+    blocks_written(0),
+    bytes_written(0),
+    segment(0),
+    dropped_blocks(0),
+    write_errors(0),
+    max_write_usec(0),
+    segment_size(16*1024*1024),
+    block_size(64*1024),
+    flush_sec(1.0),
+    direct_io(false),
+    current(NULL),
+    block_start(0.0),
+    seq(0),
+    fd(-1),
+    offset(0),
+    synced(0),
+    sync_time(0.0),
+    queue_len(0),
+    running(false),
+    done(false)
+{
+}
+
+SegmentLog::~SegmentLog() {
+    close();
+}
+
+
+bool SegmentLog::open( const char *path, uint32_t seg_size,
+                       uint32_t blk_size, double flush, bool direct )
+{
+    dir = path;
+    segment_size = align_up(seg_size);
+    block_size = blk_size;
+    flush_sec = flush;
+    direct_io = direct;
+    seq = 0;
+    if ( !open_segment(0) ) {
+        return false;
+    }
+    current = new block;
+    current->data.reserve(block_size);
+    block_start = get_Time();
+    done = false;
+    running = true;
+    worker = std::thread( &SegmentLog::worker_main, this );
+    return true;
+}
+
+
+void SegmentLog::write( const uint8_t *buf, int len ) {
+    if ( !running ) {
+        return;
+    }
+    current->data.insert( current->data.end(), buf, buf + len );
+    if ( current->data.size() >= block_size ) {
+        seal();
+    }
+}
+
+
+void SegmentLog::update() {
+    if ( running && get_Time() >= block_start + flush_sec ) {
+        seal();
+    }
+}
+
+
+// hand the current block to the writer thread
+void SegmentLog::seal() {
+    block_start = get_Time();
+    if ( current->data.empty() ) {
+        return;
+    }
+    current->time = block_start;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if ( (int)queue.size() >= max_queue ) {
+            dropped_blocks++;
+            current->data.clear();
+            return;
+        }
+        queue.push_back(current);
+        queue_len = queue.size();
+    }
+    cond.notify_one();
+    current = new block;
+    current->data.reserve(block_size);
+}
+
+
+bool SegmentLog::open_segment( uint32_t n ) {
+    char name[32];
+    snprintf( name, sizeof(name), "flight-%04u.seg", n );
+    string file = dir + "/" + name;
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    if ( direct_io ) {
+        fd = ::open( file.c_str(), flags | O_DIRECT, 0644 );
+        if ( fd < 0 && errno == EINVAL ) {
+            // not supported by this file system
+            printf("seglog: O_DIRECT not supported, using sync_file_range()\n");
+            direct_io = false;
+        }
+    }
+    if ( !direct_io ) {
+        fd = ::open( file.c_str(), flags, 0644 );
+    }
+    if ( fd < 0 ) {
+        fprintf( stderr, "seglog: cannot open %s - %s\n", file.c_str(),
+                 strerror(errno) );
+        return false;
+    }
+
+    // reserve the whole segment up front so writes never need to
+    // allocate blocks or update the file size
+    if ( fallocate( fd, 0, 0, segment_size ) < 0 ) {
+        posix_fallocate( fd, 0, segment_size );
+    }
+
+    // make sure the new directory entry itself is durable
+    int dfd = ::open( dir.c_str(), O_RDONLY | O_DIRECTORY );
+    if ( dfd >= 0 ) {
+        fsync(dfd);
+        ::close(dfd);
+    }
+
+    segment = n;
+    offset = 0;
+    synced = 0;
+    sync_time = get_Time();
+    return true;
+}
+
+
+void SegmentLog::close_segment() {
+    if ( fd < 0 ) {
+        return;
+    }
+    // trim the unused preallocation on a clean close
+    if ( ftruncate( fd, offset ) < 0 ) {
+        write_errors++;
+    }
+    fdatasync(fd);
+    ::close(fd);
+    fd = -1;
+}
+
+
+void SegmentLog::write_block( block *b ) {
+    double start = get_Time();
+
+    uLongf comp_len = compressBound( b->data.size() );
+    vector<uint8_t> comp(comp_len);
+    const uint8_t *data = b->data.data();
+    uint32_t size = b->data.size();
+    uint32_t stored_comp = 0;
+    if ( compress2( comp.data(), &comp_len, data, size, Z_BEST_SPEED ) == Z_OK
+         && comp_len < size )
+    {
+        data = comp.data();
+        stored_comp = comp_len;
+        size = comp_len;
+    }
+
+    seglog_block_header h;
+    memset( &h, 0, sizeof(h) );
+    memcpy( h.magic, "ALBK", 4 );
+    h.seq = seq++;
+    h.raw_size = b->data.size();
+    h.comp_size = stored_comp;
+    h.data_crc = crc32( 0L, data, size );
+    h.segment = segment;
+    h.time = b->time;
+    h.header_crc = header_crc(&h);
+
+    uint64_t total = align_up( sizeof(h) + size );
+    if ( offset > 0 && offset + total > segment_size ) {
+        close_segment();
+        if ( !open_segment( segment + 1 ) ) {
+            write_errors++;
+            return;
+        }
+    }
+
+    uint8_t *buf = NULL;
+    if ( posix_memalign( (void **)&buf, align, total ) != 0 ) {
+        write_errors++;
+        return;
+    }
+    memcpy( buf, &h, sizeof(h) );
+    memcpy( buf + sizeof(h), data, size );
+    memset( buf + sizeof(h) + size, 0, total - sizeof(h) - size );
+
+    ssize_t result = pwrite( fd, buf, total, offset );
+    free(buf);
+    if ( result != (ssize_t)total ) {
+        write_errors++;
+        return;
+    }
+
+    if ( !direct_io ) {
+        // start writeback of this block now, and wait for the one
+        // before it, so at most one block is ever only in page cache
+        if ( offset > synced ) {
+            sync_file_range( fd, synced, offset - synced,
+                             SYNC_FILE_RANGE_WAIT_BEFORE
+                             | SYNC_FILE_RANGE_WRITE
+                             | SYNC_FILE_RANGE_WAIT_AFTER );
+        }
+        sync_file_range( fd, offset, total, SYNC_FILE_RANGE_WRITE );
+        synced = offset;
+    }
+    offset += total;
+
+    // checkpoint: neither of the above commits the conversion of the
+    // preallocated extents to written ones, only fdatasync() does
+    double now = get_Time();
+    if ( now >= sync_time + flush_sec ) {
+        if ( fdatasync(fd) < 0 ) {
+            write_errors++;
+        }
+        sync_time = now;
+    }
+
+    blocks_written++;
+    bytes_written += total;
+    uint32_t usec = (now - start) * 1000000.0;
+    if ( usec > max_write_usec ) {
+        max_write_usec = usec;
+    }
+}
+
+
+void SegmentLog::worker_main() {
+    std::unique_lock<std::mutex> guard(lock);
+    while ( true ) {
+        while ( queue.empty() && !done ) {
+            cond.wait(guard);
+        }
+        if ( queue.empty() && done ) {
+            break;
+        }
+        block *b = queue.front();
+        queue.pop_front();
+        queue_len = queue.size();
+        guard.unlock();
+        write_block(b);
+        delete b;
+        guard.lock();
+    }
+}
+
+
+void SegmentLog::close() {
+    if ( !running ) {
+        return;
+    }
+    seal();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        done = true;
+    }
+    cond.notify_one();
+    worker.join();
+    close_segment();
+    delete current;
+    current = NULL;
+    running = false;
+}
+
+
+int seglog_read( const char *file, seglog_func func, void *arg, int *bad ) {
+    *bad = 0;
+    FILE *fp = fopen( file, "rb" );
+    if ( fp == NULL ) {
+        return -1;
+    }
+    vector<uint8_t> buf;
+    uint8_t chunk[65536];
+    size_t n;
+    while ( (n = fread( chunk, 1, sizeof(chunk), fp )) > 0 ) {
+        buf.insert( buf.end(), chunk, chunk + n );
+    }
+    fclose(fp);
+
+    int good = 0;
+    vector<uint8_t> raw;
+    uint64_t pos = 0;
+    while ( pos + sizeof(seglog_block_header) <= buf.size() ) {
+        seglog_block_header h;
+        memcpy( &h, &buf[pos], sizeof(h) );
+        if ( memcmp( h.magic, "ALBK", 4 ) != 0 ) {
+            bool zero = true;
+            for ( int i = 0; i < 4; i++ ) {
+                if ( h.magic[i] ) {
+                    zero = false;
+                }
+            }
+            if ( zero ) {
+                break;          // unused (preallocated) space
+            }
+            (*bad)++;
+            pos += align;
+            continue;
+        }
+        uint32_t size = h.comp_size ? h.comp_size : h.raw_size;
+        if ( h.header_crc != header_crc(&h)
+             || pos + sizeof(h) + size > buf.size()
+             || crc32( 0L, &buf[pos + sizeof(h)], size ) != h.data_crc )
+        {
+            // torn or damaged block, resync on the next boundary
+            (*bad)++;
+            pos += align;
+            continue;
+        }
+        const uint8_t *data = &buf[pos + sizeof(h)];
+        if ( h.comp_size ) {
+            raw.resize( h.raw_size );
+            uLongf len = h.raw_size;
+            if ( uncompress( raw.data(), &len, data, size ) != Z_OK
+                 || len != h.raw_size )
+            {
+                (*bad)++;
+                pos += align;
+                continue;
+            }
+            data = raw.data();
+        }
+        func( data, h.raw_size, h.time, arg );
+        good++;
+        pos += align_up( sizeof(h) + size );
+    }
+    return good;
+}
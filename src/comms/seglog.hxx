@@ -0,0 +1,118 @@
+#pragma once
+
+// Crash safe flight log segments.
+//
+// The log is a series of fixed size, preallocated segment files
+// (flight-0000.seg, flight-0001.seg, ...) in the flight directory.
+// Data is collected into blocks that are sealed at least once per
+// flush interval.  Each block is deflated on its own and written at a
+// 4k aligned offset with a header carrying its length and crc32, so
+// every block (and so every segment) decodes independently and a
+// torn or missing tail costs at most the last block.
+//
+// The calling thread only appends to a memory buffer.  Compression,
+// pwrite() and writeback (sync_file_range(), or O_DIRECT) all happen
+// on a background thread so a slow sd card never stalls the frame.
+// Writeback alone survives a crash of the process, but data landing
+// in the preallocated extents also needs their metadata committed to
+// survive a power loss, so the writer fdatasync()s at least once per
+// flush interval and at every segment change.  A power loss costs at
+// most the blocks since that checkpoint.
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using std::deque;
+using std::string;
+using std::vector;
+
+#pragma pack(push, 1)
+struct seglog_block_header {
+    char magic[4];              // "ALBK"
+    uint32_t seq;               // block number since the log opened
+    uint32_t raw_size;
+    uint32_t comp_size;         // 0 = stored uncompressed
+    uint32_t data_crc;          // crc32 of the stored data
+    uint32_t segment;
+    double time;                // when the block was sealed
+    uint32_t header_crc;        // crc32 of the fields above
+    uint32_t reserved;
+};
+#pragma pack(pop)
+
+class SegmentLog {
+
+public:
+
+    SegmentLog();
+    ~SegmentLog();
+
+    bool open( const char *dir, uint32_t segment_size, uint32_t block_size,
+               double flush_sec, bool direct_io );
+    void close();
+    inline bool is_open() { return running; }
+
+    // append data (main thread)
+    void write( const uint8_t *buf, int len );
+
+    // seal the current block if the flush interval has passed
+    void update();
+
+    // statistics (safe to read from the main thread)
+    std::atomic<uint32_t> blocks_written;
+    std::atomic<uint64_t> bytes_written;
+    std::atomic<uint32_t> segment;
+    std::atomic<uint32_t> dropped_blocks;
+    std::atomic<uint32_t> write_errors;
+    std::atomic<uint32_t> max_write_usec;
+    inline int queued() { return queue_len; }
+
+private:
+
+    struct block {
+        vector<uint8_t> data;
+        double time;
+    };
+
+    string dir;
+    uint32_t segment_size;
+    uint32_t block_size;
+    double flush_sec;
+    bool direct_io;
+
+    block *current;
+    double block_start;
+    uint32_t seq;
+
+    // writer thread state
+    int fd;
+    uint64_t offset;            // write position in the current segment
+    uint64_t synced;            // writeback requested up to here
+    double sync_time;           // last fdatasync() checkpoint
+    std::atomic<int> queue_len;
+    std::atomic<bool> running;
+    bool done;
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable cond;
+    deque<block *> queue;
+
+    void seal();
+    bool open_segment( uint32_t n );
+    void close_segment();
+    void write_block( block *b );
+    void worker_main();
+};
+
+// read back one segment file, calls func(data, len) with the payload
+// of every intact block in order.  Returns the number of good blocks,
+// bad (damaged) blocks are counted in *bad.
+typedef void (*seglog_func)( const uint8_t *data, int len, double time,
+                             void *arg );
+int seglog_read( const char *file, seglog_func func, void *arg, int *bad );
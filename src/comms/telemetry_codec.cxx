@@ -0,0 +1,511 @@
+#include <math.h>
+#include <string.h>
+
+#include "packet_id.h"
+#include "telemetry_codec.hxx"
+
+#define START_OF_MSG0 147
+#define START_OF_MSG1 224
+
+// Per format field layout.  fmt uses python struct codes (little
+// endian, no padding) and must match the *_fmt strings in packer.py.
+// order is the prediction order per field (1 = delta, 2 =
+// delta-of-delta).  scale is the quantization multiplier for each
+// float field in turn (resolution = 1 / scale.)
+struct codec_layout {
+    int id;
+    const char *fmt;
+    const char *order;
+    double scale[TelemetryCodec::MAX_FIELDS];
+
+    // derived
+    int num_fields;
+    int size;
+    int offset[TelemetryCodec::MAX_FIELDS];
+    double field_scale[TelemetryCodec::MAX_FIELDS];
+};
+
+static codec_layout layouts[] = {
+    { GPS_PACKET_V4, "BfddfhhhdBHHHB", "12222111211111",
+      { 1e3, 1e7, 1e7, 1e2, 1e3 } },
+    { IMU_PACKET_V4, "BffffffffffhB", "1211111111111",
+      { 1e3, 1e4, 1e4, 1e4, 1e3, 1e3, 1e3, 1e3, 1e3, 1e3 } },
+    { AIRDATA_PACKET_V6, "BfHhhffhHBBB", "121112211111",
+      { 1e3, 1e2, 1e2 } },
+    { FILTER_PACKET_V4, "BfddfhhhhhhhhhhhhBB", "1222211111111111111",
+      { 1e3, 1e7, 1e7, 1e2 } },
+    { ACTUATOR_PACKET_V3, "BfhhHhhhhhB", "12111111111",
+      { 1e3 } },
+    { PILOT_INPUT_PACKET_V3, "BfhhhhhhhhB", "12111111111",
+      { 1e3 } },
+    { AP_STATUS_PACKET_V7, "BfBhhHhhhHHddHHBHB", "121111111111111111",
+      { 1e3, 1e7, 1e7 } },
+    { SYSTEM_HEALTH_PACKET_V6, "BfHHHHHHHHHHHHHH", "1211111111111111",
+      { 1e3 } },
+};
+
+static const int num_layouts = sizeof(layouts) / sizeof(layouts[0]);
+static bool layouts_ready = false;
+
+static int type_size( char c ) {
+    switch ( c ) {
+    case 'B': case 'b': return 1;
+    case 'H': case 'h': return 2;
+    case 'L': case 'l': case 'f': return 4;
+    case 'd': return 8;
+    default: return 0;
+    }
+}
+
+static void init_layouts() {
+    for ( int i = 0; i < num_layouts; i++ ) {
+        codec_layout &lay = layouts[i];
+        lay.num_fields = strlen(lay.fmt);
+        lay.size = 0;
+        int fi = 0;
+        for ( int j = 0; j < lay.num_fields; j++ ) {
+            char c = lay.fmt[j];
+            lay.offset[j] = lay.size;
+            lay.size += type_size(c);
+            if ( c == 'f' || c == 'd' ) {
+                lay.field_scale[j] = lay.scale[fi++];
+            } else {
+                lay.field_scale[j] = 0.0;
+            }
+        }
+    }
+    layouts_ready = true;
+}
+
+static const codec_layout *find_layout( int id ) {
+    if ( !layouts_ready ) {
+        init_layouts();
+    }
+    for ( int i = 0; i < num_layouts; i++ ) {
+        if ( layouts[i].id == id ) {
+            return &layouts[i];
+        }
+    }
+    return NULL;
+}
+
+// convert payload fields to integers (exact for integer fields,
+// quantized for floats.)  Returns false if a float can't be
+// represented (nan, inf, or out of range.)
+static bool quantize( const codec_layout *lay, const uint8_t *payload,
+                      int64_t *q )
+{
+    bool ok = true;
+    for ( int i = 0; i < lay->num_fields; i++ ) {
+        const uint8_t *p = payload + lay->offset[i];
+        switch ( lay->fmt[i] ) {
+        case 'B': q[i] = *p; break;
+        case 'b': q[i] = (int8_t)*p; break;
+        case 'H': { uint16_t v; memcpy(&v, p, 2); q[i] = v; } break;
+        case 'h': { int16_t v; memcpy(&v, p, 2); q[i] = v; } break;
+        case 'L': { uint32_t v; memcpy(&v, p, 4); q[i] = v; } break;
+        case 'l': { int32_t v; memcpy(&v, p, 4); q[i] = v; } break;
+        case 'f': case 'd': {
+            double v;
+            if ( lay->fmt[i] == 'f' ) {
+                float f; memcpy(&f, p, 4); v = f;
+            } else {
+                memcpy(&v, p, 8);
+            }
+            double x = v * lay->field_scale[i] + 0.5;
+            if ( !(fabs(x) < 4.0e15) ) {
+                q[i] = 0;
+                ok = false;
+            } else {
+                q[i] = (int64_t)floor(x);
+            }
+        } break;
+        }
+    }
+    return ok;
+}
+
+static void dequantize( const codec_layout *lay, const int64_t *q,
+                        uint8_t *payload )
+{
+    for ( int i = 0; i < lay->num_fields; i++ ) {
+        uint8_t *p = payload + lay->offset[i];
+        switch ( lay->fmt[i] ) {
+        case 'B': case 'b': *p = (uint8_t)q[i]; break;
+        case 'H': case 'h': { uint16_t v = (uint16_t)q[i]; memcpy(p, &v, 2); } break;
+        case 'L': case 'l': { uint32_t v = (uint32_t)q[i]; memcpy(p, &v, 4); } break;
+        case 'f': { float f = (double)q[i] / lay->field_scale[i]; memcpy(p, &f, 4); } break;
+        case 'd': { double d = (double)q[i] / lay->field_scale[i]; memcpy(p, &d, 8); } break;
+        }
+    }
+}
+
+
+class BitWriter {
+public:
+    BitWriter( uint8_t *b, int max ): buf(b), max_bytes(max), bits(0) {
+        memset(buf, 0, max);
+    }
+    bool put( uint64_t val, int n ) {
+        if ( bits + n > max_bytes * 8 ) {
+            return false;
+        }
+        for ( int i = n - 1; i >= 0; i-- ) {
+            if ( (val >> i) & 1 ) {
+                buf[bits >> 3] |= 0x80 >> (bits & 7);
+            }
+            bits++;
+        }
+        return true;
+    }
+    inline int bytes() { return (bits + 7) >> 3; }
+private:
+    uint8_t *buf;
+    int max_bytes;
+    int bits;
+};
+
+class BitReader {
+public:
+    BitReader( const uint8_t *b, int len ): buf(b), max_bits(len * 8), bits(0) {}
+    bool get( int n, uint64_t *val ) {
+        if ( bits + n > max_bits ) {
+            return false;
+        }
+        uint64_t v = 0;
+        for ( int i = 0; i < n; i++ ) {
+            v = (v << 1) | ((buf[bits >> 3] >> (7 - (bits & 7))) & 1);
+            bits++;
+        }
+        *val = v;
+        return true;
+    }
+private:
+    const uint8_t *buf;
+    int max_bits;
+    int bits;
+};
+
+// Rice code for zigzag mapped residuals: the quotient u >> k in
+// unary, then the low k bits.  Quotients past rice_escape are sent as
+// the escape run followed by the bit length and the raw value.
+static const int rice_escape = 8;
+
+// keyframe parameter coding: Rice parameters are sent with param_k,
+// order 2 slopes in 1 / (1 << slope_shift) steps with slope_k
+static const int param_k = 1;
+static const int slope_k = 6;
+static const int slope_shift = 6;
+static const int64_t slope_round = 1 << (slope_shift - 1);
+
+static inline uint64_t zigzag( int64_t r ) {
+    return ((uint64_t)r << 1) ^ (uint64_t)(r >> 63);
+}
+
+static int rice_k( uint64_t sum, int count ) {
+    int k = 0;
+    while ( k < 48 && ((uint64_t)count << k) < sum ) {
+        k++;
+    }
+    return k;
+}
+
+static bool put_residual( BitWriter *w, int64_t r, int k ) {
+    uint64_t u = zigzag( r );
+    uint64_t q = u >> k;
+    if ( q < (uint64_t)rice_escape ) {
+        return w->put( ((uint64_t)1 << (q + 1)) - 2, q + 1 )
+            && w->put( u & (((uint64_t)1 << k) - 1), k );
+    }
+    int len = 1;
+    while ( len < 64 && (u >> len) != 0 ) {
+        len++;
+    }
+    return w->put( ((uint64_t)1 << rice_escape) - 1, rice_escape )
+        && w->put( len - 1, 6 )
+        && w->put( u, len );
+}
+
+static bool get_residual( BitReader *r, int k, int64_t *val ) {
+    uint64_t bit = 1;
+    int q = 0;
+    while ( q < rice_escape ) {
+        if ( !r->get(1, &bit) ) {
+            return false;
+        }
+        if ( !bit ) {
+            break;
+        }
+        q++;
+    }
+    uint64_t u;
+    if ( q < rice_escape ) {
+        uint64_t low = 0;
+        if ( k > 0 && !r->get(k, &low) ) {
+            return false;
+        }
+        u = ((uint64_t)q << k) | low;
+    } else {
+        uint64_t len;
+        if ( !r->get(6, &len) || !r->get(len + 1, &u) ) {
+            return false;
+        }
+    }
+    *val = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+    return true;
+}
+
+
+static int wrap_packet( int id, const uint8_t *payload, int len,
+                        uint8_t *out )
+{
+    out[0] = START_OF_MSG0;
+    out[1] = START_OF_MSG1;
+    out[2] = id;
+    out[3] = len;
+    memcpy( out + 4, payload, len );
+    uint8_t c0 = 0, c1 = 0;
+    for ( int i = 2; i < len + 4; i++ ) {
+        c0 += out[i];
+        c1 += c0;
+    }
+    out[len + 4] = c0;
+    out[len + 5] = c1;
+    return len + 6;
+}
+
+
+TelemetryCodec::TelemetryCodec():
+    keyframes(0),
+    deltas(0),
+    passthrough(0),
+    dropped(0),
+    bytes_in(0),
+    bytes_out(0),
+    keyframe_sec(5.0),
+    keyframe_count(50)
+{
+}
+
+
+// the prediction for a field gap deltas past the keyframe
+static inline int64_t predict( const int64_t *key, const int64_t *slope,
+                               int i, int gap )
+{
+    return key[i] + ((gap * slope[i] + slope_round) >> slope_shift);
+}
+
+
+// keyframe parameters: the Rice parameter of every field, followed
+// for order 2 fields by the per packet slope
+static bool put_params( BitWriter *w, const codec_layout *lay,
+                        const int *k, const int64_t *slope )
+{
+    for ( int i = 0; i < lay->num_fields; i++ ) {
+        if ( !put_residual( w, k[i], param_k ) ) {
+            return false;
+        }
+        if ( lay->order[i] == '2'
+             && !put_residual( w, slope[i], slope_k ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool get_params( BitReader *r, const codec_layout *lay,
+                        int *k, int64_t *slope )
+{
+    for ( int i = 0; i < lay->num_fields; i++ ) {
+        int64_t v;
+        if ( !get_residual( r, param_k, &v ) || v < 0 || v > 48 ) {
+            return false;
+        }
+        k[i] = v;
+        slope[i] = 0;
+        if ( lay->order[i] == '2'
+             && !get_residual( r, slope_k, &slope[i] ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+int TelemetryCodec::encode( const uint8_t *pkt, int size, double now,
+                            uint8_t *out )
+{
+    bytes_in += size;
+    int id = pkt[2];
+    int len = pkt[3];
+    const uint8_t *payload = pkt + 4;
+    const codec_layout *lay = find_layout(id);
+    if ( lay == NULL || len != lay->size || size != len + 6 ) {
+        memcpy( out, pkt, size );
+        passthrough++;
+        bytes_out += size;
+        return size;
+    }
+
+    int key = (id << 8) | payload[0];
+    map<int, stream_state>::iterator it = streams.find(key);
+    if ( it == streams.end() ) {
+        stream_state empty;
+        memset( &empty, 0, sizeof(empty) );
+        it = streams.insert( std::make_pair(key, empty) ).first;
+    }
+    stream_state &s = it->second;
+
+    int64_t q[MAX_FIELDS];
+    bool ok = quantize( lay, payload, q );
+    int gap = s.since_keyframe + 1;
+
+    uint8_t body[255];
+    int body_len = 0;
+    bool keyframe = !ok || !s.valid
+        || now - s.keyframe_time >= keyframe_sec
+        || gap > keyframe_count || gap > 255;
+    if ( !keyframe ) {
+        body[0] = id;
+        body[1] = s.kseq;
+        // never bigger than the keyframe would be
+        BitWriter w( body + 2, len );
+        int64_t res[MAX_FIELDS];
+        if ( !put_residual( &w, payload[0], 0 ) || !w.put( gap, 8 ) ) {
+            keyframe = true;
+        }
+        for ( int i = 0; !keyframe && i < lay->num_fields; i++ ) {
+            res[i] = q[i] - predict( s.key, s.slope, i, gap );
+            if ( !put_residual( &w, res[i], s.k[i] ) ) {
+                keyframe = true;
+                break;
+            }
+        }
+        if ( !keyframe ) {
+            for ( int i = 0; i < lay->num_fields; i++ ) {
+                s.rice_sum[i] += zigzag( res[i] );
+            }
+            s.rice_count++;
+            s.since_keyframe = gap;
+            deltas++;
+        }
+        body_len = 2 + w.bytes();
+    }
+
+    if ( keyframe ) {
+        s.kseq = (s.kseq + 1) & 0x7f;
+        body[0] = id;
+        body[1] = 0x80 | s.kseq;
+        memcpy( body + 2, payload, len );
+        body_len = len + 2;
+        if ( ok ) {
+            // size the Rice parameters from the residuals against
+            // the previous keyframe, and carry the order 2 slopes
+            // over from it
+            for ( int i = 0; i < lay->num_fields; i++ ) {
+                if ( s.rice_count > 0 ) {
+                    s.k[i] = rice_k( s.rice_sum[i], 2 * s.rice_count );
+                }
+                int64_t slope = 0;
+                if ( lay->order[i] == '2' && s.valid ) {
+                    double step = (double)(q[i] - s.key[i]) / gap;
+                    slope = (int64_t)floor( step * (1 << slope_shift) + 0.5 );
+                }
+                s.slope[i] = slope;
+                s.rice_sum[i] = 0;
+            }
+            s.rice_count = 0;
+            BitWriter w( body + body_len, MAX_PARAM_BYTES );
+            if ( !put_params( &w, lay, s.k, s.slope ) ) {
+                // something wild went by, start over from nothing
+                // (this always fits)
+                memset( s.k, 0, sizeof(s.k) );
+                memset( s.slope, 0, sizeof(s.slope) );
+                w = BitWriter( body + body_len, MAX_PARAM_BYTES );
+                put_params( &w, lay, s.k, s.slope );
+            }
+            body_len += w.bytes();
+            memcpy( s.key, q, lay->num_fields * sizeof(int64_t) );
+            s.keyframe_time = now;
+            s.valid = true;
+        } else {
+            s.valid = false;
+        }
+        s.since_keyframe = 0;
+        keyframes++;
+    }
+
+    int result = wrap_packet( TELEMETRY_DELTA_V1, body, body_len, out );
+    bytes_out += result;
+    return result;
+}
+
+
+int TelemetryCodec::decode( const uint8_t *pkt, int size, uint8_t *out )
+{
+    int len = pkt[3];
+    if ( pkt[2] != TELEMETRY_DELTA_V1 || len < 3 || size != len + 6 ) {
+        return 0;
+    }
+    const uint8_t *body = pkt + 4;
+    int id = body[0];
+    int kseq = body[1] & 0x7f;
+    const codec_layout *lay = find_layout(id);
+    if ( lay == NULL ) {
+        return 0;
+    }
+
+    if ( body[1] & 0x80 ) {
+        if ( len - 2 < lay->size ) {
+            return 0;
+        }
+        int key = (id << 8) | body[2];
+        map<int, stream_state>::iterator it = streams.find(key);
+        if ( it == streams.end() ) {
+            stream_state empty;
+            memset( &empty, 0, sizeof(empty) );
+            it = streams.insert( std::make_pair(key, empty) ).first;
+        }
+        stream_state &s = it->second;
+        s.kseq = kseq;
+        BitReader r( body + 2 + lay->size, len - 2 - lay->size );
+        s.valid = quantize( lay, body + 2, s.key )
+            && get_params( &r, lay, s.k, s.slope );
+        keyframes++;
+        return wrap_packet( id, body + 2, lay->size, out );
+    }
+
+    BitReader r( body + 2, len - 2 );
+    int64_t index;
+    uint64_t distance;
+    if ( !get_residual( &r, 0, &index ) || index < 0 || index > 255
+         || !r.get( 8, &distance ) )
+    {
+        return 0;
+    }
+    int gap = distance;
+    int key = (id << 8) | (int)index;
+    map<int, stream_state>::iterator it = streams.find(key);
+    if ( it == streams.end() || !it->second.valid
+         || it->second.kseq != kseq )
+    {
+        // the keyframe this delta refers to was lost
+        dropped++;
+        return 0;
+    }
+    stream_state &s = it->second;
+
+    int64_t q[MAX_FIELDS];
+    for ( int i = 0; i < lay->num_fields; i++ ) {
+        int64_t res;
+        if ( !get_residual( &r, s.k[i], &res ) ) {
+            return 0;
+        }
+        q[i] = predict( s.key, s.slope, i, gap ) + res;
+    }
+    deltas++;
+
+    uint8_t payload[255];
+    dequantize( lay, q, payload );
+    return wrap_packet( id, payload, lay->size, out );
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Delta / delta-of-delta telemetry encoding for low bandwidth links.
+//
+// Each stream (packet id + sensor index) periodically sends a
+// keyframe (the unmodified payload) followed by residuals against
+// a prediction from that keyframe.  Float fields are quantized to a
+// fixed per-field resolution, smooth fields (time, position) are
+// predicted along the per packet slope measured between the last two
+// keyframes (delta-of-delta), everything else is taken as constant
+// (delta).  Residuals are zigzag mapped and Rice coded with a per
+// field parameter sized from the residuals of the previous keyframe
+// interval, so unchanged fields cost about one bit and noisy ones
+// about their entropy.
+//
+// The radio link carries no per packet acks.  Every delta depends on
+// its keyframe alone: the keyframe carries the slopes and Rice
+// parameters, and the delta carries the keyframe's 7 bit sequence
+// number and its distance from it.  A lost delta costs only itself;
+// a lost keyframe costs the deltas that refer to it, bounded by the
+// keyframe interval.  Only formats listed in the field table are
+// encoded, anything else passes through untouched.
+//
+// Encoded packets use TELEMETRY_DELTA_V1 with payload:
+//   keyframe: orig_id, 0x80 | seq, original payload, parameter bits
+//   delta:    orig_id, seq, bit stream (index, distance, residuals)
+//
+// The field table must match comms/telemetry_codec.py (ground side).
+
+#include <stdint.h>
+
+#include <map>
+using std::map;
+
+class TelemetryCodec {
+
+public:
+
+    TelemetryCodec();
+    ~TelemetryCodec() {}
+
+    // a stream sends a keyframe after this many seconds or deltas
+    // (at most 255), whichever comes first.  This bounds the outage
+    // after a lost keyframe.
+    inline void set_keyframe_interval( double sec, int count ) {
+        keyframe_sec = sec;
+        keyframe_count = count;
+    }
+
+    // encode one wrapped packet (sync, id, len, payload, cksum) into
+    // out (at least size + MAX_GROWTH bytes.)  Returns the wrapped output size;
+    // packets with no table entry are copied unchanged.
+    int encode( const uint8_t *pkt, int size, double now, uint8_t *out );
+
+    // decode one wrapped TELEMETRY_DELTA_V1 packet back into the
+    // original wrapped packet.  Returns the output size, or 0 if the
+    // stream reference was lost (or the packet is malformed.)
+    int decode( const uint8_t *pkt, int size, uint8_t *out );
+
+    // statistics
+    uint32_t keyframes;
+    uint32_t deltas;
+    uint32_t passthrough;
+    uint32_t dropped;           // decode side, keyframe was lost
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+
+    static const int MAX_FIELDS = 24;
+    static const int MAX_PARAM_BYTES = 28;
+    static const int MAX_GROWTH = 2 + MAX_PARAM_BYTES;
+
+private:
+
+    struct stream_state {
+        bool valid;             // holds a usable keyframe
+        int kseq;               // sequence number of that keyframe
+        double keyframe_time;
+        int since_keyframe;     // deltas sent against it
+        int64_t key[MAX_FIELDS];   // keyframe state
+        int64_t slope[MAX_FIELDS]; // order 2 per packet slope
+        int k[MAX_FIELDS];         // Rice parameters
+        uint64_t rice_sum[MAX_FIELDS]; // encoder: residual magnitudes
+        int rice_count;                // since the keyframe
+    };
+
+    double keyframe_sec;
+    int keyframe_count;
+    map<int, stream_state> streams;
+};
@@ -0,0 +1,194 @@
+# decoder for the delta / delta-of-delta telemetry encoding produced
+# by the native remote link transmitter (comms/telemetry_codec.cxx.)
+# The field table here must match the C++ table.
+#
+# TELEMETRY_DELTA_V1 payload:
+#   keyframe: orig_id, 0x80 | seq, original payload, parameter bits
+#   delta:    orig_id, seq, bit stream (index, distance, residuals)
+#
+# Deltas are predicted from their keyframe alone, so a lost delta
+# costs only itself and a lost keyframe the deltas that refer to it.
+
+import math
+import struct
+
+from comms.packet_id import *
+
+# packet id: (struct format, prediction order per field, scale per
+# float field)
+layouts = {
+    GPS_PACKET_V4: ("BfddfhhhdBHHHB", "12222111211111",
+                    [1e3, 1e7, 1e7, 1e2, 1e3]),
+    IMU_PACKET_V4: ("BffffffffffhB", "1211111111111",
+                    [1e3, 1e4, 1e4, 1e4, 1e3, 1e3, 1e3, 1e3, 1e3, 1e3]),
+    AIRDATA_PACKET_V6: ("BfHhhffhHBBB", "121112211111",
+                        [1e3, 1e2, 1e2]),
+    FILTER_PACKET_V4: ("BfddfhhhhhhhhhhhhBB", "1222211111111111111",
+                       [1e3, 1e7, 1e7, 1e2]),
+    ACTUATOR_PACKET_V3: ("BfhhHhhhhhB", "12111111111", [1e3]),
+    PILOT_INPUT_PACKET_V3: ("BfhhhhhhhhB", "12111111111", [1e3]),
+    AP_STATUS_PACKET_V7: ("BfBhhHhhhHHddHHBHB", "121111111111111111",
+                          [1e3, 1e7, 1e7]),
+    SYSTEM_HEALTH_PACKET_V6: ("BfHHHHHHHHHHHHHH", "1211111111111111",
+                              [1e3]),
+}
+
+# Rice coding of the zigzag mapped residuals and the keyframe
+# parameters, see telemetry_codec.cxx
+rice_escape = 8
+param_k = 1
+slope_k = 6
+slope_shift = 6
+
+# per stream (id, index) state: [valid, seq, keyframe state, slopes,
+# Rice parameters]
+streams = {}
+dropped = 0
+
+def field_scales(fmt, scale):
+    result = []
+    fi = 0
+    for c in fmt:
+        if c == 'f' or c == 'd':
+            result.append(scale[fi])
+            fi += 1
+        else:
+            result.append(0)
+    return result
+
+def quantize(fmt, scales, values):
+    q = []
+    for i, v in enumerate(values):
+        if scales[i]:
+            x = v * scales[i] + 0.5
+            if not abs(x) < 4.0e15:
+                return None
+            q.append(int(math.floor(x)))
+        else:
+            q.append(v)
+    return q
+
+def dequantize(fmt, scales, q):
+    values = []
+    for i, c in enumerate(fmt):
+        if scales[i]:
+            values.append(q[i] / scales[i])
+        elif c == 'B':
+            values.append(q[i] & 0xff)
+        elif c == 'H':
+            values.append(q[i] & 0xffff)
+        elif c == 'h':
+            values.append(((q[i] + 0x8000) & 0xffff) - 0x8000)
+        else:
+            values.append(q[i])
+    return values
+
+class bit_reader():
+    def __init__(self, buf):
+        self.buf = buf
+        self.bits = 0
+
+    def get(self, n):
+        if self.bits + n > len(self.buf) * 8:
+            return None
+        v = 0
+        for i in range(n):
+            byte = self.buf[self.bits >> 3]
+            v = (v << 1) | ((byte >> (7 - (self.bits & 7))) & 1)
+            self.bits += 1
+        return v
+
+def get_residual(reader, k):
+    q = 0
+    while q < rice_escape:
+        bit = reader.get(1)
+        if bit is None:
+            return None
+        if not bit:
+            break
+        q += 1
+    if q < rice_escape:
+        low = 0
+        if k:
+            low = reader.get(k)
+            if low is None:
+                return None
+        u = (q << k) | low
+    else:
+        n = reader.get(6)
+        if n is None:
+            return None
+        u = reader.get(n + 1)
+        if u is None:
+            return None
+    return (u >> 1) ^ -(u & 1)
+
+def get_params(reader, order):
+    k = []
+    slope = []
+    for o in order:
+        v = get_residual(reader, param_k)
+        if v is None or v < 0 or v > 48:
+            return None
+        k.append(v)
+        s = 0
+        if o == '2':
+            s = get_residual(reader, slope_k)
+            if s is None:
+                return None
+        slope.append(s)
+    return (k, slope)
+
+def predict(s, i, gap):
+    return s[2][i] + ((gap * s[3][i] + (1 << (slope_shift - 1))) >> slope_shift)
+
+# decode a TELEMETRY_DELTA_V1 payload, returns (packet id, payload)
+# of the original packet or None if its keyframe was lost
+def decode(buf):
+    global dropped
+    if len(buf) < 3:
+        return None
+    id = buf[0]
+    seq = buf[1] & 0x7f
+    if not id in layouts:
+        return None
+    (fmt, order, scale) = layouts[id]
+    scales = field_scales(fmt, scale)
+    size = struct.calcsize('<' + fmt)
+
+    if buf[1] & 0x80:
+        payload = bytes(buf[2:2+size])
+        if len(payload) != size:
+            return None
+        values = struct.unpack('<' + fmt, payload)
+        s = [False, seq, None, None, None]
+        streams[(id, buf[2])] = s
+        q = quantize(fmt, scales, values)
+        params = get_params(bit_reader(buf[2+size:]), order)
+        if q is not None and params is not None:
+            s[0] = True
+            s[2] = q
+            (s[4], s[3]) = params
+        return id, payload
+
+    reader = bit_reader(buf[2:])
+    index = get_residual(reader, 0)
+    gap = reader.get(8)
+    if index is None or index < 0 or index > 255 or gap is None:
+        return None
+    key = (id, index)
+    if not key in streams or not streams[key][0] \
+       or streams[key][1] != seq:
+        # the keyframe this delta refers to was lost
+        dropped += 1
+        return None
+    s = streams[key]
+
+    q = []
+    for i in range(len(fmt)):
+        r = get_residual(reader, s[4][i])
+        if r is None:
+            return None
+        q.append(predict(s, i, gap) + r)
+    payload = struct.pack('<' + fmt, *dequantize(fmt, scales, q))
+    return id, payload
@@ -0,0 +1,167 @@
+// circle.cxx - circle hold navigation (L1 controller)
+//
+// Follows the same property contract as the original circle.py:
+// reads /task/circle (direction, longitude_deg, latitude_deg,
+// radius_m) and /config/autopilot/L1_controller, writes the
+// groundtrack, course error and roll targets to /autopilot/targets.
+
+#include <pyprops.hxx>
+
+#include <math.h>
+#include <string>
+using std::string;
+
+#include "util/wgs84.hxx"
+
+#include "circle.hxx"
+
+static const double d2r = M_PI / 180.0;
+static const double r2d = 180.0 / M_PI;
+static const double gravity = 9.81; // m/sec^2
+
+// property nodes
+static pyPropertyNode circle_node;
+static pyPropertyNode pos_node;
+static pyPropertyNode vel_node;
+static pyPropertyNode orient_node;
+static pyPropertyNode route_node;
+static pyPropertyNode L1_node;
+static pyPropertyNode targets_node;
+
+
+void circle_init() {
+    circle_node = pyGetNode("/task/circle", true);
+    pos_node = pyGetNode("/position", true);
+    vel_node = pyGetNode("/velocity", true);
+    orient_node = pyGetNode("/orientation", true);
+    route_node = pyGetNode("/task/route", true);
+    L1_node = pyGetNode("/config/autopilot/L1_controller", true);
+    targets_node = pyGetNode("/autopilot/targets", true);
+
+    // sanity check, set some conservative values if none are
+    // provided in the autopilot config
+    if ( L1_node.getDouble("bank_limit_deg") < 0.1 ) {
+        L1_node.setDouble("bank_limit_deg", 25.0);
+    }
+    if ( L1_node.getDouble("period") < 0.1 ) {
+        L1_node.setDouble("period", 25.0);
+    }
+}
+
+
+void circle_update(double dt) {
+    double direction = 1.0;
+    if ( circle_node.getString("direction") == "right" ) {
+        direction = -1.0;
+    }
+
+    if ( !pos_node.hasChild("longitude_deg")
+         || !pos_node.hasChild("latitude_deg") ) {
+        // no valid current position, bail out.
+        return;
+    }
+    double pos_lon = pos_node.getDouble("longitude_deg");
+    double pos_lat = pos_node.getDouble("latitude_deg");
+
+    double center_lon, center_lat;
+    if ( circle_node.hasChild("longitude_deg")
+         && circle_node.hasChild("latitude_deg") ) {
+        // we have a valid circle center
+        center_lon = circle_node.getDouble("longitude_deg");
+        center_lat = circle_node.getDouble("latitude_deg");
+    } else {
+        // we have a valid position, but no valid circle center, use
+        // current position.  (sanity fallback)
+        circle_node.setDouble("longitude_deg", pos_lon);
+        circle_node.setDouble("latitude_deg", pos_lat);
+        center_lon = pos_lon;
+        center_lat = pos_lat;
+    }
+
+    // compute course and distance to center of target circle
+    double course_deg, rev_deg, dist_m;
+    geo_inverse_wgs_84( pos_lat, pos_lon, center_lat, center_lon,
+                        &course_deg, &rev_deg, &dist_m );
+
+    // compute ideal ground course to be on the circle perimeter if at
+    // ideal radius
+    double ideal_crs = course_deg + direction * 90;
+    if ( ideal_crs > 360.0 ) { ideal_crs -= 360.0; }
+    if ( ideal_crs < 0.0 ) { ideal_crs += 360.0; }
+
+    // (in)sanity check
+    double radius_m = 100;
+    if ( circle_node.hasChild("radius_m") ) {
+        radius_m = circle_node.getDouble("radius_m");
+        if ( radius_m < 35 ) { radius_m = 35; }
+    }
+
+    // compute a target ground course based on our actual radius
+    // distance
+    double target_crs = ideal_crs;
+    if ( dist_m < radius_m ) {
+        // inside circle, adjust target heading to expand our
+        // circling radius
+        double offset_deg = direction * 90.0 * (1.0 - dist_m / radius_m);
+        target_crs += offset_deg;
+    } else if ( dist_m > radius_m ) {
+        // outside circle, adjust target heading to tighten our
+        // circling radius
+        double offset_dist = dist_m - radius_m;
+        if ( offset_dist > radius_m ) { offset_dist = radius_m; }
+        double offset_deg = direction * 90 * offset_dist / radius_m;
+        target_crs -= offset_deg;
+    }
+    if ( target_crs > 360.0 ) { target_crs -= 360.0; }
+    if ( target_crs < 0.0 ) { target_crs += 360.0; }
+    targets_node.setDouble( "groundtrack_deg", target_crs );
+
+    // L1 'mathematical' response to error
+    double L1_period = L1_node.getDouble("period"); // gain
+    double gs_mps = vel_node.getDouble("groundspeed_ms");
+    double omegaA = M_SQRT2 * M_PI / L1_period;
+    double VomegaA = gs_mps * omegaA;
+    double course_error = orient_node.getDouble("groundtrack_deg") - target_crs;
+    if ( course_error < -180.0 ) { course_error += 360.0; }
+    if ( course_error > 180.0 ) { course_error -= 360.0; }
+    targets_node.setDouble( "course_error_deg", course_error );
+
+    // accel: is the lateral acceleration we need to compensate for
+    // heading error
+    double accel = 2.0 * sin(course_error * d2r) * VomegaA;
+
+    // circling acceleration needed for our current distance from center
+    double turn_accel = 0.0;
+    if ( dist_m > 0.1 ) {
+        turn_accel = direction * gs_mps * gs_mps / dist_m;
+    }
+
+    // allow a crude fudge factor for non-straight airframes or imu
+    // mounting errors.  This is essentially the bank angle that yields
+    // zero turn rate
+    double bank_bias_deg = L1_node.getDouble("bank_bias_deg");
+
+    // compute desired acceleration = acceleration required for course
+    // correction + acceleration required to maintain turn at current
+    // distance from center.
+    double total_accel = accel + turn_accel;
+
+    double target_bank = -atan( total_accel / gravity );
+    double target_bank_deg = target_bank * r2d + bank_bias_deg;
+
+    double bank_limit_deg = L1_node.getDouble("bank_limit_deg");
+    if ( target_bank_deg < -bank_limit_deg + bank_bias_deg ) {
+        target_bank_deg = -bank_limit_deg + bank_bias_deg;
+    }
+    if ( target_bank_deg > bank_limit_deg + bank_bias_deg ) {
+        target_bank_deg = bank_limit_deg + bank_bias_deg;
+    }
+    targets_node.setDouble( "roll_deg", target_bank_deg );
+
+    route_node.setDouble( "wp_dist_m", dist_m );
+    if ( gs_mps > 0.1 ) {
+        route_node.setDouble( "wp_eta_sec", dist_m / gs_mps );
+    } else {
+        route_node.setDouble( "wp_eta_sec", 0.0 );
+    }
+}
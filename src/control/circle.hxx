@@ -0,0 +1,6 @@
+#pragma once
+
+// circle hold: steer a circle of /task/circle/radius_m around the
+// /task/circle center using the L1 controller
+void circle_init();
+void circle_update(double dt);
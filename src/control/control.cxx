@@ -33,17 +33,17 @@
 #include "comms/remote_link.hxx"
 #include "include/globaldefs.h"
 #include "init/globals.hxx"
-#include <pymodule.hxx>
 
 #include "include/util.h"
 #include "ap.hxx"
+#include "geofence.hxx"
+#include "navigation.hxx"
 #include "tecs.hxx"
 
 #include "control.hxx"
 
 
 // global variables
-static pyModuleBase navigation;
 static AuraAutopilot ap;
 
 
@@ -80,7 +80,10 @@ void control_init() {
     logging_skip = logging_node.getDouble("autopilot_skip");
 
     // initialize the navigation module
-    navigation.init("control.navigation");
+    navigation_init();
+
+    // load and index the geofence zones (/config/geofence)
+    geofence_init();
     
     // initialize and build the autopilot controller from the property
     // tree config (/config/autopilot)
@@ -146,7 +149,10 @@ void control_update(double dt)
     update_tecs();
 
     // navigation update (circle or route heading)
-    navigation.update(dt);
+    navigation_update(dt);
+
+    // geofence containment and margin (/task/geofence)
+    geofence_update(dt);
 
     // update the autopilot stages (even in manual flight mode.)  This
     // keeps the differential value up to date, tracks manual inputs,
@@ -0,0 +1,189 @@
+// geofence.cxx - inclusion/exclusion zones checked every control frame
+//
+// Zones come from /config/geofence:
+//
+//   zone[]: name, type ("include" or "exclude"), optional min_agl_ft
+//           and max_agl_ft band, latitude_deg[] and longitude_deg[]
+//
+// The vertices are placed in a north/east frame about their centroid
+// once at startup and indexed (util/geofence), so each frame only
+// converts the aircraft position and looks at the nearby edges.  The
+// result goes to /task/geofence (breach, zone, margin_m) where the
+// mission geofence task picks it up.  Once set, breach only clears
+// after the aircraft is back inside by clear_margin_m (default 10),
+// so flying along a fence line doesn't flicker it.
+
+#include <pyprops.hxx>
+
+#include <math.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+#include "comms/events.hxx"
+#include "include/globaldefs.h"
+#include "init/globals.hxx"
+#include "util/geofence.hxx"
+#include "util/wgs84.hxx"
+
+#include "geofence.hxx"
+
+static GeoFence fence;
+static bool breach = false;
+static double clear_margin_m = 10.0;
+
+// local frame: earth centered origin and the north/east rows of the
+// rotation into it, set up once in geofence_init()
+static double ref_ecef[3];
+static double ref_rot[2][3];
+
+// property nodes
+static pyPropertyNode pos_node;
+static pyPropertyNode fence_node;
+
+
+static void set_reference( double lat_deg, double lon_deg ) {
+    geod2ecef_wgs_84( lat_deg, lon_deg, 0.0,
+                      &ref_ecef[0], &ref_ecef[1], &ref_ecef[2] );
+    double sinlat = sin( lat_deg * SGD_DEGREES_TO_RADIANS );
+    double coslat = cos( lat_deg * SGD_DEGREES_TO_RADIANS );
+    double sinlon = sin( lon_deg * SGD_DEGREES_TO_RADIANS );
+    double coslon = cos( lon_deg * SGD_DEGREES_TO_RADIANS );
+    ref_rot[0][0] = -sinlat * coslon;
+    ref_rot[0][1] = -sinlat * sinlon;
+    ref_rot[0][2] = coslat;
+    ref_rot[1][0] = -sinlon;
+    ref_rot[1][1] = coslon;
+    ref_rot[1][2] = 0.0;
+}
+
+// lat/lon (degrees) to the local north/east frame of the fence
+static void to_local( double lat_deg, double lon_deg,
+                      double *north, double *east )
+{
+    double x, y, z;
+    geod2ecef_wgs_84( lat_deg, lon_deg, 0.0, &x, &y, &z );
+    x -= ref_ecef[0];
+    y -= ref_ecef[1];
+    z -= ref_ecef[2];
+    *north = ref_rot[0][0] * x + ref_rot[0][1] * y + ref_rot[0][2] * z;
+    *east = ref_rot[1][0] * x + ref_rot[1][1] * y + ref_rot[1][2] * z;
+}
+
+
+void geofence_init() {
+    pos_node = pyGetNode("/position", true);
+    fence_node = pyGetNode("/task/geofence", true);
+    fence_node.setBool("enabled", false);
+    fence_node.setBool("breach", false);
+    fence_node.setString("zone", "");
+
+    pyPropertyNode config_node = pyGetNode("/config/geofence", true);
+    if ( config_node.hasChild("clear_margin_m") ) {
+        clear_margin_m = config_node.getDouble("clear_margin_m");
+    }
+    int num = config_node.getLen("zone");
+    if ( num <= 0 ) {
+        return;
+    }
+
+    // read everything first, the frame is centered on all the vertices
+    vector< vector<double> > lats( num ), lons( num );
+    double sum_lat = 0.0, sum_lon = 0.0;
+    int total = 0;
+    for ( int i = 0; i < num; i++ ) {
+        pyPropertyNode zone_node = config_node.getChild("zone", i, true);
+        int len = zone_node.getLen("latitude_deg");
+        if ( zone_node.getLen("longitude_deg") != len ) {
+            printf("geofence: zone %d latitude/longitude count mismatch\n", i);
+            continue;
+        }
+        for ( int j = 0; j < len; j++ ) {
+            lats[i].push_back( zone_node.getDouble("latitude_deg", j) );
+            lons[i].push_back( zone_node.getDouble("longitude_deg", j) );
+            sum_lat += lats[i].back();
+            sum_lon += lons[i].back();
+        }
+        total += len;
+    }
+    if ( total == 0 ) {
+        return;
+    }
+    set_reference( sum_lat / total, sum_lon / total );
+
+    for ( int i = 0; i < num; i++ ) {
+        pyPropertyNode zone_node = config_node.getChild("zone", i, true);
+        string name = zone_node.getString("name");
+        string type = zone_node.getString("type");
+        if ( type != "include" && type != "exclude" ) {
+            printf("geofence: zone %s unknown type '%s'\n",
+                   name.c_str(), type.c_str());
+            continue;
+        }
+        double min_agl_m = -1.0e9;
+        double max_agl_m = 1.0e9;
+        if ( zone_node.hasChild("min_agl_ft") ) {
+            min_agl_m = zone_node.getDouble("min_agl_ft") * SG_FEET_TO_METER;
+        }
+        if ( zone_node.hasChild("max_agl_ft") ) {
+            max_agl_m = zone_node.getDouble("max_agl_ft") * SG_FEET_TO_METER;
+        }
+
+        int len = lats[i].size();
+        vector<FencePoint> poly( len );
+        for ( int j = 0; j < len; j++ ) {
+            to_local( lats[i][j], lons[i][j], &poly[j].x, &poly[j].y );
+        }
+        if ( !fence.add_zone( name, type == "include", poly,
+                              min_agl_m, max_agl_m ) )
+        {
+            printf("geofence: zone %s needs at least 3 vertices\n",
+                   name.c_str());
+            continue;
+        }
+        printf("geofence: %s zone %s, %d vertices\n",
+               type.c_str(), name.c_str(), len);
+    }
+    fence_node.setBool("enabled", fence.zones.size() > 0);
+}
+
+
+void geofence_update(double dt) {
+    if ( fence.zones.empty() ) {
+        return;
+    }
+
+    double lat = pos_node.getDouble("latitude_deg");
+    double lon = pos_node.getDouble("longitude_deg");
+    double north, east;
+    to_local( lat, lon, &north, &east );
+    FenceStatus s = fence.check( north, east,
+                                 pos_node.getDouble("altitude_agl_m") );
+
+    static const string none;
+    const string &zone = s.zone >= 0 ? fence.zones[s.zone].name : none;
+
+    bool last_breach = breach;
+    if ( s.breach ) {
+        breach = true;
+    } else if ( s.margin_m >= clear_margin_m ) {
+        breach = false;
+    }
+    fence_node.setBool("breach", breach);
+    fence_node.setString("zone", zone);
+    fence_node.setDouble("margin_m", s.margin_m);
+
+    if ( breach != last_breach ) {
+        char buf[128];
+        if ( breach ) {
+            snprintf( buf, sizeof(buf), "breach of zone %s (%.0f m)",
+                      zone.c_str(), -s.margin_m );
+        } else {
+            snprintf( buf, sizeof(buf), "clear (%.0f m inside)", s.margin_m );
+        }
+        events->log("geofence", buf);
+    }
+}
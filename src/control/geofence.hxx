@@ -0,0 +1,6 @@
+#pragma once
+
+// geofence zones (/config/geofence) checked every control frame,
+// status published under /task/geofence
+void geofence_init();
+void geofence_update(double dt);
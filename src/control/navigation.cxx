@@ -0,0 +1,48 @@
+// navigation.cxx - high level navigation modes
+//
+// Circle hold and route following run natively at the full control
+// rate.  Route uploads over the link (/task/route/route_request) are
+// still parsed and swapped active by the control.navigation python
+// module, which is only called when a request is pending.
+
+#include <pyprops.hxx>
+#include <pymodule.hxx>
+
+#include <string>
+using std::string;
+
+#include "circle.hxx"
+#include "route.hxx"
+
+#include "navigation.hxx"
+
+static pyModuleBase route_requests;
+
+// property nodes
+static pyPropertyNode nav_node;
+static pyPropertyNode route_node;
+
+
+void navigation_init() {
+    nav_node = pyGetNode("/navigation", true);
+    route_node = pyGetNode("/task/route", true);
+
+    route_requests.init("control.navigation");
+
+    circle_init();
+    route_init();
+}
+
+
+void navigation_update(double dt) {
+    if ( route_node.getString("route_request").length() ) {
+        route_requests.update(dt);
+    }
+
+    string mode = nav_node.getString("mode");
+    if ( mode == "circle" ) {
+        circle_update(dt);
+    } else if ( mode == "route" ) {
+        route_update(dt);
+    }
+}
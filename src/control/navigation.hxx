@@ -0,0 +1,5 @@
+#pragma once
+
+// high level navigation modes (circle or route)
+void navigation_init();
+void navigation_update(double dt);
@@ -1,18 +1,25 @@
-# high level navigation modes
+# route upload handling for the native navigation module
+#
+# Circle hold and route following run in C++ (navigation.cxx).  This
+# module is only updated when a route request is pending.
 
 from props import getNode
 
-import control.circle as circle
 import control.route as route
 
-nav_node = getNode("/navigation", True)
+route_node = getNode('/task/route', True)
 
 def init():
-    circle.init()
-    route.init()
+    pass
 
 def update(dt):
-    if nav_node.getString("mode") == 'circle':
-        circle.update(dt)
-    elif nav_node.getString("mode") == 'route':
-        route.update(dt)
+    request = route_node.getString('route_request')
+    if len(request):
+        result = ''
+        if route.build_str(request):
+            route.swap()
+            result = 'success: ' + request
+        else:
+            result = 'failed: ' + request
+        route_node.setString('request_result', result)
+        route_node.setString('route_request', '')
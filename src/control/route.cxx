@@ -0,0 +1,493 @@
+// route.cxx - route following navigation (L1 controller)
+//
+// The route itself is built and swapped active by control/route.py
+// (uploads, mission routes, surveys), which publishes the waypoints
+// under /task/route/active and bumps route_serial.  This module
+// loads a route when the serial changes, resolves home relative
+// waypoints, and does the per frame leg sequencing and L1 guidance
+// with the same /task/route property contract as the original
+// route.py.
+//
+// Each route is compiled into a leg table when it is loaded (or home
+// moves): waypoint ECEF positions, the unit direction of the leg
+// arriving at each waypoint, leg lengths and the distance remaining
+// from each waypoint to the end of the route.  Per frame tracking is
+// then a couple of dot products in the local level frame at the
+// aircraft instead of two iterative geodesic solutions, and the cost
+// doesn't depend on the route length.
+
+#include <pyprops.hxx>
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+#include <eigen3/Eigen/Core>
+using namespace Eigen;
+
+#include "init/globals.hxx"
+#include "util/wgs84.hxx"
+#include "util/windtri.hxx"
+
+#include "route.hxx"
+
+static const double d2r = M_PI / 180.0;
+static const double r2d = 180.0 / M_PI;
+static const double kt2mps = 0.5144444444444444444;
+static const double gravity = 9.81; // m/sec^2
+
+// property nodes
+static pyPropertyNode route_node;
+static pyPropertyNode pos_node;
+static pyPropertyNode vel_node;
+static pyPropertyNode orient_node;
+static pyPropertyNode home_node;
+static pyPropertyNode active_node;
+static pyPropertyNode L1_node;
+static pyPropertyNode targets_node;
+static pyPropertyNode gps_node;
+static pyPropertyNode wind_node;
+
+struct Waypoint {
+    bool relative;              // position is relative to home
+    double lon_deg;
+    double lat_deg;
+    double hdg_deg;             // relative to the home azimuth
+    double dist_m;
+    double leg_dist_m;          // distance to the next waypoint
+
+    // leg table (see update_legs())
+    Vector3d ecef;              // position (at zero altitude)
+    Vector3d leg_dir;           // unit direction of the leg ending here
+    double remaining_m;         // distance from here to the end
+};
+
+static vector<Waypoint> active_route;
+static long route_serial = 0;
+static int current_wp = 0;
+static bool acquired = false;
+
+static double last_lon = 0.0;
+static double last_lat = 0.0;
+static double last_az = 0.0;
+
+
+void route_init() {
+    route_node = pyGetNode("/task/route", true);
+    pos_node = pyGetNode("/position", true);
+    vel_node = pyGetNode("/velocity", true);
+    orient_node = pyGetNode("/orientation", true);
+    home_node = pyGetNode("/task/home", true);
+    active_node = pyGetNode("/task/route/active", true);
+    L1_node = pyGetNode("/config/autopilot/L1_controller", true);
+    targets_node = pyGetNode("/autopilot/targets", true);
+    gps_node = pyGetNode("/sensors/gps", true);
+    wind_node = pyGetNode("/filters/wind", true);
+
+    // sanity check, set some conservative values if none are
+    // provided in the autopilot config
+    if ( L1_node.getDouble("bank_limit_deg") < 0.1 ) {
+        L1_node.setDouble("bank_limit_deg", 25.0);
+    }
+    if ( L1_node.getDouble("period") < 0.1 ) {
+        L1_node.setDouble("period", 25.0);
+    }
+    if ( L1_node.getDouble("damping") < 0.1 ) {
+        L1_node.setDouble("damping", 0.7);
+    }
+
+    // defaults
+    route_node.setString("follow_mode", "leader");
+    route_node.setString("start_mode", "first_wpt");
+    route_node.setString("completion_mode", "loop");
+}
+
+
+static int previous_wp( int i ) {
+    int prev = i - 1;
+    if ( prev < 0 ) {
+        prev = active_route.size() - 1;
+    }
+    return prev;
+}
+
+
+static Vector3d geod2ecef( double lat_deg, double lon_deg ) {
+    Vector3d p;
+    geod2ecef_wgs_84( lat_deg, lon_deg, 0.0, &p(0), &p(1), &p(2) );
+    return p;
+}
+
+
+// compile the leg table for the current waypoint positions.  The leg
+// ending at waypoint i starts at the previous waypoint (the last one
+// for waypoint 0.)  The last waypoint has no outbound leg distance.
+static void update_legs() {
+    int size = active_route.size();
+    for ( int i = 0; i < size; i++ ) {
+        Waypoint &wp = active_route[i];
+        wp.ecef = geod2ecef( wp.lat_deg, wp.lon_deg );
+    }
+    for ( int i = 0; i < size; i++ ) {
+        Waypoint &wp = active_route[i];
+        Vector3d leg = wp.ecef - active_route[previous_wp(i)].ecef;
+        double len = leg.norm();
+        if ( len > 0.01 ) {
+            wp.leg_dir = leg / len;
+        } else {
+            wp.leg_dir.setZero();
+        }
+        wp.leg_dist_m = 0.0;
+        if ( i + 1 < size ) {
+            Waypoint &next = active_route[i+1];
+            double leg_course, rev_course;
+            geo_inverse_wgs_84( wp.lat_deg, wp.lon_deg,
+                                next.lat_deg, next.lon_deg,
+                                &leg_course, &rev_course, &wp.leg_dist_m );
+        }
+    }
+    double remaining_m = 0.0;
+    for ( int i = size - 1; i >= 0; i-- ) {
+        remaining_m += active_route[i].leg_dist_m;
+        active_route[i].remaining_m = remaining_m;
+    }
+    route_node.setBool("dist_valid", size > 0);
+}
+
+
+// update the position of home relative waypoints when home moves (and
+// publish their new positions)
+static void reposition(bool force) {
+    double home_lon = home_node.getDouble("longitude_deg");
+    double home_lat = home_node.getDouble("latitude_deg");
+    double home_az = home_node.getDouble("azimuth_deg");
+
+    if ( force || fabs(home_lon - last_lon) > 0.000001 ||
+         fabs(home_lat - last_lat) > 0.000001 ||
+         fabs(home_az - last_az) > 0.001 )
+    {
+        bool changed = false;
+        for ( unsigned int i = 0; i < active_route.size(); i++ ) {
+            Waypoint &wp = active_route[i];
+            if ( !wp.relative ) {
+                continue;
+            }
+            double course = home_az + wp.hdg_deg;
+            if ( course < 0.0 ) { course += 360.0; }
+            if ( course > 360.0 ) { course -= 360.0; }
+            double az2;
+            geo_direct_wgs_84( home_lat, home_lon, course, wp.dist_m,
+                               &wp.lat_deg, &wp.lon_deg, &az2 );
+            pyPropertyNode wp_node = active_node.getChild("wpt", i, true);
+            wp_node.setDouble("longitude_deg", wp.lon_deg);
+            wp_node.setDouble("latitude_deg", wp.lat_deg);
+            changed = true;
+        }
+        if ( changed || force ) {
+            update_legs();
+        }
+        if ( display_on ) {
+            printf("ROUTE pattern updated: %.6f %.6f (course = %.1f)\n",
+                   home_lon, home_lat, home_az);
+        }
+        last_lon = home_lon;
+        last_lat = home_lat;
+        last_az = home_az;
+    }
+}
+
+
+// load the active route published by route.py
+static void load_route() {
+    int route_size = active_node.getLong("route_size");
+    active_route.resize(route_size);
+    for ( int i = 0; i < route_size; i++ ) {
+        pyPropertyNode wp_node = active_node.getChild("wpt", i, true);
+        Waypoint &wp = active_route[i];
+        wp.relative = (wp_node.getString("mode") == "relative");
+        wp.lon_deg = wp_node.getDouble("longitude_deg");
+        wp.lat_deg = wp_node.getDouble("latitude_deg");
+        wp.hdg_deg = wp_node.getDouble("heading_deg");
+        wp.dist_m = wp_node.getDouble("dist_m");
+        wp.leg_dist_m = 0.0;
+    }
+    current_wp = 0;     // make sure we start at beginning
+    reposition(true);
+    if ( display_on ) {
+        printf("route: loaded %d waypoints\n", route_size);
+    }
+}
+
+
+static void increment_current_wp() {
+    if ( current_wp < (int)active_route.size() - 1 ) {
+        current_wp++;
+    } else {
+        current_wp = 0;
+    }
+}
+
+
+// Given wind speed, wind direction, and true airspeed (from the
+// property tree), as well as a current ground course, and a target
+// ground course, compute the estimated true heading (psi, aircraft
+// body heading) difference that will take us from the current ground
+// course to the target ground course.
+//
+// Note: this produces accurate tracking, even if the wind estimate is
+// wrong.  The primary affect of a poor wind estimate is sub-optimal
+// heading error gain.  i.e. the when the current course and target
+// course are aligned, this function always produces zero error.
+static double wind_heading_error( double current_crs_deg,
+                                  double target_crs_deg )
+{
+    double ws_kt = wind_node.getDouble("wind_speed_kt");
+    double tas_kt = wind_node.getDouble("true_airspeed_kt");
+    double wd_deg = wind_node.getDouble("wind_dir_deg");
+    double est_cur_hdg_deg, gs1_kt;
+    double est_nav_hdg_deg, gs2_kt;
+    bool cur_ok = wind_course( ws_kt, tas_kt, wd_deg, current_crs_deg,
+                               &est_cur_hdg_deg, &gs1_kt );
+    bool nav_ok = wind_course( ws_kt, tas_kt, wd_deg, target_crs_deg,
+                               &est_nav_hdg_deg, &gs2_kt );
+    double hdg_error;
+    if ( cur_ok && nav_ok ) {
+        // life is good
+        hdg_error = est_cur_hdg_deg - est_nav_hdg_deg;
+    } else if ( tas_kt <= 0.1 ) {
+        // no airspeed estimate to build a wind triangle with, use
+        // the ground track error
+        hdg_error = current_crs_deg - target_crs_deg;
+    } else {
+        // Yikes, course cannot be flown, wind too strong!  Compute a
+        // heading error relative to the wind 'from' direction.  This
+        // will cause the aircraft to point it's nose into the wind
+        // and kite.  This minimizes a bad situation and gives the
+        // operator maximum time to take corrective action.  But
+        // hurry and do something!
+        hdg_error = orient_node.getDouble("heading_deg") - wd_deg;
+    }
+
+    if ( hdg_error < -180 ) { hdg_error += 360; }
+    if ( hdg_error > 180 ) { hdg_error -= 360; }
+    return hdg_error;
+}
+
+
+void route_update(double dt) {
+    long serial = active_node.getLong("route_serial");
+    if ( serial != route_serial ) {
+        route_serial = serial;
+        load_route();
+    }
+
+    reposition(false);
+
+    double nav_course = 0.0;
+    double nav_dist_m = 0.0;
+    double direct_dist = 0.0;
+
+    route_node.setLong("route_size", active_route.size());
+    if ( active_route.size() > 0 ) {
+        if ( gps_node.getDouble("data_age") < 10.0 ) {
+            // track current waypoint of route (only!) if we have
+            // recent gps data
+
+            // route start up logic: if start_mode == first_wpt then
+            // there is nothing to do, we simply continue to track wpt
+            // 0 if that is the current waypoint.  If start_mode ==
+            // 'first_leg', then if we are tracking wpt 0, increment
+            // it so we track the 2nd waypoint along the first leg.
+            // If only a 1 point route is given along with first_leg
+            // startup behavior, then don't do that again, force some
+            // sort of sane route parameters instead!
+            string start_mode = route_node.getString("start_mode");
+            if ( start_mode == "first_leg" && current_wp == 0 ) {
+                if ( active_route.size() > 1 ) {
+                    current_wp++;
+                } else {
+                    route_node.setString("start_mode", "first_wpt");
+                    route_node.setString("follow_mode", "direct");
+                }
+            }
+
+            double L1_period = L1_node.getDouble("period");
+            double L1_damping = L1_node.getDouble("damping");
+            double gs_mps = vel_node.getDouble("groundspeed_ms");
+            double groundtrack_deg = orient_node.getDouble("groundtrack_deg");
+            double tas_kt = wind_node.getDouble("true_airspeed_kt");
+            double tas_mps = tas_kt * kt2mps;
+
+            const Waypoint &wp = active_route[current_wp];
+
+            // local level (north, east) axes at the aircraft
+            double pos_lon = pos_node.getDouble("longitude_deg");
+            double pos_lat = pos_node.getDouble("latitude_deg");
+            double sinlat = sin(pos_lat * d2r), coslat = cos(pos_lat * d2r);
+            double sinlon = sin(pos_lon * d2r), coslon = cos(pos_lon * d2r);
+            Vector3d north( -sinlat * coslon, -sinlat * sinlon, coslat );
+            Vector3d east( -sinlon, coslon, 0.0 );
+
+            // compute direct-to course and distance
+            Vector3d d = wp.ecef - geod2ecef( pos_lat, pos_lon );
+            double dn = d.dot(north);
+            double de = d.dot(east);
+            direct_dist = sqrt( dn*dn + de*de );
+            double direct_course = atan2( de, dn ) * r2d;
+            if ( direct_course < 0.0 ) { direct_course += 360.0; }
+
+            // compute leg course (of the leg ending at the current
+            // waypoint)
+            double leg_course = atan2( wp.leg_dir.dot(east),
+                                       wp.leg_dir.dot(north) ) * r2d;
+            if ( leg_course < 0.0 ) { leg_course += 360.0; }
+
+            // difference between ideal (leg) course and direct course
+            double angle = leg_course - direct_course;
+            if ( angle < -180.0 ) {
+                angle += 360.0;
+            } else if ( angle > 180.0 ) {
+                angle -= 360.0;
+            }
+
+            // compute cross-track error
+            double angle_rad = angle * d2r;
+            double xtrack_m = sin(angle_rad) * direct_dist;
+            double dist_m = cos(angle_rad) * direct_dist;
+            route_node.setDouble( "xtrack_dist_m", xtrack_m );
+            route_node.setDouble( "projected_dist_m", dist_m );
+
+            // default distance for waypoint acquisition = direct
+            // distance to the target waypoint.  This can be
+            // overridden later by leg following and replaced with
+            // distance remaining along the leg.
+            nav_dist_m = direct_dist;
+
+            string follow_mode = route_node.getString("follow_mode");
+            string completion_mode = route_node.getString("completion_mode");
+            if ( follow_mode == "direct" ) {
+                // steer direct to
+                nav_course = direct_course;
+            } else if ( follow_mode == "leader" ) {
+                // scale our L1_dist (something like a target heading
+                // gain) proportional to ground speed
+                double L1_dist = (1.0 / M_PI) * L1_damping * L1_period * gs_mps;
+                double wangle = 0.0;
+                if ( L1_dist < 1.0 ) {
+                    // ground really small or negative (problem?!?)
+                    L1_dist = 1.0;
+                }
+                if ( L1_dist <= fabs(xtrack_m) ) {
+                    // beyond L1 distance, steer as directly toward
+                    // leg as allowed
+                    wangle = 0.0;
+                } else {
+                    // steer towards imaginary point projected onto
+                    // the route leg L1_distance ahead of us
+                    wangle = acos(fabs(xtrack_m) / L1_dist) * r2d;
+                }
+                if ( wangle < 30.0 ) { wangle = 30.0; }
+                if ( xtrack_m > 0.0 ) {
+                    nav_course = direct_course + angle - 90.0 + wangle;
+                } else {
+                    nav_course = direct_course + angle + 90.0 - wangle;
+                }
+                if ( acquired ) {
+                    nav_dist_m = dist_m;
+                } else {
+                    // direct to first waypoint until we've acquired
+                    // this route
+                    nav_course = direct_course;
+                    nav_dist_m = direct_dist;
+                }
+            }
+            // note: the xtrack_direct_hdg and xtrack_leg_hdg cross
+            // track steering modes are deprecated.  See route_mgr.cxx
+            // in the historical archives for reference code.
+
+            if ( nav_course < 0.0 ) { nav_course += 360.0; }
+            if ( nav_course > 360.0 ) { nav_course -= 360.0; }
+
+            targets_node.setDouble( "groundtrack_deg", nav_course );
+
+            // allow a crude fudge factor for non-straight airframes
+            // or imu mounting errors.  This is essentially the bank
+            // angle that yields zero turn rate
+            double bank_bias_deg = L1_node.getDouble("bank_bias_deg");
+
+            // heading error is computed with wind triangles so this
+            // is the actual body heading error, not the ground track
+            // error, thus Vomega is computed with tas_mps, not gs_mps
+            double omegaA = M_SQRT2 * M_PI / L1_period;
+            double VomegaA = tas_mps * omegaA;
+            double hdg_error = wind_heading_error(groundtrack_deg, nav_course);
+            targets_node.setDouble( "heading_error_deg", hdg_error );
+
+            double accel = 2.0 * sin(hdg_error * d2r) * VomegaA;
+
+            double target_bank_deg = -atan( accel / gravity ) * r2d
+                + bank_bias_deg;
+
+            double bank_limit_deg = L1_node.getDouble("bank_limit_deg");
+            if ( target_bank_deg < -bank_limit_deg + bank_bias_deg ) {
+                target_bank_deg = -bank_limit_deg + bank_bias_deg;
+            }
+            if ( target_bank_deg > bank_limit_deg + bank_bias_deg ) {
+                target_bank_deg = bank_limit_deg + bank_bias_deg;
+            }
+            targets_node.setDouble( "roll_deg", target_bank_deg );
+
+            // estimate distance remaining to completion of route
+            double dist_remaining_m = nav_dist_m
+                + active_route[current_wp].remaining_m;
+            route_node.setDouble("dist_remaining_m", dist_remaining_m);
+
+            // logic to mark completion of leg and move to next leg.
+            bool last_wp = (current_wp >= (int)active_route.size() - 1);
+            if ( completion_mode == "loop" ) {
+                if ( nav_dist_m < 50.0 ) {
+                    acquired = true;
+                    increment_current_wp();
+                }
+            } else if ( completion_mode == "circle_last_wpt" ) {
+                if ( nav_dist_m < 50.0 ) {
+                    acquired = true;
+                    if ( !last_wp ) {
+                        increment_current_wp();
+                    } else {
+                        // FIXME: NEED TO GO TO CIRCLE MODE HERE SOME
+                        // HOW!!!
+                    }
+                }
+            } else if ( completion_mode == "extend_last_leg" ) {
+                if ( nav_dist_m < 50.0 ) {
+                    acquired = true;
+                    if ( !last_wp ) {
+                        increment_current_wp();
+                    } else {
+                        // follow the last leg forever
+                    }
+                }
+            }
+
+            // publish current target waypoint
+            route_node.setLong("target_waypoint_idx", current_wp);
+        }
+    } else {
+        // FIXME: we've been commanded to follow a route, but no
+        // route has been defined.  We are in ill-defined territory,
+        // should we do some sort of circle of our home position?
+    }
+
+    route_node.setDouble("wp_dist_m", direct_dist);
+
+    double gs_mps = vel_node.getDouble("groundspeed_ms");
+    if ( gs_mps > 0.1 ) {
+        route_node.setDouble("wp_eta_sec", direct_dist / gs_mps);
+    } else {
+        route_node.setDouble("wp_eta_sec", 0.0);
+    }
+}
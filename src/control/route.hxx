@@ -0,0 +1,6 @@
+#pragma once
+
+// route following: track the active route published under
+// /task/route/active with the L1 controller and sequence the legs
+void route_init();
+void route_update(double dt);
@@ -23,6 +23,7 @@ using std::ostringstream;
 #include "filters/nav_ekf15_mag/aura_interface.hxx"
 #include "include/globaldefs.h"
 #include "init/globals.hxx"
+#include "sensors/imu_batch.hxx"
 #include "util/myprof.hxx"
 
 #include "ground.hxx"
@@ -273,6 +274,11 @@ bool Filter_update() {
 	}
     }
 
+    // the imu batch spans one frame, whatever the filters above
+    // didn't take would otherwise pile up (and keep the sync driver
+    // from ever waiting for a full frame again)
+    imu_batch_clear();
+
     filter_prof.stop();
 
     if ( fresh_filter_data ) {
@@ -1,42 +1,215 @@
 #include <pyprops.hxx>
 
+#include <math.h>
+#include <stdio.h>
+
 #include "include/globaldefs.h"
 #include "util/lowpass.hxx"
+#include "util/terrain.hxx"
+#include "util/wgs84.hxx"
 
 static pyPropertyNode filter_node;
 static pyPropertyNode pos_filter_node;
 static pyPropertyNode task_node;
+static pyPropertyNode home_node;
+static pyPropertyNode active_node;
 
 // initial values are the 'time factor'
 static LowPassFilter ground_alt_filt( 30.0 );
 
 static bool ground_alt_calibrated = false;
 
+// terrain elevation from DEM tiles (when configured).  Height above
+// the terrain is published on its own.  The autopilot altitude
+// targets (and the landing glide slope) are relative to the launch
+// altitude, so altitude_agl_m only follows the terrain when asked to
+// (use_for_agl) and falls back to the launch altitude off the tiles.
+// Switching between the two would step altitude_agl_m by the launch
+// to terrain difference, so the step is carried as an offset that
+// decays over blend_sec instead.
+static Terrain terrain;
+static bool terrain_enabled = false;
+static bool terrain_for_agl = false;
+static double blend_sec = 10.0;
+static bool agl_ref_init = false;
+static bool agl_on_terrain = false;     // reference used last frame
+static double agl_ref_m = 0.0;          // and its value
+static double agl_offset_m = 0.0;       // switch step still to decay
+static double lookahead_sec = 30.0;     // clearance look ahead time
+static int lookahead_samples = 16;      // points along the look ahead
+static long route_serial = -1;
+
+
+// start reading in the terrain along the legs of a newly published
+// route (relative waypoints are placed from home like route.cxx)
+static void prefetch_route() {
+    int size = active_node.getLong("route_size");
+    double home_lon = home_node.getDouble("longitude_deg");
+    double home_lat = home_node.getDouble("latitude_deg");
+    double home_az = home_node.getDouble("azimuth_deg");
+    double first_lat = 0.0, first_lon = 0.0;
+    double last_lat = 0.0, last_lon = 0.0;
+    for ( int i = 0; i < size; i++ ) {
+        pyPropertyNode wp_node = active_node.getChild("wpt", i, true);
+        double lat = wp_node.getDouble("latitude_deg");
+        double lon = wp_node.getDouble("longitude_deg");
+        if ( wp_node.getString("mode") == "relative" ) {
+            double course = home_az + wp_node.getDouble("heading_deg");
+            if ( course < 0.0 ) { course += 360.0; }
+            if ( course > 360.0 ) { course -= 360.0; }
+            double az2;
+            geo_direct_wgs_84( home_lat, home_lon, course,
+                               wp_node.getDouble("dist_m"),
+                               &lat, &lon, &az2 );
+        }
+        if ( i == 0 ) {
+            first_lat = lat;
+            first_lon = lon;
+        } else {
+            terrain.prefetch( last_lat, last_lon, lat, lon );
+        }
+        last_lat = lat;
+        last_lon = lon;
+    }
+    // (and the closing leg of a looped route)
+    if ( size > 2 ) {
+        terrain.prefetch( last_lat, last_lon, first_lat, first_lon );
+    }
+}
+
+
+// lowest clearance above the terrain along the current flight path
+// (ground track, ground speed and vertical speed held) over the
+// next lookahead_sec.  False if any point had no terrain.
+static bool lookahead_clearance( double lat_deg, double lon_deg,
+                                 double alt_m, double *clearance_m )
+{
+    double track = filter_node.getDouble("groundtrack_deg")
+        * SGD_DEGREES_TO_RADIANS;
+    double gs = filter_node.getDouble("groundspeed_ms");
+    double vd = filter_node.getDouble("vd_ms");
+
+    // local flat earth offsets are plenty over a few km
+    const double radius_m = 6378137.0;
+    double m2lat = SGD_RADIANS_TO_DEGREES / radius_m;
+    double m2lon = m2lat / cos( lat_deg * SGD_DEGREES_TO_RADIANS );
+    double dn = cos(track) * gs;
+    double de = sin(track) * gs;
+
+    double min_clear = 1.0e9;
+    for ( int i = 1; i <= lookahead_samples; i++ ) {
+        double t = lookahead_sec * i / lookahead_samples;
+        double elev;
+        if ( !terrain.get_elevation( lat_deg + dn * t * m2lat,
+                                     lon_deg + de * t * m2lon, &elev ) )
+        {
+            return false;
+        }
+        double clear = (alt_m - vd * t) - elev;
+        if ( clear < min_clear ) {
+            min_clear = clear;
+        }
+    }
+    *clearance_m = min_clear;
+    return true;
+}
+
+
 // initialize ground estimator variables
 void init_ground() {
     filter_node = pyGetNode("/filters/filter", true);
     pos_filter_node = pyGetNode("/position/filter", true);
     task_node = pyGetNode("/task", true);
+    home_node = pyGetNode("/task/home", true);
+    active_node = pyGetNode("/task/route/active", true);
+
+    // path: directory of .dem tiles (see utils/terrain)
+    pyPropertyNode terrain_node = pyGetNode("/config/terrain", true);
+    string path = terrain_node.getString("path");
+    if ( path.length() ) {
+        terrain.set_dir( path );
+        terrain_enabled = true;
+        terrain_for_agl = terrain_node.getBool("use_for_agl");
+        if ( terrain_node.hasChild("blend_sec") ) {
+            blend_sec = terrain_node.getDouble("blend_sec");
+        }
+        if ( terrain_node.hasChild("lookahead_sec") ) {
+            lookahead_sec = terrain_node.getDouble("lookahead_sec");
+        }
+        if ( terrain_node.hasChild("lookahead_samples") ) {
+            lookahead_samples = terrain_node.getLong("lookahead_samples");
+            if ( lookahead_samples < 1 ) {
+                lookahead_samples = 1;
+            }
+        }
+        printf("ground: terrain tiles from %s\n", path.c_str());
+    }
+    pos_filter_node.setBool( "terrain_valid", false );
+    pos_filter_node.setBool( "terrain_clearance_valid", false );
 }
 
 void update_ground(double dt) {
+    double alt_m = filter_node.getDouble("altitude_m");
+
     // determine ground reference altitude.  Average filter altitude
     // over the most recent 30 seconds that we are !is_airborne
     if ( !ground_alt_calibrated ) {
 	ground_alt_calibrated = true;
-	ground_alt_filt.init( filter_node.getDouble("altitude_m") );
+	ground_alt_filt.init( alt_m );
     }
 
     if ( ! task_node.getBool("is_airborne") ) {
 	// ground reference altitude averaged current altitude over
 	// first 30 seconds while on the ground
-	ground_alt_filt.update( filter_node.getDouble("altitude_m"), dt );
-	pos_filter_node.setDouble( "altitude_ground_m",
-				   ground_alt_filt.get_value() );
+	ground_alt_filt.update( alt_m, dt );
+    }
+    double ground_m = ground_alt_filt.get_value();
+
+    if ( terrain_enabled ) {
+        long serial = active_node.getLong("route_serial");
+        if ( serial != route_serial ) {
+            route_serial = serial;
+            prefetch_route();
+        }
+
+        double lat = filter_node.getDouble("latitude_deg");
+        double lon = filter_node.getDouble("longitude_deg");
+        double elev;
+        bool valid = terrain.get_elevation( lat, lon, &elev );
+        pos_filter_node.setBool( "terrain_valid", valid );
+        if ( valid ) {
+            pos_filter_node.setDouble( "terrain_elevation_m", elev );
+            pos_filter_node.setDouble( "altitude_terrain_m", alt_m - elev );
+        }
+        if ( terrain_for_agl ) {
+            double ref_m = valid ? elev : ground_m;
+            if ( !agl_ref_init ) {
+                agl_ref_init = true;
+                agl_on_terrain = valid;
+            } else if ( valid != agl_on_terrain ) {
+                // (starts from the last reference, so a void post or
+                // the edge of the tiles doesn't jump)
+                agl_offset_m += agl_ref_m - ref_m;
+                agl_on_terrain = valid;
+            }
+            if ( blend_sec > 0.0 ) {
+                agl_offset_m *= exp( -dt / blend_sec );
+            } else {
+                agl_offset_m = 0.0;
+            }
+            agl_ref_m = ref_m;
+            ground_m = ref_m + agl_offset_m;
+        }
+        double clear;
+        valid = lookahead_clearance( lat, lon, alt_m, &clear );
+        pos_filter_node.setBool( "terrain_clearance_valid", valid );
+        if ( valid ) {
+            pos_filter_node.setDouble( "terrain_clearance_m", clear );
+        }
     }
+    pos_filter_node.setDouble( "altitude_ground_m", ground_m );
 
-    float agl_m = filter_node.getDouble( "altitude_m" )
-	- ground_alt_filt.get_value();
+    float agl_m = alt_m - ground_m;
     pos_filter_node.setDouble( "altitude_agl_m", agl_m );
     pos_filter_node.setDouble( "altitude_agl_ft", agl_m * SG_METER_TO_FEET );
 }
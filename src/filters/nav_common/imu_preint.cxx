@@ -0,0 +1,58 @@
+// imu_preint.cxx - integrate a run of imu samples into one rotation
+//                  vector and velocity change
+//
+
+#include "imu_preint.hxx"
+
+
+void IMUPreint::start( const IMUdata &imu ) {
+    last = imu;
+    t0 = imu.time;
+    count = 0;
+    alpha.setZero();
+    nu.setZero();
+    beta.setZero();
+    scul.setZero();
+}
+
+
+void IMUPreint::add( const IMUdata &imu ) {
+    double h = imu.time - last.time;
+    if ( h <= 0.0 ) {
+        return;
+    }
+    Vector3d w0( last.p, last.q, last.r );
+    Vector3d w1( imu.p, imu.q, imu.r );
+    Vector3d f0( last.ax, last.ay, last.az );
+    Vector3d f1( imu.ax, imu.ay, imu.az );
+
+    // trapezoidal increments over this sample interval
+    Vector3d dalpha = 0.5 * (w0 + w1) * h;
+    Vector3d dnu = 0.5 * (f0 + f1) * h;
+
+    // cross terms of the motion so far with this interval, plus the
+    // within-interval terms for linearly varying rates/accels
+    double k = h * h / 12.0;
+    beta += 0.5 * alpha.cross(dalpha) + k * w0.cross(w1);
+    scul += 0.5 * (alpha.cross(dnu) + nu.cross(dalpha))
+        + k * (w0.cross(f1) + f0.cross(w1));
+
+    alpha += dalpha;
+    nu += dnu;
+    last = imu;
+    count++;
+}
+
+
+IMUdelta IMUPreint::get_delta() {
+    Vector3d dtheta = alpha + beta;
+    Vector3d dvel = nu + 0.5 * alpha.cross(nu) + scul;
+
+    IMUdelta d;
+    d.time = last.time;
+    d.dt = last.time - t0;
+    d.dthx = dtheta(0); d.dthy = dtheta(1); d.dthz = dtheta(2);
+    d.dvx = dvel(0); d.dvy = dvel(1); d.dvz = dvel(2);
+    d.count = count;
+    return d;
+}
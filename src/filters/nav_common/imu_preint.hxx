@@ -0,0 +1,51 @@
+// imu_preint.hxx - integrate a run of imu samples into one rotation
+//                  vector and velocity change
+//
+// Summing p/q/r * dt over several samples loses the coning motion
+// (rotation about an axis that is itself rotating), and rotating the
+// accels by the start attitude loses sculling.  This accumulates the
+// two-speed (Savage) coning and sculling terms so a filter can do a
+// single time update per frame without the error of dropping or
+// averaging the samples in between.
+//
+// Rates and accels are assumed to vary linearly between samples,
+// which makes the within-interval terms exact:
+//   coning:   h^2/12 * (w0 x w1)
+//   sculling: h^2/12 * (w0 x f1 + f0 x w1)
+//
+// Feed it bias corrected samples: start() with the sample the
+// interval begins at, then add() each following sample.
+
+#pragma once
+
+#include <eigen3/Eigen/Core>
+#include <eigen3/Eigen/Geometry>
+using namespace Eigen;
+
+#include "structs.hxx"
+
+class IMUPreint {
+
+public:
+
+    IMUPreint() {}
+    ~IMUPreint() {}
+
+    void start( const IMUdata &imu );
+    void add( const IMUdata &imu );
+
+    // rotation vector and velocity change since start(), both in the
+    // body frame at the start of the interval
+    IMUdelta get_delta();
+
+private:
+
+    IMUdata last;
+    double t0;
+    int count;
+
+    Vector3d alpha;		// summed angle increments
+    Vector3d nu;		// summed velocity increments
+    Vector3d beta;		// coning correction
+    Vector3d scul;		// sculling correction
+};
@@ -0,0 +1,283 @@
+/*! \file nav_functions.hxx
+ *	\brief Auxiliary functions for nav filters
+ *
+ *	\details
+ *     Modified:        Brian Taylor (convert to eigen3)
+ *						Adhika Lie (revamp all functions)
+ *						Gokhan Inalhan (remaining)
+ *                      Demoz Gebre (first three functions)
+ *                      Jung Soon Jang
+ *     Description:     constants and inline functions used with the
+ *                      inertial navigation software, templated on
+ *                      the scalar type.
+ *	\ingroup nav_fcns
+ *
+ * \author University of Minnesota
+ * \author Aerospace Engineering and Mechanics
+ * \copyright Copyright 2011 Regents of the University of Minnesota. All rights reserved.
+ */
+
+// Each function is written once for any scalar type and lives here
+// so the filters can inline it.  Attitude, velocity and covariance
+// run in float (half the register width of double on NEON), while
+// geodetic position stays double: a float latitude in radians only
+// resolves to ~0.5 m, and so does a float ecef position.  Functions
+// that take a position are templated on its scalar separately (P)
+// so the position side never drops to float.  Where a result has to
+// cross precision the caller asks for it explicitly
+// (eul2quat<float>(), .cast<float>()), nothing converts silently.
+
+#pragma once
+
+#include <math.h>
+#include <eigen3/Eigen/Core>
+#include <eigen3/Eigen/Geometry>
+using namespace Eigen;
+
+// Constants
+constexpr double EarthRadius = 6378137.0;    // earth semi-major axis radius (m)
+constexpr double ECC2 = 0.0066943799901;     // major eccentricity squared
+
+// Constants that are no longer used
+// const double EarthRate = 0.00007292115;      // rotation rate of earth (rad/sec)
+// const double Eccentricity = 0.0818191908426; // major eccentricity of earth ellipsoid
+// const double Flattening = 0.0033528106650;   // flattening of the ellipsoid
+// const double Gravity0 = 9.7803730;           // zeroth coefficient for gravity model
+// const double Gravity1 = 0.0052891;           // first coefficient for the gravity model
+// const double Gravity2 = 0.0000059;           // second coefficient for the gravity model
+// const double GravityNom = 9.81;              // nominal gravity
+// const double Schuler2 = 1.533421593170545E-06; // Schuler Frequency (rad/sec) Squared
+
+
+// This function calculates the rate of change of latitude, longitude,
+// and altitude using WGS-84.  The radii are computed in the
+// position's precision, the rates returned in the velocity's.
+template <typename T, typename P>
+inline Matrix<T,3,1> llarate(const Matrix<T,3,1> &V, const Matrix<P,3,1> &lla) {
+    P lat = lla(0);
+    P h = lla(2);
+    P sin_lat = sin(lat);
+
+    P denom = fabs(P(1) - (P(ECC2) * sin_lat * sin_lat));
+    P sqrt_denom = sqrt(denom);
+
+    P Rew = P(EarthRadius) / sqrt_denom;
+    P Rns = P(EarthRadius) * P(1 - ECC2) / (denom * sqrt_denom);
+
+    Matrix<T,3,1> lla_dot;
+    lla_dot(0) = T(V(0) / (Rns + h));
+    lla_dot(1) = T(V(1) / ((Rew + h) * cos(lat)));
+    lla_dot(2) = -V(2);
+
+    return lla_dot;
+}
+
+// This function calculates the angular velocity of the NED frame,
+// also known as the navigation rate using WGS-84.
+template <typename T, typename P>
+inline Matrix<T,3,1> navrate(const Matrix<T,3,1> &V, const Matrix<P,3,1> &lla) {
+    P lat = lla(0);
+    P h = lla(2);
+    P sin_lat = sin(lat);
+
+    P denom = fabs(P(1) - (P(ECC2) * sin_lat * sin_lat));
+    P sqrt_denom = sqrt(denom);
+
+    P Rew = P(EarthRadius) / sqrt_denom;
+    P Rns = P(EarthRadius) * P(1 - ECC2) / (denom * sqrt_denom);
+
+    Matrix<T,3,1> nr;
+    nr(0) = T(V(1) / (Rew + h));
+    nr(1) = T(-V(0) / (Rns + h));
+    nr(2) = T(-V(1) * tan(lat) / (Rew + h));
+
+    return nr;
+}
+
+// This function calculates the ECEF Coordinate given the
+// Latitude, Longitude and Altitude.
+template <typename P>
+inline Matrix<P,3,1> lla2ecef(const Matrix<P,3,1> &lla) {
+    P sinlat = sin(lla(0));
+    P coslat = cos(lla(0));
+    P coslon = cos(lla(1));
+    P sinlon = sin(lla(1));
+    P alt = lla(2);
+
+    P denom = fabs(P(1) - (P(ECC2) * sinlat * sinlat));
+
+    P Rew = P(EarthRadius) / sqrt(denom);
+
+    Matrix<P,3,1> ecef;
+    ecef(0) = (Rew + alt) * coslat * coslon;
+    ecef(1) = (Rew + alt) * coslat * sinlon;
+    ecef(2) = (Rew * P(1 - ECC2) + alt) * sinlat;
+
+    return ecef;
+}
+
+// This function calculates the Latitude, Longitude and Altitude given
+// the ECEF Coordinates.
+template <typename P>
+inline Matrix<P,3,1> ecef2lla(const Matrix<P,3,1> &ecef_pos) {
+    const P Squash = 0.9966471893352525192801545;
+    const P ra2 = P(1) / P(EarthRadius * EarthRadius);
+    const P e2 = fabs(P(1) - Squash*Squash);
+    const P e4 = e2*e2;
+
+    // according to
+    // H. Vermeille,
+    // Direct transformation from geocentric to geodetic ccordinates,
+    // Journal of Geodesy (2002) 76:451-454
+    Matrix<P,3,1> lla;
+    P X = ecef_pos(0);
+    P Y = ecef_pos(1);
+    P Z = ecef_pos(2);
+    P XXpYY = X*X+Y*Y;
+    if( XXpYY + Z*Z < 25 ) {
+	// This function fails near the geocenter region, so catch
+	// that special case here.  Define the innermost sphere of
+	// small radius as earth center and return the coordinates
+	// 0/0/-EQURAD. It may be any other place on geoide's surface,
+	// the Northpole, Hawaii or Wentorf. This one was easy to code
+	// ;-)
+	lla(0) = 0.0;
+	lla(1) = 0.0;
+	lla(2) = -EarthRadius;
+	return lla;
+    }
+
+    P sqrtXXpYY = sqrt(XXpYY);
+    P p = XXpYY*ra2;
+    P q = Z*Z*(1-e2)*ra2;
+    P r = (p+q-e4)/P(6);
+    P s = e4*p*q/(4*r*r*r);
+    /*
+       s*(2+s) is negative for s = [-2..0]
+       slightly negative values for s due to floating point rounding errors
+       cause nan for sqrt(s*(2+s))
+       We can probably clamp the resulting parable to positive numbers
+    */
+    if( s >= -2 && s <= 0 )
+	s = 0;
+    P t = cbrt(1+s+sqrt(s*(2+s)));
+    P u = r*(1+t+1/t);
+    P v = sqrt(u*u+e4*q);
+    P w = e2*(u+v-q)/(2*v);
+    P k = sqrt(u+v+w*w)-w;
+    P D = k*sqrtXXpYY/(k+e2);
+    lla(1) = 2*atan2(Y, X+sqrtXXpYY);
+    P sqrtDDpZZ = sqrt(D*D+Z*Z);
+    lla(0) = 2*atan2(Z, D+sqrtDDpZZ);
+    lla(2) = (k+e2-1)*sqrtDDpZZ/k;
+    return lla;
+}
+
+// This function rotates a vector in ecef into the ned frame at
+// pos_ref.  Rotate ecef differences rather than absolute ecef
+// positions when the result is wanted in float.
+template <typename T, typename P>
+inline Matrix<T,3,1> ecef2ned(const Matrix<T,3,1> &ecef, const Matrix<P,3,1> &pos_ref) {
+    T sin_lat = T(sin(pos_ref(0)));
+    T sin_lon = T(sin(pos_ref(1)));
+    T cos_lat = T(cos(pos_ref(0)));
+    T cos_lon = T(cos(pos_ref(1)));
+
+    Matrix<T,3,1> ned;
+    ned(2) = -cos_lat*cos_lon*ecef(0) - cos_lat*sin_lon*ecef(1) - sin_lat*ecef(2);
+    ned(1) = -sin_lon*ecef(0) + cos_lon*ecef(1);
+    ned(0) = -sin_lat*cos_lon*ecef(0) - sin_lat*sin_lon*ecef(1) + cos_lat*ecef(2);
+
+    return ned;
+}
+
+// Return a quaternion rotation from the earth centered to the
+// simulation usual horizontal local frame from given longitude and
+// latitude.  The horizontal local frame used in simulations is the
+// frame with x-axis pointing north, the y-axis pointing eastwards and
+// the z axis pointing downwards.  (Returns the ecef2ned
+// transformation as a quaternion.)
+template <typename T>
+inline Quaternion<T> lla2quat(T lon_rad, T lat_rad) {
+    T zd2 = T(0.5)*lon_rad;
+    T yd2 = T(-0.25*M_PI) - T(0.5)*lat_rad;
+    T Szd2 = sin(zd2);
+    T Syd2 = sin(yd2);
+    T Czd2 = cos(zd2);
+    T Cyd2 = cos(yd2);
+    return Quaternion<T>( Czd2*Cyd2, -Szd2*Syd2, Czd2*Syd2, Szd2*Cyd2 );
+}
+
+// This function gives a skew symmetric matrix from a given vector w
+template <typename T>
+inline Matrix<T,3,3> sk(const Matrix<T,3,1> &w) {
+    Matrix<T,3,3> C;
+
+    C(0,0) = 0.0;	C(0,1) = -w(2);		C(0,2) = w(1);
+    C(1,0) = w(2);	C(1,1) = 0.0;		C(1,2) = -w(0);
+    C(2,0) = -w(1);	C(2,1) = w(0);		C(2,2) = 0.0;
+
+    return C;
+}
+
+// Quaternion to euler angle: returns phi, the, psi as a vector
+template <typename T>
+inline Matrix<T,3,1> quat2eul(const Quaternion<T> &q) {
+    T q0 = q.w();
+    T q1 = q.x();
+    T q2 = q.y();
+    T q3 = q.z();
+
+    T m11 = 2*(q0*q0 + q1*q1) - 1;
+    T m12 = 2*(q1*q2 + q0*q3);
+    T m13 = 2*(q1*q3 - q0*q2);
+    T m23 = 2*(q2*q3 + q0*q1);
+    T m33 = 2*(q0*q0 + q3*q3) - 1;
+
+    Matrix<T,3,1> result;
+    result(2) = atan2(m12, m11);
+    result(1) = asin(-m13);
+    result(0) = atan2(m23, m33);
+
+    return result;
+}
+
+// Computes a quaternion from the given euler angles.  The scalar
+// comes from the arguments, eul2quat<float>(...) builds a float
+// quaternion from double angles.
+template <typename T>
+inline Quaternion<T> eul2quat(T phi, T the, T psi) {
+    T sin_psi = sin(T(0.5)*psi);
+    T cos_psi = cos(T(0.5)*psi);
+    T sin_the = sin(T(0.5)*the);
+    T cos_the = cos(T(0.5)*the);
+    T sin_phi = sin(T(0.5)*phi);
+    T cos_phi = cos(T(0.5)*phi);
+
+    return Quaternion<T>( cos_psi*cos_the*cos_phi + sin_psi*sin_the*sin_phi,
+                          cos_psi*cos_the*sin_phi - sin_psi*sin_the*cos_phi,
+                          cos_psi*sin_the*cos_phi + sin_psi*cos_the*sin_phi,
+                          sin_psi*cos_the*cos_phi - cos_psi*sin_the*sin_phi );
+}
+
+// Quaternion to C_N2B
+template <typename T>
+inline Matrix<T,3,3> quat2dcm(const Quaternion<T> &q) {
+    T q0 = q.w(), q1 = q.x(), q2 = q.y(), q3 = q.z();
+    Matrix<T,3,3> C_N2B;
+
+    C_N2B(0,0) = 2*(q0*q0 + q1*q1) - 1;
+    C_N2B(1,1) = 2*(q0*q0 + q2*q2) - 1;
+    C_N2B(2,2) = 2*(q0*q0 + q3*q3) - 1;
+
+    C_N2B(0,1) = 2*(q1*q2 + q0*q3);
+    C_N2B(0,2) = 2*(q1*q3 - q0*q2);
+
+    C_N2B(1,0) = 2*(q1*q2 - q0*q3);
+    C_N2B(1,2) = 2*(q2*q3 + q0*q1);
+
+    C_N2B(2,0) = 2*(q1*q3 + q0*q2);
+    C_N2B(2,1) = 2*(q2*q3 - q0*q1);
+
+    return C_N2B;
+}
@@ -20,6 +20,15 @@ struct IMUdata {
     double temp;		// C
 };
 
+// integrated imu motion over an interval (see imu_preint.hxx)
+struct IMUdelta {
+    double time;		// seconds, end of the interval
+    double dt;			// seconds
+    double dthx, dthy, dthz;	// rad, rotation vector
+    double dvx, dvy, dvz;	// m/sec, velocity change (start body frame)
+    int count;			// samples integrated
+};
+
 struct GPSdata {
     double time;		// seconds
     double unix_sec;		// seconds in unix time reference
@@ -19,7 +19,7 @@ using std::cout;
 using std::endl;
 #include <stdio.h>
 
-#include "../nav_common/nav_functions_float.hxx"
+#include "../nav_common/nav_functions.hxx"
 #include "EKF_15state.hxx"
 
 const float P_P_INIT = 10.0;
@@ -136,7 +136,7 @@ void EKF15::init(IMUdata imu, GPSdata gps) {
     nav.psi = atan2(imu.hz*sin(nav.phi)-imu.hy*cos(nav.phi),imu.hx*cos(nav.the)+imu.hy*sin(nav.the)*sin(nav.phi)+imu.hz*sin(nav.the)*cos(nav.phi));
     printf("tilt compensated psi: %.2f\n", nav.psi*R2D);
 	
-    quat = eul2quat(nav.phi, nav.the, nav.psi);
+    quat = eul2quat<float>(nav.phi, nav.the, nav.psi);
 	
     nav.abx = 0.0;
     nav.aby = 0.0; 
@@ -150,6 +150,12 @@ void EKF15::init(IMUdata imu, GPSdata gps) {
 	
     nav.time = imu.time;
     nav.err_type = data_valid;
+
+    if ( history.size() ) {
+        set_history(history.size());
+        history_push(imu);
+        history_save(0);
+    }
 }
 
 // Main get_nav filter function
@@ -161,15 +167,6 @@ void EKF15::time_update(IMUdata imu) {
     
     // ==================  Time Update  ===================
 
-    // AHRS Transformations
-    C_N2B = quat2dcm(quat);
-    C_B2N = C_N2B.transpose();
-	
-    // Attitude Update
-    // ... Calculate Navigation Rate
-    Vector3f vel_vec(nav.vn, nav.ve, nav.vd);
-    Vector3d pos_vec(nav.lat, nav.lon, nav.alt);
-
     if ( false ) {
         // Get the new Specific forces and Rotation Rate from previous
         // frame (k) to use in this frame (k+1).  Rectangular
@@ -198,6 +195,91 @@ void EKF15::time_update(IMUdata imu) {
 
     Quaternionf dq = Quaternionf(1.0, 0.5*om_ib(0)*imu_dt, 0.5*om_ib(1)*imu_dt, 0.5*om_ib(2)*imu_dt);
     
+    propagate(imu_dt, dq, f_b * imu_dt);
+
+    if ( history.size() ) {
+        history_push(imu);
+        history_save(hist_count - 1);
+    }
+}
+
+// Time update from every imu sample since the last update: the
+// samples are integrated into one rotation vector and velocity change
+// (with coning and sculling corrections) and the filter steps once
+// over the whole interval.
+void EKF15::time_update_batch(const vector<IMUdata> &batch) {
+    if ( history.size() ) {
+        double last_time = imu_last.time;
+        for ( unsigned int i = 0; i < batch.size(); i++ ) {
+            if ( batch[i].time > last_time ) {
+                history_push(batch[i]);
+                last_time = batch[i].time;
+            }
+        }
+    }
+    step(batch);
+    if ( history.size() ) {
+        history_save(hist_count - 1);
+    }
+}
+
+// integrate the samples newer than imu_last and step the filter once
+void EKF15::step(const vector<IMUdata> &batch) {
+    // remove the current bias estimates before integrating so the
+    // coning/sculling terms see the same rates the filter would
+    IMUdata imu = imu_last;
+    imu.p -= nav.gbx; imu.q -= nav.gby; imu.r -= nav.gbz;
+    imu.ax -= nav.abx; imu.ay -= nav.aby; imu.az -= nav.abz;
+    preint.start(imu);
+    for ( unsigned int i = 0; i < batch.size(); i++ ) {
+        if ( batch[i].time <= imu_last.time ) {
+            continue;
+        }
+        imu_last = batch[i];
+        imu = batch[i];
+        imu.p -= nav.gbx; imu.q -= nav.gby; imu.r -= nav.gbz;
+        imu.ax -= nav.abx; imu.ay -= nav.aby; imu.az -= nav.abz;
+        preint.add(imu);
+    }
+    IMUdelta d = preint.get_delta();
+    if ( d.count == 0 || d.dt <= 0.0 ) {
+        return;
+    }
+    float imu_dt = d.dt;
+    nav.time = d.time;
+
+    // ==================  Time Update  ===================
+
+    // average rates over the interval for the jacobian
+    Vector3f dtheta(d.dthx, d.dthy, d.dthz);
+    Vector3f dvel(d.dvx, d.dvy, d.dvz);
+    om_ib = dtheta / imu_dt;
+    f_b = dvel / imu_dt;
+
+    // exact rotation for the integrated rotation vector
+    float angle = dtheta.norm();
+    Quaternionf dq = Quaternionf::Identity();
+    if ( angle > 1e-9 ) {
+        dq = Quaternionf(AngleAxisf(angle, dtheta / angle));
+    }
+
+    propagate(imu_dt, dq, dvel);
+}
+
+// Common part of the time update: attitude, velocity and position
+// from the body frame rotation dq and velocity change dv_b over
+// imu_dt (expressed in the body frame at the start of the step), then
+// the jacobian and covariance from f_b and om_ib.
+void EKF15::propagate(float imu_dt, const Quaternionf &dq, const Vector3f &dv_b) {
+    // AHRS Transformations
+    C_N2B = quat2dcm(quat);
+    C_B2N = C_N2B.transpose();
+	
+    // Attitude Update
+    // ... Calculate Navigation Rate
+    Vector3f vel_vec(nav.vn, nav.ve, nav.vd);
+    Vector3d pos_vec(nav.lat, nav.lon, nav.alt);
+
     quat = (quat * dq).normalized();
 
     if (quat.w() < 0) {
@@ -211,14 +293,16 @@ void EKF15::time_update(IMUdata imu) {
     nav.psi = att_vec(2);
 	
     // Velocity Update
-    dx = C_B2N * f_b;
-    dx += grav;
+    dx = C_B2N * dv_b;
+    dx += grav * imu_dt;
 	
-    nav.vn += imu_dt*dx(0);
-    nav.ve += imu_dt*dx(1);
-    nav.vd += imu_dt*dx(2);
+    nav.vn += dx(0);
+    nav.ve += dx(1);
+    nav.vd += dx(2);
 	
-    // Position Update
+    // Position Update (mean velocity over the step, which matters
+    // for the long steps of a batch or a delayed measurement replay)
+    vel_vec = 0.5 * (vel_vec + Vector3f(nav.vn, nav.ve, nav.vd));
     dx = llarate(vel_vec, pos_vec);
     nav.lat += imu_dt*dx(0);
     nav.lon += imu_dt*dx(1);
@@ -293,6 +377,109 @@ void EKF15::time_update(IMUdata imu) {
 }
 
 void EKF15::measurement_update(GPSdata gps) {
+    if ( history.size() && hist_count && gps.time < nav.time ) {
+        if ( delayed_update(gps) ) {
+            return;
+        }
+    }
+    correct(gps);
+    if ( history.size() && hist_count ) {
+        history_save(hist_count - 1);
+    }
+}
+
+// Apply a gps measurement at its own epoch instead of now: rewind to
+// the saved filter state at (or before) the epoch, step up to the
+// epoch sample, correct there, and step back up to the present over
+// the saved samples.  Both steps are single pre-integrated time
+// updates, so the cost doesn't grow much with the delay.  Returns
+// false if the epoch isn't covered by the history.
+bool EKF15::delayed_update(GPSdata gps) {
+    // newest sample at or before the epoch
+    int e = hist_count - 1;
+    while ( e >= 0 && history[hist_index(e)].imu.time > gps.time ) {
+        e--;
+    }
+    if ( e < 0 || e == hist_count - 1 ) {
+        // older than the history, or within the latest step
+        return false;
+    }
+    // newest saved state at or before that sample
+    int s = e;
+    while ( s >= 0 && !history[hist_index(s)].valid ) {
+        s--;
+    }
+    if ( s < 0 ) {
+        return false;
+    }
+
+    History &h = history[hist_index(s)];
+    nav = h.nav;
+    quat = h.quat;
+    P = h.P;
+    imu_last = h.imu;
+
+    replay.clear();
+    for ( int i = s + 1; i <= e; i++ ) {
+        replay.push_back( history[hist_index(i)].imu );
+    }
+    if ( replay.size() ) {
+        step(replay);
+    }
+
+    correct(gps);
+    history_save(e);
+
+    // the states saved after the epoch are from before this
+    // correction
+    replay.clear();
+    for ( int i = e + 1; i < hist_count; i++ ) {
+        History &later = history[hist_index(i)];
+        later.valid = false;
+        replay.push_back( later.imu );
+    }
+    step(replay);
+    history_save(hist_count - 1);
+
+    return true;
+}
+
+// drop the history and size it for 'size' imu samples (0 disables
+// delayed measurements)
+void EKF15::set_history(int size) {
+    history.clear();
+    history.resize(size);
+    hist_head = 0;
+    hist_count = 0;
+}
+
+// index of the i'th oldest history entry
+int EKF15::hist_index(int i) {
+    return (hist_head + i) % history.size();
+}
+
+// append an imu sample to the history, the filter state for it is
+// filled in by history_save()
+void EKF15::history_push(const IMUdata &imu) {
+    if ( hist_count < (int)history.size() ) {
+        hist_count++;
+    } else {
+        hist_head = (hist_head + 1) % history.size();
+    }
+    History &h = history[hist_index(hist_count - 1)];
+    h.imu = imu;
+    h.valid = false;
+}
+
+void EKF15::history_save(int i) {
+    History &h = history[hist_index(i)];
+    h.nav = nav;
+    h.quat = quat;
+    h.P = P;
+    h.valid = true;
+}
+
+void EKF15::correct(GPSdata gps) {
     // ==================  GPS Update  ===================
 		
     // Position, converted to NED
@@ -301,15 +488,17 @@ void EKF15::measurement_update(GPSdata gps) {
 
     Vector3d pos_ref = pos_vec;
     pos_ref(2) = 0.0;
-    pos_ins_ned = ecef2ned(pos_ins_ecef, pos_ref);
 		
     pos_gps(0) = gps.lat*D2R;
     pos_gps(1) = gps.lon*D2R;
     pos_gps(2) = gps.alt;
 		
     pos_gps_ecef = lla2ecef(pos_gps);
-		
-    pos_gps_ned = ecef2ned(pos_gps_ecef, pos_ref);
+
+    // rotate the ecef difference in double and only then drop to
+    // float (an absolute ecef position in float resolves to ~0.5 m)
+    pos_ins_ned.setZero();
+    pos_gps_ned = ecef2ned(Vector3d(pos_gps_ecef - pos_ins_ecef), pos_ref).cast<float>();
 
     // Create Measurement: y
     y(0) = pos_gps_ned(0) - pos_ins_ned(0);
@@ -393,7 +582,9 @@ BOOST_PYTHON_MODULE(EKF15)
         .def("set_config", &EKF15::set_config)
         .def("init", &EKF15::init)
         .def("time_update", &EKF15::time_update)
+        .def("time_update_batch", &EKF15::time_update_batch)
         .def("measurement_update", &EKF15::measurement_update)
+        .def("set_history", &EKF15::set_history)
         .def("get_nav", &EKF15::get_nav)
     ;
 }
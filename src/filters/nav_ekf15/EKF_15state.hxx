@@ -20,9 +20,14 @@
 #include <eigen3/Eigen/Core>
 #include <eigen3/Eigen/Geometry>
 #include <eigen3/Eigen/LU>
+#include <eigen3/Eigen/StdVector>
 using namespace Eigen;
 
+#include <vector>
+using std::vector;
+
 #include "../nav_common/constants.hxx"
+#include "../nav_common/imu_preint.hxx"
 #include "../nav_common/structs.hxx"
 
 // usefule constants
@@ -42,7 +47,7 @@ class EKF15 {
 
 public:
 
-    EKF15() {
+    EKF15(): hist_head(0), hist_count(0) {
 	default_config();
     }
     ~EKF15() {}
@@ -55,12 +60,27 @@ public:
     // main interface
     void init(IMUdata imu, GPSdata gps);
     void time_update(IMUdata imu);
+    void time_update_batch(const vector<IMUdata> &batch);
     void measurement_update(GPSdata gps);
+
+    // keep the last 'size' imu samples and filter states so gps
+    // measurements are applied at gps.time rather than when they
+    // arrive (0 = off, the default)
+    void set_history(int size);
     
     NAVdata get_nav();
     
 private:
 
+    void step(const vector<IMUdata> &batch);
+    void propagate(float imu_dt, const Quaternionf &dq, const Vector3f &dv_b);
+    void correct(GPSdata gps);
+
+    bool delayed_update(GPSdata gps);
+    int hist_index(int i);
+    void history_push(const IMUdata &imu);
+    void history_save(int i);
+
     Matrix15f F, PHI, P, Qw, Q, ImKH, KRKt, I15 /* identity */;
     Matrix15x12f G;
     Matrix15x6f K;
@@ -76,6 +96,23 @@ private:
     Quaternionf quat;
 
     IMUdata imu_last;
+    IMUPreint preint;
+
+    // ring of imu samples, each with the filter state right after it
+    // when valid (batched updates only save the state at the last
+    // sample of each batch)
+    struct History {
+        IMUdata imu;
+        bool valid;
+        NAVdata nav;
+        Quaternionf quat;
+        Matrix15f P;
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+    vector<History, aligned_allocator<History> > history;
+    int hist_head;
+    int hist_count;
+    vector<IMUdata> replay;
     NAVconfig config;
     NAVdata nav;
 };
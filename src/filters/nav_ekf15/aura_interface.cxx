@@ -10,6 +10,8 @@
 
 #include "include/globaldefs.h"
 #include "sensors/gps_mgr.hxx"
+#include "sensors/imu_batch.hxx"
+#include "util/clocksync.hxx"
 
 #include "../nav_common/constants.hxx"
 
@@ -26,6 +28,17 @@ static IMUdata imu_data;
 static GPSdata gps_data;
 static NAVdata nav_data;
 
+// every imu sample since the last update (when imu batching is on)
+static vector<IMUSample> imu_batch;
+static vector<IMUdata> imu_samples;
+
+// gps latency compensation: the filter keeps a history of imu
+// samples/states and gps is applied at its estimated fix epoch
+static bool gps_history = false;
+static double gps_delay_sec = 0.0;
+static ClockSync gps_clock;
+static double gps_unix0 = 0.0;
+
 // property nodes
 static pyPropertyNode imu_node;
 static pyPropertyNode gps_node;
@@ -106,6 +119,20 @@ void nav_ekf15_init( string output_path, pyPropertyNode *config ) {
     filter_node = pyGetNode(output_path, true);
     filter_node.setString( "navigation", "invalid" );
 
+    // history_size: imu samples of history (cover the worst case gps
+    // latency at the imu rate), gps_delay_sec: time from the fix
+    // epoch to the earliest the receiver ever delivers it
+    if ( config->hasChild("history_size") ) {
+        int size = config->getLong("history_size");
+        if ( size > 0 ) {
+            filter.set_history( size );
+            gps_history = true;
+        }
+    }
+    if ( config->hasChild("gps_delay_sec") ) {
+        gps_delay_sec = config->getDouble("gps_delay_sec");
+    }
+
 #if 0
     // set tuning value for specific gps and imu noise characteristics
     cov_gps_hpos_node = config.getChild("cov-gps-hpos", 0, true);
@@ -122,18 +149,67 @@ void nav_ekf15_init( string output_path, pyPropertyNode *config ) {
 }
 
 
+// Host time of the gps fix.  The receipt timestamp is late by the
+// receiver's solution latency plus a variable amount of serial and
+// scheduling delay.  Tracking the lower envelope of receipt time
+// against the receiver's own fix time removes the variable part, the
+// fixed part is configured.
+static double gps_epoch() {
+    double stamp = gps_data.time;
+    double unix_sec = gps_node.getDouble("unix_time_sec");
+    double epoch = stamp;
+    if ( unix_sec > 0.0 ) {
+        if ( gps_unix0 <= 0.0 ) {
+            gps_unix0 = unix_sec;
+        }
+        gps_clock.update( unix_sec - gps_unix0, stamp );
+        epoch = gps_clock.get_local( unix_sec - gps_unix0 );
+    }
+    epoch -= gps_delay_sec;
+    if ( epoch > stamp ) {
+        epoch = stamp;
+    }
+    return epoch;
+}
+
+
 bool nav_ekf15_update() {
     static bool nav_inited = false;
     static double last_gps_time = 0.0;
 
     // fill in the UMN structures
     props2umn();
+    imu_batch_take( &imu_batch );
 
     if ( nav_inited ) {
-	filter.time_update( imu_data );
+        if ( imu_batch.size() ) {
+            imu_samples.resize( imu_batch.size() );
+            for ( unsigned int i = 0; i < imu_batch.size(); i++ ) {
+                IMUdata &s = imu_samples[i];
+                s = imu_data;   // mag and temp are only needed once
+                s.time = imu_batch[i].time;
+                s.p = imu_batch[i].p;
+                s.q = imu_batch[i].q;
+                s.r = imu_batch[i].r;
+                s.ax = imu_batch[i].ax;
+                s.ay = imu_batch[i].ay;
+                s.az = imu_batch[i].az;
+            }
+            filter.time_update_batch( imu_samples );
+        } else {
+            filter.time_update( imu_data );
+        }
         if ( gps_data.time > last_gps_time ) {
             last_gps_time = gps_data.time;
-            filter.measurement_update( gps_data );
+            if ( gps_history ) {
+                GPSdata gps = gps_data;
+                gps.time = gps_epoch();
+                filter_node.setDouble( "gps_latency_ms",
+                                       (imu_data.time - gps.time) * 1000.0 );
+                filter.measurement_update( gps );
+            } else {
+                filter.measurement_update( gps_data );
+            }
         }
         nav_data = filter.get_nav();
     } else {
@@ -20,8 +20,8 @@ using std::endl;
 #include <stdio.h>
 
 #include "../nav_common/constants.hxx"
-#include "../nav_common/coremag.h"
-#include "../nav_common/nav_functions_float.hxx"
+#include "util/coremag.h"
+#include "../nav_common/nav_functions.hxx"
 
 #include "EKF_15state.hxx"
 
@@ -126,15 +126,11 @@ void EKF15_mag::init(IMUdata imu, GPSdata gps) {
 	
     // ideal magnetic vector
     long int jd = now_to_julian_days();
-    double field[6];
-    calc_magvar( nav.lat, nav.lon,
-		 nav.alt / 1000.0, jd, field );
-    mag_ned(0) = field[3];
-    mag_ned(1) = field[4];
-    mag_ned(2) = field[5];
-    mag_ned.normalize();
-    cout << field[0] << " " << field[1] << " " << field[2] << endl;
+    Vector3d field = MagCache::calc_field( nav.lat, nav.lon, nav.alt, jd );
+    mag_ned = field.cast<float>().normalized();
     cout << "Ideal mag vector (ned): " << mag_ned << endl;
+    // from here on follow the aircraft through the field grid
+    mag_cache.start( jd );
 
     // ... and initialize states with IMU Data, theta from Ax, aircraft
     // at rest
@@ -152,7 +148,7 @@ void EKF15_mag::init(IMUdata imu, GPSdata gps) {
     nav.psi = atan2(imu.hz*sin(nav.phi)-imu.hy*cos(nav.phi),imu.hx*cos(nav.the)+imu.hy*sin(nav.the)*sin(nav.phi)+imu.hz*sin(nav.the)*cos(nav.phi));
     printf("tilt compensated psi: %.2f\n", nav.psi*R2D);
 	
-    quat = eul2quat(nav.phi, nav.the, nav.psi);
+    quat = eul2quat<float>(nav.phi, nav.the, nav.psi);
     nav.qw = quat.w();
     nav.qx = quat.x();
     nav.qy = quat.y();
@@ -321,15 +317,24 @@ void EKF15_mag::measurement_update(IMUdata imu, GPSdata gps) {
 
     Vector3d pos_ref = pos_vec;
     pos_ref(2) = 0.0;
-    pos_ins_ned = ecef2ned(pos_ins_ecef, pos_ref);
 		
     pos_gps(0) = gps.lat*D2R;
     pos_gps(1) = gps.lon*D2R;
     pos_gps(2) = gps.alt;
 		
     pos_gps_ecef = lla2ecef(pos_gps);
-		
-    pos_gps_ned = ecef2ned(pos_gps_ecef, pos_ref);
+
+    // rotate the ecef difference in double and only then drop to
+    // float (an absolute ecef position in float resolves to ~0.5 m)
+    pos_ins_ned.setZero();
+    pos_gps_ned = ecef2ned(Vector3d(pos_gps_ecef - pos_ins_ecef), pos_ref).cast<float>();
+
+    // ideal magnetic vector at the current position (unchanged
+    // until the cache has filled the cell the aircraft is in)
+    Vector3d field;
+    if ( mag_cache.get_field( nav.lat, nav.lon, nav.alt, &field ) ) {
+        mag_ned = field.cast<float>().normalized();
+    }
 
     // measured mag vector (body frame)
     Vector3f mag_sense;
@@ -443,7 +448,7 @@ using namespace boost::python;
 
 BOOST_PYTHON_MODULE(EKF15_mag)
 {
-    class_<EKF15_mag>("EKF15_mag")
+    class_<EKF15_mag, boost::noncopyable>("EKF15_mag")
         .def("set_config", &EKF15_mag::set_config)
         .def("init", &EKF15_mag::init)
         .def("time_update", &EKF15_mag::time_update)
@@ -23,6 +23,7 @@
 using namespace Eigen;
 
 #include "../nav_common/structs.hxx"
+#include "util/magcache.hxx"
 
 // usefule constants
 const float g = 9.814;
@@ -71,6 +72,7 @@ private:
     Matrix3f C_N2B, C_B2N, I3 /* identity */, temp33;
     Vector3d pos_ins_ecef, pos_gps, pos_gps_ecef;
     Vector3f grav, f_b, om_ib, pos_ins_ned, pos_gps_ned, dx, mag_ned;
+    MagCache mag_cache;         // reference field along the flight
 
     Quaternionf quat;
     float tprev;
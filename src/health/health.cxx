@@ -8,24 +8,29 @@
 #include "include/globaldefs.h"
 
 #include "comms/logging.hxx"
+#include "comms/pycallable.hxx"
 #include "comms/remote_link.hxx"
 #include "init/globals.hxx"
 #include "util/timing.h"
 
 #include "health.hxx"
 #include "loadavg.hxx"
+#include "vibration.hxx"
 
 
 static pyPropertyNode remote_link_node;
 static pyPropertyNode logging_node;
+static pyPropertyNode status_node;
 
 
 bool health_init() {
     loadavg_init();
+    vibration_init();
 
     // initialize comm nodes
     remote_link_node = pyGetNode("/config/remote_link", true);
     logging_node = pyGetNode("/config/logging", true);
+    status_node = pyGetNode("/status", true);
 
     return true;
 }
@@ -33,6 +38,10 @@ bool health_init() {
 
 bool health_update() {
     loadavg_update();
+    vibration_update();
+
+    // failed calls into the python modules
+    status_node.setLong( "python_call_errors", pyCallable::total_errors );
 
     uint8_t buf[256];
     int size = packer->pack_health( 0, buf );
@@ -42,3 +51,8 @@ bool health_update() {
 
     return true;
 }
+
+
+void health_close() {
+    vibration_close();
+}
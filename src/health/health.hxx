@@ -4,3 +4,4 @@
 
 bool health_init();
 bool health_update();
+void health_close();
@@ -0,0 +1,290 @@
+// Airframe vibration spectrum monitor
+
+#include <pyprops.hxx>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::vector;
+
+#include "comms/display.hxx"
+#include "util/fft.hxx"
+#include "util/lockfree_queue.hxx"
+
+#include "vibration.hxx"
+
+
+#define NUM_AXES 6              // ax, ay, az, p, q, r
+#define NUM_BANDS 3             // low, mid, high
+
+struct vibe_sample_t {
+    double timestamp;
+    float val[NUM_AXES];
+};
+
+struct vibe_result_t {
+    float band_rms[NUM_AXES][NUM_BANDS];
+    float accel_band_rms[NUM_BANDS];
+    float gyro_band_rms[NUM_BANDS];
+    float peak_hz[NUM_AXES];
+    float accel_peak_hz;
+    float gyro_peak_hz;
+    float sample_rate_hz;
+    uint32_t windows;
+};
+
+static const char *axis_names[NUM_AXES] = {
+    "ax", "ay", "az", "p", "q", "r"
+};
+
+static pyPropertyNode vibe_node;
+
+static bool enabled = false;
+static int fft_size = 256;
+static float low_band_hz = 5.0;  // low / mid band split
+static float high_band_hz = 15.0; // mid / high band split
+
+// producer (imu path) side
+static LockFreeQueue<vibe_sample_t, 1024> sample_queue;
+static std::atomic<uint32_t> queue_drops(0);
+
+// worker results, handed to the main thread under a short lock that
+// the main thread never waits on
+static std::mutex result_lock;
+static vibe_result_t result;
+static bool result_fresh = false;
+
+static std::thread worker;
+static std::atomic<bool> running(false);
+
+
+// map a frequency to a band index
+static inline int band_index( float hz ) {
+    if ( hz < low_band_hz ) {
+        return 0;
+    } else if ( hz < high_band_hz ) {
+        return 1;
+    } else {
+        return 2;
+    }
+}
+
+
+// find the peak (non-dc) bin of a power spectrum and return its
+// frequency
+static float peak_freq( const float *power, int bins, float bin_hz ) {
+    int peak = 1;
+    for ( int k = 2; k < bins; k++ ) {
+        if ( power[k] > power[peak] ) {
+            peak = k;
+        }
+    }
+    return peak * bin_hz;
+}
+
+
+static void vibration_worker() {
+    AuraFFT fft( fft_size );
+    int n = fft.size();
+    int bins = n / 2 + 1;
+    int hop = n / 2;            // 50% window overlap
+
+    vector<double> times(n);
+    vector< vector<float> > hist( NUM_AXES, vector<float>(n) );
+    vector< vector<float> > power( NUM_AXES, vector<float>(bins) );
+    vector<float> accel_sum(bins);
+    vector<float> gyro_sum(bins);
+    int filled = 0;
+    uint32_t windows = 0;
+
+    vibe_sample_t s;
+    while ( running ) {
+        if ( !sample_queue.pop(&s) ) {
+            usleep(20000);
+            continue;
+        }
+
+        times[filled] = s.timestamp;
+        for ( int a = 0; a < NUM_AXES; a++ ) {
+            hist[a][filled] = s.val[a];
+        }
+        filled++;
+        if ( filled < n ) {
+            continue;
+        }
+
+        // a full window is available, estimate the actual sample
+        // rate from the timestamps rather than trusting the config
+        double span = times[n-1] - times[0];
+        if ( span > 0.0 ) {
+            float rate = (n - 1) / span;
+            float bin_hz = rate / n;
+
+            vibe_result_t r;
+            memset( &r, 0, sizeof(r) );
+            for ( int k = 0; k < bins; k++ ) {
+                accel_sum[k] = 0.0;
+                gyro_sum[k] = 0.0;
+            }
+            for ( int a = 0; a < NUM_AXES; a++ ) {
+                fft.compute_power( hist[a].data(), power[a].data() );
+                for ( int k = 1; k < bins; k++ ) {
+                    r.band_rms[a][band_index(k * bin_hz)] += power[a][k];
+                    if ( a < 3 ) {
+                        accel_sum[k] += power[a][k];
+                    } else {
+                        gyro_sum[k] += power[a][k];
+                    }
+                }
+                r.peak_hz[a] = peak_freq( power[a].data(), bins, bin_hz );
+            }
+            for ( int b = 0; b < NUM_BANDS; b++ ) {
+                for ( int a = 0; a < NUM_AXES; a++ ) {
+                    if ( a < 3 ) {
+                        r.accel_band_rms[b] += r.band_rms[a][b];
+                    } else {
+                        r.gyro_band_rms[b] += r.band_rms[a][b];
+                    }
+                    r.band_rms[a][b] = sqrt( r.band_rms[a][b] );
+                }
+                r.accel_band_rms[b] = sqrt( r.accel_band_rms[b] );
+                r.gyro_band_rms[b] = sqrt( r.gyro_band_rms[b] );
+            }
+            r.accel_peak_hz = peak_freq( accel_sum.data(), bins, bin_hz );
+            r.gyro_peak_hz = peak_freq( gyro_sum.data(), bins, bin_hz );
+            r.sample_rate_hz = rate;
+            r.windows = ++windows;
+
+            result_lock.lock();
+            result = r;
+            result_fresh = true;
+            result_lock.unlock();
+        }
+
+        // slide the second half of the window to the front
+        for ( int i = 0; i < n - hop; i++ ) {
+            times[i] = times[i + hop];
+            for ( int a = 0; a < NUM_AXES; a++ ) {
+                hist[a][i] = hist[a][i + hop];
+            }
+        }
+        filled = n - hop;
+    }
+}
+
+
+bool vibration_init() {
+    vibe_node = pyGetNode("/status/vibration", true);
+
+    pyPropertyNode config_node = pyGetNode("/config/vibration", true);
+    // off unless asked for, it costs a thread and an fft per axis
+    if ( config_node.hasChild("enable") ) {
+        enabled = config_node.getBool("enable");
+    }
+    if ( config_node.hasChild("fft_size") ) {
+        fft_size = config_node.getLong("fft_size");
+    }
+    if ( config_node.hasChild("low_band_hz") ) {
+        low_band_hz = config_node.getDouble("low_band_hz");
+    }
+    if ( config_node.hasChild("high_band_hz") ) {
+        high_band_hz = config_node.getDouble("high_band_hz");
+    }
+    if ( fft_size < 16 ) { fft_size = 16; }
+
+    vibe_node.setLen("accel_band_rms", NUM_BANDS, 0.0);
+    vibe_node.setLen("gyro_band_rms", NUM_BANDS, 0.0);
+    for ( int a = 0; a < NUM_AXES; a++ ) {
+        string name = string(axis_names[a]) + "_band_rms";
+        vibe_node.setLen(name.c_str(), NUM_BANDS, 0.0);
+    }
+    vibe_node.setDouble("low_band_hz", low_band_hz);
+    vibe_node.setDouble("high_band_hz", high_band_hz);
+    vibe_node.setBool("enable", enabled);
+
+    if ( !enabled ) {
+        return true;
+    }
+
+    printf("vibration: fft size = %d\n", fft_size);
+    running = true;
+    worker = std::thread( vibration_worker );
+
+    return true;
+}
+
+
+void vibration_push( double timestamp,
+                     float ax, float ay, float az,
+                     float p, float q, float r )
+{
+    if ( !enabled ) {
+        return;
+    }
+
+    vibe_sample_t s;
+    s.timestamp = timestamp;
+    s.val[0] = ax;
+    s.val[1] = ay;
+    s.val[2] = az;
+    s.val[3] = p;
+    s.val[4] = q;
+    s.val[5] = r;
+    if ( !sample_queue.push(s) ) {
+        queue_drops++;
+    }
+}
+
+
+bool vibration_update() {
+    if ( !enabled ) {
+        return false;
+    }
+
+    // never wait on the worker, just try again next time
+    if ( !result_lock.try_lock() ) {
+        return false;
+    }
+    bool fresh = result_fresh;
+    vibe_result_t r = result;
+    result_fresh = false;
+    result_lock.unlock();
+
+    vibe_node.setLong("queue_drops", queue_drops);
+    if ( !fresh ) {
+        return false;
+    }
+
+    for ( int b = 0; b < NUM_BANDS; b++ ) {
+        vibe_node.setDouble("accel_band_rms", b, r.accel_band_rms[b]);
+        vibe_node.setDouble("gyro_band_rms", b, r.gyro_band_rms[b]);
+    }
+    vibe_node.setDouble("accel_peak_hz", r.accel_peak_hz);
+    vibe_node.setDouble("gyro_peak_hz", r.gyro_peak_hz);
+    for ( int a = 0; a < NUM_AXES; a++ ) {
+        string name = string(axis_names[a]) + "_band_rms";
+        for ( int b = 0; b < NUM_BANDS; b++ ) {
+            vibe_node.setDouble(name.c_str(), b, r.band_rms[a][b]);
+        }
+        name = string(axis_names[a]) + "_peak_hz";
+        vibe_node.setDouble(name.c_str(), r.peak_hz[a]);
+    }
+    vibe_node.setDouble("sample_rate_hz", r.sample_rate_hz);
+    vibe_node.setLong("windows", r.windows);
+
+    return true;
+}
+
+
+void vibration_close() {
+    if ( running ) {
+        running = false;
+        worker.join();
+    }
+}
@@ -0,0 +1,24 @@
+// Airframe vibration spectrum monitor
+//
+// Every raw accel/gyro sample of the primary imu (not just the one
+// per frame the filter sees, which would alias prop and motor
+// vibration into the bands) is pushed into a lock free queue.  A background worker thread runs overlapping windowed
+// FFTs and computes per band rms energy and the peak frequency for
+// each axis.  The main loop only ever copies finished results into
+// the property tree (/status/vibration) from the health update, so
+// the spectral analysis cost never lands on the control frame.
+
+#pragma once
+
+bool vibration_init();
+
+// called from the imu driver with every raw sample (cheap,
+// non-blocking)
+void vibration_push( double timestamp,
+                     float ax, float ay, float az,
+                     float p, float q, float r );
+
+// publish the most recent analysis results (main thread only)
+bool vibration_update();
+
+void vibration_close();
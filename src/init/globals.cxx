@@ -16,9 +16,29 @@ pyModulePacker *packer = NULL;
 pyModuleRemoteLink *remote_link = NULL;
 pyModuleBase *mission_mgr = NULL;
 pyModuleBase *telnet = NULL;
+Reactor *reactor = NULL;
+SensorRing *sensor_ring = NULL;
 
 
 bool AuraCoreInit() {
+    // event loop for the sensor and comm file descriptors (must
+    // exist before any driver opens its device)
+    reactor = new Reactor;
+    reactor->init();
+
+    // optional io_uring backend for the sensor reads (drivers fall
+    // back to plain reads when this is NULL)
+    pyPropertyNode sensors_node = pyGetNode("/config/sensors", true);
+    if ( sensors_node.hasChild("io_uring")
+         && sensors_node.getBool("io_uring") )
+    {
+        sensor_ring = new SensorRing;
+        if ( !sensor_ring->init() ) {
+            delete sensor_ring;
+            sensor_ring = NULL;
+        }
+    }
+
     // create instances
     display = new pyModuleDisplay;
     events = new pyModuleEventLog;
@@ -13,6 +13,8 @@
 #include "comms/logging.hxx"
 #include "comms/packer.hxx"
 #include "comms/remote_link.hxx"
+#include "util/reactor.hxx"
+#include "util/uring.hxx"
 #include <pymodule.hxx>
 
 extern pyModuleDisplay *display;
@@ -22,5 +24,7 @@ extern pyModulePacker *packer;
 extern pyModuleRemoteLink *remote_link;
 extern pyModuleBase *mission_mgr;
 extern pyModuleBase *telnet;
+extern Reactor *reactor;
+extern SensorRing *sensor_ring;
 
 bool AuraCoreInit();
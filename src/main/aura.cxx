@@ -68,6 +68,10 @@ enum SyncMode {
 
 static const int HEARTBEAT_HZ = 100;  // master clock rate
 
+// how long to sleep waiting for the sync source before falling
+// through to its (possibly blocking) update routine anyway
+static const double sync_timeout_sec = 0.1;
+
 static SyncMode sync_source = SYNC_NONE;   // main loop sync source
     
 static bool enable_mission = true;    // mission mgr module enabled/disabled
@@ -95,12 +99,45 @@ void usage(char *progname)
 }	
 
 
+// true when the sync driver has already pulled input off its fd
+// (bulk/batched reads) that it hasn't consumed yet.  The fd won't
+// report that as readable, so don't sleep on it.
+static bool sync_pending() {
+    if ( sync_source == SYNC_AURA3 ) {
+        return Aura3_sync_pending();
+    } else if ( sync_source == SYNC_FGFS ) {
+        return FGFS_sync_pending();
+    } else if ( sync_source == SYNC_GOLDY2 ) {
+        return goldy2_sync_pending();
+    }
+    return false;
+}
+
+
 void main_work_loop()
 {
     // update display_on variable
     display_on = comms_node.getBool("display_on");
     
     // printf("apm loop:\n");
+
+    // sleep until the sync source has data, servicing any other
+    // devices that become readable in the meantime.  Without a sync
+    // source this paces the loop at HEARTBEAT_HZ instead of spinning.
+    static double frame_deadline = 0.0;
+    static uint32_t sync_timeouts = 0;
+    if ( sync_source == SYNC_NONE ) {
+        frame_deadline += 1.0 / HEARTBEAT_HZ;
+        double current_time = get_Time();
+        if ( frame_deadline < current_time ) {
+            frame_deadline = current_time;
+        }
+        reactor->wait( frame_deadline );
+    } else if ( reactor->is_open() && !sync_pending()
+                && !reactor->wait( get_Time() + sync_timeout_sec ) ) {
+        sync_timeouts++;
+    }
+
     // read the sensors until we receive an IMU packet
     sync_prof.start();
     double dt = 0.0;
@@ -119,6 +156,7 @@ void main_work_loop()
     }
     status_node.setDouble("frame_time", imu_node.getDouble( "timestamp" ));
     status_node.setDouble("dt", dt);
+    status_node.setLong("sync_timeouts", sync_timeouts);
     sync_prof.stop();
     
     main_prof.start();
@@ -415,6 +453,17 @@ int main( int argc, char **argv )
     // Initialize communication with the selected IMU
     IMU_init();
 
+    // the main loop sleeps on the sync source
+    if ( sync_source == SYNC_APM2 ) {
+        reactor->set_sync( APM2_sync_fd() );
+    } else if ( sync_source == SYNC_AURA3 ) {
+        reactor->set_sync( Aura3_sync_fd() );
+    } else if ( sync_source == SYNC_FGFS ) {
+        reactor->set_sync( FGFS_sync_fd() );
+    } else if ( sync_source == SYNC_GOLDY2 ) {
+        reactor->set_sync( goldy2_sync_fd() );
+    }
+
     // Initialize communication with the selected air data sensor
     AirData_init();
 
@@ -471,6 +520,7 @@ int main( int argc, char **argv )
     // 	ati_pointing_close();
     // }
     payload_mgr.close();
+    health_close();
     control_close();
     Actuator_close();
     logging->close();
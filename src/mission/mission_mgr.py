@@ -7,6 +7,7 @@ import mission.task.camera
 import mission.task.circle
 import mission.task.excite
 import mission.task.flaps_mgr
+import mission.task.geofence
 import mission.task.home_mgr
 import mission.task.idle
 import mission.task.land2
@@ -47,6 +48,8 @@ class MissionMgr:
             result = mission.task.excite.Excite(config_node)
         elif task_name == 'flaps_manager':
             result = mission.task.flaps_mgr.FlapsMgr(config_node)
+        elif task_name == 'geofence':
+            result = mission.task.geofence.GeoFence(config_node)
         elif task_name == 'home_manager':
             result = mission.task.home_mgr.HomeMgr(config_node)
         elif task_name == 'idle':
@@ -0,0 +1,59 @@
+import mission.mission_mgr
+from props import getNode
+
+import comms.events
+from mission.task.task import Task
+
+# Watch the geofence status published by the control loop
+# (/task/geofence) and on a breach while airborne push the configured
+# action task (by nickname, e.g. a circle home or a land task) onto
+# the sequential task list.  A breach that starts on the ground is
+# acted on once the aircraft is airborne.  The action is left in
+# place when the breach clears, returning to the mission is up to
+# the operator.
+
+class GeoFence(Task):
+    def __init__(self, config_node):
+        Task.__init__(self)
+        self.task_node = getNode("/task", True)
+        self.fence_node = getNode("/task/geofence", True)
+        self.name = config_node.getString("name")
+        self.action = config_node.getString("action")
+        self.breach = False
+        self.acted = False
+
+    def activate(self):
+        self.active = True
+        if self.fence_node.getBool("enabled"):
+            comms.events.log("geofence", "monitor started action=" + self.action)
+        
+    def update(self, dt):
+        if not self.active:
+            return False
+
+        breach = self.fence_node.getBool("breach")
+        if breach and not self.breach:
+            zone = self.fence_node.getString("zone")
+            comms.events.log("geofence", "zone=%s margin=%.0f action=%s" % (zone, self.fence_node.getFloat("margin_m"), self.action))
+        if breach and not self.acted:
+            # do the breach action here (iff airborne and not already
+            # flying it), keep trying until it is pushed
+            task = mission.mission_mgr.m.find_standby_task_by_nickname( self.action )
+            front = mission.mission_mgr.m.front_seq_task()
+            if front and front.nickname == self.action:
+                self.acted = True
+            elif ( task and self.task_node.getBool("is_airborne") ):
+                comms.events.log("geofence", "action=" + task.name + "(" + self.action + ")")
+                mission.mission_mgr.m.push_seq_task( task )
+                task.activate()
+                self.acted = True
+        if not breach:
+            self.acted = False
+        self.breach = breach
+
+    def is_complete(self):
+        return False
+    
+    def close(self):
+        self.active = False
+        return True
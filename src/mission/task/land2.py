@@ -4,7 +4,6 @@ from props import getNode
 from auracore import wgs84
 
 import comms.events
-import control.route
 from mission.task.task import Task
 
 d2r = math.pi / 180.0
@@ -193,7 +192,7 @@ class Land(Task):
                     self.nav_node.setString("mode", "route")
         else:
             # on final approach
-            if control.route.dist_valid:
+            if self.route_node.getBool("dist_valid"):
                 self.dist_rem_m = self.route_node.getFloat("dist_remaining_m")
 
         # compute glideslope/target elevation
@@ -26,9 +26,11 @@ using namespace Eigen;
 #include "comms/logging.hxx"
 #include "init/globals.hxx"
 #include "sensors/cal_temp.hxx"
+#include "sensors/imu_batch.hxx"
 #include "util/butter.hxx"
-#include "util/linearfit.hxx"
+#include "util/clocksync.hxx"
 #include "util/lowpass.hxx"
+#include "util/serial_write.hxx"
 #include "util/timing.h"
 
 #include "APM2.hxx"
@@ -128,7 +130,7 @@ static double imu_timestamp = 0.0;
 static uint32_t imu_micros = 0;
 static int16_t imu_sensors[NUM_IMU_SENSORS];
 
-static LinearFitFilter imu_offset(200.0, 0.01);
+static ClockSync imu_clock;
 
 // 2nd order filter, 100hz sample rate expected, 3rd field is cutoff freq.
 // higher freq value == noisier, a value near 1 hz should work well
@@ -842,39 +844,41 @@ static bool APM2_imu_update_internal() {
 	// reference frame.  Assumes the APM2 clock drifts relative to
 	// host clock.  Assumes the APM2 imu stamp dt is very stable.
 	// Assumes the host system is not-real time and there may be
-	// momentary external disruptions to execution. The code
-	// estimates the error (difference) between APM2 clock and
-	// host clock.  Then builds a real time linear fit of APM2
-	// clock versus difference with the host.  This linear fit is
-	// used to estimate the current error (smoothly), add that to
-	// the APM2 clock and derive a more regular/stable IMU time
-	// stamp (versus just sampling current host time.)
+	// momentary external disruptions to execution. Host time at
+	// parse is only ever late, so the clock sync tracks the lower
+	// envelope of (host - APM2) over time; adding that to the APM2
+	// clock gives a regular/stable IMU time stamp (versus just
+	// sampling current host time.)
 	
 	// imu_micros &= 0xffffff; // 24 bits = 16.7 microseconds roll over
 	
 	static uint32_t last_imu_micros = 0;
 	double imu_remote_sec = (double)imu_micros / 1000000.0;
-	double diff = imu_timestamp - imu_remote_sec;
 	if ( last_imu_micros > imu_micros ) {
 	    events->log("APM2", "micros() rolled over\n");
-	    imu_offset.reset();
+	    imu_clock.reset();
 	}
-	imu_offset.update(imu_remote_sec, diff);
-	double fit_diff = imu_offset.get_value(imu_remote_sec);
-	// printf("fit_diff = %.6f  diff = %.6f  ts = %.6f\n",
-	//        fit_diff, diff, imu_remote_sec + fit_diff );
+	imu_clock.update(imu_remote_sec, imu_timestamp);
+	// printf("delay = %.6f  ts = %.6f\n",
+	//        imu_clock.get_delay(), imu_clock.get_local(imu_remote_sec) );
 
 	last_imu_micros = imu_micros;
 	
-	imu_node.setDouble( "timestamp", imu_remote_sec + fit_diff );
+	double imu_time = imu_clock.get_local(imu_remote_sec);
+	float ax = ax_cal.calibrate(ax_raw, temp_C);
+	float ay = ay_cal.calibrate(ay_raw, temp_C);
+	float az = az_cal.calibrate(az_raw, temp_C);
+	imu_batch_push( "APM2", imu_time, p_raw, q_raw, r_raw, ax, ay, az );
+
+	imu_node.setDouble( "timestamp", imu_time );
 	imu_node.setLong( "imu_micros", imu_micros );
 	imu_node.setDouble( "imu_sec", (double)imu_micros / 1000000.0 );
 	imu_node.setDouble( "p_rad_sec", p_raw );
 	imu_node.setDouble( "q_rad_sec", q_raw );
 	imu_node.setDouble( "r_rad_sec", r_raw );
-	imu_node.setDouble( "ax_mps_sec", ax_cal.calibrate(ax_raw, temp_C) );
-	imu_node.setDouble( "ay_mps_sec", ay_cal.calibrate(ay_raw, temp_C) );
-	imu_node.setDouble( "az_mps_sec", az_cal.calibrate(az_raw, temp_C) );
+	imu_node.setDouble( "ax_mps_sec", ax );
+	imu_node.setDouble( "ay_mps_sec", ay );
+	imu_node.setDouble( "az_mps_sec", az );
 	imu_node.setLong( "hx_raw", hx );
 	imu_node.setLong( "hy_raw", hy );
 	imu_node.setLong( "hz_raw", hz );
@@ -1532,85 +1536,66 @@ static int gen_pulse( double val, bool symmetrical ) {
 }
 
 
-static bool APM2_act_write() {
-    uint8_t buf[256];
-    uint8_t cksum0, cksum1;
-    uint8_t size = 0;
-    /* int len; */
-
-    // start of message sync bytes
-    buf[0] = START_OF_MSG0; buf[1] = START_OF_MSG1, buf[2] = 0;
-    /* len = */ write( fd, buf, 2 );
+// actuator write statistics
+static uint32_t act_write_errors = 0;
+static uint32_t act_short_writes = 0;
+static double act_write_usec = 0.0;
+static double act_write_max_usec = 0.0;
+
+// append a pwm pulse (lo, hi) to the frame and fold it into the check sum
+static inline void act_pack( uint8_t **p, int val, uint8_t *c0, uint8_t *c1 ) {
+    uint8_t hi = val / 256;
+    uint8_t lo = val - (hi * 256);
+    *(*p)++ = lo;
+    *c0 += lo; *c1 += *c0;
+    *(*p)++ = hi;
+    *c0 += hi; *c1 += *c0;
+}
 
-    // packet id (1 byte)
-    buf[0] = FLIGHT_COMMAND_PACKET_ID;
-    // packet length (1 byte)
-    buf[1] = 2 * NUM_ACTUATORS;
-    /* len = */ write( fd, buf, 2 );
+// The whole actuator frame is assembled in one buffer and sent as a
+// unit (see util/serial_write.hxx.)
+static bool APM2_act_write() {
+    const uint8_t size = 2 * NUM_ACTUATORS;
+    uint8_t frame[size + 6];
+    uint8_t *p = frame + 4;
+
+    // header
+    frame[0] = START_OF_MSG0; frame[1] = START_OF_MSG1;
+    frame[2] = FLIGHT_COMMAND_PACKET_ID;
+    frame[3] = size;
+    uint8_t c0 = FLIGHT_COMMAND_PACKET_ID;
+    uint8_t c1 = c0;
+    c0 += size; c1 += c0;
 
     // actuator data
-    if ( NUM_ACTUATORS == 8 ) {
-	int val;
-	uint8_t hi, lo;
-
-	val = gen_pulse( act_node.getDouble("aileron"), true );
-	hi = val / 256;
-	lo = val - (hi * 256);
-	buf[size++] = lo;
-	buf[size++] = hi;
-
-	val = gen_pulse( act_node.getDouble("elevator"), true );
-	hi = val / 256;
-	lo = val - (hi * 256);
-	buf[size++] = lo;
-	buf[size++] = hi;
-
-	val = gen_pulse( act_node.getDouble("throttle"), false );
-	hi = val / 256;
-	lo = val - (hi * 256);
-	buf[size++] = lo;
-	buf[size++] = hi;
-
-	val = gen_pulse( act_node.getDouble("rudder"), true );
-	hi = val / 256;
-	lo = val - (hi * 256);
-	buf[size++] = lo;
-	buf[size++] = hi;
+    act_pack( &p, gen_pulse( act_node.getDouble("aileron"), true ), &c0, &c1 );
+    act_pack( &p, gen_pulse( act_node.getDouble("elevator"), true ), &c0, &c1 );
+    act_pack( &p, gen_pulse( act_node.getDouble("throttle"), false ), &c0, &c1 );
+    act_pack( &p, gen_pulse( act_node.getDouble("rudder"), true ), &c0, &c1 );
+    act_pack( &p, gen_pulse( act_node.getDouble("channel5"), true ), &c0, &c1 );
+    act_pack( &p, gen_pulse( act_node.getDouble("flaps"), false ), &c0, &c1 );
+    act_pack( &p, gen_pulse( act_node.getDouble("channel7"), true ), &c0, &c1 );
+    act_pack( &p, gen_pulse( act_node.getDouble("channel8"), true ), &c0, &c1 );
 
-	val = gen_pulse( act_node.getDouble("channel5"), true );
-	hi = val / 256;
-	lo = val - (hi * 256);
-	buf[size++] = lo;
-	buf[size++] = hi;
-
-	val = gen_pulse( act_node.getDouble("flaps"), false );
-	hi = val / 256;
-	lo = val - (hi * 256);
-	buf[size++] = lo;
-	buf[size++] = hi;
-
-	val = gen_pulse( act_node.getDouble("channel7"), true );
-	hi = val / 256;
-	lo = val - (hi * 256);
-	buf[size++] = lo;
-	buf[size++] = hi;
+    // check sum (2 bytes)
+    *p++ = c0;
+    *p++ = c1;
 
-	val = gen_pulse( act_node.getDouble("channel8"), true );
-	hi = val / 256;
-	lo = val - (hi * 256);
-	buf[size++] = lo;
-	buf[size++] = hi;
+    double start = get_Time();
+    bool result = serial_write_frame( fd, frame, p - frame,
+                                      &act_short_writes, &act_write_errors );
+    act_write_usec = (get_Time() - start) * 1000000.0;
+    if ( act_write_usec > act_write_max_usec ) {
+        act_write_max_usec = act_write_usec;
     }
 
-    // write packet
-    /* len = */ write( fd, buf, size );
-  
-    // check sum (2 bytes)
-    APM2_cksum( FLIGHT_COMMAND_PACKET_ID, size, buf, size, &cksum0, &cksum1 );
-    buf[0] = cksum0; buf[1] = cksum1; buf[2] = 0;
-    /* len = */ write( fd, buf, 2 );
+    return result;
+}
 
-    return true;
+
+// the uart the main loop waits on
+int APM2_sync_fd() {
+    return fd;
 }
 
 
@@ -1622,18 +1607,26 @@ double APM2_update() {
     // read packets until we receive an IMU packet and the uart buffer
     // is mostly empty.  The IMU packet (combined with being caught up
     // reading the uart buffer is our signal to run an interation of
-    // the main loop.
+    // the main loop.  When batching, keep going until the batch
+    // covers a whole frame.
     double last_time = imu_node.getDouble( "timestamp" );
     int bytes_available = 0;
     while ( true ) {
         int pkt_id = APM2_read();
-        if ( pkt_id == IMU_PACKET_ID ) {
+        if ( pkt_id == IMU_PACKET_ID && imu_batch_ready() ) {
             ioctl(fd, FIONREAD, &bytes_available);
 	    if ( bytes_available < 64 ) {
 		break;
             }
         }
     }
+
+    // track communication errors to the APM2
+    apm2_node.setLong("act_write_errors", act_write_errors);
+    apm2_node.setLong("act_short_writes", act_short_writes);
+    apm2_node.setDouble("act_write_usec", act_write_usec);
+    apm2_node.setDouble("act_write_max_usec", act_write_max_usec);
+
     double cur_time = imu_node.getDouble( "timestamp" );
 
     return cur_time - last_time;
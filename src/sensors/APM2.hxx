@@ -12,6 +12,7 @@
 // function prototypes
 
 double APM2_update();
+int APM2_sync_fd();
 void APM2_close();
 bool APM2_request_baud( uint32_t baud );
 
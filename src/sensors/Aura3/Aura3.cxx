@@ -26,9 +26,11 @@ using namespace Eigen;
 #include "comms/logging.hxx"
 #include "init/globals.hxx"
 #include "sensors/cal_temp.hxx"
+#include "sensors/imu_batch.hxx"
 #include "util/butter.hxx"
-#include "util/linearfit.hxx"
+#include "util/clocksync.hxx"
 #include "util/lowpass.hxx"
+#include "util/serial_write.hxx"
 #include "util/timing.h"
 
 #include "Aura3.hxx"
@@ -61,6 +63,7 @@ static bool actuator_inited = false;
 bool Aura3_actuator_configured = false; // externally visible
 
 static int fd = -1;
+static int ring_slot = -1;	// io_uring slot when sensor_ring is active
 static string device_name = "/dev/ttyS4";
 static int baud = 500000;
 static float volt_div_ratio = 100; // a nonsense value
@@ -79,7 +82,18 @@ static double imu_timestamp = 0.0;
 static uint32_t imu_micros = 0;
 static int16_t imu_sensors[NUM_IMU_SENSORS];
 
-static LinearFitFilter imu_offset(200.0, 0.01);
+static ClockSync imu_clock;
+
+// uart receive buffer, the last byte arrived at rx_time and the
+// earlier ones one character time (byte_sec) apart before that
+static uint8_t rx_buf[512];
+static int rx_len = 0;
+static int rx_pos = 0;
+static double rx_time = 0.0;
+static double byte_sec = 10.0 / 500000;  // start + 8 data + stop bits
+static double last_byte_time = 0.0;	// arrival of the last byte read
+static double pkt_start_time = 0.0;	// arrival of the current packet
+static uint32_t bulk_reads = 0;
 
 // 2nd order filter, 100hz sample rate expected, 3rd field is cutoff freq.
 // higher freq value == noisier, a value near 1 hz should work well
@@ -151,32 +165,39 @@ static void Aura3_cksum( uint8_t hdr1, uint8_t hdr2, uint8_t *buf, uint8_t size,
     *cksum1 = c1;
 }
 
+// serial write statistics
+static uint32_t write_errors = 0;
+static uint32_t short_writes = 0;
+static double act_write_usec = 0.0;
+static double act_write_max_usec = 0.0;
+
+// send one complete, preformatted frame (see util/serial_write.hxx)
+static bool write_frame( const uint8_t *frame, int size ) {
+    return serial_write_frame( fd, frame, size, &short_writes, &write_errors );
+}
+
 static bool write_packet(uint8_t packet_id, uint8_t *payload, uint8_t len) {
-    uint8_t buf[256];
+    uint8_t buf[256 + 6];
     uint8_t cksum0, cksum1;
     
     // start of message sync bytes
-    buf[0] = START_OF_MSG0; buf[1] = START_OF_MSG1, buf[2] = 0;
-    write( fd, buf, 2 );
+    buf[0] = START_OF_MSG0; buf[1] = START_OF_MSG1;
 
     // packet id (1 byte)
-    buf[0] = packet_id;
+    buf[2] = packet_id;
 
     // packet length (1 byte)
-    buf[1] = len;
-    write( fd, buf, 2 );
+    buf[3] = len;
 
     if ( len > 0 ) {
-        // write payload
-        write( fd, payload, len );
+        memcpy( buf + 4, payload, len );
     }
     
     // check sum (2 bytes)
     Aura3_cksum( packet_id, len, payload, len, &cksum0, &cksum1 );
-    buf[0] = cksum0; buf[1] = cksum1; buf[2] = 0;
-    write( fd, buf, 2 );
+    buf[4 + len] = cksum0; buf[5 + len] = cksum1;
 
-    return true;
+    return write_frame( buf, len + 6 );
 }
 
 static bool write_eeprom() {
@@ -355,6 +376,8 @@ static bool Aura3_open() {
     }
     if ( battery_cells < 1 ) { battery_cells = 1; }
 
+    byte_sec = 10.0 / baud;
+
     int baud_bits = B500000;
     if ( baud == 115200 ) {
 	baud_bits = B115200;
@@ -370,6 +393,10 @@ static bool Aura3_open() {
     }
 
     sleep(1);
+
+    if ( sensor_ring != NULL ) {
+        ring_slot = sensor_ring->add( fd, false, "Aura3" );
+    }
     
     master_opened = true;
 
@@ -533,39 +560,42 @@ static bool Aura3_imu_update_internal() {
 	// reference frame.  Assumes the Aura3 clock drifts relative to
 	// host clock.  Assumes the Aura3 imu stamp dt is very stable.
 	// Assumes the host system is not-real time and there may be
-	// momentary external disruptions to execution. The code
-	// estimates the error (difference) between Aura3 clock and
-	// host clock.  Then builds a real time linear fit of Aura3
-	// clock versus difference with the host.  This linear fit is
-	// used to estimate the current error (smoothly), add that to
-	// the Aura3 clock and derive a more regular/stable IMU time
-	// stamp (versus just sampling current host time.)
+	// momentary external disruptions to execution. The packet
+	// arrival time (back dated to its first byte on the wire) is
+	// only ever late, so the clock sync tracks the lower envelope
+	// of (host - Aura3) rather than a least squares fit through
+	// all the scheduling noise.  Adding that to the Aura3 clock
+	// gives a regular/stable IMU time stamp in host time.
 	
 	// imu_micros &= 0xffffff; // 24 bits = 16.7 microseconds roll over
 	
 	static uint32_t last_imu_micros = 0;
 	double imu_remote_sec = (double)imu_micros / 1000000.0;
-	double diff = imu_timestamp - imu_remote_sec;
 	if ( last_imu_micros > imu_micros ) {
 	    events->log("Aura3", "micros() rolled over\n");
-	    imu_offset.reset();
+	    imu_clock.reset();
 	}
-	imu_offset.update(imu_remote_sec, diff);
-	double fit_diff = imu_offset.get_value(imu_remote_sec);
-	// printf("fit_diff = %.6f  diff = %.6f  ts = %.6f\n",
-	//        fit_diff, diff, imu_remote_sec + fit_diff );
+	imu_clock.update(imu_remote_sec, imu_timestamp);
+	// printf("delay = %.6f  ts = %.6f\n",
+	//        imu_clock.get_delay(), imu_clock.get_local(imu_remote_sec) );
 
 	last_imu_micros = imu_micros;
 	
-	imu_node.setDouble( "timestamp", imu_remote_sec + fit_diff );
+	double imu_time = imu_clock.get_local(imu_remote_sec);
+	float ax = ax_cal.calibrate(ax_raw, temp_C);
+	float ay = ay_cal.calibrate(ay_raw, temp_C);
+	float az = az_cal.calibrate(az_raw, temp_C);
+	imu_batch_push( "Aura3", imu_time, p_raw, q_raw, r_raw, ax, ay, az );
+
+	imu_node.setDouble( "timestamp", imu_time );
 	imu_node.setLong( "imu_micros", imu_micros );
 	imu_node.setDouble( "imu_sec", (double)imu_micros / 1000000.0 );
 	imu_node.setDouble( "p_rad_sec", p_raw );
 	imu_node.setDouble( "q_rad_sec", q_raw );
 	imu_node.setDouble( "r_rad_sec", r_raw );
-	imu_node.setDouble( "ax_mps_sec", ax_cal.calibrate(ax_raw, temp_C) );
-	imu_node.setDouble( "ay_mps_sec", ay_cal.calibrate(ay_raw, temp_C) );
-	imu_node.setDouble( "az_mps_sec", az_cal.calibrate(az_raw, temp_C) );
+	imu_node.setDouble( "ax_mps_sec", ax );
+	imu_node.setDouble( "ay_mps_sec", ay );
+	imu_node.setDouble( "az_mps_sec", az );
 	imu_node.setDouble( "hx_raw", hx_raw );
 	imu_node.setDouble( "hy_raw", hy_raw );
 	imu_node.setDouble( "hz_raw", hz_raw );
@@ -632,7 +662,7 @@ static bool Aura3_parse( uint8_t pkt_id, uint8_t pkt_len,
     } else if ( pkt_id == IMU_PACKET_ID ) {
 	if ( pkt_len == sizeof(imu_packet_t) ) {
             imu_packet_t *imu = (imu_packet_t *)payload;
-	    imu_timestamp = get_Time();
+	    imu_timestamp = pkt_start_time;
 	    imu_micros = imu->micros;
 	    //printf("%d\n", imu_micros);
 	    
@@ -761,6 +791,38 @@ static bool Aura3_parse( uint8_t pkt_id, uint8_t pkt_len,
 }
 
 
+// read from the receive buffer, refilling it with one bulk read from
+// the io_uring slot (returns 0 rather than blocking when nothing is
+// queued) or straight from the uart.  The host time is sampled right
+// after the bulk read and each byte is back dated by its position in
+// the chunk.
+static int Aura3_read_bytes( uint8_t *buf, int len ) {
+    if ( rx_pos >= rx_len ) {
+        int result;
+        if ( ring_slot >= 0 ) {
+            result = sensor_ring->read( ring_slot, rx_buf, sizeof(rx_buf) );
+        } else {
+            result = read( fd, rx_buf, sizeof(rx_buf) );
+        }
+        if ( result <= 0 ) {
+            return result;
+        }
+        rx_time = get_Time();
+        rx_len = result;
+        rx_pos = 0;
+        bulk_reads++;
+    }
+    int n = rx_len - rx_pos;
+    if ( n > len ) {
+        n = len;
+    }
+    memcpy( buf, rx_buf + rx_pos, n );
+    rx_pos += n;
+    last_byte_time = rx_time - (rx_len - rx_pos) * byte_sec;
+    return n;
+}
+
+
 #if 0
 static void Aura3_read_tmp() {
     int len;
@@ -794,27 +856,29 @@ static int Aura3_read() {
     if ( state == 0 ) {
 	counter = 0;
 	cksum_A = cksum_B = 0;
-	len = read( fd, input, 1 );
+	len = Aura3_read_bytes( input, 1 );
 	giveup_counter = 0;
 	while ( len > 0 && input[0] != START_OF_MSG0 && giveup_counter < 100 ) {
 	    // printf("state0: len = %d val = %2X (%c)\n", len, input[0] , input[0]);
-	    len = read( fd, input, 1 );
+	    len = Aura3_read_bytes( input, 1 );
 	    giveup_counter++;
 	    // fprintf( stderr, "giveup_counter = %d\n", giveup_counter);
 	}
 	if ( len > 0 && input[0] == START_OF_MSG0 ) {
 	    // fprintf( stderr, "read START_OF_MSG0\n");
+	    pkt_start_time = last_byte_time;
 	    state++;
 	}
     }
     if ( state == 1 ) {
-	len = read( fd, input, 1 );
+	len = Aura3_read_bytes( input, 1 );
 	if ( len > 0 ) {
 	    if ( input[0] == START_OF_MSG1 ) {
 		//fprintf( stderr, "read START_OF_MSG1\n");
 		state++;
 	    } else if ( input[0] == START_OF_MSG0 ) {
 		//fprintf( stderr, "read START_OF_MSG0\n");
+		pkt_start_time = last_byte_time;
 	    } else {
                 parse_errors++;
 		state = 0;
@@ -822,7 +886,7 @@ static int Aura3_read() {
 	}
     }
     if ( state == 2 ) {
-	len = read( fd, input, 1 );
+	len = Aura3_read_bytes( input, 1 );
 	if ( len > 0 ) {
 	    pkt_id = input[0];
 	    cksum_A += input[0];
@@ -832,7 +896,7 @@ static int Aura3_read() {
 	}
     }
     if ( state == 3 ) {
-	len = read( fd, input, 1 );
+	len = Aura3_read_bytes( input, 1 );
 	if ( len > 0 ) {
 	    pkt_len = input[0];
 	    if ( pkt_len < 256 ) {
@@ -847,7 +911,7 @@ static int Aura3_read() {
 	}
     }
     if ( state == 4 ) {
-	len = read( fd, input, 1 );
+	len = Aura3_read_bytes( input, 1 );
 	while ( len > 0 ) {
 	    payload[counter++] = input[0];
 	    // fprintf( stderr, "%02X ", input[0] );
@@ -856,7 +920,7 @@ static int Aura3_read() {
 	    if ( counter >= pkt_len ) {
 		break;
 	    }
-	    len = read( fd, input, 1 );
+	    len = Aura3_read_bytes( input, 1 );
 	}
 
 	if ( counter >= pkt_len ) {
@@ -865,14 +929,14 @@ static int Aura3_read() {
 	}
     }
     if ( state == 5 ) {
-	len = read( fd, input, 1 );
+	len = Aura3_read_bytes( input, 1 );
 	if ( len > 0 ) {
 	    cksum_lo = input[0];
 	    state++;
 	}
     }
     if ( state == 6 ) {
-	len = read( fd, input, 1 );
+	len = Aura3_read_bytes( input, 1 );
 	if ( len > 0 ) {
 	    cksum_hi = input[0];
 	    if ( cksum_A == cksum_lo && cksum_B == cksum_hi ) {
@@ -1270,55 +1334,66 @@ static bool Aura3_send_config() {
 }
 
 
-static bool Aura3_act_write() {
-    uint8_t buf[256];
-    uint8_t *p = buf;
-    uint8_t cksum0, cksum1;
-    uint8_t size = 2 * AP_CHANNELS;
-    /* int len; */
-
-    // start of message sync bytes
-    buf[0] = START_OF_MSG0; buf[1] = START_OF_MSG1, buf[2] = 0;
-    /* len = */ write( fd, buf, 2 );
+// append a 16 bit value to the frame and fold it into the check sum
+static inline void act_pack( uint8_t **p, double val, uint8_t *c0, uint8_t *c1 ) {
+    int16_t v = (int)(val * 16384.0);
+    memcpy( *p, &v, 2 );
+    *c0 += (*p)[0]; *c1 += *c0;
+    *c0 += (*p)[1]; *c1 += *c0;
+    *p += 2;
+}
 
-    // packet id (1 byte)
-    buf[0] = FLIGHT_COMMAND_PACKET_ID;
-    // packet length (1 byte)
-    buf[1] = size;
-    /* len = */ write( fd, buf, 2 );
+static bool Aura3_act_write() {
+    const uint8_t size = 2 * AP_CHANNELS;
+    uint8_t frame[size + 6];
+    uint8_t *p = frame + 4;
+
+    // header
+    frame[0] = START_OF_MSG0; frame[1] = START_OF_MSG1;
+    frame[2] = FLIGHT_COMMAND_PACKET_ID;
+    frame[3] = size;
+    uint8_t c0 = FLIGHT_COMMAND_PACKET_ID;
+    uint8_t c1 = c0;
+    c0 += size; c1 += c0;
 
     // actuator data
-    if ( AP_CHANNELS == 6 ) {
-	int val;
+    act_pack( &p, act_node.getDouble("throttle"), &c0, &c1 );
+    act_pack( &p, act_node.getDouble("aileron"), &c0, &c1 );
+    act_pack( &p, act_node.getDouble("elevator"), &c0, &c1 );
+    act_pack( &p, act_node.getDouble("rudder"), &c0, &c1 );
+    act_pack( &p, act_node.getDouble("flaps"), &c0, &c1 );
+    act_pack( &p, act_node.getDouble("gear"), &c0, &c1 );
 
-	val = act_node.getDouble("throttle") * 16384.0;
-        *(int16_t *)p = val; p += 2;
-
-	val = act_node.getDouble("aileron") * 16384.0;
-        *(int16_t *)p = val; p += 2;
+    // check sum (2 bytes)
+    *p++ = c0;
+    *p++ = c1;
 
-	val = act_node.getDouble("elevator") * 16384.0;
-        *(int16_t *)p = val; p += 2;
+    double start = get_Time();
+    bool result = write_frame( frame, p - frame );
+    act_write_usec = (get_Time() - start) * 1000000.0;
+    if ( act_write_usec > act_write_max_usec ) {
+        act_write_max_usec = act_write_usec;
+    }
 
-	val = act_node.getDouble("rudder") * 16384.0;
-        *(int16_t *)p = val; p += 2;
+    return result;
+}
 
-	val = act_node.getDouble("flaps") * 16384.0;
-        *(int16_t *)p = val; p += 2;
 
-	val = act_node.getDouble("gear") * 16384.0;
-        *(int16_t *)p = val; p += 2;
+// the uart the main loop waits on
+int Aura3_sync_fd() {
+    if ( ring_slot >= 0 ) {
+        return sensor_ring->get_fd();
     }
+    return fd;
+}
 
-    // write packet
-    /* len = */ write( fd, buf, size );
-  
-    // check sum (2 bytes)
-    Aura3_cksum( FLIGHT_COMMAND_PACKET_ID, size, buf, size, &cksum0, &cksum1 );
-    buf[0] = cksum0; buf[1] = cksum1; buf[2] = 0;
-    /* len = */ write( fd, buf, 2 );
 
-    return true;
+// unparsed input already pulled off the uart
+bool Aura3_sync_pending() {
+    if ( rx_pos < rx_len ) {
+        return true;
+    }
+    return ring_slot >= 0 && sensor_ring->available(ring_slot) > 0;
 }
 
 
@@ -1330,13 +1405,27 @@ double Aura3_update() {
     // read packets until we receive an IMU packet and the uart buffer
     // is mostly empty.  The IMU packet (combined with being caught up
     // reading the uart buffer is our signal to run an interation of
-    // the main loop.
+    // the main loop.  When batching, keep going until the batch
+    // covers a whole frame.
     double last_time = imu_node.getDouble( "timestamp" );
     int bytes_available = 0;
     while ( true ) {
         int pkt_id = Aura3_read();
-        if ( pkt_id == IMU_PACKET_ID ) {
-            ioctl(fd, FIONREAD, &bytes_available);
+        if ( pkt_id == 0 && ring_slot >= 0 && rx_pos >= rx_len
+             && sensor_ring->available(ring_slot) == 0 )
+        {
+            // ring is drained, sleep until more data arrives (the
+            // plain uart read blocks instead)
+            reactor->wait( get_Time() + 0.1 );
+            continue;
+        }
+        if ( pkt_id == IMU_PACKET_ID && imu_batch_ready() ) {
+            if ( ring_slot >= 0 ) {
+                bytes_available = sensor_ring->available(ring_slot);
+            } else {
+                ioctl(fd, FIONREAD, &bytes_available);
+            }
+            bytes_available += rx_len - rx_pos;
 	    if ( bytes_available < 256 ) {
                 // a smaller value here means more skipping ahead and
                 // less catching up.
@@ -1350,6 +1439,13 @@ double Aura3_update() {
     // track communication errors from FMU
     aura3_node.setLong("parse_errors", parse_errors);
     aura3_node.setLong("skipped_frames", skipped_frames);
+    aura3_node.setLong("write_errors", write_errors);
+    aura3_node.setLong("short_writes", short_writes);
+    aura3_node.setDouble("act_write_usec", act_write_usec);
+    aura3_node.setDouble("act_write_max_usec", act_write_max_usec);
+    aura3_node.setLong("bulk_reads", bulk_reads);
+    aura3_node.setDouble("clock_skew_ppm", imu_clock.get_skew() * 1000000.0);
+    aura3_node.setDouble("clock_delay_ms", imu_clock.get_delay() * 1000.0);
     
     double cur_time = imu_node.getDouble( "timestamp" );
 
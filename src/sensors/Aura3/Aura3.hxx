@@ -13,6 +13,8 @@
 // function prototypes
 
 double Aura3_update();
+int Aura3_sync_fd();
+bool Aura3_sync_pending();
 void Aura3_close();
 bool Aura3_request_baud( uint32_t baud );
 
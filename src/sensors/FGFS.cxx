@@ -6,7 +6,7 @@
 #include <pyprops.hxx>
 
 #include <stdlib.h>		// drand48()
-#include <sys/ioctl.h>
+#include <string.h>		// memcpy()
 
 #include <eigen3/Eigen/Core>
 #include <eigen3/Eigen/Geometry>
@@ -15,16 +15,23 @@ using namespace Eigen;
 using std::cout;
 using std::endl;
 
-#include "filters/nav_common/coremag.h"
-#include "filters/nav_common/nav_functions_float.hxx"
+#include "util/coremag.h"
+#include "filters/nav_common/nav_functions.hxx"
+#include "init/globals.hxx"
+#include "sensors/imu_batch.hxx"
 #include "util/netSocket.h"
 #include "util/timing.h"
+#include "util/udp_batch.hxx"
 
 #include "FGFS.hxx"
 
 
 static netSocket sock_imu;
 static netSocket sock_gps;
+static int ring_imu = -1;	// io_uring slots when sensor_ring is active
+static int ring_gps = -1;
+static UDPBatch batch_imu;	// otherwise batched recvmmsg() reads
+static UDPBatch batch_gps;
 
 static int port_imu = 0;
 static int port_gps = 0;
@@ -110,6 +117,13 @@ bool fgfs_imu_init( string output_path, pyPropertyNode *config ) {
     // don't block waiting for input
     sock_imu.setBlocking( false );
 #endif
+
+    if ( sensor_ring != NULL ) {
+        ring_imu = sensor_ring->add( sock_imu.getHandle(), true, "fgfs imu" );
+    }
+    if ( ring_imu < 0 ) {
+        batch_imu.init( sock_imu.getHandle() );
+    }
     
     return true;
 }
@@ -142,6 +156,13 @@ bool fgfs_gps_init( string output_path, pyPropertyNode *config ) {
     // don't block waiting for input
     sock_gps.setBlocking( false );
 
+    if ( sensor_ring != NULL ) {
+        ring_gps = sensor_ring->add( sock_gps.getHandle(), true, "fgfs gps" );
+    }
+    if ( ring_gps < 0 ) {
+        batch_gps.init( sock_gps.getHandle() );
+    }
+
     return true;
 }
 
@@ -164,6 +185,27 @@ static void my_swap( uint8_t *buf, int index, int count )
 }
 
 
+// next datagram from the io_uring slot or the recvmmsg() batch,
+// returns its length (0 when nothing is queued) and the arrival time
+// in *stamp
+static int fgfs_recv( UDPBatch *batch, int slot, uint8_t *buf, int len,
+                      double *stamp )
+{
+    uint8_t *packet;
+    int size;
+    if ( slot >= 0 ) {
+        size = sensor_ring->recv( slot, &packet, stamp );
+    } else {
+        size = batch->next( &packet, stamp );
+    }
+    if ( size <= 0 ) {
+        return 0;
+    }
+    memcpy( buf, packet, size < len ? size : len );
+    return size;
+}
+
+
 static bool fgfs_imu_sync_update() {
     const int fgfs_imu_size = 52;
     uint8_t packet_buf[fgfs_imu_size];
@@ -171,8 +213,9 @@ static bool fgfs_imu_sync_update() {
     bool fresh_data = false;
 
     int result;
-    if ( (result = sock_imu.recv(packet_buf, fgfs_imu_size, 0))
-	    == fgfs_imu_size )
+    double stamp;
+    if ( (result = fgfs_recv(&batch_imu, ring_imu, packet_buf, fgfs_imu_size,
+                             &stamp)) == fgfs_imu_size )
     {
 	fresh_data = true;
 
@@ -221,13 +264,13 @@ static bool fgfs_imu_sync_update() {
         //cout << av << endl << nav << endl << endl;
 
         // generate fake magnetometer readings
-        q_N2B = eul2quat(roll_truth * D2R, pitch_truth * D2R, yaw_truth * D2R);
+        q_N2B = eul2quat<float>(roll_truth * D2R, pitch_truth * D2R, yaw_truth * D2R);
         // rotate ideal mag vector into body frame (then normalized)
         Vector3f mag_body = q_N2B.inverse() * mag_ned;
         mag_body.normalize();
         // cout << "mag vector (body): " << mag_body(0) << " " << mag_body(1) << " " << mag_body(2) << endl;
 
-	double cur_time = get_Time();
+	double cur_time = stamp;
 	imu_node.setDouble( "timestamp", cur_time );
 	imu_node.setDouble( "p_rad_sec", ngv(0) );
 	imu_node.setDouble( "q_rad_sec", ngv(1) );
@@ -235,6 +278,8 @@ static bool fgfs_imu_sync_update() {
 	imu_node.setDouble( "ax_mps_sec", nav(0) );
 	imu_node.setDouble( "ay_mps_sec", nav(1) );
 	imu_node.setDouble( "az_mps_sec", nav(2) );
+	imu_batch_push( "fgfs", cur_time, ngv(0), ngv(1), ngv(2),
+			nav(0), nav(1), nav(2) );
 	imu_node.setDouble( "hx", mag_body(0) );
 	imu_node.setDouble( "hy", mag_body(1) );
 	imu_node.setDouble( "hz", mag_body(2) );
@@ -267,6 +312,22 @@ static bool fgfs_imu_sync_update() {
     return fresh_data;
 }
 
+// the imu socket the main loop waits on
+int FGFS_sync_fd() {
+    if ( ring_imu >= 0 ) {
+        return sensor_ring->get_fd();
+    }
+    return sock_imu.getHandle();
+}
+
+// imu packets already pulled off the socket
+bool FGFS_sync_pending() {
+    if ( ring_imu >= 0 ) {
+        return sensor_ring->available(ring_imu) > 0;
+    }
+    return batch_imu.pending() > 0;
+}
+
 // Read fgfs packets using IMU packet as the main timing reference.
 // Returns the dt from the IMU perspective, not the localhost
 // perspective.  This should generally be far more accurate and
@@ -278,10 +339,24 @@ double FGFS_update() {
     // main loop.
     double last_time = imu_node.getDouble( "timestamp" );
     int bytes_available = 0;
+    bool got_imu = false;
     while ( true ) {
-        fgfs_imu_sync_update();
-	ioctl(sock_imu.getHandle(), FIONREAD, &bytes_available);
+        if ( fgfs_imu_sync_update() ) {
+            got_imu = true;
+        }
+	if ( ring_imu >= 0 ) {
+	    bytes_available = sensor_ring->available(ring_imu);
+	} else {
+	    bytes_available = batch_imu.available();
+	}
 	if ( !bytes_available ) {
+            if ( !got_imu || !imu_batch_ready() ) {
+                // woken early (the ring fd also wakes us for gps
+                // packets) or timed out, keep waiting for the imu
+                // (or the rest of the batch)
+                reactor->wait( get_Time() + 0.1 );
+                continue;
+            }
 	    break;
         }
 	// printf("looping: %d bytes available in imu sock buffer\n", bytes_available);
@@ -323,8 +398,9 @@ bool fgfs_gps_update() {
     bool fresh_data = false;
 
     int result;
-    while ( (result = sock_gps.recv(packet_buf, fgfs_gps_size, 0))
-	    == fgfs_gps_size )
+    double stamp;
+    while ( (result = fgfs_recv(&batch_gps, ring_gps, packet_buf, fgfs_gps_size,
+                                &stamp)) == fgfs_gps_size )
     {
 	fresh_data = true;
 
@@ -366,7 +442,7 @@ bool fgfs_gps_update() {
         mag_ned.normalize();
         // cout << "mag vector (ned): " << mag_ned(0) << " " << mag_ned(1) << " " << mag_ned(2) << endl;
         
-	gps_node.setDouble( "timestamp", get_Time() );
+	gps_node.setDouble( "timestamp", stamp );
 	gps_node.setDouble( "latitude_deg", lat );
 	gps_node.setDouble( "longitude_deg", lon );
 	gps_node.setDouble( "altitude_m", alt );
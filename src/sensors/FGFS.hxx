@@ -7,6 +7,8 @@
 
 // function prototypes
 double FGFS_update();
+int FGFS_sync_fd();
+bool FGFS_sync_pending();
 
 bool fgfs_imu_init( string output_path, pyPropertyNode *config );
 bool fgfs_imu_update();
@@ -9,7 +9,6 @@
 #include <stdio.h>
 #include <string>
 #include <string.h>
-#include <sys/ioctl.h>
 #include <sys/time.h>  // settimeofday()
 
 #include <eigen3/Eigen/Core>
@@ -23,10 +22,12 @@ using namespace Eigen;
 //#include "math/SGGeodesy.hxx"
 #include "util/geodesy.hxx"
 #include "sensors/cal_temp.hxx"
-#include "util/linearfit.hxx"
+#include "sensors/imu_batch.hxx"
+#include "util/clocksync.hxx"
 #include "util/netSocket.h"
 //#include "util/poly1d.hxx"
 #include "util/timing.h"
+#include "util/udp_batch.hxx"
 
 #include "util_goldy2.hxx"
 #include "Goldy2.hxx"
@@ -34,6 +35,8 @@ using namespace Eigen;
 
 static netSocket sock;
 static int port = 0;
+static int ring_slot = -1;	// io_uring slot when sensor_ring is active
+static UDPBatch batch;		// otherwise batched recvmmsg() reads
 static int gps_fix_value = 0;
 static const int rcin_channels = 16;
 static uint16_t rcin[rcin_channels];
@@ -61,7 +64,7 @@ static bool pilot_input_inited = false;
 static string imu_orientation = "normal";
 
 static double imu_timestamp = 0.0;
-static LinearFitFilter imu_offset(200.0, 0.01);
+static ClockSync imu_clock;
 
 static AuraCalTemp p_cal;
 static AuraCalTemp q_cal;
@@ -172,6 +175,13 @@ bool goldy2_init() {
     sock.setBlocking( false );
 #endif
 
+    if ( sensor_ring != NULL ) {
+        ring_slot = sensor_ring->add( sock.getHandle(), true, "goldy2" );
+    }
+    if ( ring_slot < 0 ) {
+        batch.init( sock.getHandle() );
+    }
+
     master_init = true;
 
     return true;
@@ -340,12 +350,18 @@ static bool goldy2_imu_update_internal() {
     }
     double temp_C = imu_sensors.temp;
 	
-    imu_node.setDouble( "p_rad_sec", p_cal.calibrate(p_raw, temp_C) );
-    imu_node.setDouble( "q_rad_sec", q_cal.calibrate(q_raw, temp_C) );
-    imu_node.setDouble( "r_rad_sec", r_cal.calibrate(r_raw, temp_C) );
-    imu_node.setDouble( "ax_mps_sec", ax_cal.calibrate(ax_raw, temp_C) );
-    imu_node.setDouble( "ay_mps_sec", ay_cal.calibrate(ay_raw, temp_C) );
-    imu_node.setDouble( "az_mps_sec", az_cal.calibrate(az_raw, temp_C) );
+    float p = p_cal.calibrate(p_raw, temp_C);
+    float q = q_cal.calibrate(q_raw, temp_C);
+    float r = r_cal.calibrate(r_raw, temp_C);
+    float ax = ax_cal.calibrate(ax_raw, temp_C);
+    float ay = ay_cal.calibrate(ay_raw, temp_C);
+    float az = az_cal.calibrate(az_raw, temp_C);
+    imu_node.setDouble( "p_rad_sec", p );
+    imu_node.setDouble( "q_rad_sec", q );
+    imu_node.setDouble( "r_rad_sec", r );
+    imu_node.setDouble( "ax_mps_sec", ax );
+    imu_node.setDouble( "ay_mps_sec", ay );
+    imu_node.setDouble( "az_mps_sec", az );
 
     imu_node.setDouble( "hx_raw", hx_raw );
     imu_node.setDouble( "hy_raw", hy_raw );
@@ -368,25 +384,23 @@ static bool goldy2_imu_update_internal() {
     // reference frame.  Assumes the FMU clock drifts relative to
     // host clock.  Assumes the FMU imu stamp dt is very stable.
     // Assumes the host system is not-real time and there may be
-    // momentary external disruptions to execution. The code
-    // estimates the error (difference) between FMU clock and
-    // host clock.  Then builds a real time linear fit of FMU
-    // clock versus difference with the host.  This linear fit is
-    // used to estimate the current error (smoothly), add that to
-    // the FMU clock and derive a more regular/stable IMU time
-    // stamp (versus just sampling current host time.)
+    // momentary external disruptions to execution. The kernel
+    // arrival stamp is only ever late, so the clock sync tracks the
+    // lower envelope of (host - FMU) over time; adding that to the
+    // FMU clock gives a regular/stable IMU time stamp (versus just
+    // sampling current host time.)
 	
     double imu_remote_sec = (double)imu_sensors.time / 1000000.0;
-    double diff = imu_timestamp - imu_remote_sec;
     if ( last_imu_internal_time > imu_sensors.time ) {
 	events->log("FMU", "micros() rolled over\n");
-	imu_offset.reset();
+	imu_clock.reset();
     }
-    imu_offset.update(imu_remote_sec, diff);
-    double fit_diff = imu_offset.get_value(imu_remote_sec);
-    // printf("imu = %.6f fit_diff = %.6f  diff = %.6f  ts = %.6f\n",
-    //        imu_remote_sec, fit_diff, diff, imu_remote_sec + fit_diff );
-    imu_node.setDouble( "timestamp", imu_remote_sec + fit_diff );
+    imu_clock.update(imu_remote_sec, imu_timestamp);
+    // printf("imu = %.6f delay = %.6f  ts = %.6f\n",
+    //        imu_remote_sec, imu_clock.get_delay(), imu_clock.get_local(imu_remote_sec) );
+    double imu_time = imu_clock.get_local(imu_remote_sec);
+    imu_node.setDouble( "timestamp", imu_time );
+    imu_batch_push( "Goldy2", imu_time, p, q, r, ax, ay, az );
 
     last_imu_internal_time = imu_sensors.time;
 
@@ -876,7 +890,8 @@ static bool scan_ublox(uint8_t *packet, int packet_len) {
 }
 
 // parse packets
-static int goldy2_parse( uint8_t *buf, int size ) {
+// stamp is the packet arrival time (get_Time() seconds)
+static int goldy2_parse( uint8_t *buf, int size, double stamp ) {
     if ( size < 8 ) {
         printf("goldy packet corruption!\n");
 	return 0;
@@ -900,7 +915,7 @@ static int goldy2_parse( uint8_t *buf, int size ) {
     }
     if ( buf[3] == 0x81 && len == 76 ) {
 	// IMU packet
-	imu_timestamp = get_Time();
+	imu_timestamp = stamp;
         uint8_t *payload = buf + 6;
 	uint64_t time_ls = *(uint32_t *)payload; payload += 4;
 	uint64_t time_ms = *(uint32_t *)payload; payload += 4;
@@ -960,18 +975,38 @@ static int goldy2_parse( uint8_t *buf, int size ) {
 
 // read and parse the next incoming packet
 static int goldy2_read() {
-    const int goldy2_max_size = 2048;
-    uint8_t packet_buf[goldy2_max_size];
-    
-    int result = sock.recv(packet_buf, goldy2_max_size, 0);
+    uint8_t *packet_buf;
+    double stamp;
+    int result;
+    if ( ring_slot >= 0 ) {
+        result = sensor_ring->recv(ring_slot, &packet_buf, &stamp);
+    } else {
+        result = batch.next(&packet_buf, &stamp);
+    }
     if ( result > 0 ) {
-	int pkt_id = goldy2_parse(packet_buf, result);
+	int pkt_id = goldy2_parse(packet_buf, result, stamp);
 	return pkt_id;
     }
 
     return 0;
 }
 
+// the socket the main loop waits on
+int goldy2_sync_fd() {
+    if ( ring_slot >= 0 ) {
+        return sensor_ring->get_fd();
+    }
+    return sock.getHandle();
+}
+
+// packets already pulled off the socket
+bool goldy2_sync_pending() {
+    if ( ring_slot >= 0 ) {
+        return sensor_ring->available(ring_slot) > 0;
+    }
+    return batch.pending() > 0;
+}
+
 // Read goldy2 packets using IMU packet as the main timing reference.
 // Returns the dt from the IMU perspective, not the localhost
 // perspective.  This should generally be far more accurate and
@@ -981,9 +1016,23 @@ double goldy2_update() {
     double last_time = imu_node.getDouble( "timestamp" );
     while ( true ) {
 	int pkt_id = goldy2_read();
-	if ( pkt_id == 0x81 /* IMU */ ) {
+	if ( pkt_id == 0 ) {
+	    // nothing parsed: either the socket is empty or a bad packet
+	    // was dropped.  Only sleep (rather than spinning on recv())
+	    // when nothing is left of the last batch, packets already
+	    // pulled in won't make the socket readable again.
+	    if ( !goldy2_sync_pending() ) {
+		reactor->wait( get_Time() + 0.1 );
+	    }
+	    continue;
+	}
+	if ( pkt_id == 0x81 /* IMU */ && imu_batch_ready() ) {
 	    int bytes_available = 0;
-            ioctl(sock.getHandle(), FIONREAD, &bytes_available);
+            if ( ring_slot >= 0 ) {
+                bytes_available = sensor_ring->available(ring_slot);
+            } else {
+                bytes_available = batch.available();
+            }
             if ( bytes_available < 512 /* IMU packet len */ ) {
                 // bigger values == break out and process data even though we
                 // are slightly backed up (play more catchup).
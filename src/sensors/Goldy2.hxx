@@ -13,6 +13,8 @@
 // function prototypes
 bool goldy2_open();
 double goldy2_update();
+int goldy2_sync_fd();
+bool goldy2_sync_pending();
 bool goldy2_close();
 
 bool goldy2_imu_init( string output_path, pyPropertyNode *config );
@@ -4,20 +4,33 @@
  * Read gps data from the gpsd driver (provides data via a socket
  * connection on port 2947)
  *
+ * Speaks the gpsd json protocol: after ?WATCH={"enable":true,"json":true}
+ * gpsd streams one json object per line.  TPV (position/velocity/time)
+ * and SKY (satellites, dop) reports are scanned in place out of the
+ * receive buffer and written straight to the gps properties; nothing
+ * is allocated per report and a report split across recv() calls is
+ * simply completed by the next one.
+ *
  * Copyright (C) 2012 - Curt Olson curtolson@flightgear.org
  *
  */
 
 #include <pyprops.hxx>
 
+#include <errno.h>		// errno
+#include <math.h>		// sqrt(), NAN
+#include <stdlib.h>		// strtod()
+#include <string.h>		// memchr(), memmove()
+#include <time.h>		// timegm()
+
 #include <string>
 using std::string;
 
 #include "include/globaldefs.h"
 
 #include "comms/display.hxx"
+#include "init/globals.hxx"
 #include "util/netSocket.h"
-#include "util/strutils.hxx"
 #include "util/timing.h"
 #include "gps_mgr.hxx"
 
@@ -29,10 +42,18 @@ static pyPropertyNode gps_node;
 
 static int port = 2947;
 static string host = "localhost";
-static string init_string;
+static string init_string = "?WATCH={\"enable\":true,\"json\":true};\n";
 static netSocket gpsd_sock;
 static bool socket_connected = false;
 static double last_init_time = 0.0;
+static bool use_reactor = false;
+static bool fresh_gps = false;  // set by the reactor callback
+
+// receive buffer, complete lines are parsed in place and the partial
+// one left at the front for the next recv()
+static char rx_buf[8192];
+static int rx_len = 0;
+static uint32_t parse_errors = 0;
 
 
 // initialize gpsd input property nodes
@@ -49,7 +70,7 @@ static void bind_input( pyPropertyNode *config ) {
 }
 
 
-// initialize gpsd output property nodes 
+// initialize gpsd output property nodes
 static void bind_output( string output_path ) {
     gps_node = pyGetNode(output_path, true);
 }
@@ -80,10 +101,24 @@ static void gpsd_send_init() {
 }
 
 
+// drop the gpsd connection (and its reactor registration)
+static void gpsd_disconnect() {
+    if ( use_reactor ) {
+	reactor->remove( gpsd_sock.getHandle() );
+	use_reactor = false;
+    }
+    gpsd_sock.close();
+    socket_connected = false;
+    rx_len = 0;
+}
+
+
+static void gpsd_ready( int fd, void *arg );
+
 // attempt to connect to gpsd
 static void gpsd_connect() {
     // make sure it's closed
-    gpsd_sock.close();
+    gpsd_disconnect();
 
     if ( display_on ) {
 	printf("Attempting to connect to gpsd @ %s:%d ... ",
@@ -96,7 +131,7 @@ static void gpsd_connect() {
 	}
 	return;
     }
-    
+
     if (gpsd_sock.connect( host.c_str(), port ) < 0) {
 	if ( display_on ) {
 	    printf("error connecting to gpsd\n");
@@ -107,6 +142,8 @@ static void gpsd_connect() {
     gpsd_sock.setBlocking( false );
 
     socket_connected = true;
+    use_reactor = reactor->add( gpsd_sock.getHandle(), gpsd_ready, NULL,
+                                "gpsd" );
 
     gpsd_send_init();
 
@@ -116,133 +153,399 @@ static void gpsd_connect() {
 }
 
 
-static bool parse_gpsd_sentence( const char *sentence ) {
+// Minimal json scanning over [p, end).  Each returns the position
+// after what it consumed, or NULL on malformed input.
+
+static const char *json_ws( const char *p, const char *end ) {
+    while ( p < end && (*p == ' ' || *p == '\t' || *p == '\r') ) {
+	p++;
+    }
+    return p;
+}
+
+// a string token, *s/*len are the raw contents between the quotes
+// (escapes are left as is, none of the fields we use have any)
+static const char *json_string( const char *p, const char *end,
+				const char **s, int *len )
+{
+    if ( p >= end || *p != '"' ) {
+	return NULL;
+    }
+    const char *start = ++p;
+    while ( p < end && *p != '"' ) {
+	if ( *p == '\\' ) {
+	    p++;
+	}
+	p++;
+    }
+    if ( p >= end ) {
+	return NULL;
+    }
+    *s = start;
+    *len = p - start;
+    return p + 1;
+}
+
+// skip any value, including nested objects/arrays
+static const char *json_skip( const char *p, const char *end ) {
+    int depth = 0;
+    do {
+	p = json_ws( p, end );
+	if ( p >= end ) {
+	    return NULL;
+	}
+	if ( *p == '"' ) {
+	    const char *s; int len;
+	    p = json_string( p, end, &s, &len );
+	    if ( p == NULL ) {
+		return NULL;
+	    }
+	} else if ( *p == '{' || *p == '[' ) {
+	    depth++;
+	    p++;
+	} else if ( *p == '}' || *p == ']' ) {
+	    depth--;
+	    p++;
+	} else if ( *p == ',' || *p == ':' ) {
+	    p++;
+	} else {
+	    // number, true, false, null
+	    while ( p < end && *p != ',' && *p != '}' && *p != ']' ) {
+		p++;
+	    }
+	}
+    } while ( depth > 0 );
+    return p;
+}
+
+static const char *json_number( const char *p, const char *end,
+				double *val )
+{
+    char *stop;
+    *val = strtod( p, &stop );	// the line is terminated in place
+    if ( stop == p || stop > end ) {
+	return NULL;
+    }
+    return stop;
+}
+
+static bool json_key_is( const char *s, int len, const char *key ) {
+    return (int)strlen(key) == len && strncmp(s, key, len) == 0;
+}
+
+
+// iterate the members of an object: call with p at '{' (first) or
+// after the previous value; returns the position of the value and
+// sets *key/*klen, or NULL at the end of the object
+static const char *json_member( const char *p, const char *end,
+				const char **key, int *klen )
+{
+    p = json_ws( p, end );
+    if ( p < end && (*p == '{' || *p == ',') ) {
+	p = json_ws( p + 1, end );
+    }
+    if ( p >= end || *p != '"' ) {
+	return NULL;
+    }
+    p = json_string( p, end, key, klen );
+    if ( p == NULL ) {
+	return NULL;
+    }
+    p = json_ws( p, end );
+    if ( p >= end || *p != ':' ) {
+	return NULL;
+    }
+    return json_ws( p + 1, end );
+}
+
+
+// "2018-05-21T18:40:12.000Z" to unix seconds
+static double iso8601_to_unix( const char *s, int len ) {
+    struct tm t;
+    memset( &t, 0, sizeof(t) );
+    char buf[40];
+    if ( len >= (int)sizeof(buf) ) {
+	return 0.0;
+    }
+    memcpy( buf, s, len );
+    buf[len] = 0;
+    double sec = 0.0;
+    if ( sscanf( buf, "%d-%d-%dT%d:%d:%lf", &t.tm_year, &t.tm_mon,
+		 &t.tm_mday, &t.tm_hour, &t.tm_min, &sec ) != 6 ) {
+	return 0.0;
+    }
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+    t.tm_sec = (int)sec;
+    return (double)timegm( &t ) + (sec - t.tm_sec);
+}
+
+
+// count the "used":true satellites of a SKY satellites array
+static const char *count_used( const char *p, const char *end, int *used ) {
+    *used = 0;
+    p = json_ws( p, end );
+    if ( p >= end || *p != '[' ) {
+	return json_skip( p, end );
+    }
+    p = json_ws( p + 1, end );
+    while ( p < end && *p == '{' ) {
+	const char *key; int klen;
+	const char *v;
+	while ( (v = json_member( p, end, &key, &klen )) != NULL ) {
+	    if ( json_key_is( key, klen, "used" ) && strncmp(v, "true", 4) == 0 ) {
+		(*used)++;
+	    }
+	    p = json_skip( v, end );
+	    if ( p == NULL ) {
+		return NULL;
+	    }
+	}
+	p = json_ws( p, end );
+	if ( p < end && *p == '{' ) {
+	    // empty object
+	    p = json_ws( p + 1, end );
+	}
+	if ( p >= end || *p != '}' ) {
+	    return NULL;
+	}
+	p = json_ws( p + 1, end );
+	if ( p < end && *p == ',' ) {
+	    p = json_ws( p + 1, end );
+	}
+    }
+    if ( p >= end || *p != ']' ) {
+	return NULL;
+    }
+    return p + 1;
+}
+
+
+// parse one json report (line is 0 terminated at end)
+static bool parse_gpsd_report( const char *line, const char *end ) {
     static double last_gps_sec = 0.0;
-    bool new_position = false;
 
-    // printf("%s", sentence);
-
-    vector <string> token = split( sentence, " " );
-    if ( token.size() < 1 ) {
-        // no valid tokens
-        return false;
-    }
-
-    int pos = token[0].find(",");
-    string tmp1 = "";
-    string gpsd_cmd = "";
-    string gpsd_arg = "";
-    if ( pos >= 0 ) {
- 	tmp1 = token[0].substr(pos + 1);
-        pos = tmp1.find("=");
-	if ( pos >= 0 ) {
-            gpsd_cmd = tmp1.substr(0, pos);
-	    gpsd_arg = tmp1.substr(pos + 1);
-            // printf("cmd = %s  arg = %s\n", gpsd_cmd.c_str(), gpsd_arg.c_str() ); 
-        }
-    }
-
-    if ( gpsd_cmd == "F" ) {
-	gps_node.setString( "device_name", gpsd_arg.c_str() );
-    } else if ( gpsd_cmd == "N" ) {
-	if ( gpsd_arg == "0" ) {
-	    gps_node.setString( "nmea_mode", "nmea ascii" );
-        } else {
-	    gps_node.setString( "nmea_mode", "binary" );
-        }
-    } else if ( gpsd_cmd == "O" && 
-                (gpsd_arg == "GGA" || gpsd_arg == "GLL" ||
-		 gpsd_arg == "GND" || gpsd_arg == "GSA" ||
-		 gpsd_arg == "MID2" || gpsd_arg == "MID4" ||
-		 gpsd_arg == "RMC" || gpsd_arg == "0x0106") ) {
-	// Output of GPSD "O" (ohhh) command
-	//
-	// example: GPSD,O=RMC 1232073262.000 0.005 45.138145
-	// -93.157083 285.50 3.60 1.80 181.4300 0.046 0.000 ? 7.20 ? 3
-	gps_node.setDouble( "unix_time_sec", atof(token[1].c_str()) );
-	gps_node.setDouble( "latitude_deg", atof(token[3].c_str()) );
-	gps_node.setDouble( "longitude_deg", atof(token[4].c_str()) );
-	if ( token[5] != "?" ) {
-	    gps_node.setDouble( "altitude_m", atof(token[5].c_str()) );
-        }
-	if ( token[8] != "?" && token[9] != "?" ) {
-	    double course_deg = atof( token[8].c_str() );
-	    double speed_mps = atof( token[9].c_str() );
-	    double angle_rad = (90.0 - course_deg) * SGD_DEGREES_TO_RADIANS;
-	    gps_node.setDouble( "vn_ms", sin(angle_rad) * speed_mps );
-	    gps_node.setDouble( "ve_ms", cos(angle_rad) * speed_mps );
-	    /* printf("mps=%.1f deg=%.1f rad=%.3f vn=%.1f ve=%.1f\n",
-		   speed_mps, course_deg, angle_rad,
-		   gps_vn_node->getDouble(),
-		   gps_ve_node->getDouble()); */
+    enum { CLASS_OTHER, CLASS_TPV, CLASS_SKY, CLASS_DEVICE } cls = CLASS_OTHER;
+    int mode = -1;
+    double unix_sec = 0.0;
+    double lat = NAN, lon = NAN, alt = NAN, alt_msl = NAN;
+    double vn = NAN, ve = NAN, vd = NAN;
+    double track = NAN, speed = NAN, climb = NAN;
+    double eph = NAN, epx = NAN, epy = NAN, epv = NAN;
+    double pdop = NAN;
+    int sats = -1;
+    const char *path = NULL; int path_len = 0;
+
+    const char *p = json_ws( line, end );
+    if ( p >= end || *p != '{' ) {
+	return false;
+    }
+    const char *key; int klen;
+    const char *v;
+    while ( (v = json_member( p, end, &key, &klen )) != NULL ) {
+	const char *s; int slen;
+	double *num = NULL;
+	p = NULL;
+	if ( json_key_is(key, klen, "class") ) {
+	    p = json_string( v, end, &s, &slen );
+	    if ( p && json_key_is(s, slen, "TPV") ) {
+		cls = CLASS_TPV;
+	    } else if ( p && json_key_is(s, slen, "SKY") ) {
+		cls = CLASS_SKY;
+	    } else if ( p && json_key_is(s, slen, "DEVICE") ) {
+		cls = CLASS_DEVICE;
+	    }
+	} else if ( json_key_is(key, klen, "time") ) {
+	    if ( *v == '"' ) {
+		p = json_string( v, end, &s, &slen );
+		if ( p ) {
+		    unix_sec = iso8601_to_unix( s, slen );
+		}
+	    } else {
+		num = &unix_sec;  // very old gpsd sends a number
+	    }
+	} else if ( json_key_is(key, klen, "mode") ) {
+	    double m;
+	    p = json_number( v, end, &m );
+	    mode = (int)m;
+	} else if ( json_key_is(key, klen, "satellites") ) {
+	    p = count_used( v, end, &sats );
+	} else if ( json_key_is(key, klen, "path") ) {
+	    p = json_string( v, end, &path, &path_len );
+	} else if ( json_key_is(key, klen, "lat") ) { num = &lat;
+	} else if ( json_key_is(key, klen, "lon") ) { num = &lon;
+	} else if ( json_key_is(key, klen, "alt") ) { num = &alt;
+	} else if ( json_key_is(key, klen, "altMSL") ) { num = &alt_msl;
+	} else if ( json_key_is(key, klen, "velN") ) { num = &vn;
+	} else if ( json_key_is(key, klen, "velE") ) { num = &ve;
+	} else if ( json_key_is(key, klen, "velD") ) { num = &vd;
+	} else if ( json_key_is(key, klen, "track") ) { num = &track;
+	} else if ( json_key_is(key, klen, "speed") ) { num = &speed;
+	} else if ( json_key_is(key, klen, "climb") ) { num = &climb;
+	} else if ( json_key_is(key, klen, "eph") ) { num = &eph;
+	} else if ( json_key_is(key, klen, "epx") ) { num = &epx;
+	} else if ( json_key_is(key, klen, "epy") ) { num = &epy;
+	} else if ( json_key_is(key, klen, "epv") ) { num = &epv;
+	} else if ( json_key_is(key, klen, "pdop") ) { num = &pdop;
+	} else {
+	    p = json_skip( v, end );
 	}
-	// if ( gps_data.date > last_unix_time && last_unix_time > 0.0 ) {
-	//   gps_data.vd = (gps_data.alt - last_alt_m) * (gps_data.date - last_unix_time);
-	//   last_alt_m = gps_data.alt;
-	//    last_unix_time = gps_data.date;
-	// }
-	if ( token[10] != "?" ) {
-	    gps_node.setDouble( "vd_ms", -atof(token[10].c_str()) );
+	if ( num ) {
+	    p = json_number( v, end, num );
 	}
-	if ( gps_node.getDouble("unix_time_sec") > last_gps_sec ) {
-	    last_gps_sec = gps_node.getDouble("unix_time_sec");
-	    gps_node.setDouble( "timestamp", get_Time() );
-	    new_position = true;
+	if ( p == NULL ) {
+	    parse_errors++;
+	    return false;
 	}
-    } else if ( gpsd_cmd == "Y" && 
-		(gpsd_arg == "GSV" || gpsd_arg == "0x0130") ) {
-	// Output of GPSD "Y" command 
-	// 
-	// GPSD,Y=GSV 1232073259.000 11:14 76 358 0 0:22 55 126 41
-	// 1:31 41 198 35 1:5 27 82 36 1:30 24 111 32 1:12 22 69 25
-	// 1:11 21 302 26 1:18 20 125 38 1:32 17 304 28 1:9 8 41 14
-	// 1:51 36 199 37 0:
-	//
-	// gps_satellites.setString( sentence );
-#if 0 // depricated ... could have original been a bug in gpsd for this gps?
-    } else if ( gpsd_cmd == "O" &&
-                (gpsd_arg == "MID2" || gpsd_arg == "MID4") ) {
-	// still in "unreliable" binary mode, resend init sequence
-	gpsd_send_init();
-#endif
-    } else if ( gpsd_cmd == "W" ) {
-	// reports if "watcher" mode is set (1) or unset (0).  In watcher mode
-	// gpsd streams gps messages to the connected clients as they come in
-	// rather than waiting for the client to poll.  This is the default
-	// mode of operation.
-    } else if ( gpsd_cmd == "X" ) {
-	// according to the docs, gpsd_arg will be 0 when the gps is offline
-	// or "n" with the timestamp of the most recent message
-    } else {
-	if ( display_on ) {
-	    printf("Unknown GPSD sentence: %s", sentence);
+    }
+
+    if ( cls == CLASS_SKY ) {
+	if ( sats >= 0 ) {
+	    gps_node.setLong( "satellites", sats );
 	}
+	if ( !isnan(pdop) ) {
+	    gps_node.setDouble( "pdop", pdop );
+	}
+	return false;
+    } else if ( cls == CLASS_DEVICE ) {
+	if ( path != NULL ) {
+	    gps_node.setString( "device_name", string(path, path_len) );
+	}
+	return false;
+    } else if ( cls != CLASS_TPV || mode < 0 ) {
+	return false;
+    }
+
+    // TPV, mode: 0/1 = no fix, 2 = 2d, 3 = 3d
+    gps_node.setLong( "fixType", mode );
+    if ( mode <= 1 ) {
+	gps_node.setLong( "status", 0 );
+	return false;
+    }
+    gps_node.setLong( "status", mode == 3 ? 2 : 1 );
+    if ( isnan(lat) || isnan(lon) ) {
+	return false;
+    }
+    gps_node.setDouble( "unix_time_sec", unix_sec );
+    gps_node.setDouble( "latitude_deg", lat );
+    gps_node.setDouble( "longitude_deg", lon );
+    if ( !isnan(alt_msl) ) {
+	gps_node.setDouble( "altitude_m", alt_msl );
+    } else if ( !isnan(alt) ) {
+	gps_node.setDouble( "altitude_m", alt );
     }
+    if ( isnan(vn) && !isnan(track) && !isnan(speed) ) {
+	// older gpsd only reports track/speed/climb
+	double angle_rad = (90.0 - track) * SGD_DEGREES_TO_RADIANS;
+	vn = sin(angle_rad) * speed;
+	ve = cos(angle_rad) * speed;
+    }
+    if ( isnan(vd) && !isnan(climb) ) {
+	vd = -climb;
+    }
+    if ( !isnan(vn) && !isnan(ve) ) {
+	gps_node.setDouble( "vn_ms", vn );
+	gps_node.setDouble( "ve_ms", ve );
+    }
+    if ( !isnan(vd) ) {
+	gps_node.setDouble( "vd_ms", vd );
+    }
+    if ( !isnan(speed) ) {
+	gps_node.setDouble( "groundspeed_ms", speed );
+    }
+    if ( !isnan(track) ) {
+	gps_node.setDouble( "groundtrack_deg", track );
+    }
+    if ( isnan(eph) && !isnan(epx) && !isnan(epy) ) {
+	eph = sqrt(epx*epx + epy*epy);
+    }
+    if ( !isnan(eph) ) {
+	gps_node.setDouble( "horiz_accuracy_m", eph );
+    }
+    if ( !isnan(epv) ) {
+	gps_node.setDouble( "vert_accuracy_m", epv );
+    }
+
+    if ( unix_sec > last_gps_sec ) {
+	last_gps_sec = unix_sec;
+	gps_node.setDouble( "timestamp", get_Time() );
+	return true;
+    }
+    return false;
+}
+
 
+// parse the complete lines in the receive buffer and keep the partial
+// one (if any) for next time
+static bool gpsd_parse_buffer() {
+    bool new_position = false;
+    char *p = rx_buf;
+    char *end = rx_buf + rx_len;
+    char *nl;
+    while ( (nl = (char *)memchr( p, '\n', end - p )) != NULL ) {
+	*nl = 0;
+	if ( parse_gpsd_report( p, nl ) ) {
+	    new_position = true;
+	}
+	p = nl + 1;
+    }
+    rx_len = end - p;
+    if ( rx_len >= (int)sizeof(rx_buf) - 1 ) {
+	// a line longer than the whole buffer, drop it
+	parse_errors++;
+	rx_len = 0;
+    } else if ( p != rx_buf && rx_len > 0 ) {
+	memmove( rx_buf, p, rx_len );
+    }
+    gps_node.setLong( "gpsd_parse_errors", parse_errors );
     return new_position;
 }
 
 
-bool gpsd_get_gps() {
+// drain and parse everything waiting on the socket
+static bool gpsd_read() {
     bool gps_data_valid = false;
 
-    if ( !socket_connected ) {
-	gpsd_connect();
-    }
- 
-    char gpsd_sentence[256];
     int result;
-    while ( (result = gpsd_sock.recv( gpsd_sentence, 256 )) > 0 ) {
-	gpsd_sentence[result] = 0;
-	if ( parse_gpsd_sentence( gpsd_sentence ) ) {
+    while ( (result = gpsd_sock.recv( rx_buf + rx_len,
+				      sizeof(rx_buf) - 1 - rx_len )) > 0 ) {
+	rx_len += result;
+	if ( gpsd_parse_buffer() ) {
 	    gps_data_valid = true;
 	}
     }
-    if ( errno != EAGAIN ) {
+    if ( result == 0 || errno != EAGAIN ) {
 	if ( display_on ) {
 	    perror("gpsd recv");
 	}
-	socket_connected = false;
+	gpsd_disconnect();
+    }
+
+    return gps_data_valid;
+}
+
+
+// reactor callback
+static void gpsd_ready( int fd, void *arg ) {
+    if ( gpsd_read() ) {
+	fresh_gps = true;
+    }
+}
+
+
+bool gpsd_get_gps() {
+    bool gps_data_valid = false;
+
+    if ( !socket_connected ) {
+	gpsd_connect();
+    }
+
+    if ( use_reactor ) {
+	// already read and parsed as it arrived
+	gps_data_valid = fresh_gps;
+	fresh_gps = false;
+    } else if ( socket_connected ) {
+	gps_data_valid = gpsd_read();
     }
 
     // If more than 5 seconds has elapsed without seeing new data and
@@ -258,4 +561,5 @@ bool gpsd_get_gps() {
 
 
 void gpsd_close() {
+    gpsd_disconnect();
 }
@@ -43,6 +43,9 @@ static int fd = -1;
 static string device_name = "/dev/ttyS0";
 static int baud = 115200;
 static int gps_fix_value = 0;
+static bool use_reactor = false;
+static bool fresh_gps = false;  // set by the reactor callback
+static int ring_slot = -1;	// io_uring slot when sensor_ring is active
 
 // initialize gpsd input property nodes
 static void bind_input( pyPropertyNode *config ) {
@@ -121,10 +124,28 @@ static bool gps_ublox8_open() {
 }
 
 
+static bool read_ublox8();
+
+// reactor callback, run the scanner/parser over whatever has arrived
+static void gps_ublox8_ready( int fd, void *arg ) {
+    if ( read_ublox8() ) {
+	fresh_gps = true;
+    }
+}
+
+
 void gps_ublox8_init( string output_node, pyPropertyNode *config ) {
     bind_input( config );
     bind_output( output_node );
-    gps_ublox8_open();
+    if ( gps_ublox8_open() ) {
+	if ( sensor_ring != NULL ) {
+	    // the ring does the waiting, the update just drains it
+	    ring_slot = sensor_ring->add( fd, false, "ublox8" );
+	}
+	if ( ring_slot < 0 ) {
+	    use_reactor = reactor->add( fd, gps_ublox8_ready, NULL, "ublox8" );
+	}
+    }
 }
 
 
@@ -293,6 +314,14 @@ static bool parse_ublox8_msg( uint8_t msg_class, uint8_t msg_id,
     return new_position;
 }
 
+// read from the io_uring slot or straight from the (non-blocking) uart
+static int ublox8_read_bytes( uint8_t *buf, int len ) {
+    if ( ring_slot >= 0 ) {
+        return sensor_ring->read( ring_slot, buf, len );
+    }
+    return read( fd, buf, len );
+}
+
 static bool read_ublox8() {
     static int state = 0;
     static int msg_class = 0, msg_id = 0;
@@ -310,10 +339,10 @@ static bool read_ublox8() {
     if ( state == 0 ) {
 	counter = 0;
 	cksum_A = cksum_B = 0;
-	len = read( fd, input, 1 );
+	len = ublox8_read_bytes( input, 1 );
 	while ( len > 0 && input[0] != 0xB5 ) {
 	    // fprintf( stderr, "state0: len = %d val = %2X\n", len, input[0] );
-	    len = read( fd, input, 1 );
+	    len = ublox8_read_bytes( input, 1 );
 	}
 	if ( len > 0 && input[0] == 0xB5 ) {
 	    // fprintf( stderr, "read 0xB5\n");
@@ -321,7 +350,7 @@ static bool read_ublox8() {
 	}
     }
     if ( state == 1 ) {
-	len = read( fd, input, 1 );
+	len = ublox8_read_bytes( input, 1 );
 	if ( len > 0 ) {
 	    if ( input[0] == 0x62 ) {
 		// fprintf( stderr, "read 0x62\n");
@@ -334,7 +363,7 @@ static bool read_ublox8() {
 	}
     }
     if ( state == 2 ) {
-	len = read( fd, input, 1 );
+	len = ublox8_read_bytes( input, 1 );
 	if ( len > 0 ) {
 	    msg_class = input[0];
 	    cksum_A += input[0];
@@ -344,7 +373,7 @@ static bool read_ublox8() {
 	}
     }
     if ( state == 3 ) {
-	len = read( fd, input, 1 );
+	len = ublox8_read_bytes( input, 1 );
 	if ( len > 0 ) {
 	    msg_id = input[0];
 	    cksum_A += input[0];
@@ -354,7 +383,7 @@ static bool read_ublox8() {
 	}
     }
     if ( state == 4 ) {
-	len = read( fd, input, 1 );
+	len = ublox8_read_bytes( input, 1 );
 	if ( len > 0 ) {
 	    length_lo = input[0];
 	    cksum_A += input[0];
@@ -363,7 +392,7 @@ static bool read_ublox8() {
 	}
     }
     if ( state == 5 ) {
-	len = read( fd, input, 1 );
+	len = ublox8_read_bytes( input, 1 );
 	if ( len > 0 ) {
 	    length_hi = input[0];
 	    cksum_A += input[0];
@@ -378,7 +407,7 @@ static bool read_ublox8() {
 	}
     }
     if ( state == 6 ) {
-	len = read( fd, input, 1 );
+	len = ublox8_read_bytes( input, 1 );
 	while ( len > 0 ) {
 	    payload[counter++] = input[0];
 	    //fprintf( stderr, "%02X ", input[0] );
@@ -387,7 +416,7 @@ static bool read_ublox8() {
 	    if ( counter >= payload_length ) {
 		break;
 	    }
-	    len = read( fd, input, 1 );
+	    len = ublox8_read_bytes( input, 1 );
 	}
 
 	if ( counter >= payload_length ) {
@@ -396,14 +425,14 @@ static bool read_ublox8() {
 	}
     }
     if ( state == 7 ) {
-	len = read( fd, input, 1 );
+	len = ublox8_read_bytes( input, 1 );
 	if ( len > 0 ) {
 	    cksum_lo = input[0];
 	    state++;
 	}
     }
     if ( state == 8 ) {
-	len = read( fd, input, 1 );
+	len = ublox8_read_bytes( input, 1 );
 	if ( len > 0 ) {
 	    cksum_hi = input[0];
 	    if ( cksum_A == cksum_lo && cksum_B == cksum_hi ) {
@@ -428,6 +457,13 @@ static bool read_ublox8() {
 
 
 bool gps_ublox8_update() {
+    if ( use_reactor ) {
+	// already read and parsed as it arrived
+	bool result = fresh_gps;
+	fresh_gps = false;
+	return result;
+    }
+
     // run an iteration of the ublox scanner/parser
     bool gps_data_valid = read_ublox8();
 
@@ -436,4 +472,8 @@ bool gps_ublox8_update() {
 
 
 void gps_ublox8_close() {
+    if ( use_reactor ) {
+	reactor->remove(fd);
+	use_reactor = false;
+    }
 }
@@ -0,0 +1,103 @@
+//
+// imu_batch.cxx - hand every imu sample between frames to the filter
+//
+// This code is released into the public domain.
+//
+
+#include <stdio.h>
+
+#include "health/vibration.hxx"
+
+#include "imu_batch.hxx"
+
+static const unsigned int max_samples = 256;
+
+static bool enabled = false;
+static string primary;
+static double frame_dt = 0.0;
+static vector<IMUSample> batch;
+static double last_time = 0.0;
+
+static pyPropertyNode batch_node;
+static uint32_t dropped = 0;
+
+
+void imu_batch_init( pyPropertyNode *config, string primary_source ) {
+    if ( config->hasChild("enable") ) {
+        enabled = config->getBool("enable");
+    }
+    if ( config->hasChild("frame_hz") ) {
+        double hz = config->getDouble("frame_hz");
+        if ( hz > 0.0 ) {
+            frame_dt = 1.0 / hz;
+        }
+    }
+    primary = primary_source;
+    batch.reserve( max_samples );
+    batch_node = pyGetNode("/sensors/imu_batch", true);
+    if ( enabled ) {
+        printf("imu batch: collecting %s samples, frame = %.3f sec\n",
+               primary.c_str(), frame_dt);
+    }
+}
+
+
+bool imu_batch_enabled() {
+    return enabled;
+}
+
+
+void imu_batch_push( const char *source, double time,
+                     float p, float q, float r,
+                     float ax, float ay, float az )
+{
+    if ( primary != source || time <= last_time ) {
+        return;
+    }
+    last_time = time;
+
+    // the vibration analyzer wants every raw sample too, anything
+    // above the frame rate would alias into its bands otherwise
+    vibration_push( time, ax, ay, az, p, q, r );
+
+    if ( !enabled ) {
+        return;
+    }
+    if ( batch.size() >= max_samples ) {
+        // the filter hasn't been taking them, keep the newest
+        batch.erase( batch.begin() );
+        dropped++;
+    }
+    IMUSample s;
+    s.time = time;
+    s.p = p; s.q = q; s.r = r;
+    s.ax = ax; s.ay = ay; s.az = az;
+    batch.push_back( s );
+}
+
+
+bool imu_batch_ready() {
+    if ( !enabled || frame_dt <= 0.0 || batch.size() < 2 ) {
+        return true;
+    }
+    // the filter also integrates the interval leading up to the first
+    // sample (from the previous batch), plus half a sample of slop so
+    // timestamp jitter doesn't stretch a frame by one sample
+    double span = batch.back().time - batch.front().time;
+    double sample_dt = span / (batch.size() - 1);
+    return span + 1.5 * sample_dt >= frame_dt;
+}
+
+
+int imu_batch_take( vector<IMUSample> *samples ) {
+    samples->swap( batch );
+    batch.clear();
+    batch_node.setLong( "samples", samples->size() );
+    batch_node.setLong( "dropped", dropped );
+    return samples->size();
+}
+
+
+void imu_batch_clear() {
+    batch.clear();
+}
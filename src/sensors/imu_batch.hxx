@@ -0,0 +1,49 @@
+//
+// imu_batch.hxx - hand every imu sample between frames to the filter
+//
+// The main loop runs one filter update per frame, but a fast imu (or
+// a sync driver catching up on a backlog) parses several samples per
+// frame and /sensors/imu only holds the newest.  The primary imu
+// driver also pushes each calibrated sample here; the filter takes
+// the whole batch once per frame and integrates it (see
+// filters/nav_common/imu_preint.hxx.)  Every sample is also passed on
+// to the vibration analyzer (health/vibration.hxx), batching or not.
+//
+// Configured by /config/sensors/imu_batch: enable, and frame_hz (the
+// sync driver keeps reading until the batch spans one frame, 0 =
+// one frame per sample as before.)
+//
+
+#pragma once
+
+#include <pyprops.hxx>
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+struct IMUSample {
+    double time;
+    float p, q, r;              // rad/sec
+    float ax, ay, az;           // m/sec^2
+};
+
+// primary_source is the imu_group source name of imu[0] ("Aura3",
+// "APM2", ...), only that driver's samples are collected
+void imu_batch_init( pyPropertyNode *config, string primary_source );
+bool imu_batch_enabled();
+
+void imu_batch_push( const char *source, double time,
+                     float p, float q, float r,
+                     float ax, float ay, float az );
+
+// true once the batch covers a frame (always true when not batching)
+bool imu_batch_ready();
+
+// move the collected samples out, returns how many
+int imu_batch_take( vector<IMUSample> *samples );
+
+// end of frame (filter manager): discard anything the active filter
+// didn't take, only nav-ekf15 integrates the batch
+void imu_batch_clear();
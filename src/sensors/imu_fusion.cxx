@@ -0,0 +1,466 @@
+//
+// imu_fusion.cxx - combine several imus into one virtual imu
+//
+// This code is released into the public domain.
+//
+
+#include <pyprops.hxx>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sstream>
+#include <string>
+using std::ostringstream;
+using std::string;
+
+#include "comms/events.hxx"
+#include "init/globals.hxx"
+
+#include "imu_fusion.hxx"
+
+
+static const int NUM_CH = 9;
+static const char *channel_names[NUM_CH] = {
+    "p_rad_sec", "q_rad_sec", "r_rad_sec",
+    "ax_mps_sec", "ay_mps_sec", "az_mps_sec",
+    "hx", "hy", "hz"
+};
+
+// channel groups: gyro, accel, mag (three axes each)
+enum { GYRO = 0, ACCEL = 1, MAG = 2, NUM_GROUPS = 3 };
+static const char *weight_names[NUM_GROUPS] = {
+    "gyro_weight", "accel_weight", "mag_weight"
+};
+static const char *resid_names[NUM_GROUPS] = {
+    "gyro_resid", "accel_resid", "mag_resid"
+};
+static const char *noise_names[NUM_GROUPS] = {
+    "gyro_noise", "accel_noise", "mag_noise"
+};
+
+static const int MAX_IMUS = 8;
+
+struct fusion_input {
+    pyPropertyNode node;
+    pyPropertyNode stats_node;
+
+    // the three most recent samples, [2] is the newest
+    int samples;
+    double t[3];
+    double x[3][NUM_CH];
+    double temp_C;
+
+    double noise[NUM_GROUPS];   // sample noise variance estimate
+    double resid[NUM_GROUPS];   // smoothed residual from the vote
+    double aligned[NUM_CH];     // sample at the reference time
+
+    bool fresh;
+    bool available;             // recent enough to use this frame
+    bool healthy;               // passing the vote
+    int bad_count;
+    int good_count;
+    int stuck_count;
+    uint32_t faults;
+    string name;
+};
+
+static vector<fusion_input> imus;
+static pyPropertyNode fused_node;
+
+// tuning (overridable from the config section)
+static double max_age = 0.05;           // sec behind the newest imu
+static double noise_tc = 2.0;           // sec, noise/residual smoothing
+static double threshold[NUM_GROUPS] = { 0.1, 2.0, 0.0 }; // rad/s, m/s^2
+static int fault_frames = 5;            // consecutive misses to fault
+static int recover_frames = 50;         // consecutive passes to recover
+static int stuck_frames = 20;           // identical samples to fault
+
+
+void imu_fusion_init( pyPropertyNode *config, vector<int> inputs ) {
+    if ( config->hasChild("max_age_sec") ) {
+        max_age = config->getDouble("max_age_sec");
+    }
+    if ( config->hasChild("noise_time_const") ) {
+        noise_tc = config->getDouble("noise_time_const");
+    }
+    if ( config->hasChild("gyro_threshold") ) {
+        threshold[GYRO] = config->getDouble("gyro_threshold");
+    }
+    if ( config->hasChild("accel_threshold") ) {
+        threshold[ACCEL] = config->getDouble("accel_threshold");
+    }
+    if ( config->hasChild("fault_frames") ) {
+        fault_frames = config->getLong("fault_frames");
+    }
+    if ( config->hasChild("recover_frames") ) {
+        recover_frames = config->getLong("recover_frames");
+    }
+
+    fused_node = pyGetNode("/sensors/imu[0]", true);
+
+    if ( inputs.size() > MAX_IMUS ) {
+        printf("imu fusion: only using the first %d imus\n", MAX_IMUS);
+        inputs.resize( MAX_IMUS );
+    }
+
+    imus.clear();
+    for ( unsigned int i = 0; i < inputs.size(); i++ ) {
+        fusion_input imu;
+        memset( imu.t, 0, sizeof(imu.t) );
+        memset( imu.x, 0, sizeof(imu.x) );
+        memset( imu.aligned, 0, sizeof(imu.aligned) );
+        for ( int g = 0; g < NUM_GROUPS; g++ ) {
+            imu.noise[g] = 0.0;
+            imu.resid[g] = 0.0;
+        }
+        imu.samples = 0;
+        imu.temp_C = 0.0;
+        imu.fresh = false;
+        imu.available = false;
+        imu.healthy = true;
+        imu.bad_count = 0;
+        imu.good_count = 0;
+        imu.stuck_count = 0;
+        imu.faults = 0;
+
+        ostringstream path;
+        path << "/sensors/imu[" << inputs[i] << "]";
+        imu.name = path.str();
+        imu.node = pyGetNode(path.str(), true);
+        ostringstream stats_path;
+        stats_path << "/sensors/imu_fusion/imu[" << i << "]";
+        imu.stats_node = pyGetNode(stats_path.str(), true);
+        imu.stats_node.setString("source", imu.name);
+        imus.push_back(imu);
+    }
+    printf("imu fusion: %d inputs\n", (int)imus.size());
+}
+
+
+// pull in a new sample if the imu has published one since last time
+static void read_input( fusion_input *imu ) {
+    imu->fresh = false;
+    double t = imu->node.getDouble("timestamp");
+    if ( imu->samples > 0 && t <= imu->t[2] ) {
+        return;
+    }
+    imu->t[0] = imu->t[1];
+    imu->t[1] = imu->t[2];
+    memcpy( imu->x[0], imu->x[1], sizeof(imu->x[0]) );
+    memcpy( imu->x[1], imu->x[2], sizeof(imu->x[1]) );
+    imu->t[2] = t;
+    for ( int c = 0; c < NUM_CH; c++ ) {
+        imu->x[2][c] = imu->node.getDouble(channel_names[c]);
+    }
+    imu->temp_C = imu->node.getDouble("temp_C");
+    if ( imu->samples < 3 ) {
+        imu->samples++;
+    }
+    imu->fresh = true;
+    if ( imu->samples < 3 ) {
+        return;
+    }
+
+    // noise: the second difference of the sample stream cancels
+    // the (locally linear) motion and leaves the sensor noise
+    // (var(d2) = 6 * var(noise))
+    double dt = imu->t[2] - imu->t[1];
+    double a = dt / noise_tc;
+    if ( a > 1.0 ) { a = 1.0; }
+    bool same = true;
+    for ( int g = 0; g < NUM_GROUPS; g++ ) {
+        double sum = 0.0;
+        for ( int c = g * 3; c < g * 3 + 3; c++ ) {
+            double d2 = imu->x[2][c] - 2.0 * imu->x[1][c] + imu->x[0][c];
+            sum += d2 * d2;
+            if ( g != MAG && imu->x[2][c] != imu->x[1][c] ) {
+                same = false;
+            }
+        }
+        double var = sum / 18.0;
+        imu->noise[g] = (1.0 - a) * imu->noise[g] + a * var;
+    }
+
+    // a real sensor never repeats six channels exactly
+    if ( same ) {
+        imu->stuck_count++;
+    } else {
+        imu->stuck_count = 0;
+    }
+}
+
+
+// estimate each imu at the reference time (interpolate or extrapolate
+// by at most one sample interval)
+static void align_input( fusion_input *imu, double t_ref ) {
+    double frac = 0.0;
+    if ( imu->samples >= 2 && imu->t[2] > imu->t[1] ) {
+        frac = (t_ref - imu->t[2]) / (imu->t[2] - imu->t[1]);
+        if ( frac < -1.0 ) { frac = -1.0; }
+        if ( frac > 1.0 ) { frac = 1.0; }
+    }
+    for ( int c = 0; c < NUM_CH; c++ ) {
+        imu->aligned[c] = imu->x[2][c] + frac * (imu->x[2][c] - imu->x[1][c]);
+    }
+}
+
+
+// (n <= MAX_IMUS, an insertion sort is all it takes)
+static double median( double *v, int n ) {
+    for ( int i = 1; i < n; i++ ) {
+        double x = v[i];
+        int j = i - 1;
+        while ( j >= 0 && v[j] > x ) {
+            v[j + 1] = v[j];
+            j--;
+        }
+        v[j + 1] = x;
+    }
+    if ( n % 2 ) {
+        return v[n/2];
+    }
+    return 0.5 * (v[n/2 - 1] + v[n/2]);
+}
+
+
+// residual of each available imu from the per axis median, count
+// persistent outliers as faults
+static void vote( int group, double a ) {
+    int n = 0;
+    double vals[MAX_IMUS];
+    double mid[3];
+    for ( int axis = 0; axis < 3; axis++ ) {
+        n = 0;
+        for ( unsigned int i = 0; i < imus.size(); i++ ) {
+            if ( imus[i].available ) {
+                vals[n++] = imus[i].aligned[group * 3 + axis];
+            }
+        }
+        if ( n == 0 ) {
+            return;
+        }
+        mid[axis] = median( vals, n );
+    }
+
+    double resid[MAX_IMUS];
+    int over = 0;
+    for ( unsigned int i = 0; i < imus.size(); i++ ) {
+        resid[i] = 0.0;
+        if ( !imus[i].available ) {
+            continue;
+        }
+        double sum = 0.0;
+        for ( int axis = 0; axis < 3; axis++ ) {
+            double d = imus[i].aligned[group * 3 + axis] - mid[axis];
+            sum += d * d;
+        }
+        resid[i] = sqrt(sum);
+        imus[i].resid[group] = (1.0 - a) * imus[i].resid[group]
+            + a * resid[i];
+        if ( threshold[group] > 0.0 && resid[i] > threshold[group] ) {
+            over++;
+        }
+    }
+
+    if ( threshold[group] <= 0.0 || n < 2 ) {
+        return;
+    }
+
+    // with two imus the median can't say which one is wrong, blame
+    // the noisier one
+    int blame = -1;
+    if ( n == 2 && over == 2 ) {
+        for ( unsigned int i = 0; i < imus.size(); i++ ) {
+            if ( imus[i].available
+                 && ( blame < 0
+                      || imus[i].noise[group] > imus[blame].noise[group] ) )
+            {
+                blame = i;
+            }
+        }
+    }
+
+    for ( unsigned int i = 0; i < imus.size(); i++ ) {
+        if ( !imus[i].available ) {
+            continue;
+        }
+        bool bad = resid[i] > threshold[group];
+        if ( blame >= 0 ) {
+            bad = ( (int)i == blame );
+        }
+        if ( bad ) {
+            imus[i].bad_count++;
+            imus[i].good_count = 0;
+        }
+    }
+}
+
+
+static void set_health( fusion_input *imu, bool healthy, const char *why ) {
+    if ( imu->healthy == healthy ) {
+        return;
+    }
+    imu->healthy = healthy;
+    char buf[128];
+    if ( healthy ) {
+        snprintf( buf, sizeof(buf), "%s recovered", imu->name.c_str() );
+    } else {
+        imu->faults++;
+        snprintf( buf, sizeof(buf), "%s failed (%s)", imu->name.c_str(), why );
+    }
+    events->log("imu_fusion", buf);
+}
+
+
+bool imu_fusion_update() {
+    if ( imus.empty() ) {
+        return false;
+    }
+
+    // newest sample time across all imus
+    double newest = 0.0;
+    for ( unsigned int i = 0; i < imus.size(); i++ ) {
+        read_input( &imus[i] );
+        if ( imus[i].samples > 0 && imus[i].t[2] > newest ) {
+            newest = imus[i].t[2];
+        }
+    }
+
+    for ( unsigned int i = 0; i < imus.size(); i++ ) {
+        fusion_input *imu = &imus[i];
+        bool stale = ( imu->samples == 0 || newest - imu->t[2] > max_age );
+        bool stuck = ( imu->stuck_count >= stuck_frames );
+        imu->available = !stale && !stuck;
+        if ( stale ) {
+            set_health( imu, false, "stale" );
+        } else if ( stuck ) {
+            set_health( imu, false, "stuck" );
+        }
+    }
+
+    // the primary sets the pace while it's usable, otherwise the
+    // newest healthy imu does
+    fusion_input *ref = NULL;
+    if ( imus[0].available && imus[0].healthy ) {
+        ref = &imus[0];
+    } else {
+        for ( unsigned int i = 0; i < imus.size(); i++ ) {
+            if ( imus[i].available && imus[i].healthy
+                 && ( ref == NULL || imus[i].t[2] > ref->t[2] ) )
+            {
+                ref = &imus[i];
+            }
+        }
+    }
+    if ( ref == NULL ) {
+        // nothing trustworthy, pass the primary through if it
+        // has anything at all
+        if ( imus[0].samples == 0 ) {
+            return false;
+        }
+        ref = &imus[0];
+    }
+    if ( !ref->fresh ) {
+        return false;
+    }
+    double t_ref = ref->t[2];
+
+    for ( unsigned int i = 0; i < imus.size(); i++ ) {
+        if ( imus[i].available ) {
+            align_input( &imus[i], t_ref );
+        }
+    }
+
+    // vote on gyros and accels (mag calibrations differ too much
+    // between units to compare raw values)
+    double dt = 0.0;
+    if ( ref->samples >= 2 ) {
+        dt = ref->t[2] - ref->t[1];
+    }
+    double a = dt / noise_tc;
+    if ( a > 1.0 ) { a = 1.0; }
+    int bad_before[MAX_IMUS];
+    for ( unsigned int i = 0; i < imus.size(); i++ ) {
+        bad_before[i] = imus[i].bad_count;
+    }
+    vote( GYRO, a );
+    vote( ACCEL, a );
+    vote( MAG, a );
+    for ( unsigned int i = 0; i < imus.size(); i++ ) {
+        fusion_input *imu = &imus[i];
+        if ( !imu->available ) {
+            continue;
+        }
+        if ( imu->bad_count == bad_before[i] ) {
+            // passed every vote this frame
+            imu->bad_count = 0;
+            imu->good_count++;
+        }
+        if ( imu->bad_count >= fault_frames ) {
+            set_health( imu, false, "disagrees" );
+        } else if ( imu->good_count >= recover_frames ) {
+            set_health( imu, true, "" );
+        }
+    }
+
+    // noise weighted average of the healthy imus
+    double fused[NUM_CH];
+    double temp_C = 0.0;
+    int count = 0;
+    for ( int g = 0; g < NUM_GROUPS; g++ ) {
+        double wsum = 0.0;
+        double sum[3] = { 0.0, 0.0, 0.0 };
+        for ( unsigned int i = 0; i < imus.size(); i++ ) {
+            fusion_input *imu = &imus[i];
+            double w = 0.0;
+            if ( imu->available && imu->healthy ) {
+                w = 1.0 / (imu->noise[g] + 1e-12);
+            }
+            imu->stats_node.setDouble( weight_names[g], w );
+            wsum += w;
+            for ( int axis = 0; axis < 3; axis++ ) {
+                sum[axis] += w * imu->aligned[g * 3 + axis];
+            }
+        }
+        for ( int axis = 0; axis < 3; axis++ ) {
+            if ( wsum > 0.0 ) {
+                fused[g * 3 + axis] = sum[axis] / wsum;
+            } else {
+                fused[g * 3 + axis] = ref->x[2][g * 3 + axis];
+            }
+        }
+    }
+    for ( unsigned int i = 0; i < imus.size(); i++ ) {
+        if ( imus[i].available && imus[i].healthy ) {
+            temp_C += imus[i].temp_C;
+            count++;
+        }
+    }
+    if ( count > 0 ) {
+        temp_C /= count;
+    } else {
+        temp_C = ref->temp_C;
+    }
+
+    fused_node.setDouble( "timestamp", t_ref );
+    for ( int c = 0; c < NUM_CH; c++ ) {
+        fused_node.setDouble( channel_names[c], fused[c] );
+    }
+    fused_node.setDouble( "temp_C", temp_C );
+    fused_node.setLong( "imu_count", count );
+
+    for ( unsigned int i = 0; i < imus.size(); i++ ) {
+        fusion_input *imu = &imus[i];
+        imu->stats_node.setBool( "healthy", imu->available && imu->healthy );
+        imu->stats_node.setLong( "faults", imu->faults );
+        imu->stats_node.setDouble( "age_ms", (newest - imu->t[2]) * 1000.0 );
+        for ( int g = 0; g < NUM_GROUPS; g++ ) {
+            imu->stats_node.setDouble( resid_names[g], imu->resid[g] );
+            imu->stats_node.setDouble( noise_names[g], sqrt(imu->noise[g]) );
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,28 @@
+//
+// imu_fusion.hxx - combine several imus into one virtual imu
+//
+// Each configured imu publishes to its own /sensors/imu[n].  Every
+// frame the fusion stage aligns the latest samples to a common time
+// (the primary imu's), votes out imus that disagree with the median
+// or have gone stale/stuck, and publishes the noise weighted average
+// of the healthy ones as /sensors/imu[0], which is what the filters
+// and everything else downstream read.  Per-imu residual and health
+// statistics go to /sensors/imu_fusion/imu[n].
+//
+// Cost is O(number of imus) per frame, only the newest sample from
+// each imu is used.
+//
+
+#pragma once
+
+#include <pyprops.hxx>
+
+#include <vector>
+using std::vector;
+
+// inputs are the /sensors/imu[] indices to fuse, the first one is the
+// primary (time reference and fallback)
+void imu_fusion_init( pyPropertyNode *config, vector<int> inputs );
+
+// returns true when a new fused sample was published
+bool imu_fusion_update();
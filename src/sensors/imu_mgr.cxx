@@ -29,6 +29,8 @@ using std::vector;
 #include "sensors/Aura3/Aura3.hxx"
 #include "sensors/FGFS.hxx"
 #include "sensors/Goldy2.hxx"
+#include "sensors/imu_fusion.hxx"
+#include "sensors/imu_batch.hxx"
 #include "sensors/imu_vn100_spi.hxx"
 #include "sensors/imu_vn100_uart.hxx"
 #include "sensors/ugfile.hxx"
@@ -44,6 +46,7 @@ static double imu_last_time = -31557600.0; // default to t minus one year old
 
 static pyPropertyNode imu_node;
 static vector<pyPropertyNode> sections;
+static bool fusion = false;	// publish a fused virtual imu as imu[0]
 
 static int remote_link_skip = 0;
 static int logging_skip = 0;
@@ -63,6 +66,15 @@ void IMU_init() {
     remote_link_skip = remote_link_node.getDouble("imu_skip");
     logging_skip = logging_node.getDouble("imu_skip");
 
+    // with fusion enabled each imu publishes to /sensors/imu[i+1] and
+    // the fused result takes over /sensors/imu[0]
+    pyPropertyNode fusion_node = pyGetNode("/config/sensors/imu_fusion", true);
+    if ( fusion_node.hasChild("enable") ) {
+	fusion = fusion_node.getBool("enable");
+    }
+    vector<int> fusion_inputs;
+    string primary_source = "";
+
     // traverse configured modules
     pyPropertyNode group_node = pyGetNode("/config/sensors/imu_group", true);
     vector<string>children = group_node.getChildren();
@@ -75,9 +87,16 @@ void IMU_init() {
 	if ( !enabled ) {
 	    continue;
 	}
+	int index = fusion ? i + 1 : i;
 	ostringstream output_path;
-	output_path << "/sensors/imu" << '[' << i << ']';
-	printf("imu: %d = %s\n", i, source.c_str());
+	output_path << "/sensors/imu" << '[' << index << ']';
+	printf("imu: %d = %s\n", index, source.c_str());
+	if ( source != "null" ) {
+	    fusion_inputs.push_back(index);
+	}
+	if ( index == 0 ) {
+	    primary_source = source;
+	}
 	if ( source == "null" ) {
 	    // do nothing
 	} else if ( source == "APM2" ) {
@@ -99,6 +118,34 @@ void IMU_init() {
 		   source.c_str());
 	}
     }
+
+    if ( fusion ) {
+	imu_fusion_init( &fusion_node, fusion_inputs );
+    }
+
+    // batching feeds the filter every sample of imu[0], the fused imu
+    // is only computed once per frame so there is nothing to batch
+    pyPropertyNode batch_node = pyGetNode("/config/sensors/imu_batch", true);
+    if ( fusion && batch_node.getBool("enable") ) {
+	printf("imu batch: disabled while imu fusion is enabled\n");
+	batch_node.setBool("enable", false);
+    }
+    imu_batch_init( &batch_node, primary_source );
+}
+
+
+// pack and send/log /sensors/imu[index]
+static void send_imu( int index, bool send_remote_link, bool send_logging ) {
+    if ( send_remote_link || send_logging ) {
+	uint8_t buf[256];
+	int size = packer->pack_imu( index, buf );
+	if ( send_remote_link ) {
+	    remote_link->send_message( buf, size );
+	}
+	if ( send_logging ) {
+	    logging->log_message( buf, size );
+	}
+    }
 }
 
 
@@ -112,57 +159,54 @@ bool IMU_update() {
     static int remote_link_count = 0;
     static int logging_count = 0;
 
+    // decided once per frame so every imu that updates gets sent
+    bool send_remote_link = ( remote_link_count < 0 );
+    bool send_logging = ( logging_count < 0 );
+
     // traverse configured modules
+    bool primary = true;
     for ( unsigned int i = 0; i < sections.size(); i++ ) {
 	string source = sections[i].getString("source");
 	bool enabled = sections[i].getBool("enable");
 	if ( !enabled ) {
 	    continue;
 	}
+	bool fresh = false;
 	if ( source == "null" ) {
 	    // do nothing
 	} else if ( source == "APM2" ) {
-	    fresh_data = APM2_imu_update();
+	    fresh = APM2_imu_update();
 	} else if ( source == "Aura3" ) {
-	    fresh_data = Aura3_imu_update();
+	    fresh = Aura3_imu_update();
 	} else if ( source == "fgfs" ) {
-	    fresh_data = fgfs_imu_update();
+	    fresh = fgfs_imu_update();
 	} else if ( source == "file" ) {
 	    ugfile_read();
-	    fresh_data = ugfile_get_imu();
+	    fresh = ugfile_get_imu();
 	} else if ( source == "Goldy2" ) {
-	    fresh_data = goldy2_imu_update();
+	    fresh = goldy2_imu_update();
 	} else if ( source == "vn100" ) {
-	    fresh_data = imu_vn100_uart_get();
+	    fresh = imu_vn100_uart_get();
 	} else if ( source == "vn100-spi" ) {
-	    fresh_data = imu_vn100_spi_get();
+	    fresh = imu_vn100_spi_get();
 	} else {
 	    printf("Unknown imu source = '%s' in config file\n",
 		   source.c_str());
 	}
+	if ( primary ) {
+	    // without fusion the first imu is the one everything uses
+	    fresh_data = fresh;
+	    primary = false;
+	}
+	if ( fresh ) {
+	    send_imu( fusion ? i + 1 : i, send_remote_link, send_logging );
+	}
+    }
+
+    if ( fusion ) {
+	fresh_data = imu_fusion_update();
 	if ( fresh_data ) {
-	    bool send_remote_link = false;
-	    if ( remote_link_count < 0 ) {
-		send_remote_link = true;
-		remote_link_count = remote_link_skip;
-	    }
-	
-	    bool send_logging = false;
-	    if ( logging_count < 0 ) {
-		send_logging = true;
-		logging_count = logging_skip;
-	    }
-	
-	    if ( send_remote_link || send_logging ) {
-		uint8_t buf[256];
-		int size = packer->pack_imu( i, buf );
-		if ( send_remote_link ) {
-		    remote_link->send_message( buf, size );
-		}
-		if ( send_logging ) {
-		    logging->log_message( buf, size );
-		}
-	    }
+	    send_imu( 0, send_remote_link, send_logging );
 	}
     }
 
@@ -175,6 +219,12 @@ bool IMU_update() {
 	// for computing imu data age
 	imu_last_time = imu_node.getDouble("timestamp");
 
+	if ( send_remote_link ) {
+	    remote_link_count = remote_link_skip;
+	}
+	if ( send_logging ) {
+	    logging_count = logging_skip;
+	}
         remote_link_count--;
         logging_count--;
     }
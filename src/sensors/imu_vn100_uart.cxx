@@ -1,7 +1,14 @@
 /**
  *  \file: imu_vn100_uart.cxx
  *
- * Vectornav.com VN-100 (ascii/uart) driver
+ * Vectornav.com VN-100 (uart) driver
+ *
+ * By default the VN-100 is configured for its binary output
+ * (register 75, common group: time since startup, uncompensated
+ * imu, mag/temp/pressure) which is a fixed 58 byte packet with a
+ * crc16.  mode = "ascii" selects the older $VNCMV sentence output.
+ * Both are parsed in place out of a bulk read buffer, nothing is
+ * allocated or copied per sample.
  *
  * Copyright (C) 2012 - Curtis L. Olson - curtolson@flightgear.org
  *
@@ -13,14 +20,24 @@
 #include <fcntl.h>		// open()
 #include <math.h>		// fabs()
 #include <stdio.h>		// printf() et. al.
+#include <stdlib.h>		// strtod()
 #include <termios.h>		// tcgetattr() et. al.
 #include <unistd.h>		// tcgetattr() et. al.
 #include <string.h>		// memset(), strerror()
 
+#if defined(__has_include)
+#  if __has_include(<charconv>)
+#    include <charconv>		// from_chars()
+#  endif
+#endif
+
 #include "include/globaldefs.h"
 
 #include "comms/display.hxx"
-#include "util/strutils.hxx"
+#include "init/globals.hxx"
+#include "sensors/imu_batch.hxx"
+#include "sensors/util_goldy2.hxx"	// utilCRC16() (same ccitt crc)
+#include "util/clocksync.hxx"
 #include "util/timing.h"
 
 #include "imu_vn100_uart.hxx"
@@ -28,9 +45,39 @@
 
 // imu nodes
 static pyPropertyNode imu_node;
+static pyPropertyNode vn100_node;
 
 static int fd = -1;
 static string device_name = "/dev/ttyS0";
+static bool binary = true;
+static int baud = 921600;
+static int rate_hz = 50;
+static bool use_reactor = false;
+static bool fresh_imu = false;  // set by the reactor callback
+
+// binary output: sync, group 1, fields TimeStartup (bit 0), Imu (bit
+// 9 = uncompensated accel + gyro) and MagPres (bit 10 = mag, temp,
+// pressure), then a big endian crc16 over everything after the sync
+static const uint8_t bin_sync = 0xFA;
+static const uint8_t bin_group = 0x01;
+static const uint16_t bin_fields = 0x0601;
+static const int bin_payload = 8 + 6*4 + 5*4;
+static const int bin_len = 1 + 1 + 2 + bin_payload + 2;
+static const int vn100_imu_hz = 800;	// rate divisor base
+
+// uart receive buffer, packets are parsed in place out of
+// [rx_pos, rx_len).  The last byte arrived at rx_time, earlier ones
+// one character time (byte_sec) apart before that.
+static uint8_t rx_buf[1024];
+static int rx_len = 0;
+static int rx_pos = 0;
+static double rx_time = 0.0;
+static double byte_sec = 10.0 / 921600;
+
+static ClockSync imu_clock;
+
+static uint32_t crc_errors = 0;
+static uint32_t ascii_errors = 0;
 
 
 // initialize gpsd input property nodes
@@ -38,66 +85,50 @@ static void bind_imu_input( pyPropertyNode *config ) {
     if ( config->hasChild("device") ) {
 	device_name = config->getString("device");
     }
+    if ( config->hasChild("mode") ) {
+	binary = (config->getString("mode") != "ascii");
+    }
+    if ( !binary ) {
+	baud = 115200;
+    }
+    if ( config->hasChild("baud") ) {
+	baud = config->getLong("baud");
+    }
+    if ( config->hasChild("rate_hz") ) {
+	rate_hz = config->getLong("rate_hz");
+    }
+    if ( rate_hz < 1 ) {
+	rate_hz = 1;
+    }
+    byte_sec = 10.0 / baud;
 }
 
 
-// initialize imu output property nodes 
+// initialize imu output property nodes
 static void bind_imu_output( string output_path ) {
     imu_node = pyGetNode(output_path, true);
+    vn100_node = pyGetNode("/sensors/vn100", true);
 }
 
 
-// send our configured init strings to configure gpsd the way we prefer
-static bool imu_vn100_uart_open_9600() {
+static bool imu_vn100_uart_open( int baud ) {
     if ( display_on ) {
-	printf("Vectornav.com VN-100 on %s @ 9600\n", device_name.c_str());
+	printf("Vectornav.com VN-100 on %s @ %d\n", device_name.c_str(), baud);
     }
 
-    fd = open( device_name.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK );
-    if ( fd < 0 ) {
-        fprintf( stderr, "open serial: unable to open %s - %s\n",
-                 device_name.c_str(), strerror(errno) );
-	return false;
-    }
-
-    struct termios config;     // New Serial Port Settings
-
-    memset(&config, 0, sizeof(config));
-
-    // Save Current Serial Port Settings
-    // tcgetattr(fd,&oldTio); 
-
-    // Configure New Serial Port Settings
-    config.c_cflag     = B9600 | // bps rate
-                         CS8	 | // 8n1
-                         CLOCAL	 | // local connection, no modem
-                         CREAD;	   // enable receiving chars
-    config.c_iflag     = IGNPAR;   // ignore parity bits
-    config.c_oflag     = 0;
-    config.c_lflag     = 0;
-    config.c_cc[VTIME] = 0;
-    config.c_cc[VMIN]  = 0;	   // block 'read' from returning until at
-                                   // least 1 character is received
-
-    // Flush Serial Port I/O buffer
-    tcflush(fd, TCIOFLUSH);
-
-    // Set New Serial Port Settings
-    int ret = tcsetattr( fd, TCSANOW, &config );
-    if ( ret > 0 ) {
-        fprintf( stderr, "error configuring device: %s - %s\n",
-                 device_name.c_str(), strerror(errno) );
-	return false;
-    }
-
-    return true;
-}
-
-
-// send our configured init strings to configure gpsd the way we prefer
-static bool imu_vn100_uart_open_115200() {
-    if ( display_on ) {
-	printf("Vectornav.com VN-100 on %s @ 115,200\n", device_name.c_str());
+    int baud_bits = B115200;
+    if ( baud == 9600 ) {
+	baud_bits = B9600;
+    } else if ( baud == 115200 ) {
+	baud_bits = B115200;
+    } else if ( baud == 230400 ) {
+	baud_bits = B230400;
+    } else if ( baud == 460800 ) {
+	baud_bits = B460800;
+    } else if ( baud == 921600 ) {
+	baud_bits = B921600;
+    } else {
+	fprintf( stderr, "vn100 baud (%d) unsupported, using 115200\n", baud );
     }
 
     fd = open( device_name.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK );
@@ -112,10 +143,10 @@ static bool imu_vn100_uart_open_115200() {
     memset(&config, 0, sizeof(config));
 
     // Save Current Serial Port Settings
-    // tcgetattr(fd,&oldTio); 
+    // tcgetattr(fd,&oldTio);
 
     // Configure New Serial Port Settings
-    config.c_cflag     = B115200 | // bps rate
+    config.c_cflag     = baud_bits | // bps rate
                          CS8	 | // 8n1
                          CLOCAL	 | // local connection, no modem
                          CREAD;	   // enable receiving chars
@@ -145,40 +176,34 @@ static bool imu_vn100_uart_open_115200() {
 
 
 // calculate the nmea check sum
-static char calc_nmea_cksum(const char *sentence) {
-    unsigned char sum = 0;
-    int i, len;
-
-    // cout << sentence << endl;
-
-    len = strlen(sentence);
-    sum = sentence[0];
-    for ( i = 1; i < len; i++ ) {
-        // cout << sentence[i];
+static uint8_t calc_nmea_cksum( const char *sentence, int len ) {
+    uint8_t sum = 0;
+    for ( int i = 0; i < len; i++ ) {
         sum ^= sentence[i];
     }
-    // cout << endl;
-
-    // printf("sum = %02x\n", sum);
     return sum;
 }
 
 
-static int imu_vn100_uart_send_cmd( string msg ) {
-    char msg_sum[10];
-    snprintf( msg_sum, 3, "%02X", calc_nmea_cksum(msg.c_str()) );
-    string command = "$";
-    command += msg;
-    command += "*";
-    command += msg_sum;
+static int imu_vn100_uart_send_cmd( const char *msg ) {
+    char command[128];
+    int len = snprintf( command, sizeof(command), "$%s*%02X",
+			msg, calc_nmea_cksum(msg, strlen(msg)) );
     if ( display_on ) {
-	printf("sending '%s'\n", command.c_str());
+	printf("sending '%s'\n", command);
     }
-    command += "\r\n";
-    
-    int len = write( fd, command.c_str(), command.length() );
+    len += snprintf( command + len, sizeof(command) - len, "\r\n" );
+    return write( fd, command, len );
+}
+
 
-    return len;
+static bool imu_vn100_uart_read();
+
+// reactor callback, parse whatever has arrived
+static void imu_vn100_uart_ready( int fd, void *arg ) {
+    while ( imu_vn100_uart_read() ) {
+	fresh_imu = true;
+    }
 }
 
 
@@ -186,25 +211,41 @@ void imu_vn100_uart_init( string output_path, pyPropertyNode *config ) {
     bind_imu_input( config );
     bind_imu_output( output_path );
 
-    imu_vn100_uart_open_9600();
+    char cmd[64];
+
+    imu_vn100_uart_open( 9600 );
     sleep(1);
-    imu_vn100_uart_send_cmd( "VNWRG,05,115200" ); // switch to 115,200 baud
+    snprintf( cmd, sizeof(cmd), "VNWRG,05,%d", baud ); // switch baud
+    imu_vn100_uart_send_cmd( cmd );
     sleep(1);
     imu_vn100_uart_close();
     sleep(1);
 
-    imu_vn100_uart_open_115200();
+    imu_vn100_uart_open( baud );
     sleep(1);
-    imu_vn100_uart_send_cmd( "VNWRG,06,253" ); // switch to CMV (raw sensor) output which wasn't documented
-    imu_vn100_uart_send_cmd( "VNWRG,07,50" ); // switch to 50hz output
+    if ( binary ) {
+	// ascii async output off, binary output 1 on serial port 1
+	imu_vn100_uart_send_cmd( "VNWRG,06,0" );
+	snprintf( cmd, sizeof(cmd), "VNWRG,75,1,%d,%02X,%04X",
+		  vn100_imu_hz / rate_hz, bin_group, bin_fields );
+	imu_vn100_uart_send_cmd( cmd );
+    } else {
+	imu_vn100_uart_send_cmd( "VNWRG,06,253" ); // switch to CMV (raw sensor) output which wasn't documented
+	snprintf( cmd, sizeof(cmd), "VNWRG,07,%d", rate_hz );
+	imu_vn100_uart_send_cmd( cmd );
+    }
+
+    use_reactor = reactor->add( fd, imu_vn100_uart_ready, NULL, "vn100" );
 }
 
 
-static bool imu_vn100_uart_parse_msg( char *msg_buf, int size )
+// publish one sample (both output modes end up here)
+static void imu_vn100_uart_publish( double current_time,
+				    double p, double q, double r,
+				    double ax, double ay, double az,
+				    double hx, double hy, double hz,
+				    double temp )
 {
-    double current_time = get_Time();
-    string msg = (string)msg_buf;
-
     // variables used to compute an intial steady state gyro bias
     static bool bias_ready = false;
     static double start_time  = -1.0;
@@ -212,178 +253,265 @@ static bool imu_vn100_uart_parse_msg( char *msg_buf, int size )
     static double p_sum = 0.0, q_sum = 0.0, r_sum = 0.0;
     static double p_bias = 0.0, q_bias = 0.0, r_bias = 0.0;
 
-    // validate message
-    if ( msg.length() < 9 ) {
-        // bogus command
+    imu_node.setDouble( "hx", hx );
+    imu_node.setDouble( "hy", hy );
+    imu_node.setDouble( "hz", hz );
+    imu_node.setDouble( "ax_mps_sec", ax );
+    imu_node.setDouble( "ay_mps_sec", ay );
+    imu_node.setDouble( "az_mps_sec", az );
+    imu_node.setDouble( "p_rad_sec", p - p_bias );
+    imu_node.setDouble( "q_rad_sec", q - q_bias );
+    imu_node.setDouble( "r_rad_sec", r - r_bias );
+    imu_node.setDouble( "temp_C", temp );
+    imu_node.setDouble( "timestamp", current_time );
+    imu_batch_push( "vn100", current_time, p - p_bias, q - q_bias,
+		    r - r_bias, ax, ay, az );
+
+    if ( !bias_ready ) {
+	// average first 15 seconds of steady state gyro values and
+	// use as a global bias.  This should be removed for the
+	// temperature compensated vector nav unit.
+	if ( start_time < 0.0 ) {
+	    start_time = current_time;
+	}
+	if ( current_time - start_time < 15.0 ) {
+	    p_sum += p;
+	    q_sum += q;
+	    r_sum += r;
+	    count++;
+	    p_bias = p_sum / (double)count;
+	    q_bias = q_sum / (double)count;
+	    r_bias = r_sum / (double)count;
+	} else {
+	    bias_ready = true;
+	    if ( display_on ) {
+		printf("gyro bias: p=%.2f q=%.2f r=%.2f\n",
+		       p_bias, q_bias, r_bias);
+	    }
+	    // sanity check
+	    if ( fabs(p_bias) > 1.0 /* 57.3 deg/sec */ ||
+		 fabs(q_bias) > 1.0 /* 57.3 deg/sec */ ||
+		 fabs(r_bias) > 1.0 /* 57.3 deg/sec */ )
+	    {
+		printf("Something is wrong with the gyro, it is outputting bad data!\n");
+		printf("Aborting so you can fix the hardware problem.\n");
+		printf("NOTE: IMU must be still when software is started.\n");
+		exit(-1);
+	    }
+	}
+    }
+}
+
+
+static float get_float( const uint8_t *buf ) {
+    float val;
+    memcpy( &val, buf, sizeof(val) );
+    return val;
+}
+
+
+// buf points at the sync byte of a complete, crc checked packet
+static bool imu_vn100_uart_parse_binary( const uint8_t *buf,
+					 double arrival_time )
+{
+    const uint8_t *p = buf + 4;
+    uint64_t startup_ns;
+    memcpy( &startup_ns, p, sizeof(startup_ns) );
+    p += 8;
+    float ax = get_float(p);
+    float ay = get_float(p + 4);
+    float az = get_float(p + 8);
+    float gx = get_float(p + 12);
+    float gy = get_float(p + 16);
+    float gz = get_float(p + 20);
+    p += 24;
+    float hx = get_float(p);
+    float hy = get_float(p + 4);
+    float hz = get_float(p + 8);
+    float temp = get_float(p + 12);
+
+    // the vn100 clock is very stable, map it to host time on the
+    // lower envelope of the arrival times
+    double remote_sec = startup_ns / 1000000000.0;
+    imu_clock.update( remote_sec, arrival_time );
+    imu_vn100_uart_publish( imu_clock.get_local(remote_sec),
+			    gx, gy, gz, ax, ay, az, hx, hy, hz, temp );
+    return true;
+}
+
+
+// parse a number at p (up to end), returns the first char after it
+// or NULL if there wasn't one
+static const char *parse_double( const char *p, const char *end,
+				 double *val )
+{
+#if defined(__cpp_lib_to_chars)
+    // the vn100 writes explicit '+' signs, from_chars doesn't take them
+    if ( p < end && *p == '+' ) {
+	p++;
+    }
+    std::from_chars_result res = std::from_chars( p, end, *val );
+    if ( res.ec != std::errc() ) {
+	return NULL;
+    }
+    return res.ptr;
+#else
+    // the message is terminated in place so strtod can't run past end
+    char *stop;
+    *val = strtod( p, &stop );
+    if ( stop == p || stop > end ) {
+	return NULL;
+    }
+    return stop;
+#endif
+}
+
+
+// msg is the sentence between '$' and '\r' (not including them),
+// terminated in place
+static bool imu_vn100_uart_parse_ascii( char *msg, int len,
+					double arrival_time )
+{
+    // validate message: VNCMV,...*XX
+    if ( len < 9 || msg[len-3] != '*' ) {
+	ascii_errors++;
         return false;
     }
-    // save sender check sum
-    string nmea_sum = msg.substr(msg.length() - 2);
-    // trim down to core message
-    msg = msg.substr(0, msg.length() - 3);
-    char msg_sum[10];
-    snprintf( msg_sum, 3, "%02X", calc_nmea_cksum(msg.c_str()) );
-
-    /*
-      debug = fopen("/tmp/debug.txt", "a");
-      fprintf(debug, " cmd: '%s' nmea: '%s' '%s'\n", cmd.c_str(),
-              nmea_sum.c_str(), cmd_sum);
-      fclose(debug);
-    */
-
-    // printf("%s %s\n", nmea_sum.c_str(), msg_sum);
-
-    if ( nmea_sum.c_str()[0] != msg_sum[0]
-         || nmea_sum.c_str()[1] != msg_sum[1])
-    {
+    char msg_sum[3];
+    snprintf( msg_sum, 3, "%02X", calc_nmea_cksum(msg, len - 3) );
+    if ( msg[len-2] != msg_sum[0] || msg[len-1] != msg_sum[1] ) {
         // checksum failure
-        /*
-	  debug = fopen("/tmp/debug.txt", "a");
-	  fprintf(debug, "check sum failure\n");
-	  fclose(debug);
-	*/
+	ascii_errors++;
         return false;
     }
-    vector<string> tokens = split( msg.c_str(), "," );
-    if ( tokens[0] == "VNCMV" && tokens.size() == 11 ) {
-	double val, p, q, r;
-	val = atof( tokens[1].c_str() );
-	// hx_filter = 0.75*hx_filter + 0.25*val;
-	imu_node.setDouble( "hx", val );
-
-	val = atof( tokens[2].c_str() );
-	// hy_filter = 0.75*hy_filter + 0.25*val;
-	imu_node.setDouble( "hy", val );
-
-	val = atof( tokens[3].c_str() );
-	// hz_filter = 0.75*hz_filter + 0.25*val;
-	imu_node.setDouble( "hz", val );
-
-	val = atof( tokens[4].c_str() );
-	// ax_filter = 0.75*ax_filter + 0.25*val;
-	imu_node.setDouble( "ax_mps_sec", val );
-
-	val = atof( tokens[5].c_str() );
-	// ay_filter = 0.75*ay_filter + 0.25*val;
-	imu_node.setDouble( "ay_mps_sec", val );
-
-	val = atof( tokens[6].c_str() );
-	// az_filter = 0.75*az_filter + 0.25*val;
-	imu_node.setDouble( "az_mps_sec", val );
-
-	p = val = atof( tokens[7].c_str() );
-	// p_filter = 0.75*p_filter + 0.25*val;
-	imu_node.setDouble( "p_rad_sec", val - p_bias );
-
-	q = val = atof( tokens[8].c_str() );
-	// q_filter = 0.75*q_filter + 0.25*val;
-	imu_node.setDouble( "q_rad_sec", val - q_bias );
-
-	r = val = atof( tokens[9].c_str() );
-	// r_filter = 0.75*r_filter + 0.25*val;
-	imu_node.setDouble( "r_rad_sec", val - r_bias );
-
-	val = atof( tokens[10].c_str() );
-	// r_filter = 0.75*r_filter + 0.25*val;
-	imu_node.setDouble( "temp_C", val );
-
-	imu_node.setDouble( "timestamp", current_time );
-
-	if ( !bias_ready ) {
-	    // average first 15 seconds of steady state gyro values and
-	    // use as a global bias.  This should be removed for the
-	    // temperature compensated vector nav unit.
-	    if ( start_time < 0.0 ) {
-		start_time = current_time;
-	    }
-	    if ( current_time - start_time < 15.0 ) {
-		p_sum += p;
-		q_sum += q;
-		r_sum += r;
-		count++;
-		p_bias = p_sum / (double)count;
-		q_bias = q_sum / (double)count;
-		r_bias = r_sum / (double)count;
-	    } else {
-		bias_ready = true;
-		if ( display_on ) {
-		    printf("gyro bias: p=%.2f q=%.2f r=%.2f\n",
-			   p_bias, q_bias, r_bias);
-		}
-		// sanity check
-		if ( fabs(p_bias) > 1.0 /* 57.3 deg/sec */ ||
-		     fabs(q_bias) > 1.0 /* 57.3 deg/sec */ ||
-		     fabs(r_bias) > 1.0 /* 57.3 deg/sec */ )
-	        {
-		    printf("Something is wrong with the gyro, it is outputting bad data!\n");
-		    printf("Aborting so you can fix the hardware problem.\n");
-		    printf("NOTE: IMU must be still when software is started.\n");
-		    exit(-1);
-		}
-	    }
-	}
-    } else {
+    if ( strncmp(msg, "VNCMV,", 6) != 0 ) {
 	if ( display_on ) {
-	    printf("Unknown message or wrong number of fields: '%s'\n",
-		   msg.c_str());
+	    printf("Unknown message: '%s'\n", msg);
 	}
 	return false;
     }
 
-    // printf("%s\n", msg.c_str());
+    // hx hy hz ax ay az p q r temp
+    double val[10];
+    const char *p = msg + 6;
+    const char *end = msg + len - 3;
+    for ( int i = 0; i < 10; i++ ) {
+	p = parse_double( p, end, &val[i] );
+	if ( p == NULL || (i < 9 && *p != ',') || (i == 9 && p != end) ) {
+	    if ( display_on ) {
+		printf("Wrong number of fields: '%s'\n", msg);
+	    }
+	    ascii_errors++;
+	    return false;
+	}
+	p++;
+    }
 
+    imu_vn100_uart_publish( arrival_time, val[6], val[7], val[8],
+			    val[3], val[4], val[5], val[0], val[1], val[2],
+			    val[9] );
     return true;
 }
 
 
+// Look for one complete message in the receive buffer.  Returns 1
+// when one was parsed, 0 when more data is needed.
+static int imu_vn100_uart_scan() {
+    while ( rx_pos < rx_len ) {
+	uint8_t *start = rx_buf + rx_pos;
+	int avail = rx_len - rx_pos;
+	if ( binary ) {
+	    if ( start[0] != bin_sync ) {
+		rx_pos++;
+		continue;
+	    }
+	    if ( avail < bin_len ) {
+		return 0;
+	    }
+	    uint16_t fields = start[2] | (start[3] << 8);
+	    if ( start[1] != bin_group || fields != bin_fields ) {
+		// not our packet (or a 0xFA inside something else)
+		rx_pos++;
+		continue;
+	    }
+	    if ( utilCRC16(start + 1, bin_len - 1, 0) != 0 ) {
+		crc_errors++;
+		rx_pos++;
+		continue;
+	    }
+	    rx_pos += bin_len;
+	    double arrival = rx_time - (rx_len - rx_pos) * byte_sec;
+	    return imu_vn100_uart_parse_binary( start, arrival ) ? 1 : 0;
+	} else {
+	    if ( start[0] != '$' ) {
+		rx_pos++;
+		continue;
+	    }
+	    uint8_t *cr = (uint8_t *)memchr( start, '\r', avail );
+	    if ( cr == NULL ) {
+		if ( avail >= 256 ) {
+		    // too long to be a sentence, resync
+		    rx_pos++;
+		    continue;
+		}
+		return 0;
+	    }
+	    uint8_t *next = (uint8_t *)memchr( start + 1, '$', cr - start - 1 );
+	    if ( next != NULL ) {
+		// a truncated sentence, start over at the next one
+		rx_pos = next - rx_buf;
+		continue;
+	    }
+	    *cr = 0;
+	    rx_pos = cr + 1 - rx_buf;
+	    double arrival = rx_time - (rx_len - rx_pos) * byte_sec;
+	    if ( imu_vn100_uart_parse_ascii( (char *)start + 1,
+					     cr - start - 1, arrival ) )
+	    {
+		return 1;
+	    }
+	}
+    }
+    return 0;
+}
+
+
+// parse the next message, reading more from the uart as needed.
+// Returns false once the uart is drained.
 static bool imu_vn100_uart_read() {
-    static int state = 0;
-    static int counter = 0;
-    int len;
-    const int max_len = 256;
-    uint8_t input[max_len];
-    static uint8_t msg[max_len];
-
-    // printf("read vn100_uart, entry state = %d\n", state);
-
-    bool fresh_data = false;
-
-    if ( state == 0 ) {
-	counter = 0;
-	len = read( fd, input, 1 );
-	while ( len > 0 && input[0] != '$' ) {
-	    // printf( "%c", input[0] );
-	    len = read( fd, input, 1 );
+    while ( true ) {
+	if ( imu_vn100_uart_scan() ) {
+	    return true;
 	}
-	if ( len > 0 && input[0] == '$' ) {
-	    // printf( "read '$'\n" );
-	    state = 1;
+	// keep the partial message (if any) and make room behind it
+	if ( rx_pos > 0 ) {
+	    memmove( rx_buf, rx_buf + rx_pos, rx_len - rx_pos );
+	    rx_len -= rx_pos;
+	    rx_pos = 0;
 	}
-    }
-    if ( state == 1 ) {
-	len = read( fd, input, 1 );
-	while ( len > 0 && input[0] != '\r' && counter < max_len-1 ) {
-	    msg[counter] = input[0];
-	    counter++;
-	    // printf( "%d ", input[0] );
-	    len = read( fd, input, 1 );
+	if ( rx_len >= (int)sizeof(rx_buf) ) {
+	    rx_len = 0;
 	}
-	if ( (len > 0 && input[0] == '\r') || counter >= max_len-1 ) {
-	    if ( counter > max_len-1 ) {
-		counter = max_len - 1;
-	    }
-	    msg[counter] = 0;
-	    fresh_data = imu_vn100_uart_parse_msg( (char *)msg, counter );
-	    state = 0;
+	int result = read( fd, rx_buf + rx_len, sizeof(rx_buf) - rx_len );
+	if ( result <= 0 ) {
+	    vn100_node.setLong( "crc_errors", crc_errors );
+	    vn100_node.setLong( "ascii_errors", ascii_errors );
+	    return false;
 	}
-	// printf("len = %d  counter = %d  input = %d\n", len, counter, input[0]);
+	rx_time = get_Time();
+	rx_len += result;
     }
-
-    return fresh_data;
 }
 
 
 bool imu_vn100_uart_get() {
+    if ( use_reactor ) {
+	// already read and parsed as it arrived
+	bool result = fresh_imu;
+	fresh_imu = false;
+	return result;
+    }
+
     // scan for new messages
     bool imu_data_valid = false;
 
@@ -396,5 +524,9 @@ bool imu_vn100_uart_get() {
 
 
 void imu_vn100_uart_close() {
+    if ( use_reactor ) {
+	reactor->remove(fd);
+	use_reactor = false;
+    }
     close(fd);
 }
@@ -0,0 +1,51 @@
+#!/usr/bin/python3
+
+# time the native survey planner (auracore.survey) against the
+# original python area slicing on a large, wavy survey area
+#
+# run from the src directory: python3 -m survey.bench_plan
+
+import contextlib
+import io
+import math
+import time
+
+from auracore import survey as survey_plan
+
+import survey.area as area
+import survey.point as point
+import survey.vector as vector
+
+def python_plan(geod, advance_deg, step_m, extend_m):
+    poly = [ point.Point(p[0], p[1]) for p in geod ]
+    ref = poly[0]
+    dir = vector.Vector( math.sin(advance_deg * math.pi / 180),
+                         math.cos(advance_deg * math.pi / 180) )
+    # area.py is very chatty, don't time the printing
+    with contextlib.redirect_stdout(io.StringIO()):
+        cart_area = area.Area( area.geod2cart(ref, poly) )
+        cart_route = area.slice(cart_area, dir, step=step_m, extend=extend_m)
+        return area.cart2geod(ref, cart_route)
+
+# ~10 km across, 2000 vertices
+lon0 = -93.2
+lat0 = 45.1
+n = 2000
+geod = []
+for i in range(n):
+    a = 2 * math.pi * i / n
+    r = 5000 * (1 + 0.1 * math.sin(7 * a))
+    x = r * math.cos(a)
+    y = 5000 * math.sin(a)
+    geod.append( (lon0 + x / (111320 * math.cos(lat0 * math.pi / 180)),
+                  lat0 + y / 110540) )
+
+for step_m in [ 50, 20, 5 ]:
+    start = time.time()
+    route = survey_plan.plan(geod, 30, step_m, 50)
+    native_ms = (time.time() - start) * 1000
+    start = time.time()
+    py_route = python_plan(geod, 30, step_m, 50)
+    python_ms = (time.time() - start) * 1000
+    print('step %.0f m: %d lines  native %.1f ms  python %.1f ms (%d lines)' %
+          (step_m, len(route) / 2, native_ms, python_ms, len(py_route) / 2))
@@ -1,20 +1,21 @@
 import math
 
 from props import getNode
+from auracore import survey as survey_plan
 
 import control.route
 import control.waypoint
 
-import survey.point as point
-import survey.vector as vector
-import survey.area as area
-
 ft2m = 0.3048
+kt2mps = 0.5144444444444444444
 d2r = math.pi / 180.0
+r2d = 180.0 / math.pi
+gravity = 9.81                  # m/sec^2
 
 wind_node = getNode("/filters/wind", True)
 task_node = getNode( '/task', True )
 targets_node = getNode( '/autopilot/targets', True )
+L1_node = getNode('/config/autopilot/L1_controller', True)
 
 def do_survey( request ):
     # validate the inputs
@@ -44,24 +45,17 @@ def do_survey( request ):
     else:
         lfov = 40
 
-    # generate the boundary polygon
-    poly = []
+    # the boundary polygon
     if not 'area' in request:
         return    
-    for p in request['area']:
-        poly.append( point.Point(p[0], p[1]) )
-    ref = poly[0]
-    cart = area.geod2cart( ref, poly )
-    cart_area = area.Area( cart )
 
-    # convert to cartesian coordinates
     # advance direction is upwind by default
     if wind_node.getFloat('wind_speed_kt') > 2:
-        advance_dir = vector.Vector( wind_node.getFloat('wind_east_mps'),
-                                     wind_node.getFloat('wind_north_mps') )
+        advance_deg = math.atan2( wind_node.getFloat('wind_east_mps'),
+                                  wind_node.getFloat('wind_north_mps') ) * r2d
     else:
         # little or no wind
-        advance_dir = vector.Vector(0, 1) # north
+        advance_deg = 0.0       # north
 
     # survey altitude
     if agl_ft >= 100 and agl_ft <= 400:
@@ -75,18 +69,26 @@ def do_survey( request ):
     fov2_tan = math.tan(lfov*0.5 * d2r)
     slap_dist_m = 2 * fov2_tan * agl_m * (1.0 - slap)
 
+    # turn radius at the target airspeed and bank limit (weights the
+    # order the survey cells are flown in)
+    speed_mps = targets_node.getFloat('airspeed_kt') * kt2mps
+    bank_deg = L1_node.getFloat('bank_limit_deg')
+    turn_radius_m = 0.0
+    if bank_deg > 1.0:
+        turn_radius_m = speed_mps * speed_mps \
+                        / (gravity * math.tan(bank_deg * d2r))
+
     # slice the area and make the route
-    cart_route = area.slice(cart_area, advance_dir, step=slap_dist_m,
-                            extend=extend_m)
-    geod_route = area.cart2geod( ref, cart_route )
+    geod_route = survey_plan.plan( request['area'], advance_deg,
+                                   slap_dist_m, extend_m, turn_radius_m )
 
     # assemble the route
     control.route.standby_route = []
     for p in geod_route:
         wp = control.waypoint.Waypoint()
         wp.mode = 'absolute'
-        wp.lon_deg = p.x
-        wp.lat_deg = p.y
+        wp.lon_deg = p[0]
+        wp.lat_deg = p[1]
         control.route.standby_route.append(wp)
 
     # make active
@@ -94,6 +96,3 @@ def do_survey( request ):
 
     # request a task change
     task_node.setString( 'command_request', 'task,route' )
-
-    # dribble
-    control.route.dribble(reset=True)
@@ -0,0 +1,101 @@
+#include <math.h>
+
+#include "clocksync.hxx"
+
+ClockSync::ClockSync( double window_sec, double bin_sec, double skew ):
+    window(window_sec),
+    bin(bin_sec),
+    max_skew(skew),
+    a0(0.0),
+    a1(0.0),
+    last_delay(0.0)
+{
+}
+
+ClockSync::~ClockSync() {}
+
+
+void ClockSync::reset() {
+    bins.clear();
+    a0 = 0.0;
+    a1 = 0.0;
+    last_delay = 0.0;
+}
+
+
+void ClockSync::update( double remote, double local ) {
+    point p;
+    p.x = remote;
+    p.y = local - remote;
+    p.bin_start = remote;
+
+    // keep the lowest offset seen in each bin
+    if ( bins.empty() || remote >= bins.back().bin_start + bin ) {
+        bins.push_back( p );
+    } else if ( p.y < bins.back().y ) {
+        p.bin_start = bins.back().bin_start;
+        bins.back() = p;
+    }
+    while ( bins.size() > 2 && bins.front().x < remote - window ) {
+        bins.pop_front();
+    }
+
+    fit();
+
+    last_delay = local - get_local( remote );
+}
+
+
+// lower envelope line through the bin minimums
+void ClockSync::fit() {
+    int n = bins.size();
+
+    double min_y = bins[0].y;
+    double mean_x = 0.0;
+    for ( int i = 0; i < n; i++ ) {
+        if ( bins[i].y < min_y ) {
+            min_y = bins[i].y;
+        }
+        mean_x += bins[i].x;
+    }
+    mean_x /= n;
+
+    // lower convex hull (the bins are already in x order)
+    hull.clear();
+    for ( int i = 0; i < n; i++ ) {
+        const point *p = &bins[i];
+        while ( hull.size() >= 2 ) {
+            const point *o = hull[hull.size()-2];
+            const point *a = hull[hull.size()-1];
+            double cross = (a->x - o->x) * (p->y - o->y)
+                - (a->y - o->y) * (p->x - o->x);
+            if ( cross > 0.0 ) {
+                break;
+            }
+            hull.pop_back();
+        }
+        hull.push_back( p );
+    }
+
+    // the hull edge spanning the mean x minimizes the total distance
+    // to the points while staying below all of them
+    for ( unsigned int i = 0; i + 1 < hull.size(); i++ ) {
+        if ( mean_x <= hull[i+1]->x || i + 2 == hull.size() ) {
+            double dx = hull[i+1]->x - hull[i]->x;
+            if ( dx <= 0.0 ) {
+                break;
+            }
+            double slope = (hull[i+1]->y - hull[i]->y) / dx;
+            if ( fabs(slope) > max_skew ) {
+                // not enough history yet to tell drift from delay
+                break;
+            }
+            a1 = slope;
+            a0 = hull[i]->y - slope * hull[i]->x;
+            return;
+        }
+    }
+
+    a1 = 0.0;
+    a0 = min_y;
+}
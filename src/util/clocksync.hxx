@@ -0,0 +1,65 @@
+// estimate the mapping from a sensor's clock to host time from
+// (remote stamp, host arrival time) pairs.
+//
+// Every sample arrives some unknown, strictly positive delay after it
+// was stamped (uart transmission, driver latency, main loop
+// scheduling.)  A least squares fit of (host - remote) averages that
+// delay noise straight into the result.  Like NTP/PTP style clock
+// filters, this only trusts the lower envelope: the offset samples
+// are binned, the minimum of each bin is kept over a sliding window,
+// and the fit is the supporting line of the lower convex hull that
+// lies closest to all of them (Moon/Skelly/Towsley.)  Drift between
+// the two clocks shows up as the slope.
+
+#pragma once
+
+#include <deque>
+#include <vector>
+using std::deque;
+using std::vector;
+
+class ClockSync {
+
+public:
+
+    ClockSync( double window_sec = 60.0, double bin_sec = 0.5,
+               double max_skew = 0.001 );
+    ~ClockSync();
+
+    void reset();
+
+    // remote: sensor clock stamp (sec), local: host arrival time
+    // (get_Time() sec)
+    void update( double remote, double local );
+
+    // host time for a sensor clock stamp
+    inline double get_local( double remote ) {
+        return remote + a0 + a1 * remote;
+    }
+
+    // estimated drift of the host clock versus the sensor (sec/sec)
+    inline double get_skew() { return a1; }
+
+    // delay of the most recent sample above the envelope (sec)
+    inline double get_delay() { return last_delay; }
+
+private:
+
+    struct point {
+        double x;               // remote time
+        double y;               // local - remote
+        double bin_start;
+    };
+
+    double window;
+    double bin;
+    double max_skew;
+    deque<point> bins;
+    vector<const point *> hull; // fit() scratch, kept to reuse its storage
+
+    double a0;
+    double a1;
+    double last_delay;
+
+    void fit();
+};
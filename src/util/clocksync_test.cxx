@@ -0,0 +1,69 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clocksync.hxx"
+#include "linearfit.hxx"
+
+// simulated 100hz imu with clock drift and one sided (always late)
+// arrival jitter, run through both filters
+int main() {
+    const double skew = 40e-6;          // host runs 40 ppm fast
+    const double offset = 12.3;         // host clock at sensor boot
+    const double min_delay = 0.0005;    // fixed transport latency
+
+    ClockSync sync;
+    LinearFitFilter lsq(200.0, 0.01);
+
+    double sync_err2 = 0.0, lsq_err2 = 0.0;
+    double sync_dt2 = 0.0, lsq_dt2 = 0.0;
+    double last_sync = 0.0, last_lsq = 0.0;
+    int count = 0;
+    for ( int i = 0; i < 12000; i++ ) {
+        double remote = i * 0.01;
+        double stamp = remote + offset + skew * remote;
+        // mostly a couple msec of scheduling delay, occasionally a
+        // long stall
+        double delay = min_delay - 0.002 * log(1.0 - drand48());
+        if ( drand48() < 0.01 ) {
+            delay += 0.02;
+        }
+        double local = stamp + delay;
+
+        sync.update( remote, local );
+        lsq.update( remote, local - remote );
+
+        // error in the stamp itself (least squares carries the mean
+        // delay as a bias) and in the frame dt the filter sees
+        double sync_ts = sync.get_local(remote);
+        double lsq_ts = remote + lsq.get_value(remote);
+        if ( remote > 10.0 ) {
+            // (past the settling time)
+            double sync_err = sync_ts - (stamp + min_delay);
+            double lsq_err = lsq_ts - (stamp + min_delay);
+            double true_dt = 0.01 * (1.0 + skew);
+            double sync_dt = sync_ts - last_sync - true_dt;
+            double lsq_dt = lsq_ts - last_lsq - true_dt;
+            sync_err2 += sync_err * sync_err;
+            lsq_err2 += lsq_err * lsq_err;
+            sync_dt2 += sync_dt * sync_dt;
+            lsq_dt2 += lsq_dt * lsq_dt;
+            count++;
+        }
+        last_sync = sync_ts;
+        last_lsq = lsq_ts;
+    }
+    double sync_rms = sqrt(sync_err2 / count);
+    double lsq_rms = sqrt(lsq_err2 / count);
+    double sync_dt_rms = sqrt(sync_dt2 / count);
+    double lsq_dt_rms = sqrt(lsq_dt2 / count);
+
+    printf("lower envelope: stamp rms = %.4f ms  dt rms = %.5f ms  skew = %.1f ppm\n",
+           sync_rms * 1000.0, sync_dt_rms * 1000.0, sync.get_skew() * 1e6);
+    printf("least squares:  stamp rms = %.4f ms  dt rms = %.5f ms\n",
+           lsq_rms * 1000.0, lsq_dt_rms * 1000.0);
+
+    // the envelope should track the minimum delay to well under a
+    // msec and give steadier frame dt's than least squares
+    return ( sync_rms < 0.0002 && sync_dt_rms < lsq_dt_rms ) ? 0 : 1;
+}
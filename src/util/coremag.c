@@ -91,6 +91,7 @@
 
 
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -176,15 +177,27 @@ static double htnm_wmm2015[13][13]=
 
 static const int nmax = 12;
 
-static double P[13][13];
-static double DP[13][13];
-static double gnm[13][13];
-static double hnm[13][13];
-static double sm[13];
-static double cm[13];
-
+// constant tables, filled once (calc_magvar() keeps all of its
+// per call scratch on the stack so it may run on several threads)
 static double root[13];
 static double roots[13][13][2];
+static pthread_once_t roots_once = PTHREAD_ONCE_INIT;
+
+static void init_roots(void)
+{
+    int n, m;
+    for ( n = 2; n <= nmax; n++ ) {
+	root[n] = sqrt((2.0*n-1) / (2.0*n));
+    }
+
+    for ( m = 0; m <= nmax; m++ ) {
+	double mm = m*m;
+	for ( n = SG_MAX2(m + 1, 2); n <= nmax; n++ ) {
+	    roots[m][n][0] = sqrt((n-1)*(n-1) - mm);
+	    roots[m][n][1] = 1.0 / sqrt( n*n - mm);
+	}
+    }
+}
 
 /* Convert date to Julian day    1950-2049 */
 unsigned long int yymmdd_to_julian_days( int yy, int mm, int dd )
@@ -239,7 +252,12 @@ double calc_magvar( double lat, double lon, double h, long dat, double* field )
     double yearfrac,sr,r,theta,c,s,psi,fn,fn_0,B_r,B_theta,B_phi,X,Y,Z;
     double sinpsi, cospsi, inv_s;
 
-    static int been_here = 0;
+    double P[13][13];
+    double DP[13][13];
+    double gnm[13][13];
+    double hnm[13][13];
+    double sm[13];
+    double cm[13];
 
     double sinlat = sin(lat);
     double coslat = cos(lat);
@@ -281,20 +299,7 @@ double calc_magvar( double lat, double lon, double h, long dat, double* field )
     DP[1][0] = -s;
 
     // these values will not change for subsequent function calls
-    if( !been_here ) {
-	for ( n = 2; n <= nmax; n++ ) {
-	    root[n] = sqrt((2.0*n-1) / (2.0*n));
-	}
-
-	for ( m = 0; m <= nmax; m++ ) {
-	    double mm = m*m;
-	    for ( n = SG_MAX2(m + 1, 2); n <= nmax; n++ ) {
-		roots[m][n][0] = sqrt((n-1)*(n-1) - mm);
-		roots[m][n][1] = 1.0 / sqrt( n*n - mm);
-	    }
-	}
-	been_here = 1;
-    }
+    pthread_once( &roots_once, init_roots );
 
     for ( n=2; n <= nmax; n++ ) {
 	// double root = sqrt((2.0*n-1) / (2.0*n));
@@ -375,7 +380,7 @@ double calc_magvar( double lat, double lon, double h, long dat, double* field )
     field[4]=Y;
     field[5]=Z;   /* output fields */
 
-    printf("hx=%.2f hy=%.2f hz=%.2f\n", X, Y, Z);
+    /* printf("hx=%.2f hy=%.2f hz=%.2f\n", X, Y, Z); */
     
     /* find variation in radians */
     /* return zero variation at magnetic pole X=Y=0. */
@@ -0,0 +1,85 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "fft.hxx"
+
+AuraFFT::AuraFFT( int size ):
+    n(size),
+    log2n(0),
+    window_scale(1.0)
+{
+    while ( (1 << log2n) < n ) {
+        log2n++;
+    }
+    if ( (1 << log2n) != n ) {
+        printf("AuraFFT: size %d is not a power of two, using %d\n",
+               size, 1 << log2n);
+        n = 1 << log2n;
+    }
+
+    window.resize(n);
+    double sum_w2 = 0.0;
+    for ( int i = 0; i < n; i++ ) {
+        window[i] = 0.5 - 0.5 * cos( 2.0 * M_PI * i / n );
+        sum_w2 += window[i] * window[i];
+    }
+    window_scale = 1.0 / (n * sum_w2);
+
+    twiddle.resize(n/2);
+    for ( int i = 0; i < n/2; i++ ) {
+        double a = -2.0 * M_PI * i / n;
+        twiddle[i] = complex<float>( cos(a), sin(a) );
+    }
+
+    bitrev.resize(n);
+    for ( int i = 0; i < n; i++ ) {
+        int r = 0;
+        for ( int b = 0; b < log2n; b++ ) {
+            if ( i & (1 << b) ) {
+                r |= 1 << (log2n - 1 - b);
+            }
+        }
+        bitrev[i] = r;
+    }
+
+    work.resize(n);
+}
+
+AuraFFT::~AuraFFT() {}
+
+// iterative in place decimation in time transform over work[] which
+// must already be in bit reversed order.
+void AuraFFT::transform() {
+    for ( int len = 2; len <= n; len <<= 1 ) {
+        int half = len >> 1;
+        int step = n / len;
+        for ( int i = 0; i < n; i += len ) {
+            for ( int j = 0; j < half; j++ ) {
+                complex<float> t = twiddle[j * step] * work[i + j + half];
+                work[i + j + half] = work[i + j] - t;
+                work[i + j] += t;
+            }
+        }
+    }
+}
+
+void AuraFFT::compute_power( const float *input, float *power ) {
+    float mean = 0.0;
+    for ( int i = 0; i < n; i++ ) {
+        mean += input[i];
+    }
+    mean /= n;
+
+    for ( int i = 0; i < n; i++ ) {
+        work[bitrev[i]] = complex<float>( (input[i] - mean) * window[i], 0.0 );
+    }
+
+    transform();
+
+    // fold the negative frequencies into a one-sided spectrum
+    power[0] = std::norm(work[0]) * window_scale;
+    for ( int k = 1; k < n/2; k++ ) {
+        power[k] = 2.0 * std::norm(work[k]) * window_scale;
+    }
+    power[n/2] = std::norm(work[n/2]) * window_scale;
+}
@@ -0,0 +1,40 @@
+// a small radix-2 fft for computing the power spectrum of a block of
+// real valued samples.  All work buffers and twiddle factors are
+// allocated once in the constructor so compute_power() does no
+// allocation and can be called from a worker thread at a steady rate.
+
+#pragma once
+
+#include <complex>
+#include <vector>
+using std::complex;
+using std::vector;
+
+class AuraFFT {
+
+private:
+
+    int n;                      // transform size (power of two)
+    int log2n;
+    vector<float> window;       // hann window coefficients
+    float window_scale;         // 1 / (n * sum(w^2)) for parseval
+    vector< complex<float> > twiddle;
+    vector< complex<float> > work;
+    vector<int> bitrev;
+
+    void transform();
+
+public:
+
+    AuraFFT( int size );
+    ~AuraFFT();
+
+    inline int size() { return n; }
+
+    // Remove the mean, apply the hann window, transform, and write
+    // the one-sided power spectrum into power[0 .. n/2].  The output
+    // is scaled so that the sum over all bins equals the mean square
+    // of the (de-meaned) input; summing a range of bins therefore
+    // gives the mean square energy in that frequency band.
+    void compute_power( const float *input, float *power );
+};
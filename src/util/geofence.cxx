@@ -0,0 +1,362 @@
+// geofence.cxx - polygon fence zones: containment and distance to the
+//                boundary through a uniform grid over the edges
+//
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "geofence.hxx"
+
+static const int max_cells_per_axis = 512;
+
+// the containment reference point of each cell sits a little off the
+// center so fences drawn on round numbers don't run through it
+static const double ref_frac = 0.4142135623730950;
+
+
+// squared distance from p to the segment a-b
+static inline double seg_dist2( double px, double py,
+                                const FencePoint &a, const FencePoint &b )
+{
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double len2 = dx * dx + dy * dy;
+    double t = 0.0;
+    if ( len2 > 0.0 ) {
+        t = ((px - a.x) * dx + (py - a.y) * dy) / len2;
+        if ( t < 0.0 ) { t = 0.0; }
+        if ( t > 1.0 ) { t = 1.0; }
+    }
+    double ex = a.x + t * dx - px;
+    double ey = a.y + t * dy - py;
+    return ex * ex + ey * ey;
+}
+
+static inline double orient( const FencePoint &a, const FencePoint &b,
+                             double px, double py )
+{
+    return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+}
+
+// does segment a-b touch the box [x0,x1] x [y0,y1] (Liang-Barsky)
+static bool seg_box( const FencePoint &a, const FencePoint &b,
+                     double x0, double y0, double x1, double y1 )
+{
+    double t0 = 0.0, t1 = 1.0;
+    double d[2] = { b.x - a.x, b.y - a.y };
+    double lo[2] = { x0 - a.x, y0 - a.y };
+    double hi[2] = { x1 - a.x, y1 - a.y };
+    for ( int k = 0; k < 2; k++ ) {
+        if ( d[k] == 0.0 ) {
+            if ( lo[k] > 0.0 || hi[k] < 0.0 ) {
+                return false;
+            }
+            continue;
+        }
+        double ta = lo[k] / d[k];
+        double tb = hi[k] / d[k];
+        if ( ta > tb ) { std::swap( ta, tb ); }
+        if ( ta > t0 ) { t0 = ta; }
+        if ( tb < t1 ) { t1 = tb; }
+        if ( t0 > t1 ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+FenceZone::FenceZone():
+    include(true),
+    min_agl_m(-1.0e9),
+    max_agl_m(1.0e9),
+    x0(0.0), y0(0.0), cell(1.0),
+    nx(0), ny(0)
+{
+}
+
+FenceZone::~FenceZone() {
+}
+
+
+bool FenceZone::build( const vector<FencePoint> &poly ) {
+    verts = poly;
+    if ( verts.size() > 1 && verts.front().x == verts.back().x
+         && verts.front().y == verts.back().y )
+    {
+        verts.pop_back();
+    }
+    int n = verts.size();
+    if ( n < 3 ) {
+        nx = ny = 0;
+        return false;
+    }
+
+    double xmin = verts[0].x, xmax = xmin;
+    double ymin = verts[0].y, ymax = ymin;
+    for ( int k = 1; k < n; k++ ) {
+        xmin = std::min( xmin, verts[k].x );
+        xmax = std::max( xmax, verts[k].x );
+        ymin = std::min( ymin, verts[k].y );
+        ymax = std::max( ymax, verts[k].y );
+    }
+
+    // about one cell per edge, square cells
+    double w = std::max( xmax - xmin, 1.0 );
+    double h = std::max( ymax - ymin, 1.0 );
+    cell = sqrt( w * h / n );
+    cell = std::max( cell, std::max(w, h) / max_cells_per_axis );
+    nx = std::min( (int)(w / cell) + 1, max_cells_per_axis );
+    ny = std::min( (int)(h / cell) + 1, max_cells_per_axis );
+    x0 = xmin - 0.5 * (nx * cell - (xmax - xmin));
+    y0 = ymin - 0.5 * (ny * cell - (ymax - ymin));
+    int cells = nx * ny;
+
+    // edges per cell (two passes into one flat array)
+    vector<int> count( cells, 0 );
+    for ( int pass = 0; pass < 2; pass++ ) {
+        for ( int k = 0; k < n; k++ ) {
+            const FencePoint &a = verts[k];
+            const FencePoint &b = verts[(k + 1) % n];
+            int i0 = std::max( (int)floor((std::min(a.x, b.x) - x0) / cell), 0 );
+            int i1 = std::min( (int)floor((std::max(a.x, b.x) - x0) / cell), nx - 1 );
+            int j0 = std::max( (int)floor((std::min(a.y, b.y) - y0) / cell), 0 );
+            int j1 = std::min( (int)floor((std::max(a.y, b.y) - y0) / cell), ny - 1 );
+            for ( int j = j0; j <= j1; j++ ) {
+                for ( int i = i0; i <= i1; i++ ) {
+                    double bx = x0 + i * cell;
+                    double by = y0 + j * cell;
+                    if ( !seg_box(a, b, bx, by, bx + cell, by + cell) ) {
+                        continue;
+                    }
+                    int c = cell_index( i, j );
+                    if ( pass == 0 ) {
+                        count[c]++;
+                    } else {
+                        cell_edges[cell_start[c] + count[c]++] = k;
+                    }
+                }
+            }
+        }
+        if ( pass == 0 ) {
+            cell_start.resize( cells + 1 );
+            cell_start[0] = 0;
+            for ( int c = 0; c < cells; c++ ) {
+                cell_start[c + 1] = cell_start[c] + count[c];
+            }
+            cell_edges.resize( cell_start[cells] );
+            std::fill( count.begin(), count.end(), 0 );
+        }
+    }
+
+    // inside state of the cell reference points, one scanline per row
+    ref_inside.assign( cells, 0 );
+    vector<double> xs;
+    for ( int j = 0; j < ny; j++ ) {
+        double y = y0 + (j + ref_frac) * cell;
+        xs.clear();
+        for ( int k = 0; k < n; k++ ) {
+            const FencePoint &a = verts[k];
+            const FencePoint &b = verts[(k + 1) % n];
+            if ( (a.y > y) != (b.y > y) ) {
+                xs.push_back( a.x + (y - a.y) * (b.x - a.x) / (b.y - a.y) );
+            }
+        }
+        std::sort( xs.begin(), xs.end() );
+        unsigned int m = 0;
+        for ( int i = 0; i < nx; i++ ) {
+            double x = x0 + (i + ref_frac) * cell;
+            while ( m < xs.size() && xs[m] < x ) {
+                m++;
+            }
+            ref_inside[cell_index(i, j)] = m & 1;
+        }
+    }
+
+    // rings out to the nearest cell holding an edge (two pass
+    // chessboard distance transform)
+    const unsigned short far = 0xffff;
+    ring_min.assign( cells, far );
+    for ( int c = 0; c < cells; c++ ) {
+        if ( cell_start[c + 1] > cell_start[c] ) {
+            ring_min[c] = 0;
+        }
+    }
+    for ( int j = 0; j < ny; j++ ) {
+        for ( int i = 0; i < nx; i++ ) {
+            unsigned short &r = ring_min[cell_index(i, j)];
+            for ( int dj = -1; dj <= 0; dj++ ) {
+                for ( int di = -1; di <= 1; di++ ) {
+                    if ( dj == 0 && di >= 0 ) { break; }
+                    int ii = i + di, jj = j + dj;
+                    if ( ii < 0 || ii >= nx || jj < 0 ) { continue; }
+                    unsigned short q = ring_min[cell_index(ii, jj)];
+                    if ( q != far && q + 1 < r ) { r = q + 1; }
+                }
+            }
+        }
+    }
+    for ( int j = ny - 1; j >= 0; j-- ) {
+        for ( int i = nx - 1; i >= 0; i-- ) {
+            unsigned short &r = ring_min[cell_index(i, j)];
+            for ( int dj = 1; dj >= 0; dj-- ) {
+                for ( int di = 1; di >= -1; di-- ) {
+                    if ( dj == 0 && di <= 0 ) { break; }
+                    int ii = i + di, jj = j + dj;
+                    if ( ii < 0 || ii >= nx || jj >= ny ) { continue; }
+                    unsigned short q = ring_min[cell_index(ii, jj)];
+                    if ( q != far && q + 1 < r ) { r = q + 1; }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+void FenceZone::scan_cell( int c, double x, double y, double *best_d2 ) const {
+    int n = verts.size();
+    for ( int e = cell_start[c]; e < cell_start[c + 1]; e++ ) {
+        int k = cell_edges[e];
+        double d2 = seg_dist2( x, y, verts[k], verts[(k + 1) % n] );
+        if ( d2 < *best_d2 ) {
+            *best_d2 = d2;
+        }
+    }
+}
+
+
+bool FenceZone::query( double x, double y, double *dist_m ) const {
+    if ( nx == 0 ) {
+        *dist_m = 0.0;
+        return false;
+    }
+    int n = verts.size();
+
+    int ci = (int)floor( (x - x0) / cell );
+    int cj = (int)floor( (y - y0) / cell );
+    bool in_grid = ci >= 0 && ci < nx && cj >= 0 && cj < ny;
+    ci = std::min( std::max(ci, 0), nx - 1 );
+    cj = std::min( std::max(cj, 0), ny - 1 );
+    int c = cell_index( ci, cj );
+
+    // containment: from the cell reference point to the point only
+    // the edges of this cell can be crossed
+    bool inside = false;
+    if ( in_grid ) {
+        inside = ref_inside[c];
+        double cx = x0 + (ci + ref_frac) * cell;
+        double cy = y0 + (cj + ref_frac) * cell;
+        FencePoint p = { x, y };
+        FencePoint q = { cx, cy };
+        for ( int e = cell_start[c]; e < cell_start[c + 1]; e++ ) {
+            const FencePoint &a = verts[cell_edges[e]];
+            const FencePoint &b = verts[(cell_edges[e] + 1) % n];
+            // half open on the segment side so a vertex exactly on
+            // the reference-point line is counted once
+            if ( (orient(p, q, a.x, a.y) > 0.0) != (orient(p, q, b.x, b.y) > 0.0)
+                 && orient(a, b, x, y) * orient(a, b, cx, cy) < 0.0 )
+            {
+                inside = !inside;
+            }
+        }
+    }
+
+    // nearest edge: ring k around the cell is at least (k-1) cells
+    // away from any point in (or clamped onto) the cell
+    double best_d2 = 1.0e300;
+    int max_ring = std::max( nx, ny );
+    for ( int k = ring_min[c]; k <= max_ring; k++ ) {
+        double lower = (k - 1) * cell;
+        if ( lower > 0.0 && lower * lower >= best_d2 ) {
+            break;
+        }
+        if ( k == 0 ) {
+            scan_cell( c, x, y, &best_d2 );
+            continue;
+        }
+        int i0 = std::max( ci - k, 0 ), i1 = std::min( ci + k, nx - 1 );
+        int j0 = std::max( cj - k, 0 ), j1 = std::min( cj + k, ny - 1 );
+        if ( cj - k >= 0 ) {
+            for ( int i = i0; i <= i1; i++ ) {
+                scan_cell( cell_index(i, cj - k), x, y, &best_d2 );
+            }
+        }
+        if ( cj + k < ny ) {
+            for ( int i = i0; i <= i1; i++ ) {
+                scan_cell( cell_index(i, cj + k), x, y, &best_d2 );
+            }
+        }
+        int jj0 = std::max( cj - k + 1, j0 ), jj1 = std::min( cj + k - 1, j1 );
+        if ( ci - k >= 0 ) {
+            for ( int j = jj0; j <= jj1; j++ ) {
+                scan_cell( cell_index(ci - k, j), x, y, &best_d2 );
+            }
+        }
+        if ( ci + k < nx ) {
+            for ( int j = jj0; j <= jj1; j++ ) {
+                scan_cell( cell_index(ci + k, j), x, y, &best_d2 );
+            }
+        }
+    }
+    *dist_m = sqrt( best_d2 );
+    return inside;
+}
+
+
+bool GeoFence::add_zone( const string &name, bool include,
+                         const vector<FencePoint> &poly,
+                         double min_agl_m, double max_agl_m )
+{
+    FenceZone z;
+    if ( !z.build(poly) ) {
+        return false;
+    }
+    z.name = name;
+    z.include = include;
+    z.min_agl_m = min_agl_m;
+    z.max_agl_m = max_agl_m;
+    zones.push_back( z );
+    return true;
+}
+
+
+FenceStatus GeoFence::check( double x, double y, double agl_m ) const {
+    FenceStatus s;
+    s.breach = false;
+    s.zone = -1;
+    s.margin_m = 1.0e9;
+
+    // best inclusion zone (largest margin) and worst exclusion zone
+    int incl = -1;
+    double incl_margin = -1.0e9;
+    for ( unsigned int i = 0; i < zones.size(); i++ ) {
+        const FenceZone &z = zones[i];
+        double dist;
+        bool in = z.query( x, y, &dist );
+        double horiz = in ? dist : -dist;
+        double band = std::min( agl_m - z.min_agl_m, z.max_agl_m - agl_m );
+        if ( z.include ) {
+            // must be inside and in the band
+            double m = std::min( horiz, band );
+            if ( incl < 0 || m > incl_margin ) {
+                incl = i;
+                incl_margin = m;
+            }
+        } else {
+            // safe while outside or above/below the band
+            double m = std::max( -horiz, -band );
+            if ( m < s.margin_m ) {
+                s.margin_m = m;
+                s.zone = i;
+            }
+        }
+    }
+    if ( incl >= 0 && incl_margin < s.margin_m ) {
+        s.margin_m = incl_margin;
+        s.zone = incl;
+    }
+    s.breach = s.zone >= 0 && s.margin_m < 0.0;
+    return s;
+}
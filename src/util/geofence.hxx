@@ -0,0 +1,100 @@
+// geofence.hxx - polygon fence zones: containment and distance to the
+//                boundary through a uniform grid over the edges
+//
+// Zones are closed polygons in a local tangent frame (north/east
+// meters) with an optional altitude band.  Each zone lays a uniform
+// grid (about one cell per edge) over its bounding box and keeps:
+//
+//   - the edges that cross each cell
+//   - whether a reference point in each cell is inside the polygon
+//     (one scanline pass at build time)
+//   - how many rings of cells out the nearest cell with an edge is
+//     (a chessboard distance transform)
+//
+// Containment is the reference point's state flipped by every edge
+// of the cell that crosses the short segment from there to the
+// point.  The nearest edge is found by searching rings of cells outward,
+// starting at the first ring that has edges at all and stopping once
+// a ring can't hold anything closer.  Both only look at the edges
+// near the point, so a fence with thousands of vertices costs about
+// as much as a small one.
+
+#pragma once
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+struct FencePoint {
+    double x;                   // north (m)
+    double y;                   // east (m)
+};
+
+class FenceZone {
+
+public:
+
+    FenceZone();
+    ~FenceZone();
+
+    // index a closed polygon (the last vertex joins back to the
+    // first), false for fewer than three vertices
+    bool build( const vector<FencePoint> &poly );
+
+    // true if x/y is inside the polygon, *dist_m is the distance to
+    // the nearest edge either way
+    bool query( double x, double y, double *dist_m ) const;
+
+    inline int size() const { return verts.size(); }
+
+    string name;
+    bool include;               // inclusion (stay in) or exclusion zone
+    double min_agl_m;           // altitude band the zone applies to
+    double max_agl_m;
+
+private:
+
+    inline int cell_index( int i, int j ) const { return j * nx + i; }
+    void scan_cell( int c, double x, double y, double *best_d2 ) const;
+
+    vector<FencePoint> verts;
+
+    double x0, y0;              // grid origin (min corner)
+    double cell;                // cell size (m)
+    int nx, ny;
+
+    vector<int> cell_start;     // edges of cell c: cell_edges[start[c]..start[c+1])
+    vector<int> cell_edges;
+    vector<unsigned char> ref_inside;
+    vector<unsigned short> ring_min;
+};
+
+// the result of checking a position against all the zones
+struct FenceStatus {
+    bool breach;
+    int zone;                   // limiting zone, -1 when there are none
+    double margin_m;            // signed distance to the nearest fence
+                                // limit (horizontal or vertical),
+                                // negative in breach
+};
+
+class GeoFence {
+
+public:
+
+    GeoFence() {}
+    ~GeoFence() {}
+
+    void clear() { zones.clear(); }
+    bool add_zone( const string &name, bool include,
+                   const vector<FencePoint> &poly,
+                   double min_agl_m, double max_agl_m );
+
+    // Allowed space is inside at least one inclusion zone (when any
+    // exist) and within its altitude band, and outside every
+    // exclusion zone whose band contains the aircraft.
+    FenceStatus check( double x, double y, double agl_m ) const;
+
+    vector<FenceZone> zones;
+};
@@ -0,0 +1,95 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "geofence.hxx"
+
+// the answer the grid index has to reproduce: test every edge
+static bool brute( const vector<FencePoint> &poly, double x, double y,
+                   double *dist_m )
+{
+    int n = poly.size();
+    bool inside = false;
+    double best = 1.0e300;
+    for ( int k = 0; k < n; k++ ) {
+        const FencePoint &a = poly[k];
+        const FencePoint &b = poly[(k + 1) % n];
+        if ( (a.y > y) != (b.y > y)
+             && x < a.x + (y - a.y) * (b.x - a.x) / (b.y - a.y) )
+        {
+            inside = !inside;
+        }
+        double dx = b.x - a.x, dy = b.y - a.y;
+        double t = ((x - a.x) * dx + (y - a.y) * dy) / (dx * dx + dy * dy);
+        if ( t < 0.0 ) { t = 0.0; }
+        if ( t > 1.0 ) { t = 1.0; }
+        double ex = a.x + t * dx - x, ey = a.y + t * dy - y;
+        double d2 = ex * ex + ey * ey;
+        if ( d2 < best ) {
+            best = d2;
+        }
+    }
+    *dist_m = sqrt( best );
+    return inside;
+}
+
+int main() {
+    // ~5 km radius with 200 spikes, 5000 vertices
+    int n = 5000;
+    vector<FencePoint> poly( n );
+    for ( int i = 0; i < n; i++ ) {
+        double a = 2.0 * M_PI * i / n;
+        double r = 5000.0 + 800.0 * sin( 200.0 * a ) + 50.0 * cos( 37.0 * a );
+        poly[i].x = r * cos( a );
+        poly[i].y = r * sin( a );
+    }
+
+    GeoFence fence;
+    fence.add_zone( "field", true, poly, 10.0, 120.0 );
+
+    // a grid of points over the whole fence and some way past it, at
+    // a spacing that doesn't line up with the spikes
+    int queries = 0, mismatch = 0;
+    double max_err = 0.0;
+    for ( double x = -6500.0; x < 6500.0; x += 41.3 ) {
+        for ( double y = -6500.0; y < 6500.0; y += 43.7 ) {
+            double d1, d2;
+            bool in1 = fence.zones[0].query( x, y, &d1 );
+            bool in2 = brute( poly, x, y, &d2 );
+            if ( in1 != in2 ) {
+                mismatch++;
+            }
+            if ( fabs(d1 - d2) > max_err ) {
+                max_err = fabs( d1 - d2 );
+            }
+            queries++;
+        }
+    }
+
+    // altitude band and breach reporting
+    FenceStatus ok = fence.check( 0.0, 0.0, 60.0 );
+    FenceStatus high = fence.check( 0.0, 0.0, 130.0 );
+    FenceStatus out = fence.check( 7000.0, 0.0, 60.0 );
+    fence.add_zone( "tower", false,
+                    { {-100.0, -100.0}, {100.0, -100.0},
+                      {100.0, 100.0}, {-100.0, 100.0} },
+                    -1.0e9, 1.0e9 );
+    FenceStatus tower = fence.check( 0.0, 50.0, 60.0 );
+
+    printf("mismatches = %d / %d  max distance error = %.6f m\n",
+           mismatch, queries, max_err);
+    printf("inside ok = %d  above band = %d  outside = %d  exclusion = %d (%s)\n",
+           !ok.breach, high.breach, out.breach, tower.breach,
+           tower.zone >= 0 ? fence.zones[tower.zone].name.c_str() : "");
+
+    if ( mismatch > 0 || max_err > 1.0e-6 ) {
+        return 1;
+    }
+    if ( ok.breach || !high.breach || !out.breach ) {
+        return 2;
+    }
+    if ( !tower.breach || tower.zone != 1 ) {
+        return 3;
+    }
+    return 0;
+}
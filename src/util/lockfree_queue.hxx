@@ -0,0 +1,64 @@
+// a fixed size, lock free, single producer / single consumer queue.
+//
+// One thread may call push() and exactly one other thread may call
+// pop().  Neither side ever blocks or allocates: push() returns false
+// when the queue is full (the caller decides whether to count/drop)
+// and pop() returns false when the queue is empty.  Capacity must be
+// a power of two.
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+template <class T, unsigned int SIZE>
+class LockFreeQueue {
+
+    static_assert( SIZE >= 2 && (SIZE & (SIZE - 1)) == 0,
+                   "LockFreeQueue size must be a power of two" );
+
+private:
+
+    T buf[SIZE];
+
+    // head is only written by the consumer, tail only by the producer
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+
+public:
+
+    LockFreeQueue(): head(0), tail(0) {}
+    ~LockFreeQueue() {}
+
+    // producer side
+    inline bool push( const T &item ) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if ( t - head.load(std::memory_order_acquire) >= SIZE ) {
+            return false;
+        }
+        buf[t & (SIZE - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side
+    inline bool pop( T *item ) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if ( h == tail.load(std::memory_order_acquire) ) {
+            return false;
+        }
+        *item = buf[h & (SIZE - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // approximate when called from either side
+    inline unsigned int size() const {
+        return tail.load(std::memory_order_acquire)
+            - head.load(std::memory_order_acquire);
+    }
+
+    inline unsigned int capacity() const {
+        return SIZE;
+    }
+};
@@ -0,0 +1,207 @@
+// magcache.cxx - lazily filled lat/lon grid of WMM field vectors
+//
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "coremag.h"
+#include "magcache.hxx"
+
+// cells of margin to queue around the aircraft, and how far away
+// (in cells) a node may be before it is dropped
+static const int prefetch_cells = 1;
+static const int keep_cells = 4;
+
+
+MagCache::MagCache( double spacing_deg ):
+    spacing_deg(spacing_deg),
+    jd(0),
+    cell_lat(0),
+    cell_lon(0),
+    cell_ready(false),
+    pending(0),
+    running(false)
+{
+}
+
+MagCache::~MagCache() {
+    stop();
+}
+
+
+void MagCache::start( long jd ) {
+    stop();
+    this->jd = jd;
+    nodes.clear();
+    cell_ready = false;
+    pending = 0;
+    running = true;
+    worker = std::thread( &MagCache::worker_main, this );
+}
+
+void MagCache::stop() {
+    if ( worker.joinable() ) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            running = false;
+        }
+        cond.notify_one();
+        worker.join();
+    }
+    // anything still queued belongs to the old date
+    node_t n;
+    while ( request_queue.pop(&n) );
+    while ( result_queue.pop(&n) );
+}
+
+
+Vector3d MagCache::calc_field( double lat_rad, double lon_rad,
+                               double alt_m, long jd )
+{
+    double field[6];
+    calc_magvar( lat_rad, lon_rad, alt_m / 1000.0, jd, field );
+    return Vector3d( field[3], field[4], field[5] );
+}
+
+
+void MagCache::worker_main() {
+    node_t n;
+    while ( running ) {
+        if ( !request_queue.pop(&n) ) {
+            std::unique_lock<std::mutex> guard(lock);
+            cond.wait( guard, [this] {
+                    return !running || request_queue.size() > 0;
+                } );
+            continue;
+        }
+        double lat_deg = n.ilat * spacing_deg;
+        if ( lat_deg > 90.0 ) { lat_deg = 90.0; }
+        if ( lat_deg < -90.0 ) { lat_deg = -90.0; }
+        double lon_deg = n.ilon * spacing_deg;
+        Vector3d f = calc_field( lat_deg * M_PI / 180.0,
+                                 lon_deg * M_PI / 180.0, n.alt_m, jd );
+        n.ned[0] = f(0); n.ned[1] = f(1); n.ned[2] = f(2);
+        result_queue.push(n);
+    }
+}
+
+
+// queue a node unless it is already known (ready or in flight),
+// true if it was queued
+bool MagCache::request( int32_t ilat, int32_t ilon, double alt_m ) {
+    int64_t k = key(ilat, ilon);
+    if ( nodes.find(k) != nodes.end() ) {
+        return false;
+    }
+    if ( pending >= (int)result_queue.capacity() ) {
+        return false;
+    }
+    node_t n;
+    n.ilat = ilat;
+    n.ilon = ilon;
+    n.alt_m = alt_m;
+    if ( !request_queue.push(n) ) {
+        // asked for again next call
+        return false;
+    }
+    entry_t &e = nodes[k];
+    e.ready = false;
+    e.ned.setZero();
+    pending++;
+    return true;
+}
+
+
+// a node if it has been evaluated, otherwise NULL
+const MagCache::entry_t *MagCache::ready( int32_t ilat, int32_t ilon ) {
+    std::map<int64_t, entry_t>::const_iterator it
+        = nodes.find( key(ilat, ilon) );
+    if ( it == nodes.end() || !it->second.ready ) {
+        return NULL;
+    }
+    return &it->second;
+}
+
+
+// drop nodes far from the current cell once the table grows
+void MagCache::evict( int32_t ilat, int32_t ilon ) {
+    int side = 2 * (keep_cells + 1);
+    if ( (int)nodes.size() <= side * side ) {
+        return;
+    }
+    std::map<int64_t, entry_t>::iterator it = nodes.begin();
+    while ( it != nodes.end() ) {
+        int32_t nlat = (int32_t)(it->first >> 32);
+        int32_t nlon = (int32_t)(uint32_t)(it->first & 0xffffffff);
+        if ( it->second.ready
+             && (abs(nlat - ilat) > keep_cells
+                 || abs(nlon - ilon) > keep_cells) )
+        {
+            nodes.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+
+bool MagCache::get_field( double lat_rad, double lon_rad, double alt_m,
+                          Vector3d *field )
+{
+    if ( !running ) {
+        return false;
+    }
+
+    // collect finished nodes
+    node_t n;
+    while ( result_queue.pop(&n) ) {
+        entry_t &e = nodes[key(n.ilat, n.ilon)];
+        e.ready = true;
+        e.ned = Vector3d( n.ned[0], n.ned[1], n.ned[2] );
+        pending--;
+    }
+
+    double lat = lat_rad * 180.0 / M_PI / spacing_deg;
+    double lon = lon_rad * 180.0 / M_PI / spacing_deg;
+    int32_t ilat = (int32_t)floor(lat);
+    int32_t ilon = (int32_t)floor(lon);
+    double u = lat - ilat;
+    double v = lon - ilon;
+
+    if ( ilat != cell_lat || ilon != cell_lon || !cell_ready ) {
+        // entered a new cell (or still waiting on this one): queue
+        // the cell itself first, then the margin around it
+        cell_lat = ilat;
+        cell_lon = ilon;
+        bool queued = request( ilat, ilon, alt_m );
+        queued |= request( ilat + 1, ilon, alt_m );
+        queued |= request( ilat, ilon + 1, alt_m );
+        queued |= request( ilat + 1, ilon + 1, alt_m );
+        for ( int i = -prefetch_cells; i <= prefetch_cells + 1; i++ ) {
+            for ( int j = -prefetch_cells; j <= prefetch_cells + 1; j++ ) {
+                queued |= request( ilat + i, ilon + j, alt_m );
+            }
+        }
+        if ( queued ) {
+            // (taking the lock orders the pushes against the worker's
+            // check, so the wakeup can't be lost)
+            { std::lock_guard<std::mutex> guard(lock); }
+            cond.notify_one();
+        }
+        evict( ilat, ilon );
+
+        const entry_t *n00 = ready( ilat, ilon );
+        const entry_t *n10 = ready( ilat + 1, ilon );
+        const entry_t *n01 = ready( ilat, ilon + 1 );
+        const entry_t *n11 = ready( ilat + 1, ilon + 1 );
+        cell_ready = n00 && n10 && n01 && n11;
+        if ( !cell_ready ) {
+            return false;
+        }
+        c00 = n00->ned; c10 = n10->ned; c01 = n01->ned; c11 = n11->ned;
+    }
+
+    *field = (1.0 - u) * ((1.0 - v) * c00 + v * c01)
+        + u * ((1.0 - v) * c10 + v * c11);
+    return true;
+}
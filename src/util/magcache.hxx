@@ -0,0 +1,97 @@
+// magcache.hxx - lazily filled lat/lon grid of WMM field vectors
+//
+// calc_magvar() sums the degree 12 spherical harmonic model, far too
+// much to run every frame.  The main field changes over hundreds of
+// km, so this keeps the ned field vector at the nodes of a regular
+// lat/lon grid and bilinearly interpolates between the four nodes
+// around the aircraft.  Nodes are evaluated by a worker thread: as
+// the aircraft moves, the cell under it and the cells around it are
+// queued, so a lookup never runs the model itself.  Nodes well away
+// from the aircraft are dropped again.
+//
+// The altitude dependence is a fraction of a percent per km and
+// barely turns the field, a node keeps the altitude it was first
+// evaluated at.
+//
+// get_field() must always be called from the same thread.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
+
+#include <eigen3/Eigen/Core>
+using namespace Eigen;
+
+#include "lockfree_queue.hxx"
+
+class MagCache {
+
+public:
+
+    MagCache( double spacing_deg = 0.5 );
+    ~MagCache();
+
+    // start the worker, jd: date (julian days) to evaluate the
+    // model for
+    void start( long jd );
+    void stop();
+
+    // interpolated ned field vector (nT) at lat/lon (rad), alt (m).
+    // Returns false (and leaves *field alone) until the worker has
+    // filled the surrounding cell.
+    bool get_field( double lat_rad, double lon_rad, double alt_m,
+                    Vector3d *field );
+
+    // evaluate the model directly (blocks for the full sum)
+    static Vector3d calc_field( double lat_rad, double lon_rad,
+                                double alt_m, long jd );
+
+private:
+
+    struct node_t {
+        int32_t ilat, ilon;     // grid indices
+        double alt_m;
+        double ned[3];
+    };
+
+    struct entry_t {
+        bool ready;
+        Vector3d ned;
+    };
+
+    static inline int64_t key( int32_t ilat, int32_t ilon ) {
+        return ((int64_t)ilat << 32) | (uint32_t)ilon;
+    }
+
+    bool request( int32_t ilat, int32_t ilon, double alt_m );
+    const entry_t *ready( int32_t ilat, int32_t ilon );
+    void evict( int32_t ilat, int32_t ilon );
+    void worker_main();
+
+    double spacing_deg;
+    long jd;
+
+    // main thread only
+    std::map<int64_t, entry_t> nodes;
+    int32_t cell_lat, cell_lon;  // current cell and its corners
+    bool cell_ready;
+    Vector3d c00, c10, c01, c11;
+    int pending;                 // requested, result not collected yet
+
+    // main thread -> worker (requests), worker -> main thread
+    // (results).  At most result_queue.capacity() requests are ever
+    // pending, so the worker's push of a result can't fail.
+    LockFreeQueue<node_t, 64> request_queue;
+    LockFreeQueue<node_t, 64> result_queue;
+
+    // the worker sleeps here while there are no requests
+    std::thread worker;
+    std::atomic<bool> running;
+    std::mutex lock;
+    std::condition_variable cond;
+};
@@ -0,0 +1,55 @@
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "coremag.h"
+#include "magcache.hxx"
+
+int main() {
+    const double d2r = M_PI / 180.0;
+    long jd = yymmdd_to_julian_days(18, 6, 1);
+
+    MagCache cache(0.5);
+    cache.start(jd);
+
+    // fly ~1800 km north east from the upper midwest, each step
+    // standing in for a frame (so the flight runs ~2000x real time)
+    // and compare the cached field direction to the full model
+    double lat = 44.0, lon = -94.0, alt = 1500.0;
+    int steps = 20000, hits = 0, late = 0;
+    double max_err = 0.0;
+    Vector3d field;
+    for ( int i = 0; i < steps; i++ ) {
+        lat += 0.0006;
+        lon += 0.0008;
+        if ( cache.get_field( lat * d2r, lon * d2r, alt, &field ) ) {
+            hits++;
+            Vector3d truth = MagCache::calc_field( lat * d2r, lon * d2r,
+                                                   alt, jd );
+            double c = field.normalized().dot( truth.normalized() );
+            double err = acos( c > 1.0 ? 1.0 : c ) / d2r;
+            if ( err > max_err ) {
+                max_err = err;
+            }
+        } else if ( hits ) {
+            // the prefetch should stay ahead once the first cell is in
+            late++;
+        }
+        usleep(50);
+    }
+    cache.stop();
+
+    printf("cache hits = %d / %d (late = %d)  max direction error = %.4f deg\n",
+           hits, steps, late, max_err);
+
+    int errors = 0;
+    if ( late > steps / 100 ) {
+        printf("prefetch fell behind the aircraft\n");
+        errors++;
+    }
+    if ( max_err > 0.05 ) {
+        printf("interpolated field direction is off\n");
+        errors++;
+    }
+    return errors;
+}
@@ -0,0 +1,216 @@
+#include <errno.h>		// errno
+#include <stdio.h>		// printf() et. al.
+#include <string.h>		// memset(), strerror()
+#include <sys/epoll.h>		// epoll_create1() et. al.
+#include <sys/syscall.h>	// syscall()
+#include <sys/timerfd.h>	// timerfd_create() et. al.
+#include <unistd.h>		// close(), syscall()
+
+#include "timing.h"
+
+#include "reactor.hxx"
+
+static const int max_events = 16;
+
+
+Reactor::Reactor():
+    wakeups(0),
+    dispatches(0),
+    timeouts(0),
+    epfd(-1),
+    timer_fd(-1),
+    sync_fd(-1),
+    use_pwait2(true)
+{
+}
+
+Reactor::~Reactor() {
+    if ( timer_fd >= 0 ) {
+        close(timer_fd);
+    }
+    if ( epfd >= 0 ) {
+        close(epfd);
+    }
+}
+
+
+bool Reactor::init() {
+    epfd = epoll_create1( EPOLL_CLOEXEC );
+    if ( epfd < 0 ) {
+        fprintf( stderr, "reactor: epoll_create1() failed - %s\n",
+                 strerror(errno) );
+        return false;
+    }
+
+    // fallback deadline timer for kernels without epoll_pwait2()
+    timer_fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+    if ( timer_fd < 0 ) {
+        fprintf( stderr, "reactor: timerfd_create() failed - %s\n",
+                 strerror(errno) );
+        close(epfd);
+        epfd = -1;
+        return false;
+    }
+    struct epoll_event ev;
+    memset( &ev, 0, sizeof(ev) );
+    ev.events = EPOLLIN;
+    ev.data.fd = timer_fd;
+    epoll_ctl( epfd, EPOLL_CTL_ADD, timer_fd, &ev );
+
+    return true;
+}
+
+
+bool Reactor::add( int fd, reactor_func func, void *arg, const char *name ) {
+    if ( epfd < 0 || fd < 0 ) {
+        return false;
+    }
+    struct epoll_event ev;
+    memset( &ev, 0, sizeof(ev) );
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if ( epoll_ctl( epfd, EPOLL_CTL_ADD, fd, &ev ) < 0 ) {
+        fprintf( stderr, "reactor: cannot add %s - %s\n", name,
+                 strerror(errno) );
+        return false;
+    }
+    handler h;
+    h.func = func;
+    h.arg = arg;
+    h.name = name;
+    handlers[fd] = h;
+    return true;
+}
+
+
+void Reactor::remove( int fd ) {
+    if ( epfd < 0 || fd < 0 ) {
+        return;
+    }
+    epoll_ctl( epfd, EPOLL_CTL_DEL, fd, NULL );
+    handlers.erase(fd);
+    if ( fd == sync_fd ) {
+        sync_fd = -1;
+    }
+}
+
+
+void Reactor::set_sync( int fd ) {
+    if ( epfd < 0 ) {
+        return;
+    }
+    if ( sync_fd >= 0 ) {
+        epoll_ctl( epfd, EPOLL_CTL_DEL, sync_fd, NULL );
+    }
+    sync_fd = fd;
+    if ( sync_fd >= 0 ) {
+        struct epoll_event ev;
+        memset( &ev, 0, sizeof(ev) );
+        ev.events = EPOLLIN;
+        ev.data.fd = sync_fd;
+        if ( epoll_ctl( epfd, EPOLL_CTL_ADD, sync_fd, &ev ) < 0 ) {
+            fprintf( stderr, "reactor: cannot add sync source - %s\n",
+                     strerror(errno) );
+            sync_fd = -1;
+        }
+    }
+}
+
+
+// one epoll wait bounded by the deadline
+int Reactor::wait_events( struct epoll_event *events, double deadline,
+                          bool *timer_armed )
+{
+    double remaining = deadline - get_Time();
+    if ( remaining < 0.0 ) {
+        remaining = 0.0;
+    }
+
+#ifdef __NR_epoll_pwait2
+    if ( use_pwait2 ) {
+        // nanosecond timeout in a single call (linux 5.11+)
+        struct timespec ts;
+        ts.tv_sec = (time_t)remaining;
+        ts.tv_nsec = (remaining - ts.tv_sec) * 1000000000.0;
+        int n = syscall( __NR_epoll_pwait2, epfd, events, max_events, &ts,
+                         NULL, 0 );
+        if ( n >= 0 || errno != ENOSYS ) {
+            return n;
+        }
+        use_pwait2 = false;
+    }
+#endif
+
+    // otherwise the deadline is a timer in the epoll set (epoll_wait()
+    // only takes msec.)
+    if ( remaining <= 0.0 ) {
+        return epoll_wait( epfd, events, max_events, 0 );
+    }
+    if ( !*timer_armed ) {
+        struct itimerspec its;
+        memset( &its, 0, sizeof(its) );
+        its.it_value.tv_sec = (time_t)remaining;
+        its.it_value.tv_nsec = (remaining - its.it_value.tv_sec) * 1000000000.0;
+        if ( its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0 ) {
+            its.it_value.tv_nsec = 1;
+        }
+        timerfd_settime( timer_fd, 0, &its, NULL );
+        *timer_armed = true;
+    }
+    return epoll_wait( epfd, events, max_events, -1 );
+}
+
+
+bool Reactor::wait( double deadline ) {
+    if ( epfd < 0 ) {
+        return false;
+    }
+
+    struct epoll_event events[max_events];
+    bool timer_armed = false;
+    bool sync_ready = false;
+    bool expired = false;
+    while ( !sync_ready && !expired ) {
+        int n = wait_events( events, deadline, &timer_armed );
+        if ( n < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            fprintf( stderr, "reactor: epoll_wait() failed - %s\n",
+                     strerror(errno) );
+            break;
+        }
+        wakeups++;
+        if ( n == 0 ) {
+            expired = true;
+        }
+        for ( int i = 0; i < n; i++ ) {
+            int fd = events[i].data.fd;
+            if ( fd == timer_fd ) {
+                expired = true;
+            } else if ( fd == sync_fd ) {
+                sync_ready = true;
+            } else {
+                map<int, handler>::iterator it = handlers.find(fd);
+                if ( it != handlers.end() ) {
+                    dispatches++;
+                    it->second.func( fd, it->second.arg );
+                }
+            }
+        }
+    }
+
+    if ( !sync_ready ) {
+        timeouts++;
+    }
+
+    if ( timer_armed ) {
+        // disarm (this also clears any pending expiry) so a stale
+        // timer can't cut the next wait short
+        struct itimerspec its;
+        memset( &its, 0, sizeof(its) );
+        timerfd_settime( timer_fd, 0, &its, NULL );
+    }
+
+    return sync_ready;
+}
@@ -0,0 +1,67 @@
+// an epoll based event loop for the sensor and comm file descriptors.
+//
+// Drivers register their fd with a read callback.  The main loop
+// then sleeps in wait() until the sync source (the imu) has data or
+// the frame deadline passes, and every other device that becomes
+// readable in the meantime is dispatched to its callback.  Handlers
+// are level triggered, so a callback may consume as much or as little
+// as it likes; anything left over is dispatched again on the next
+// pass.  Everything runs on the main thread.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+using std::map;
+using std::string;
+
+struct epoll_event;
+
+typedef void (*reactor_func)( int fd, void *arg );
+
+class Reactor {
+
+public:
+
+    Reactor();
+    ~Reactor();
+
+    bool init();
+    inline bool is_open() { return epfd >= 0; }
+
+    // register/unregister a readable handler
+    bool add( int fd, reactor_func func, void *arg, const char *name );
+    void remove( int fd );
+
+    // the main loop sync source (no callback, wait() returns when it
+    // is readable.)  -1 for none.
+    void set_sync( int fd );
+
+    // dispatch handlers until the sync fd is readable (returns true)
+    // or the deadline (get_Time() seconds) passes (returns false.)
+    bool wait( double deadline );
+
+    // statistics
+    uint32_t wakeups;
+    uint32_t dispatches;
+    uint32_t timeouts;
+
+private:
+
+    struct handler {
+        reactor_func func;
+        void *arg;
+        string name;
+    };
+
+    int epfd;
+    int timer_fd;
+    int sync_fd;
+    bool use_pwait2;
+    map<int, handler> handlers;
+
+    int wait_events( struct epoll_event *events, double deadline,
+                     bool *timer_armed );
+};
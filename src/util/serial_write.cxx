@@ -0,0 +1,43 @@
+#include <errno.h>		// errno
+#include <poll.h>		// poll()
+#include <unistd.h>		// write()
+
+#include "serial_write.hxx"
+
+bool serial_write_frame( int fd, const uint8_t *frame, int size,
+                         uint32_t *short_writes, uint32_t *write_errors,
+                         int timeout_ms )
+{
+    int sent = 0;
+    bool split = false;
+    while ( sent < size ) {
+        int len = write( fd, frame + sent, size - sent );
+        if ( len < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            if ( (errno == EAGAIN || errno == EWOULDBLOCK) && sent > 0 ) {
+                // part of the frame is already out, wait for room
+                // rather than leave the far end mid frame
+                struct pollfd pfd;
+                pfd.fd = fd;
+                pfd.events = POLLOUT;
+                if ( poll( &pfd, 1, timeout_ms ) > 0 ) {
+                    continue;
+                }
+            }
+            // nothing sent yet (the frame is simply dropped), the
+            // device stayed blocked, or a real error
+            (*write_errors)++;
+            return false;
+        }
+        if ( len < size - sent ) {
+            split = true;
+        }
+        sent += len;
+    }
+    if ( split ) {
+        (*short_writes)++;
+    }
+    return true;
+}
@@ -0,0 +1,20 @@
+// whole frame writes to a serial device.
+//
+// A flight controller parser that sees half a frame has to throw it
+// away and resync, so a frame either goes out complete or (if none
+// of it could be written) not at all.  The frame is normally sent
+// with a single write(); a short write, EINTR, or EAGAIN after part
+// of it is out is finished off, waiting on poll() for the uart to
+// drain.  Only a device that stays blocked past the timeout (or a
+// real error) leaves a partial frame behind.
+
+#pragma once
+
+#include <stdint.h>
+
+// returns true when the whole frame was written.  *short_writes
+// counts frames that took more than one write(), *write_errors
+// frames that were dropped or cut off.
+bool serial_write_frame( int fd, const uint8_t *frame, int size,
+                         uint32_t *short_writes, uint32_t *write_errors,
+                         int timeout_ms = 20 );
@@ -0,0 +1,306 @@
+// survey_plan.cxx - lawnmower survey route generation for polygon
+//                   areas
+//
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "wgs84.hxx"
+
+#include "survey_plan.hxx"
+
+static const double d2r = M_PI / 180.0;
+static const double r2d = 180.0 / M_PI;
+
+// a polygon edge in the (u = cut, v = advance) frame, v0 < v1
+struct Edge {
+    double v0, v1;
+    double u0;                  // u at v0
+    double dudv;
+};
+
+static bool edge_less( const Edge &a, const Edge &b ) {
+    return a.v0 < b.v0;
+}
+
+// the part of one cut line inside the area
+struct Span {
+    double v;
+    double u0, u1;
+};
+
+// how a cell is flown: from its first or last line, starting at the
+// low or high u end
+struct CellPlan {
+    int cell;
+    bool reverse;
+    bool up;
+    double cost;
+};
+
+
+// cut the area, spans are returned in line order
+static void sweep( const vector<Edge> &edges, double vmin, double vmax,
+                   double step, vector< vector<Span> > *lines )
+{
+    vector<const Edge *> active;
+    vector<double> cuts;
+    unsigned int next = 0;
+    lines->clear();
+    for ( double v = vmin + step * 0.5; v < vmax; v += step ) {
+        // edges are active over [v0, v1) so a vertex is only counted
+        // once
+        while ( next < edges.size() && edges[next].v0 <= v ) {
+            active.push_back( &edges[next] );
+            next++;
+        }
+        cuts.clear();
+        for ( unsigned int i = 0; i < active.size(); ) {
+            const Edge *e = active[i];
+            if ( e->v1 <= v ) {
+                active[i] = active.back();
+                active.pop_back();
+                continue;
+            }
+            cuts.push_back( e->u0 + (v - e->v0) * e->dudv );
+            i++;
+        }
+        std::sort( cuts.begin(), cuts.end() );
+        lines->push_back( vector<Span>() );
+        vector<Span> &spans = lines->back();
+        for ( unsigned int i = 0; i + 1 < cuts.size(); i += 2 ) {
+            Span s = { v, cuts[i], cuts[i+1] };
+            spans.push_back( s );
+        }
+    }
+}
+
+
+// group the spans into cells, consecutive lines of a cell each have
+// exactly one span that only overlaps the other
+static void decompose( const vector< vector<Span> > &lines,
+                       vector< vector<Span> > *cells )
+{
+    vector<int> prev_cell;
+    vector<int> cur_cell;
+    cells->clear();
+    for ( unsigned int k = 0; k < lines.size(); k++ ) {
+        const vector<Span> &cur = lines[k];
+        cur_cell.assign( cur.size(), -1 );
+        if ( k > 0 ) {
+            const vector<Span> &prev = lines[k-1];
+            vector<int> prev_hits( prev.size(), 0 );
+            vector<int> cur_hits( cur.size(), 0 );
+            vector<int> match( cur.size(), -1 );
+            for ( unsigned int j = 0; j < cur.size(); j++ ) {
+                for ( unsigned int i = 0; i < prev.size(); i++ ) {
+                    if ( prev[i].u0 <= cur[j].u1 && cur[j].u0 <= prev[i].u1 ) {
+                        prev_hits[i]++;
+                        cur_hits[j]++;
+                        match[j] = i;
+                    }
+                }
+            }
+            for ( unsigned int j = 0; j < cur.size(); j++ ) {
+                if ( cur_hits[j] == 1 && prev_hits[match[j]] == 1 ) {
+                    cur_cell[j] = prev_cell[match[j]];
+                }
+            }
+        }
+        for ( unsigned int j = 0; j < cur.size(); j++ ) {
+            if ( cur_cell[j] < 0 ) {
+                cur_cell[j] = cells->size();
+                cells->push_back( vector<Span>() );
+            }
+            (*cells)[cur_cell[j]].push_back( cur[j] );
+        }
+        prev_cell.swap( cur_cell );
+    }
+}
+
+
+// the route through a cell flown as 'plan', in (u, v)
+static void fly_cell( const vector<Span> &cell, bool reverse, bool up,
+                      double extend, vector<SurveyPoint> *route )
+{
+    int n = cell.size();
+    for ( int t = 0; t < n; t++ ) {
+        int i = reverse ? n - 1 - t : t;
+        const Span &s = cell[i];
+        const Span *prev = t > 0 ? &cell[reverse ? i + 1 : i - 1] : &s;
+        const Span *next = t < n - 1 ? &cell[reverse ? i - 1 : i + 1] : &s;
+        double start, end;
+        if ( up ) {
+            start = std::min( s.u0, prev->u0 ) - extend;
+            end = std::max( s.u1, next->u1 ) + extend;
+        } else {
+            start = std::max( s.u1, prev->u1 ) + extend;
+            end = std::min( s.u0, next->u0 ) - extend;
+        }
+        SurveyPoint p1 = { start, s.v };
+        SurveyPoint p2 = { end, s.v };
+        route->push_back( p1 );
+        route->push_back( p2 );
+        up = !up;
+    }
+}
+
+
+// heading change (rad) between two directions in the (u, v) plane
+static double turn_angle( double au, double av, double bu, double bv ) {
+    return fabs( atan2( au*bv - av*bu, au*bu + av*bv ) );
+}
+
+
+// turn cost of leaving 'exit' heading along u (exit_up) and starting
+// the first line of the next cell
+static double link_cost( const SurveyPoint &exit, bool exit_up,
+                         const SurveyPoint &entry, bool entry_up,
+                         double turn_radius )
+{
+    double du = entry.x - exit.x;
+    double dv = entry.y - exit.y;
+    double dist = sqrt( du*du + dv*dv );
+    double cost = dist;
+    if ( turn_radius > 0.0 && dist > 0.0 ) {
+        double h0 = exit_up ? 1.0 : -1.0;
+        double h1 = entry_up ? 1.0 : -1.0;
+        cost += turn_radius * ( turn_angle( h0, 0.0, du, dv )
+                                + turn_angle( du, dv, h1, 0.0 ) );
+    }
+    return cost;
+}
+
+
+vector<SurveyPoint> survey_plan_cart( const vector<SurveyPoint> &area,
+                                      double advance_deg, double step_m,
+                                      double extend_m,
+                                      double turn_radius_m )
+{
+    vector<SurveyPoint> route;
+    if ( area.size() < 3 || step_m <= 0.0 ) {
+        return route;
+    }
+
+    // advance (v) and cut (u) directions
+    double dx = sin( advance_deg * d2r );
+    double dy = cos( advance_deg * d2r );
+    double cx = -dy;
+    double cy = dx;
+
+    vector<Edge> edges;
+    edges.reserve( area.size() );
+    double vmin = 0.0, vmax = 0.0;
+    for ( unsigned int i = 0; i < area.size(); i++ ) {
+        const SurveyPoint &a = area[i];
+        const SurveyPoint &b = area[(i + 1) % area.size()];
+        double ua = a.x * cx + a.y * cy, va = a.x * dx + a.y * dy;
+        double ub = b.x * cx + b.y * cy, vb = b.x * dx + b.y * dy;
+        if ( i == 0 || va < vmin ) { vmin = va; }
+        if ( i == 0 || va > vmax ) { vmax = va; }
+        if ( va == vb ) {
+            // parallel to the cut lines, never crossed
+            continue;
+        }
+        Edge e;
+        if ( va < vb ) {
+            e.v0 = va; e.v1 = vb; e.u0 = ua;
+        } else {
+            e.v0 = vb; e.v1 = va; e.u0 = ub;
+        }
+        e.dudv = (ub - ua) / (vb - va);
+        edges.push_back( e );
+    }
+    std::sort( edges.begin(), edges.end(), edge_less );
+
+    vector< vector<Span> > lines;
+    sweep( edges, vmin, vmax, step_m, &lines );
+    vector< vector<Span> > cells;
+    decompose( lines, &cells );
+    if ( cells.empty() ) {
+        return route;
+    }
+
+    // chain the cells: start at the trailing edge (the first cell)
+    // flying towards +u, then repeatedly take the cheapest unvisited
+    // cell and entry
+    vector<bool> done( cells.size(), false );
+    CellPlan plan = { 0, false, true, 0.0 };
+    vector<SurveyPoint> cell_route;
+    for ( unsigned int n = 0; n < cells.size(); n++ ) {
+        done[plan.cell] = true;
+        cell_route.clear();
+        fly_cell( cells[plan.cell], plan.reverse, plan.up, extend_m,
+                  &cell_route );
+        route.insert( route.end(), cell_route.begin(), cell_route.end() );
+
+        SurveyPoint exit = route.back();
+        bool exit_up = (route.back().x > route[route.size()-2].x);
+        plan.cell = -1;
+        for ( unsigned int c = 0; c < cells.size(); c++ ) {
+            if ( done[c] ) {
+                continue;
+            }
+            for ( int option = 0; option < 4; option++ ) {
+                bool reverse = option & 1;
+                bool up = option & 2;
+                const Span &s = reverse ? cells[c].back() : cells[c].front();
+                SurveyPoint entry = { up ? s.u0 - extend_m : s.u1 + extend_m,
+                                      s.v };
+                double cost = link_cost( exit, exit_up, entry, up,
+                                         turn_radius_m );
+                if ( plan.cell < 0 || cost < plan.cost ) {
+                    plan.cell = c;
+                    plan.reverse = reverse;
+                    plan.up = up;
+                    plan.cost = cost;
+                }
+            }
+        }
+        if ( plan.cell < 0 ) {
+            break;
+        }
+    }
+
+    // back to x east, y north
+    for ( unsigned int i = 0; i < route.size(); i++ ) {
+        double u = route[i].x;
+        double v = route[i].y;
+        route[i].x = u * cx + v * dx;
+        route[i].y = u * cy + v * dy;
+    }
+    return route;
+}
+
+
+vector<SurveyPoint> survey_plan( const vector<SurveyPoint> &area,
+                                 double advance_deg, double step_m,
+                                 double extend_m, double turn_radius_m )
+{
+    vector<SurveyPoint> cart;
+    if ( area.empty() ) {
+        return cart;
+    }
+    const SurveyPoint &ref = area[0];
+    for ( unsigned int i = 0; i < area.size(); i++ ) {
+        double heading, reverse, dist;
+        geo_inverse_wgs_84( ref.y, ref.x, area[i].y, area[i].x,
+                            &heading, &reverse, &dist );
+        double angle = (90 - heading) * d2r;
+        SurveyPoint p = { cos(angle) * dist, sin(angle) * dist };
+        cart.push_back( p );
+    }
+
+    vector<SurveyPoint> route = survey_plan_cart( cart, advance_deg, step_m,
+                                                  extend_m, turn_radius_m );
+    for ( unsigned int i = 0; i < route.size(); i++ ) {
+        double heading = 90 - atan2( route[i].y, route[i].x ) * r2d;
+        double dist = sqrt( route[i].x*route[i].x + route[i].y*route[i].y );
+        double lat, lon, az2;
+        geo_direct_wgs_84( ref.y, ref.x, heading, dist, &lat, &lon, &az2 );
+        route[i].x = lon;
+        route[i].y = lat;
+    }
+    return route;
+}
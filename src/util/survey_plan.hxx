@@ -0,0 +1,38 @@
+// survey_plan.hxx - lawnmower survey route generation for polygon
+//                   areas
+//
+// The area is cut with parallel lines perpendicular to the advance
+// direction, spaced step_m apart and starting half a step in from
+// the trailing edge.  Line/edge crossings are found with a sweep over
+// the edges sorted along the advance direction, so each line only
+// visits the edges it actually crosses.  Concave areas produce
+// several spans on some lines; runs of spans that continue from line
+// to line become cells (a boustrophedon decomposition) that are each
+// flown back and forth.  Cells are chained greedily by a turn cost:
+// connecting distance plus turn_radius_m times the heading change
+// needed to get onto the next line.  Line ends are extended by
+// extend_m beyond the area (and out to the neighboring line at each
+// turn) to leave room to turn and line up.
+
+#pragma once
+
+#include <vector>
+using std::vector;
+
+struct SurveyPoint {
+    double x;
+    double y;
+};
+
+// area and result in local cartesian coordinates (x east, y north,
+// meters.)  advance_deg is the compass direction the lines advance in.
+vector<SurveyPoint> survey_plan_cart( const vector<SurveyPoint> &area,
+                                      double advance_deg, double step_m,
+                                      double extend_m,
+                                      double turn_radius_m );
+
+// area and result as geodetic points (x = lon_deg, y = lat_deg),
+// planned in a local cartesian frame about the first area vertex.
+vector<SurveyPoint> survey_plan( const vector<SurveyPoint> &area,
+                                 double advance_deg, double step_m,
+                                 double extend_m, double turn_radius_m );
@@ -0,0 +1,268 @@
+// terrain.cxx - elevation lookups from memory mapped DEM tiles
+//
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "terrain.hxx"
+
+
+string dem_tile_name( int lat, int lon ) {
+    char name[32];
+    snprintf( name, sizeof(name), "%c%02d%c%03d.dem",
+              lat >= 0 ? 'N' : 'S', lat >= 0 ? lat : -lat,
+              lon >= 0 ? 'E' : 'W', lon >= 0 ? lon : -lon );
+    return name;
+}
+
+
+bool dem_write_tile( const string &file, int lat, int lon, int posts,
+                     const int16_t *heights, int16_t void_m )
+{
+    int row_blocks = (posts + DEM_BLOCK - 1) / DEM_BLOCK;
+    vector<int16_t> block( DEM_BLOCK * DEM_BLOCK );
+
+    FILE *fd = fopen( file.c_str(), "wb" );
+    if ( fd == NULL ) {
+        printf("terrain: cannot create %s\n", file.c_str());
+        return false;
+    }
+
+    vector<char> page( DEM_DATA_OFFSET, 0 );
+    dem_header_t h;
+    memset( &h, 0, sizeof(h) );
+    memcpy( h.magic, DEM_MAGIC, sizeof(h.magic) );
+    h.lat = lat;
+    h.lon = lon;
+    h.posts = posts;
+    h.block = DEM_BLOCK;
+    h.void_m = void_m;
+    memcpy( &page[0], &h, sizeof(h) );
+    bool ok = fwrite( &page[0], page.size(), 1, fd ) == 1;
+
+    for ( int br = 0; br < row_blocks && ok; br++ ) {
+        for ( int bc = 0; bc < row_blocks && ok; bc++ ) {
+            // the last row/column of blocks is padded with voids
+            for ( int r = 0; r < DEM_BLOCK; r++ ) {
+                for ( int c = 0; c < DEM_BLOCK; c++ ) {
+                    int row = br * DEM_BLOCK + r;
+                    int col = bc * DEM_BLOCK + c;
+                    block[r * DEM_BLOCK + c]
+                        = (row < posts && col < posts)
+                        ? heights[row * posts + col] : void_m;
+                }
+            }
+            ok = fwrite( &block[0], block.size() * sizeof(int16_t), 1, fd ) == 1;
+        }
+    }
+    if ( fclose(fd) != 0 ) {
+        ok = false;
+    }
+    if ( !ok ) {
+        printf("terrain: error writing %s\n", file.c_str());
+    }
+    return ok;
+}
+
+
+Terrain::Terrain( unsigned int max_tiles ):
+    max_tiles(max_tiles),
+    last(NULL),
+    counter(0)
+{
+    // slots are never reallocated, last points into them
+    tiles.reserve( max_tiles );
+    page_size = sysconf( _SC_PAGESIZE );
+}
+
+Terrain::~Terrain() {
+    for ( unsigned int i = 0; i < tiles.size(); i++ ) {
+        unmap( &tiles[i] );
+    }
+}
+
+
+void Terrain::set_dir( const string &dir ) {
+    for ( unsigned int i = 0; i < tiles.size(); i++ ) {
+        unmap( &tiles[i] );
+    }
+    tiles.clear();
+    last = NULL;
+    this->dir = dir;
+}
+
+
+void Terrain::unmap( tile_t *t ) {
+    if ( t->map != NULL ) {
+        munmap( t->map, t->map_size );
+        t->map = NULL;
+        t->data = NULL;
+    }
+    t->present = false;
+}
+
+
+// tile by corner, most recent first, bounded by max_tiles
+Terrain::tile_t *Terrain::find( int lat, int lon ) {
+    if ( last != NULL && last->lat == lat && last->lon == lon ) {
+        return last;
+    }
+    for ( unsigned int i = 0; i < tiles.size(); i++ ) {
+        if ( tiles[i].lat == lat && tiles[i].lon == lon ) {
+            last = &tiles[i];
+            return last;
+        }
+    }
+    last = load( lat, lon );
+    return last;
+}
+
+
+// map a tile into a free (or the least recently used) slot.  A
+// missing or bad tile still takes a slot, marked not present.
+Terrain::tile_t *Terrain::load( int lat, int lon ) {
+    tile_t *t;
+    if ( tiles.size() < max_tiles ) {
+        tiles.push_back( tile_t() );
+        t = &tiles.back();
+    } else {
+        t = &tiles[0];
+        for ( unsigned int i = 1; i < tiles.size(); i++ ) {
+            if ( tiles[i].used < t->used ) {
+                t = &tiles[i];
+            }
+        }
+        unmap( t );
+    }
+    memset( t, 0, sizeof(tile_t) );
+    t->lat = lat;
+    t->lon = lon;
+    t->used = ++counter;
+
+    if ( dir.empty() ) {
+        return t;
+    }
+    string file = dir + "/" + dem_tile_name( lat, lon );
+    int fd = open( file.c_str(), O_RDONLY );
+    if ( fd < 0 ) {
+        return t;
+    }
+    struct stat st;
+    if ( fstat(fd, &st) < 0 || st.st_size < DEM_DATA_OFFSET ) {
+        close( fd );
+        printf("terrain: %s is too short\n", file.c_str());
+        return t;
+    }
+    void *map = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( map == MAP_FAILED ) {
+        printf("terrain: cannot map %s\n", file.c_str());
+        return t;
+    }
+    t->map = map;
+    t->map_size = st.st_size;
+
+    dem_header_t h;
+    memcpy( &h, map, sizeof(h) );
+    int shift = 0;
+    while ( h.block > 0 && (1 << shift) < h.block ) {
+        shift++;
+    }
+    int row_blocks = h.block > 0 ? (h.posts + h.block - 1) / h.block : 0;
+    size_t need = DEM_DATA_OFFSET
+        + (size_t)row_blocks * row_blocks * h.block * h.block * sizeof(int16_t);
+    if ( memcmp(h.magic, DEM_MAGIC, sizeof(h.magic)) != 0
+         || h.lat != lat || h.lon != lon || h.posts < 2
+         || h.block <= 0 || (1 << shift) != h.block
+         || (size_t)st.st_size < need )
+    {
+        printf("terrain: %s is not a valid tile\n", file.c_str());
+        unmap( t );
+        return t;
+    }
+    // posts are read scattered, not front to back
+    madvise( map, st.st_size, MADV_RANDOM );
+
+    t->present = true;
+    t->data = (const int16_t *)((const char *)map + DEM_DATA_OFFSET);
+    t->posts = h.posts;
+    t->shift = shift;
+    t->row_blocks = row_blocks;
+    t->void_m = h.void_m;
+    return t;
+}
+
+
+bool Terrain::get_elevation( double lat_deg, double lon_deg, double *elev_m ) {
+    int lat = (int)floor( lat_deg );
+    int lon = (int)floor( lon_deg );
+    tile_t *t = find( lat, lon );
+    t->used = ++counter;
+    if ( !t->present ) {
+        return false;
+    }
+
+    double y = (lat_deg - lat) * (t->posts - 1);
+    double x = (lon_deg - lon) * (t->posts - 1);
+    int r = (int)y;
+    int c = (int)x;
+    if ( r > t->posts - 2 ) { r = t->posts - 2; }
+    if ( c > t->posts - 2 ) { c = t->posts - 2; }
+    double u = y - r;
+    double v = x - c;
+
+    int16_t h00 = post( t, r, c );
+    int16_t h01 = post( t, r, c + 1 );
+    int16_t h10 = post( t, r + 1, c );
+    int16_t h11 = post( t, r + 1, c + 1 );
+    if ( h00 == t->void_m || h01 == t->void_m
+         || h10 == t->void_m || h11 == t->void_m )
+    {
+        return false;
+    }
+    *elev_m = (1.0 - u) * ((1.0 - v) * h00 + v * h01)
+        + u * ((1.0 - v) * h10 + v * h11);
+    return true;
+}
+
+
+void Terrain::prefetch( double lat1_deg, double lon1_deg,
+                        double lat2_deg, double lon2_deg )
+{
+    // sample at a quarter block of the finest (1 arc second) tiles so
+    // no block along the segment is skipped
+    double step_deg = 0.25 * DEM_BLOCK / 3600.0;
+    double dlat = lat2_deg - lat1_deg;
+    double dlon = lon2_deg - lon1_deg;
+    double len = sqrt( dlat * dlat + dlon * dlon );
+    int n = (int)(len / step_deg) + 1;
+    const void *last_block = NULL;
+    for ( int i = 0; i <= n; i++ ) {
+        double lat_deg = lat1_deg + dlat * i / n;
+        double lon_deg = lon1_deg + dlon * i / n;
+        int lat = (int)floor( lat_deg );
+        int lon = (int)floor( lon_deg );
+        tile_t *t = find( lat, lon );
+        if ( !t->present ) {
+            continue;
+        }
+        int r = (int)((lat_deg - lat) * (t->posts - 1));
+        int c = (int)((lon_deg - lon) * (t->posts - 1));
+        int b = (r >> t->shift) * t->row_blocks + (c >> t->shift);
+        const int16_t *block = t->data + ((size_t)b << (2 * t->shift));
+        if ( block == last_block ) {
+            continue;
+        }
+        last_block = block;
+        // (blocks are page aligned for 4k pages, round for larger)
+        uintptr_t start = (uintptr_t)block & ~(uintptr_t)(page_size - 1);
+        size_t bytes = sizeof(int16_t) << (2 * t->shift);
+        madvise( (void *)start, (uintptr_t)block + bytes - start,
+                 MADV_WILLNEED );
+    }
+}
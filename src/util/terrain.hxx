@@ -0,0 +1,101 @@
+// terrain.hxx - elevation lookups from memory mapped DEM tiles
+//
+// Tiles cover one degree square each (the SRTM layout) and are
+// converted ahead of time (utils/terrain/aura-hgt2dem) into a blocked
+// binary format: after a one page header the posts are stored in
+// square blocks of 64x64 int16 (8 KB, page aligned), instead of full
+// rows.  A lookup touches one block (occasionally up to four at a
+// block edge) and a flight corridor only faults in the blocks along
+// it, so the resident set stays small and the page cache can simply
+// drop clean pages again on a low memory board.  With whole rows a
+// north/south leg would touch a new page every post.
+//
+// File name: the south west corner, N44W094.dem etc.  Posts run
+// south to north and west to east, the edge posts are shared with
+// the neighbouring tiles.  Heights are meters above msl (EGM96 for
+// SRTM), host byte order.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+// file header, the block data starts at DEM_DATA_OFFSET
+struct dem_header_t {
+    char magic[8];              // "AURADEM1"
+    int32_t lat;                // south west corner (deg)
+    int32_t lon;
+    int32_t posts;              // posts per side (1201, 3601)
+    int32_t block;              // posts per block side (power of two)
+    int16_t void_m;             // marks posts without data
+    int16_t pad;
+};
+
+const char DEM_MAGIC[8] = { 'A', 'U', 'R', 'A', 'D', 'E', 'M', '1' };
+const int DEM_DATA_OFFSET = 4096;
+const int DEM_BLOCK = 64;
+
+// file name of the tile holding lat/lon (deg)
+string dem_tile_name( int lat, int lon );
+
+// write a tile, posts[] is posts*posts heights in row major order
+// from the south west corner
+bool dem_write_tile( const string &file, int lat, int lon, int posts,
+                     const int16_t *heights, int16_t void_m = -32768 );
+
+class Terrain {
+
+public:
+
+    Terrain( unsigned int max_tiles = 8 );
+    ~Terrain();
+
+    // directory holding the .dem tiles, drops any mapped tiles
+    void set_dir( const string &dir );
+
+    // bilinear elevation (m) at lat/lon (deg), false when there is
+    // no tile or a surrounding post has no data
+    bool get_elevation( double lat_deg, double lon_deg, double *elev_m );
+
+    // start reading in (asynchronously) the blocks under the segment
+    // between two points, e.g. the legs of the route
+    void prefetch( double lat1_deg, double lon1_deg,
+                   double lat2_deg, double lon2_deg );
+
+private:
+
+    struct tile_t {
+        int lat, lon;           // south west corner
+        bool present;           // false: no tile, don't retry every call
+        void *map;
+        size_t map_size;
+        const int16_t *data;    // first block
+        int posts;
+        int shift;              // log2(block)
+        int row_blocks;         // blocks per row of blocks
+        int16_t void_m;
+        unsigned long used;     // for lru replacement
+    };
+
+    tile_t *find( int lat, int lon );
+    tile_t *load( int lat, int lon );
+    void unmap( tile_t *t );
+
+    inline int16_t post( const tile_t *t, int row, int col ) {
+        int mask = (1 << t->shift) - 1;
+        int b = (row >> t->shift) * t->row_blocks + (col >> t->shift);
+        return t->data[ (b << (2 * t->shift))
+                        + ((row & mask) << t->shift) + (col & mask) ];
+    }
+
+    string dir;
+    unsigned int max_tiles;
+    vector<tile_t> tiles;
+    tile_t *last;               // most recent hit
+    unsigned long counter;
+    long page_size;
+};
@@ -0,0 +1,80 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "terrain.hxx"
+
+// a tilted plane is exact under bilinear interpolation, so any lookup
+// error beyond the int16 rounding is a bug
+static double plane( double lat, double lon ) {
+    return 300.0 + 2000.0 * (lat - 44.0) - 1500.0 * (lon + 94.0);
+}
+
+static bool write_plane( const string &dir, int lat, int lon, int posts ) {
+    vector<int16_t> h( posts * posts );
+    for ( int r = 0; r < posts; r++ ) {
+        for ( int c = 0; c < posts; c++ ) {
+            h[r * posts + c] = (int16_t)lrint( plane( lat + r / (posts - 1.0),
+                                                      lon + c / (posts - 1.0) ) );
+        }
+    }
+    // a 3x3 post hole
+    for ( int r = 500; r < 503; r++ ) {
+        for ( int c = 500; c < 503; c++ ) {
+            h[r * posts + c] = -32768;
+        }
+    }
+    return dem_write_tile( dir + "/" + dem_tile_name(lat, lon), lat, lon,
+                           posts, &h[0] );
+}
+
+int main() {
+    char tmpl[] = "/tmp/terrain_testXXXXXX";
+    string dir = mkdtemp( tmpl );
+    // 3 arc second posts so the plane stays within int16 rounding
+    if ( !write_plane( dir, 44, -94, 1201 ) || !write_plane( dir, 44, -93, 1201 ) ) {
+        printf("cannot write test tiles in %s\n", dir.c_str());
+        return 1;
+    }
+
+    Terrain terrain;
+    terrain.set_dir( dir );
+    terrain.prefetch( 44.1, -93.9, 44.9, -92.1 );
+
+    // survey lines across both tiles (int16 rounding allows 0.5 m)
+    int n = 0, found = 0;
+    double max_err = 0.0;
+    for ( double lat = 44.05; lat < 44.95; lat += 0.01 ) {
+        for ( double lon = -93.95; lon < -92.05; lon += 0.00037 ) {
+            n++;
+            double elev;
+            if ( !terrain.get_elevation( lat, lon, &elev ) ) {
+                continue;
+            }
+            found++;
+            double err = fabs( elev - plane(lat, lon) );
+            if ( err > max_err ) {
+                max_err = err;
+            }
+        }
+    }
+
+    double elev;
+    bool edge = terrain.get_elevation( 44.5, -93.0, &elev )
+        && fabs( elev - plane(44.5, -93.0) ) < 0.5;
+    bool hole = terrain.get_elevation( 44 + 501 / 1200.0, -94 + 501 / 1200.0,
+                                       &elev );
+    bool outside = terrain.get_elevation( 46.5, -93.5, &elev );
+
+    printf("found = %d / %d  max error = %.3f m\n", found, n, max_err);
+    printf("tile edge ok = %d  void hole rejected = %d  no tile rejected = %d\n",
+           edge, !hole, !outside);
+
+    unlink( (dir + "/" + dem_tile_name(44, -94)).c_str() );
+    unlink( (dir + "/" + dem_tile_name(44, -93)).c_str() );
+    rmdir( dir.c_str() );
+
+    return ( found > n * 0.99 && max_err < 0.501 && edge && !hole && !outside )
+        ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+#include <errno.h>		// errno
+#include <stdio.h>		// printf() et. al.
+#include <string.h>		// memset(), strerror()
+#include <sys/ioctl.h>		// ioctl()
+#include <time.h>		// clock_gettime()
+
+#include "timing.h"
+
+#include "udp_batch.hxx"
+
+static const int control_size = CMSG_SPACE(sizeof(struct timespec));
+
+
+double udp_kernel_stamp( struct msghdr *hdr, const struct timespec &now,
+                         double host_time )
+{
+    double stamp = host_time;
+    for ( struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr); cmsg != NULL;
+          cmsg = CMSG_NXTHDR(hdr, cmsg) )
+    {
+        if ( cmsg->cmsg_level == SOL_SOCKET
+             && cmsg->cmsg_type == SCM_TIMESTAMPNS )
+        {
+            // kernel stamps are CLOCK_REALTIME, carry them over to the
+            // get_Time() reference by their age
+            struct timespec ts;
+            memcpy( &ts, CMSG_DATA(cmsg), sizeof(ts) );
+            double age = (now.tv_sec - ts.tv_sec)
+                + (now.tv_nsec - ts.tv_nsec) * 1e-9;
+            if ( age > 0.0 ) {
+                stamp = host_time - age;
+            }
+        }
+    }
+    return stamp;
+}
+
+
+UDPBatch::UDPBatch():
+    syscalls(0),
+    packets(0),
+    truncated(0),
+    fd(-1),
+    count(0),
+    size(0),
+    filled(0),
+    pos(0)
+{
+}
+
+UDPBatch::~UDPBatch() {
+}
+
+
+bool UDPBatch::init( int sock_fd, int pool_count, int pool_size ) {
+    if ( sock_fd < 0 || pool_count < 1 || pool_size < 1 ) {
+        return false;
+    }
+
+    int on = 1;
+    if ( setsockopt( sock_fd, SOL_SOCKET, SO_TIMESTAMPNS, &on,
+                     sizeof(on) ) < 0 )
+    {
+        // not fatal, packets are stamped with the receive time instead
+        fprintf( stderr, "udp batch: no kernel timestamps - %s\n",
+                 strerror(errno) );
+    }
+
+    fd = sock_fd;
+    count = pool_count;
+    size = pool_size;
+    pool.resize( count * size );
+    control.resize( count * control_size );
+    msgs.resize( count );
+    iovs.resize( count );
+    stamps.resize( count );
+    filled = pos = 0;
+
+    return true;
+}
+
+
+// one recvmmsg() for whatever is queued (up to the pool size)
+bool UDPBatch::fill() {
+    filled = pos = 0;
+    for ( int i = 0; i < count; i++ ) {
+        iovs[i].iov_base = &pool[i * size];
+        iovs[i].iov_len = size;
+        memset( &msgs[i], 0, sizeof(struct mmsghdr) );
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = &control[i * control_size];
+        msgs[i].msg_hdr.msg_controllen = control_size;
+    }
+
+    int n;
+    do {
+        n = recvmmsg( fd, &msgs[0], count, MSG_DONTWAIT, NULL );
+        syscalls++;
+    } while ( n < 0 && errno == EINTR );
+    if ( n <= 0 ) {
+        if ( n < 0 && errno != EAGAIN && errno != EWOULDBLOCK ) {
+            fprintf( stderr, "udp batch: recvmmsg() failed - %s\n",
+                     strerror(errno) );
+        }
+        return false;
+    }
+
+    struct timespec now;
+    clock_gettime( CLOCK_REALTIME, &now );
+    double host_time = get_Time();
+    for ( int i = 0; i < n; i++ ) {
+        struct msghdr *hdr = &msgs[i].msg_hdr;
+        stamps[i] = udp_kernel_stamp( hdr, now, host_time );
+        if ( hdr->msg_flags & MSG_TRUNC ) {
+            truncated++;
+        }
+    }
+    filled = n;
+    packets += n;
+
+    return true;
+}
+
+
+int UDPBatch::next( uint8_t **packet, double *stamp ) {
+    if ( fd < 0 ) {
+        return 0;
+    }
+    if ( pos >= filled && !fill() ) {
+        return 0;
+    }
+    int len = msgs[pos].msg_len;
+    if ( len > size ) {
+        len = size;
+    }
+    *packet = &pool[pos * size];
+    *stamp = stamps[pos];
+    pos++;
+    return len;
+}
+
+
+int UDPBatch::available() {
+    if ( fd < 0 ) {
+        return 0;
+    }
+    int bytes = 0;
+    for ( int i = pos; i < filled; i++ ) {
+        bytes += msgs[i].msg_len;
+    }
+    if ( bytes == 0 ) {
+        ioctl( fd, FIONREAD, &bytes );
+        syscalls++;
+    }
+    return bytes;
+}
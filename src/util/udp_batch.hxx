@@ -0,0 +1,72 @@
+// batched UDP receive with kernel arrival timestamps.
+//
+// One recvmmsg() drains up to 'count' datagrams into a preallocated
+// packet pool; next() then hands them out one at a time and only goes
+// back to the kernel once the pool is empty.  SO_TIMESTAMPNS is
+// enabled on the socket so every packet carries the time the kernel
+// received it, converted to the get_Time() reference, which is a much
+// better arrival estimate than sampling the clock when the main loop
+// finally gets around to parsing it.
+//
+// next() never blocks (the main loop sleeps in the reactor instead.)
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/socket.h>		// struct mmsghdr
+#include <time.h>		// struct timespec
+
+#include <vector>
+using std::vector;
+
+// the SO_TIMESTAMPNS stamp carried in hdr's control data, converted
+// to get_Time() seconds.  now and host_time are the realtime clock and
+// get_Time() read together; host_time is returned when there's no
+// stamp.
+double udp_kernel_stamp( struct msghdr *hdr, const struct timespec &now,
+                         double host_time );
+
+class UDPBatch {
+
+public:
+
+    UDPBatch();
+    ~UDPBatch();
+
+    // allocate the pool and turn on receive timestamps for fd
+    bool init( int fd, int count = 16, int size = 2048 );
+    inline bool is_open() { return fd >= 0; }
+
+    // next datagram, returns its length (0 when nothing is pending)
+    // with *packet pointing into the pool until the following call.
+    // *stamp is the kernel arrival time in get_Time() seconds.
+    int next( uint8_t **packet, double *stamp );
+
+    // backlog in bytes: what is left in the pool, or the next queued
+    // datagram once the pool is drained
+    int available();
+
+    // datagrams still in the pool
+    inline int pending() { return filled - pos; }
+
+    // statistics
+    uint32_t syscalls;
+    uint32_t packets;
+    uint32_t truncated;
+
+private:
+
+    int fd;
+    int count;
+    int size;
+    int filled;                 // datagrams in the pool
+    int pos;                    // next one to hand out
+
+    vector<uint8_t> pool;
+    vector<uint8_t> control;
+    vector<struct mmsghdr> msgs;
+    vector<struct iovec> iovs;
+    vector<double> stamps;
+
+    bool fill();
+};
@@ -0,0 +1,561 @@
+#include "include/aura_config.h"
+
+#include <errno.h>		// errno
+#include <stdio.h>		// printf() et. al.
+#include <stdlib.h>		// posix_memalign()
+#include <string.h>		// memset(), strerror()
+#include <time.h>		// clock_gettime()
+#include <unistd.h>		// close()
+
+#ifdef HAVE_LINUX_IO_URING_H
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>		// mmap()
+#  include <sys/syscall.h>	// syscall()
+#endif
+
+#include "timing.h"
+#include "udp_batch.hxx"		// udp_kernel_stamp()
+
+#include "uring.hxx"
+
+static const uint16_t buf_group = 1;
+
+// IORING_OP_READ_MULTISHOT (linux 6.7) postdates some kernel headers
+static const int op_read_multishot = 49;
+
+
+SensorRing::SensorRing():
+    syscalls(0),
+    completions(0),
+    rearms(0),
+    dropped(0),
+    ring_fd(-1),
+    sq_ptr(NULL),
+    sq_size(0),
+    sq_head(NULL),
+    sq_tail(NULL),
+    sq_mask(NULL),
+    sq_array(NULL),
+    sqes(NULL),
+    sqes_size(0),
+    sq_pending(0),
+    cq_ptr(NULL),
+    cq_size(0),
+    cq_head(NULL),
+    cq_tail(NULL),
+    cq_mask(NULL),
+    cqes(NULL),
+    buf_ring(NULL),
+    buf_ring_size(0),
+    buf_base(NULL),
+    buf_count(0),
+    buf_size(0),
+    buf_tail(0),
+    buf_held(0),
+    exhausted(false),
+    read_multishot(false),
+    starved(false)
+{
+    // multishot recvmsg only looks at the name and control lengths,
+    // the kernel lays both out in each buffer ahead of the payload
+    memset( &recv_msg, 0, sizeof(recv_msg) );
+    recv_msg.msg_controllen = CMSG_SPACE(sizeof(struct timespec));
+}
+
+SensorRing::~SensorRing() {
+    close_ring();
+}
+
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+static int ring_setup( unsigned int entries, struct io_uring_params *p ) {
+    return syscall( __NR_io_uring_setup, entries, p );
+}
+
+static int ring_enter( int fd, unsigned int to_submit, unsigned int flags ) {
+    return syscall( __NR_io_uring_enter, fd, to_submit, 0, flags, NULL, 0 );
+}
+
+static int ring_register( int fd, unsigned int op, void *arg,
+                          unsigned int nr )
+{
+    return syscall( __NR_io_uring_register, fd, op, arg, nr );
+}
+
+#endif
+
+
+bool SensorRing::init( unsigned int buffers, unsigned int size ) {
+#ifdef HAVE_LINUX_IO_URING_H
+    struct io_uring_params p;
+    memset( &p, 0, sizeof(p) );
+#ifdef IORING_SETUP_COOP_TASKRUN
+    // completions are only ever reaped on this thread, so skip the
+    // interrupt the kernel would otherwise send to run them
+    p.flags = IORING_SETUP_COOP_TASKRUN;
+#endif
+    ring_fd = ring_setup( 32, &p );
+#ifdef IORING_SETUP_COOP_TASKRUN
+    if ( ring_fd < 0 && errno == EINVAL ) {
+        memset( &p, 0, sizeof(p) );
+        ring_fd = ring_setup( 32, &p );
+    }
+#endif
+    if ( ring_fd < 0 ) {
+        fprintf( stderr, "io_uring: not available - %s\n", strerror(errno) );
+        return false;
+    }
+
+    // map the submission/completion rings and the sqe array
+    sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if ( single_mmap ) {
+        if ( cq_size > sq_size ) {
+            sq_size = cq_size;
+        }
+        cq_size = sq_size;
+    }
+    sq_ptr = mmap( NULL, sq_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING );
+    if ( sq_ptr == MAP_FAILED ) {
+        sq_ptr = NULL;
+        close_ring();
+        return false;
+    }
+    if ( single_mmap ) {
+        cq_ptr = sq_ptr;
+    } else {
+        cq_ptr = mmap( NULL, cq_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring_fd,
+                       IORING_OFF_CQ_RING );
+        if ( cq_ptr == MAP_FAILED ) {
+            cq_ptr = NULL;
+            close_ring();
+            return false;
+        }
+    }
+    sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = mmap( NULL, sqes_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES );
+    if ( sqes == MAP_FAILED ) {
+        sqes = NULL;
+        close_ring();
+        return false;
+    }
+    uint8_t *sq = (uint8_t *)sq_ptr;
+    sq_head = (unsigned int *)(sq + p.sq_off.head);
+    sq_tail = (unsigned int *)(sq + p.sq_off.tail);
+    sq_mask = (unsigned int *)(sq + p.sq_off.ring_mask);
+    sq_array = (unsigned int *)(sq + p.sq_off.array);
+    uint8_t *cq = (uint8_t *)cq_ptr;
+    cq_head = (unsigned int *)(cq + p.cq_off.head);
+    cq_tail = (unsigned int *)(cq + p.cq_off.tail);
+    cq_mask = (unsigned int *)(cq + p.cq_off.ring_mask);
+    cqes = cq + p.cq_off.cqes;
+
+    // does this kernel do multishot read() (serial devices)?
+    size_t probe_size = sizeof(struct io_uring_probe)
+        + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = (struct io_uring_probe *)calloc( 1, probe_size );
+    if ( probe != NULL ) {
+        if ( ring_register( ring_fd, IORING_REGISTER_PROBE, probe, 256 ) == 0
+             && probe->last_op >= op_read_multishot
+             && (probe->ops[op_read_multishot].flags & IO_URING_OP_SUPPORTED) )
+        {
+            read_multishot = true;
+        }
+        free(probe);
+    }
+
+    // provided buffer ring (count must be a power of two)
+    buf_count = 1;
+    while ( buf_count < buffers && buf_count < 32768 ) {
+        buf_count <<= 1;
+    }
+    buf_size = size;
+    buf_ring_size = buf_count * sizeof(struct io_uring_buf);
+    buf_ring = mmap( NULL, buf_ring_size, PROT_READ | PROT_WRITE,
+                     MAP_ANONYMOUS | MAP_PRIVATE, -1, 0 );
+    if ( buf_ring == MAP_FAILED ) {
+        buf_ring = NULL;
+        close_ring();
+        return false;
+    }
+    if ( posix_memalign( (void **)&buf_base, 4096, buf_count * buf_size ) != 0 ) {
+        buf_base = NULL;
+        close_ring();
+        return false;
+    }
+    struct io_uring_buf_reg reg;
+    memset( &reg, 0, sizeof(reg) );
+    reg.ring_addr = (uint64_t)buf_ring;
+    reg.ring_entries = buf_count;
+    reg.bgid = buf_group;
+    if ( ring_register( ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1 ) < 0 ) {
+        fprintf( stderr, "io_uring: provided buffer rings not supported - %s\n",
+                 strerror(errno) );
+        close_ring();
+        return false;
+    }
+    for ( unsigned int i = 0; i < buf_count; i++ ) {
+        recycle(i);
+    }
+
+    printf("io_uring: %u x %u byte buffers, multishot read %s\n",
+           buf_count, buf_size, read_multishot ? "yes" : "no");
+    return true;
+#else
+    fprintf( stderr, "io_uring: support not compiled in\n" );
+    return false;
+#endif
+}
+
+
+void SensorRing::close_ring() {
+#ifdef HAVE_LINUX_IO_URING_H
+    if ( sqes != NULL ) {
+        munmap( sqes, sqes_size );
+        sqes = NULL;
+    }
+    if ( cq_ptr != NULL && cq_ptr != sq_ptr ) {
+        munmap( cq_ptr, cq_size );
+    }
+    cq_ptr = NULL;
+    if ( sq_ptr != NULL ) {
+        munmap( sq_ptr, sq_size );
+        sq_ptr = NULL;
+    }
+    if ( buf_ring != NULL ) {
+        munmap( buf_ring, buf_ring_size );
+        buf_ring = NULL;
+    }
+#endif
+    if ( ring_fd >= 0 ) {
+        close(ring_fd);
+        ring_fd = -1;
+    }
+    // the kernel may still hold references to the buffers until the
+    // ring fd is closed
+    free(buf_base);
+    buf_base = NULL;
+}
+
+
+// hand a buffer back to the kernel
+void SensorRing::recycle( uint16_t bid ) {
+#ifdef HAVE_LINUX_IO_URING_H
+    // index the entries directly: the header's flexible array member
+    // doesn't have the same layout when compiled as C++
+    struct io_uring_buf *bufs = (struct io_uring_buf *)buf_ring;
+    struct io_uring_buf *b = &bufs[buf_tail & (buf_count - 1)];
+    b->addr = (uint64_t)(buf_base + bid * buf_size);
+    b->len = buf_size;
+    b->bid = bid;
+    buf_tail++;
+    // the ring tail overlays bufs[0].resv (so fill entries field by
+    // field above, never as a whole struct)
+    __atomic_store_n( &bufs[0].resv, buf_tail, __ATOMIC_RELEASE );
+#endif
+}
+
+
+bool SensorRing::arm( int slot ) {
+#ifdef HAVE_LINUX_IO_URING_H
+    slot_t &s = slots[slot];
+    unsigned int tail = *sq_tail;
+    unsigned int head = __atomic_load_n( sq_head, __ATOMIC_ACQUIRE );
+    if ( tail - head > *sq_mask ) {
+        // submission ring full, flush it first
+        submit();
+        head = __atomic_load_n( sq_head, __ATOMIC_ACQUIRE );
+        if ( tail - head > *sq_mask ) {
+            return false;
+        }
+    }
+    unsigned int index = tail & *sq_mask;
+    struct io_uring_sqe *sqe = &((struct io_uring_sqe *)sqes)[index];
+    memset( sqe, 0, sizeof(*sqe) );
+    sqe->fd = s.fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buf_group;
+    sqe->user_data = slot;
+    if ( s.socket ) {
+        if ( s.multishot ) {
+            sqe->opcode = IORING_OP_RECVMSG;
+            sqe->addr = (uint64_t)&recv_msg;
+            sqe->len = 1;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+        } else {
+            sqe->opcode = IORING_OP_RECV;
+            sqe->len = buf_size;
+        }
+    } else if ( s.multishot ) {
+        sqe->opcode = op_read_multishot;
+    } else {
+        sqe->opcode = IORING_OP_READ;
+        sqe->off = (uint64_t)-1;    // current position (a tty)
+        sqe->len = buf_size;
+    }
+    sq_array[index] = index;
+    __atomic_store_n( sq_tail, tail + 1, __ATOMIC_RELEASE );
+    sq_pending++;
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+void SensorRing::submit() {
+#ifdef HAVE_LINUX_IO_URING_H
+    if ( sq_pending > 0 ) {
+        syscalls++;
+        if ( ring_enter( ring_fd, sq_pending, 0 ) < 0 ) {
+            fprintf( stderr, "io_uring: submit failed - %s\n",
+                     strerror(errno) );
+        }
+        sq_pending = 0;
+    }
+#endif
+}
+
+
+int SensorRing::add( int fd, bool socket, const char *name ) {
+    if ( ring_fd < 0 || fd < 0 ) {
+        return -1;
+    }
+    if ( socket ) {
+        int on = 1;
+        if ( setsockopt( fd, SOL_SOCKET, SO_TIMESTAMPNS, &on,
+                         sizeof(on) ) < 0 )
+        {
+            // not fatal, packets are stamped when they are reaped
+            fprintf( stderr, "io_uring: %s has no kernel timestamps - %s\n",
+                     name, strerror(errno) );
+        }
+    }
+    slot_t s;
+    s.fd = fd;
+    s.socket = socket;
+    s.multishot = socket || read_multishot;
+    s.failed = false;
+    s.starved = false;
+    s.name = name;
+    s.queue.resize( buf_count );
+    s.head = 0;
+    s.count = 0;
+    s.offset = 0;
+    s.held = -1;
+    s.queued_bytes = 0;
+    slots.push_back(s);
+    int slot = slots.size() - 1;
+    if ( !arm(slot) ) {
+        slots.pop_back();
+        return -1;
+    }
+    submit();
+    return slot;
+}
+
+
+int SensorRing::harvest() {
+    int count = 0;
+#ifdef HAVE_LINUX_IO_URING_H
+    if ( ring_fd < 0 ) {
+        return 0;
+    }
+    if ( exhausted && buf_held < buf_count ) {
+        // receives that ran out of buffers end with -ENOBUFS, but
+        // those completions aren't posted until the ring is entered
+        exhausted = false;
+        syscalls++;
+        ring_enter( ring_fd, 0, IORING_ENTER_GETEVENTS );
+    }
+    unsigned int head = *cq_head;
+    unsigned int tail = __atomic_load_n( cq_tail, __ATOMIC_ACQUIRE );
+    struct timespec now;
+    double host_time = 0.0;
+    if ( head != tail ) {
+        clock_gettime( CLOCK_REALTIME, &now );
+        host_time = get_Time();
+    }
+    while ( head != tail ) {
+        struct io_uring_cqe *cqe
+            = &((struct io_uring_cqe *)cqes)[head & *cq_mask];
+        int slot = cqe->user_data;
+        int res = cqe->res;
+        uint32_t flags = cqe->flags;
+        slot_t &s = slots[slot];
+        if ( flags & IORING_CQE_F_BUFFER ) {
+            buf_held++;
+            if ( buf_held >= buf_count ) {
+                exhausted = true;
+            }
+            chunk_t c;
+            c.bid = flags >> IORING_CQE_BUFFER_SHIFT;
+            c.start = 0;
+            c.len = res;
+            c.stamp = host_time;
+            if ( res > 0 && s.socket && s.multishot ) {
+                // io_uring_recvmsg_out, the name (none), the control
+                // data (timestamp) and then the datagram itself
+                uint8_t *data = buf_base + c.bid * buf_size;
+                struct io_uring_recvmsg_out *out
+                    = (struct io_uring_recvmsg_out *)data;
+                int start = sizeof(*out) + recv_msg.msg_namelen
+                    + recv_msg.msg_controllen;
+                c.len = 0;
+                if ( res >= start ) {
+                    struct msghdr hdr;
+                    memset( &hdr, 0, sizeof(hdr) );
+                    hdr.msg_control = data + sizeof(*out) + recv_msg.msg_namelen;
+                    hdr.msg_controllen = out->controllen;
+                    c.stamp = udp_kernel_stamp( &hdr, now, host_time );
+                    c.start = start;
+                    c.len = out->payloadlen;
+                    if ( c.len > res - start ) {
+                        // truncated
+                        c.len = res - start;
+                    }
+                }
+            }
+            if ( c.len > 0 ) {
+                // a slot may hold at most half the buffers, so one
+                // backed up fd can't starve the others
+                if ( s.count >= buf_count / 2 ) {
+                    chunk_t &front = s.queue[s.head];
+                    s.queued_bytes -= front.len - s.offset;
+                    release( front.bid );
+                    pop( s );
+                    dropped++;
+                }
+                s.queue[(s.head + s.count) & (buf_count - 1)] = c;
+                s.count++;
+                s.queued_bytes += c.len;
+            } else {
+                release( c.bid );
+            }
+        }
+        if ( res < 0 && s.multishot && res == -EINVAL ) {
+            // multishot not accepted for this fd, use single shot
+            s.multishot = false;
+        } else if ( res == -ENOBUFS && buf_held >= buf_count ) {
+            // every buffer is queued somewhere, re-arm once one is
+            // consumed (see release())
+            s.starved = true;
+            starved = true;
+        } else if ( (res < 0 && res != -ENOBUFS && res != -EAGAIN
+                     && res != -EINTR)
+                    || (res == 0 && !s.socket) )
+        {
+            // device error or hangup
+            fprintf( stderr, "io_uring: %s read stopped - %s\n",
+                     s.name.c_str(), res ? strerror(-res) : "end of file" );
+            s.failed = true;
+        }
+        if ( !(flags & IORING_CQE_F_MORE) && !s.failed && !s.starved ) {
+            rearms++;
+            arm(slot);
+        }
+        head++;
+        count++;
+        if ( head == tail ) {
+            tail = __atomic_load_n( cq_tail, __ATOMIC_ACQUIRE );
+        }
+    }
+    __atomic_store_n( cq_head, head, __ATOMIC_RELEASE );
+    completions += count;
+    submit();
+#endif
+    return count;
+}
+
+
+// a consumed buffer goes back to the kernel, along with any receive
+// that stopped waiting for one
+void SensorRing::release( uint16_t bid ) {
+    recycle( bid );
+    buf_held--;
+    if ( !starved ) {
+        return;
+    }
+    starved = false;
+    for ( unsigned int i = 0; i < slots.size(); i++ ) {
+        if ( slots[i].starved ) {
+            slots[i].starved = false;
+            if ( !slots[i].failed ) {
+                rearms++;
+                arm(i);
+            }
+        }
+    }
+    submit();
+}
+
+
+void SensorRing::pop( slot_t &s ) {
+    s.head = (s.head + 1) & (buf_count - 1);
+    s.count--;
+    s.offset = 0;
+}
+
+
+int SensorRing::recv( int slot, uint8_t **packet, double *stamp ) {
+    slot_t &s = slots[slot];
+    if ( s.held >= 0 ) {
+        release( s.held );
+        s.held = -1;
+    }
+    if ( s.count == 0 ) {
+        harvest();
+        if ( s.count == 0 ) {
+            return 0;
+        }
+    }
+    chunk_t &c = s.queue[s.head];
+    int len = c.len - s.offset;
+    *packet = buf_base + c.bid * buf_size + c.start + s.offset;
+    *stamp = c.stamp;
+    s.held = c.bid;
+    s.queued_bytes -= len;
+    pop( s );
+    return len;
+}
+
+
+int SensorRing::read( int slot, uint8_t *buf, int len ) {
+    slot_t &s = slots[slot];
+    if ( s.held >= 0 ) {
+        release( s.held );
+        s.held = -1;
+    }
+    if ( s.count == 0 ) {
+        harvest();
+    }
+    int copied = 0;
+    while ( copied < len && s.count > 0 ) {
+        chunk_t &c = s.queue[s.head];
+        int n = c.len - s.offset;
+        if ( n > len - copied ) {
+            n = len - copied;
+        }
+        memcpy( buf + copied, buf_base + c.bid * buf_size + c.start + s.offset,
+                n );
+        copied += n;
+        s.offset += n;
+        if ( (int)s.offset >= c.len ) {
+            release( c.bid );
+            pop( s );
+        }
+    }
+    s.queued_bytes -= copied;
+    return copied;
+}
+
+
+int SensorRing::available( int slot ) {
+    harvest();
+    return slots[slot].queued_bytes;
+}
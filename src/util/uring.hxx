@@ -0,0 +1,141 @@
+// an optional io_uring backend for the sensor reads.
+//
+// Every registered fd keeps a multishot receive (sockets) or read
+// (serial devices) outstanding, feeding a shared ring of provided
+// buffers.  The kernel fills buffers as data arrives; harvest() reaps
+// completions straight out of the shared completion ring into per-fd
+// queues of buffer ids, all without a system call.  Datagrams are
+// handed to the caller in place and a buffer only goes back to the
+// kernel once it has been consumed.  A syscall is only needed to
+// re-arm a request that stopped (buffers ran out, or single shot
+// reads on kernels without multishot read support), and those are
+// batched into one io_uring_enter() per harvest.
+//
+// Sockets are read with multishot recvmsg and SO_TIMESTAMPNS, so each
+// datagram keeps its kernel arrival time (see UDPBatch.)
+//
+// The ring fd itself is pollable (readable when completions are
+// pending) so the reactor can sleep on it in place of the device fds.
+//
+// init() fails cleanly on kernels (or builds) without io_uring or
+// provided buffer rings (5.19+), and callers fall back to their
+// plain read()/recv() paths.
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/socket.h>		// struct msghdr
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+class SensorRing {
+
+public:
+
+    SensorRing();
+    ~SensorRing();
+
+    bool init( unsigned int buffers = 64, unsigned int buffer_size = 2048 );
+    inline bool is_open() { return ring_fd >= 0; }
+
+    // pollable ring fd
+    inline int get_fd() { return ring_fd; }
+
+    // keep a receive outstanding on fd, returns a slot id for the
+    // read calls below or -1 on failure
+    int add( int fd, bool socket, const char *name );
+
+    // reap all pending completions, returns the number reaped
+    int harvest();
+
+    // next datagram (socket) or chunk (serial), returns its length
+    // (0 when nothing is queued) with *packet pointing into the ring
+    // buffer until the following recv() or read() on the slot.
+    // *stamp is the kernel arrival time in get_Time() seconds, or
+    // the time the completion was reaped when there is none.
+    int recv( int slot, uint8_t **packet, double *stamp );
+
+    // byte stream read across chunks, returns bytes copied (0 when
+    // nothing is queued, never blocks)
+    int read( int slot, uint8_t *buf, int len );
+
+    // bytes queued for slot
+    int available( int slot );
+
+    // statistics
+    uint32_t syscalls;
+    uint32_t completions;
+    uint32_t rearms;
+    uint32_t dropped;
+
+private:
+
+    // a filled buffer waiting to be consumed
+    struct chunk_t {
+        uint16_t bid;
+        uint16_t start;         // payload offset in the buffer
+        int len;
+        double stamp;
+    };
+
+    struct slot_t {
+        int fd;
+        bool socket;
+        bool multishot;
+        bool failed;
+        bool starved;           // stopped for lack of buffers
+        string name;
+        vector<chunk_t> queue;  // circular, buf_count entries
+        unsigned int head;
+        unsigned int count;
+        unsigned int offset;    // read position in the front chunk
+        int held;               // buffer handed out by recv(), or -1
+        int queued_bytes;
+    };
+
+    int ring_fd;
+
+    // submission ring
+    void *sq_ptr;
+    size_t sq_size;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    void *sqes;
+    size_t sqes_size;
+    unsigned int sq_pending;
+
+    // completion ring
+    void *cq_ptr;
+    size_t cq_size;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    void *cqes;
+
+    // provided buffers
+    void *buf_ring;
+    size_t buf_ring_size;
+    uint8_t *buf_base;
+    unsigned int buf_count;
+    unsigned int buf_size;
+    uint16_t buf_tail;
+    unsigned int buf_held;      // buffers the kernel handed us, not back yet
+    bool exhausted;             // buf_held reached buf_count
+
+    bool read_multishot;        // kernel supports multishot read()
+    struct msghdr recv_msg;     // multishot recvmsg layout (control only)
+    vector<slot_t> slots;
+    bool starved;               // some slot waits for a buffer
+
+    void close_ring();
+    bool arm( int slot );
+    void recycle( uint16_t bid );
+    void release( uint16_t bid );
+    void pop( slot_t &s );
+    void submit();
+};
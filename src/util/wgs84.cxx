@@ -0,0 +1,404 @@
+// wgs84.cxx - WGS84 ellipsoid geodesy (shared by the native
+//             navigation code and the auracore python module)
+//
+
+#include <limits>
+#include <math.h>
+
+#include "wgs84.hxx"
+
+// These are hard numbers from the WGS84 standard.  DON'T MODIFY
+// unless you want to change the datum.
+static const double EQURAD = 6378137.0;
+static const double iFLATTENING = 298.257223563;
+
+static double d2r = M_PI / 180.0;
+static double r2d = 180.0 / M_PI;
+
+
+// geodetic lat/lon (degrees) and altitude (meters) to earth centered,
+// earth fixed cartesian coordinates (meters)
+void geod2ecef_wgs_84( double lat_deg, double lon_deg, double alt_m,
+                       double *x, double *y, double *z )
+{
+    double f = 1.0 / iFLATTENING;
+    double e2 = f*(2.0-f);
+    double sinlat = sin(lat_deg*d2r), coslat = cos(lat_deg*d2r);
+    double sinlon = sin(lon_deg*d2r), coslon = cos(lon_deg*d2r);
+    double Rn = EQURAD / sqrt(1.0 - e2*sinlat*sinlat);
+    *x = (Rn + alt_m) * coslat * coslon;
+    *y = (Rn + alt_m) * coslat * sinlon;
+    *z = (Rn*(1.0 - e2) + alt_m) * sinlat;
+}
+
+
+void geod2ecef_wgs_84( int n, const double *lat_deg, const double *lon_deg,
+                       const double *alt_m, double *__restrict__ x,
+                       double *__restrict__ y, double *__restrict__ z )
+{
+    const double f = 1.0 / iFLATTENING;
+    const double e2 = f*(2.0-f);
+    for ( int i = 0; i < n; i++ ) {
+        double lat = lat_deg[i] * d2r, lon = lon_deg[i] * d2r;
+        double sinlat = sin(lat), coslat = cos(lat);
+        double Rn = EQURAD / sqrt(1.0 - e2*sinlat*sinlat);
+        double h = alt_m[i];
+        x[i] = (Rn + h) * coslat * cos(lon);
+        y[i] = (Rn + h) * coslat * sin(lon);
+        z[i] = (Rn*(1.0 - e2) + h) * sinlat;
+    }
+}
+
+
+void ecef2geod_wgs_84( int n, const double *x, const double *y,
+                       const double *z, double *__restrict__ lat_deg,
+                       double *__restrict__ lon_deg,
+                       double *__restrict__ alt_m )
+{
+    // H. Vermeille, Direct transformation from geocentric to geodetic
+    // coordinates, Journal of Geodesy (2002) 76:451-454
+    const double f = 1.0 / iFLATTENING;
+    const double e2 = f*(2.0-f);
+    const double e4 = e2*e2;
+    const double ra2 = 1.0 / (EQURAD*EQURAD);
+    for ( int i = 0; i < n; i++ ) {
+        double X = x[i], Y = y[i], Z = z[i];
+        double XXpYY = X*X + Y*Y;
+        if ( XXpYY + Z*Z < 25 ) {
+            // fails near the geocenter, call it the earth center
+            lat_deg[i] = 0.0;
+            lon_deg[i] = 0.0;
+            alt_m[i] = -EQURAD;
+            continue;
+        }
+        double sqrtXXpYY = sqrt(XXpYY);
+        double p = XXpYY*ra2;
+        double q = Z*Z*(1-e2)*ra2;
+        double r = 1/6.0*(p+q-e4);
+        double s = e4*p*q/(4*r*r*r);
+        // rounding can make s slightly negative, which would give a
+        // nan from sqrt(s*(2+s))
+        if ( s >= -2.0 && s <= 0.0 ) {
+            s = 0.0;
+        }
+        double t = cbrt(1+s+sqrt(s*(2+s)));
+        double u = r*(1+t+1/t);
+        double v = sqrt(u*u+e4*q);
+        double w = e2*(u+v-q)/(2*v);
+        double k = sqrt(u+v+w*w)-w;
+        double D = k*sqrtXXpYY/(k+e2);
+        double sqrtDDpZZ = sqrt(D*D+Z*Z);
+        lat_deg[i] = 2*atan2(Z, D+sqrtDDpZZ) * r2d;
+        lon_deg[i] = 2*atan2(Y, X+sqrtXXpYY) * r2d;
+        alt_m[i] = (k+e2-1)*sqrtDDpZZ/k;
+    }
+}
+
+
+// rows of the ecef to ned rotation at a reference point
+static void ned_axes( double lat_deg, double lon_deg, double R[3][3] ) {
+    double sinlat = sin(lat_deg*d2r), coslat = cos(lat_deg*d2r);
+    double sinlon = sin(lon_deg*d2r), coslon = cos(lon_deg*d2r);
+    R[0][0] = -sinlat*coslon; R[0][1] = -sinlat*sinlon; R[0][2] = coslat;
+    R[1][0] = -sinlon;        R[1][1] = coslon;         R[1][2] = 0.0;
+    R[2][0] = -coslat*coslon; R[2][1] = -coslat*sinlon; R[2][2] = -sinlat;
+}
+
+
+void ecef2ned_wgs_84( int n, double ref_lat_deg, double ref_lon_deg,
+                      double ref_alt_m, const double *x, const double *y,
+                      const double *z, double *__restrict__ north,
+                      double *__restrict__ east, double *__restrict__ down )
+{
+    double R[3][3];
+    ned_axes( ref_lat_deg, ref_lon_deg, R );
+    double x0, y0, z0;
+    geod2ecef_wgs_84( ref_lat_deg, ref_lon_deg, ref_alt_m, &x0, &y0, &z0 );
+    for ( int i = 0; i < n; i++ ) {
+        double dx = x[i] - x0, dy = y[i] - y0, dz = z[i] - z0;
+        north[i] = R[0][0]*dx + R[0][1]*dy + R[0][2]*dz;
+        east[i] = R[1][0]*dx + R[1][1]*dy + R[1][2]*dz;
+        down[i] = R[2][0]*dx + R[2][1]*dy + R[2][2]*dz;
+    }
+}
+
+
+void ned2ecef_wgs_84( int n, double ref_lat_deg, double ref_lon_deg,
+                      double ref_alt_m, const double *north,
+                      const double *east, const double *down,
+                      double *__restrict__ x, double *__restrict__ y,
+                      double *__restrict__ z )
+{
+    double R[3][3];
+    ned_axes( ref_lat_deg, ref_lon_deg, R );
+    double x0, y0, z0;
+    geod2ecef_wgs_84( ref_lat_deg, ref_lon_deg, ref_alt_m, &x0, &y0, &z0 );
+    for ( int i = 0; i < n; i++ ) {
+        double N = north[i], E = east[i], D = down[i];
+        x[i] = x0 + R[0][0]*N + R[1][0]*E + R[2][0]*D;
+        y[i] = y0 + R[0][1]*N + R[1][1]*E + R[2][1]*D;
+        z[i] = z0 + R[0][2]*N + R[1][2]*E + R[2][2]*D;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//
+// Direct and inverse distance functions 
+//
+// Proceedings of the 7th International Symposium on Geodetic
+// Computations, 1985
+//
+// "The Nested Coefficient Method for Accurate Solutions of Direct and
+// Inverse Geodetic Problems With Any Length"
+//
+// Zhang Xue-Lian
+// pp 747-763
+//
+// modified for FlightGear to use WGS84 only -- Norman Vine
+// modified for AuraUAS by Curtis Olson
+
+static inline double M0( double e2 ) {
+    //double e4 = e2*e2;
+    return M_PI*0.5*(1.0 - e2*( 1.0/4.0 + e2*( 3.0/64.0 + 
+					       e2*(5.0/256.0) )));
+}
+
+// given, lat1, lon1, az1 and distance (s), calculate lat2, lon2
+// and az2.  Lat, lon, and azimuth are in degrees.  distance in meters
+int geo_direct_wgs_84 ( double lat1, double lon1, double az1,
+                        double s, double *lat2, double *lon2,
+                        double *az2 )
+{
+    double a = EQURAD, rf = iFLATTENING;
+    double testv = 1.0E-10;
+    double f = ( rf > 0.0 ? 1.0/rf : 0.0 );
+    double b = a*(1.0-f);
+    double e2 = f*(2.0-f);
+    double phi1 = lat1*d2r, lam1 = lon1*d2r;
+    double sinphi1 = sin(phi1), cosphi1 = cos(phi1);
+    double azm1 = az1*d2r;
+    double sinaz1 = sin(azm1), cosaz1 = cos(azm1);
+	
+	
+    if( fabs(s) < 0.01 ) {	// distance < centimeter => congruency
+	*lat2 = lat1;
+	*lon2 = lon1;
+	*az2 = 180.0 + az1;
+	if( *az2 > 360.0 ) *az2 -= 360.0;
+	return 0;
+    } else if( fabs(cosphi1) > std::numeric_limits<int>::min() ) {
+    	// non-polar origin
+	// u1 is reduced latitude
+	double tanu1 = sqrt(1.0-e2)*sinphi1/cosphi1;
+	double sig1 = atan2(tanu1,cosaz1);
+	double cosu1 = 1.0/sqrt( 1.0 + tanu1*tanu1 ), sinu1 = tanu1*cosu1;
+	double sinaz =  cosu1*sinaz1, cos2saz = 1.0-sinaz*sinaz;
+	double us = cos2saz*e2/(1.0-e2);
+
+	// Terms
+	double	ta = 1.0+us*(4096.0+us*(-768.0+us*(320.0-175.0*us)))/16384.0,
+	    tb = us*(256.0+us*(-128.0+us*(74.0-47.0*us)))/1024.0,
+	    tc = 0;
+
+	// FIRST ESTIMATE OF SIGMA (SIG)
+	double first = s/(b*ta);  // !!
+	double sig = first;
+	double c2sigm, sinsig,cossig, temp,denom,rnumer, dlams, dlam;
+	do {
+	    c2sigm = cos(2.0*sig1+sig);
+	    sinsig = sin(sig); cossig = cos(sig);
+	    temp = sig;
+	    sig = first + 
+		tb*sinsig*(c2sigm+tb*(cossig*(-1.0+2.0*c2sigm*c2sigm) - 
+				      tb*c2sigm*(-3.0+4.0*sinsig*sinsig)
+				      *(-3.0+4.0*c2sigm*c2sigm)/6.0)
+			   /4.0);
+	} while( fabs(sig-temp) > testv);
+
+	// LATITUDE OF POINT 2
+	// DENOMINATOR IN 2 PARTS (TEMP ALSO USED LATER)
+	temp = sinu1*sinsig-cosu1*cossig*cosaz1;
+	denom = (1.0-f)*sqrt(sinaz*sinaz+temp*temp);
+
+	// NUMERATOR
+	rnumer = sinu1*cossig+cosu1*sinsig*cosaz1;
+	*lat2 = atan2(rnumer,denom)*r2d;
+
+	// DIFFERENCE IN LONGITUDE ON AUXILARY SPHERE (DLAMS )
+	rnumer = sinsig*sinaz1;
+	denom = cosu1*cossig-sinu1*sinsig*cosaz1;
+	dlams = atan2(rnumer,denom);
+
+	// TERM C
+	tc = f*cos2saz*(4.0+f*(4.0-3.0*cos2saz))/16.0;
+
+	// DIFFERENCE IN LONGITUDE
+	dlam = dlams-(1.0-tc)*f*sinaz*(sig+tc*sinsig*
+				       (c2sigm+
+					tc*cossig*(-1.0+2.0*
+						   c2sigm*c2sigm)));
+	*lon2 = (lam1+dlam)*r2d;
+	if (*lon2 > 180.0  ) *lon2 -= 360.0;
+	if (*lon2 < -180.0 ) *lon2 += 360.0;
+
+	// AZIMUTH - FROM NORTH
+	*az2 = atan2(-sinaz,temp)*r2d;
+	if ( fabs(*az2) < testv ) *az2 = 0.0;
+	if( *az2 < 0.0) *az2 += 360.0;
+	return 0;
+    } else {			// phi1 == 90 degrees, polar origin
+	double dM = a*M0(e2) - s;
+	double paz = ( phi1 < 0.0 ? 180.0 : 0.0 );
+        double zero = 0.0f;
+	return geo_direct_wgs_84( zero, lon1, paz, dM, lat2, lon2, az2 );
+    } 
+}
+
+// given lat1, lon1, lat2, lon2, calculate starting and ending
+// az1, az2 and distance (s).  Lat, lon, and azimuth are in degrees.
+// distance in meters
+int geo_inverse_wgs_84( double lat1, double lon1, double lat2,
+			double lon2, double *az1, double *az2,
+			double *s )
+{
+    double a = EQURAD, rf = iFLATTENING;
+    int iter=0;
+    double testv = 1.0E-10;
+    double f = ( rf > 0.0 ? 1.0/rf : 0.0 );
+    double b = a*(1.0-f);
+    // double e2 = f*(2.0-f); // unused in this routine
+    double phi1 = lat1*d2r, lam1 = lon1*d2r;
+    double sinphi1 = sin(phi1), cosphi1 = cos(phi1);
+    double phi2 = lat2*d2r, lam2 = lon2*d2r;
+    double sinphi2 = sin(phi2), cosphi2 = cos(phi2);
+	
+    if( (fabs(lat1-lat2) < testv && 
+	 ( fabs(lon1-lon2) < testv)) || (fabs(lat1-90.0) < testv ) )
+    {	
+	// TWO STATIONS ARE IDENTICAL : SET DISTANCE & AZIMUTHS TO ZERO */
+	*az1 = 0.0; *az2 = 0.0; *s = 0.0;
+	return 0;
+    } else if(  fabs(cosphi1) < testv ) {
+	// initial point is polar
+	int k = geo_inverse_wgs_84( lat2,lon2,lat1,lon1, az1,az2,s );
+	k = k; // avoid compiler error since return result is unused
+	b = *az1; *az1 = *az2; *az2 = b;
+	return 0;
+    } else if( fabs(cosphi2) < testv ) {
+	// terminal point is polar
+        double _lon1 = lon1 + 180.0f;
+	int k = geo_inverse_wgs_84( lat1, lon1, lat1, _lon1, 
+				    az1, az2, s );
+	k = k; // avoid compiler error since return result is unused
+	*s /= 2.0;
+	*az2 = *az1 + 180.0;
+	if( *az2 > 360.0 ) *az2 -= 360.0; 
+	return 0;
+    } else if( (fabs( fabs(lon1-lon2) - 180 ) < testv) && 
+	       (fabs(lat1+lat2) < testv) ) 
+    {
+	// Geodesic passes through the pole (antipodal)
+	double s1,s2;
+	geo_inverse_wgs_84( lat1,lon1, lat1,lon2, az1,az2, &s1 );
+	geo_inverse_wgs_84( lat2,lon2, lat1,lon2, az1,az2, &s2 );
+	*az2 = *az1;
+	*s = s1 + s2;
+	return 0;
+    } else {
+	// antipodal and polar points don't get here
+	double dlam = lam2 - lam1, dlams = dlam;
+	double sdlams,cdlams, sig,sinsig,cossig, sinaz,
+	    cos2saz, c2sigm;
+	double tc,temp, us,rnumer,denom, ta,tb;
+	double cosu1,sinu1, sinu2,cosu2;
+
+	// Reduced latitudes
+	temp = (1.0-f)*sinphi1/cosphi1;
+	cosu1 = 1.0/sqrt(1.0+temp*temp);
+	sinu1 = temp*cosu1;
+	temp = (1.0-f)*sinphi2/cosphi2;
+	cosu2 = 1.0/sqrt(1.0+temp*temp);
+	sinu2 = temp*cosu2;
+    
+	do {
+	    sdlams = sin(dlams), cdlams = cos(dlams);
+	    sinsig = sqrt(cosu2*cosu2*sdlams*sdlams+
+			  (cosu1*sinu2-sinu1*cosu2*cdlams)*
+			  (cosu1*sinu2-sinu1*cosu2*cdlams));
+	    cossig = sinu1*sinu2+cosu1*cosu2*cdlams;
+	    
+	    sig = atan2(sinsig,cossig);
+	    sinaz = cosu1*cosu2*sdlams/sinsig;
+	    cos2saz = 1.0-sinaz*sinaz;
+	    c2sigm = (sinu1 == 0.0 || sinu2 == 0.0 ? cossig : 
+		      cossig-2.0*sinu1*sinu2/cos2saz);
+	    tc = f*cos2saz*(4.0+f*(4.0-3.0*cos2saz))/16.0;
+	    temp = dlams;
+	    dlams = dlam+(1.0-tc)*f*sinaz*
+		(sig+tc*sinsig*
+		 (c2sigm+tc*cossig*(-1.0+2.0*c2sigm*c2sigm)));
+	    if (fabs(dlams) > M_PI && iter++ > 50) {
+		return iter;
+	    }
+	} while ( fabs(temp-dlams) > testv);
+
+	us = cos2saz*(a*a-b*b)/(b*b); // !!
+	// BACK AZIMUTH FROM NORTH
+	rnumer = -(cosu1*sdlams);
+	denom = sinu1*cosu2-cosu1*sinu2*cdlams;
+	*az2 = atan2(rnumer,denom)*r2d;
+	if( fabs(*az2) < testv ) *az2 = 0.0;
+	if(*az2 < 0.0) *az2 += 360.0;
+
+	// FORWARD AZIMUTH FROM NORTH
+	rnumer = cosu2*sdlams;
+	denom = cosu1*sinu2-sinu1*cosu2*cdlams;
+	*az1 = atan2(rnumer,denom)*r2d;
+	if( fabs(*az1) < testv ) *az1 = 0.0;
+	if(*az1 < 0.0) *az1 += 360.0;
+
+	// Terms a & b
+	ta = 1.0+us*(4096.0+us*(-768.0+us*(320.0-175.0*us)))/
+	    16384.0;
+	tb = us*(256.0+us*(-128.0+us*(74.0-47.0*us)))/1024.0;
+
+	// GEODETIC DISTANCE
+	*s = b*ta*(sig-tb*sinsig*
+		   (c2sigm+tb*(cossig*(-1.0+2.0*c2sigm*c2sigm)-tb*
+			       c2sigm*(-3.0+4.0*sinsig*sinsig)*
+			       (-3.0+4.0*c2sigm*c2sigm)/6.0)/
+		    4.0));
+	return 0;
+    }
+}
+
+
+int geo_direct_wgs_84 ( int n, const double *lat1, const double *lon1,
+                        const double *az1, const double *s,
+                        double *lat2, double *lon2, double *az2 )
+{
+    int result = 0;
+    for ( int i = 0; i < n; i++ ) {
+        if ( geo_direct_wgs_84( lat1[i], lon1[i], az1[i], s[i],
+                                &lat2[i], &lon2[i], &az2[i] ) ) {
+            result++;
+        }
+    }
+    return result;
+}
+
+
+int geo_inverse_wgs_84( int n, const double *lat1, const double *lon1,
+                        const double *lat2, const double *lon2,
+                        double *az1, double *az2, double *s )
+{
+    int result = 0;
+    for ( int i = 0; i < n; i++ ) {
+        if ( geo_inverse_wgs_84( lat1[i], lon1[i], lat2[i], lon2[i],
+                                 &az1[i], &az2[i], &s[i] ) ) {
+            result++;
+        }
+    }
+    return result;
+}
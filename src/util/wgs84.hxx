@@ -0,0 +1,61 @@
+// wgs84.hxx - WGS84 ellipsoid geodesy: cartesian conversions and the
+//             geodesic direct and inverse solutions
+//
+// The batch versions take structure-of-arrays inputs (one array per
+// coordinate) and write to separate output arrays so the inner loops
+// are straight line code over contiguous memory the compiler can
+// vectorize.  Input and output arrays must not overlap.
+
+#pragma once
+
+// given, lat1, lon1, az1 and distance (s), calculate lat2, lon2 and
+// az2 (the starting return heading.)  Lat, lon, and azimuth are in
+// degrees, distance in meters.
+int geo_direct_wgs_84 ( double lat1, double lon1, double az1,
+                        double s, double *lat2, double *lon2,
+                        double *az2 );
+
+// given lat1, lon1, lat2, lon2, calculate starting and ending az1,
+// az2 and distance (s).  Lat, lon, and azimuth are in degrees,
+// distance in meters.  Returns non-zero if the solution did not
+// converge.
+int geo_inverse_wgs_84( double lat1, double lon1, double lat2,
+			double lon2, double *az1, double *az2,
+			double *s );
+
+// geodetic lat/lon (degrees) and altitude (meters) to earth centered,
+// earth fixed cartesian coordinates (meters)
+void geod2ecef_wgs_84( double lat_deg, double lon_deg, double alt_m,
+                       double *x, double *y, double *z );
+
+
+// batch versions of the above over n points
+
+void geod2ecef_wgs_84( int n, const double *lat_deg, const double *lon_deg,
+                       const double *alt_m, double *x, double *y, double *z );
+
+int geo_direct_wgs_84 ( int n, const double *lat1, const double *lon1,
+                        const double *az1, const double *s,
+                        double *lat2, double *lon2, double *az2 );
+
+// returns the number of points that did not converge
+int geo_inverse_wgs_84( int n, const double *lat1, const double *lon1,
+                        const double *lat2, const double *lon2,
+                        double *az1, double *az2, double *s );
+
+// earth centered, earth fixed cartesian to geodetic lat/lon (degrees)
+// and altitude (meters), closed form (Vermeille 2002)
+void ecef2geod_wgs_84( int n, const double *x, const double *y,
+                       const double *z, double *lat_deg, double *lon_deg,
+                       double *alt_m );
+
+// earth centered, earth fixed cartesian to and from local north, east,
+// down (meters) about a geodetic reference point
+void ecef2ned_wgs_84( int n, double ref_lat_deg, double ref_lon_deg,
+                      double ref_alt_m, const double *x, const double *y,
+                      const double *z, double *north, double *east,
+                      double *down );
+void ned2ecef_wgs_84( int n, double ref_lat_deg, double ref_lon_deg,
+                      double ref_alt_m, const double *north,
+                      const double *east, const double *down,
+                      double *x, double *y, double *z );
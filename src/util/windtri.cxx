@@ -0,0 +1,39 @@
+// windtri.cxx - wind triangle calcs
+//
+
+#include <math.h>
+
+#include "windtri.hxx"
+
+static const double d2r = M_PI / 180.0;
+static const double r2d = 180.0 / M_PI;
+static const double m2pi = M_PI * 2.0;
+
+bool wind_course( double ws_kt, double tas_kt, double wd_deg,
+                  double crs_deg, double *hd_deg, double *gs_kt )
+{
+    // from williams.best.vwh.net/avform.htm (aviation formulas)
+    double wd = wd_deg * d2r;
+    double crs = crs_deg * d2r;
+    double hd = 0.0;
+    bool result = false;
+    *gs_kt = 0.0;
+    *hd_deg = 0.0;
+    if ( tas_kt > 0.1 ) {
+	double swc = (ws_kt/tas_kt)*sin(wd-crs);
+	if ( fabs(swc) > 1.0 ) {
+	    // course cannot be flown, wind too strong
+	    // point nose into estimated wind and "kite" as best we can
+	    hd = wd + M_PI;
+	    if ( hd > m2pi ) { hd -= m2pi; }
+	} else {
+	    hd = crs + asin(swc);
+	    if ( hd < 0.0 ) { hd += m2pi; }
+	    if ( hd > m2pi ) { hd -= m2pi; }
+	    *gs_kt = tas_kt * sqrt(1-swc*swc) - ws_kt * cos(wd - crs);
+	    result = true;
+	}
+	*hd_deg = hd * r2d;
+    }
+    return result;
+}
@@ -0,0 +1,13 @@
+// windtri.hxx - wind triangle calcs
+//
+
+#pragma once
+
+// Given a wind speed estimate, true airspeed estimate, wind direction
+// estimate, and a desired course to fly, then compute a true heading
+// to fly to achieve the desired course in the given wind.  Also
+// compute the estimated ground speed.  Returns false if the course
+// cannot be flown (wind too strong, or no airspeed) in which case
+// hd_deg points the nose into the wind and gs_kt is zero.
+bool wind_course( double ws_kt, double tas_kt, double wd_deg,
+                  double crs_deg, double *hd_deg, double *gs_kt );
@@ -0,0 +1,60 @@
+// Time the geofence build and the per frame check() as the fence
+// grows from a hand drawn polygon to a dense survey boundary.
+//
+// usage: geofence_bench [queries]
+//
+// Each fence is a wavy ring about 5 km across with 16 to 64k
+// vertices.  Queries follow a slow circular path through it, like
+// a loiter, so the numbers reflect the cache behavior of a real
+// flight rather than random scatter across the grid.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>		// atoi()
+
+#include <vector>
+using std::vector;
+
+#include "util/geofence.hxx"
+#include "util/timing.h"
+
+int main( int argc, char **argv ) {
+    int queries = 200000;
+    if ( argc > 1 ) {
+        queries = atoi( argv[1] );
+    }
+
+    printf("%8s %10s %10s %8s\n", "vertices", "build ms", "check us", "breach");
+    int sizes[] = { 16, 256, 4096, 65536 };
+    for ( int n : sizes ) {
+        vector<FencePoint> poly( n );
+        for ( int i = 0; i < n; i++ ) {
+            double a = 2.0 * M_PI * i / n;
+            double r = 5000.0 + 300.0 * sin( 11.0 * a );
+            poly[i].x = r * cos( a );
+            poly[i].y = r * sin( a );
+        }
+
+        GeoFence fence;
+        double t0 = get_Time();
+        fence.add_zone( "bench", true, poly, 0.0, 400.0 );
+        double build = get_Time() - t0;
+
+        int breach = 0;
+        t0 = get_Time();
+        for ( int i = 0; i < queries; i++ ) {
+            double a = i * 1.0e-4;
+            double x = 4700.0 * cos( a ) + 150.0 * sin( 7.0 * a );
+            double y = 4700.0 * sin( a );
+            if ( fence.check( x, y, 100.0 ).breach ) {
+                breach++;
+            }
+        }
+        double check = get_Time() - t0;
+
+        printf("%8d %10.2f %10.3f %8d\n", n, build * 1e3,
+               check / queries * 1e6, breach);
+    }
+
+    return 0;
+}
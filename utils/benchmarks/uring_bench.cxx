@@ -0,0 +1,196 @@
+// Compare the plain (epoll + recv), batched (epoll + recvmmsg) and
+// io_uring sensor read paths on a simulated Goldy2 UDP stream.
+//
+// usage: uring_bench [seconds] [hz]
+//
+// A sender thread plays the Goldy2 role: each frame it sends an imu
+// packet (512 bytes) followed by gps, airdata and pilot packets to a
+// local UDP port.  The receiver runs the same frame loop the main
+// program does (sleep on the reactor until the sync source is
+// readable, then read everything) and reports system calls and cpu
+// time per frame for each backend.  System calls are counted at the
+// call sites, the cpu time comes from getrusage(RUSAGE_THREAD).
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>		// atoi()
+#include <string.h>
+#include <sys/ioctl.h>		// ioctl()
+#include <sys/resource.h>	// getrusage()
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+using std::vector;
+
+#include "util/netSocket.h"
+#include "util/reactor.hxx"
+#include "util/timing.h"
+#include "util/udp_batch.hxx"
+#include "util/uring.hxx"
+
+static const int port = 6543;
+
+static std::atomic<bool> sending;
+
+static void sender( int hz ) {
+    netSocket sock;
+    sock.open( false );
+    sock.connect( "127.0.0.1", port );
+    uint8_t imu[512], gps[96], air[64], pilot[48];
+    memset( imu, 0x81, sizeof(imu) );
+    memset( gps, 0x82, sizeof(gps) );
+    memset( air, 0x83, sizeof(air) );
+    memset( pilot, 0x84, sizeof(pilot) );
+    double next = get_Time();
+    while ( sending ) {
+        // the imu packet arrives last so the receiver sees a
+        // complete frame when it wakes on it
+        sock.send( gps, sizeof(gps) );
+        sock.send( air, sizeof(air) );
+        sock.send( pilot, sizeof(pilot) );
+        sock.send( imu, sizeof(imu) );
+        next += 1.0 / hz;
+        double wait = next - get_Time();
+        if ( wait > 0.0 ) {
+            usleep( wait * 1000000 );
+        }
+    }
+    sock.close();
+}
+
+static double thread_cpu() {
+    struct rusage ru;
+    getrusage( RUSAGE_THREAD, &ru );
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6
+        + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+}
+
+struct result {
+    int frames;
+    uint64_t packets;
+    uint64_t syscalls;
+    double cpu;
+};
+
+enum backend { PLAIN, BATCH, RING };
+
+static bool run( backend mode, double seconds, int hz, result *r ) {
+    netSocket sock;
+    if ( !sock.open( false ) || sock.bind( "", port ) == -1 ) {
+        fprintf( stderr, "cannot bind udp port %d\n", port );
+        return false;
+    }
+    sock.setBlocking( false );
+
+    Reactor reactor;
+    SensorRing ring;
+    UDPBatch batch;
+    int slot = -1;
+    if ( !reactor.init() ) {
+        return false;
+    }
+    if ( mode == BATCH ) {
+        batch.init( sock.getHandle() );
+    }
+    if ( mode == RING ) {
+        if ( !ring.init() ) {
+            return false;
+        }
+        slot = ring.add( sock.getHandle(), true, "goldy2" );
+        if ( slot < 0 ) {
+            return false;
+        }
+        reactor.set_sync( ring.get_fd() );
+    } else {
+        reactor.set_sync( sock.getHandle() );
+    }
+
+    sending = true;
+    std::thread tx( sender, hz );
+
+    memset( r, 0, sizeof(*r) );
+    uint8_t buf[2048];
+    double start_cpu = thread_cpu();
+    double end = get_Time() + seconds;
+    uint32_t start_wakeups = reactor.wakeups;
+    while ( get_Time() < end ) {
+        reactor.wait( get_Time() + 0.1 );
+        bool imu = false;
+        while ( !imu ) {
+            int len;
+            uint8_t *packet;
+            double stamp;
+            if ( mode == RING ) {
+                len = ring.recv( slot, &packet, &stamp );
+            } else if ( mode == BATCH ) {
+                len = batch.next( &packet, &stamp );
+            } else {
+                len = sock.recv( buf, sizeof(buf), 0 );
+                r->syscalls++;
+            }
+            if ( len <= 0 ) {
+                break;
+            }
+            r->packets++;
+            if ( len == 512 ) {
+                // goldy2_update() checks for a backlog after each imu
+                // packet
+                int bytes_available = 0;
+                if ( mode == RING ) {
+                    bytes_available = ring.available( slot );
+                } else if ( mode == BATCH ) {
+                    bytes_available = batch.available();
+                } else {
+                    ioctl( sock.getHandle(), FIONREAD, &bytes_available );
+                    r->syscalls++;
+                }
+                imu = ( bytes_available < 512 );
+            }
+        }
+        r->frames++;
+    }
+    r->cpu = thread_cpu() - start_cpu;
+    r->syscalls += reactor.wakeups - start_wakeups;
+    if ( mode == RING ) {
+        r->syscalls += ring.syscalls;
+    } else if ( mode == BATCH ) {
+        r->syscalls += batch.syscalls;
+    }
+
+    sending = false;
+    tx.join();
+    sock.close();
+    return true;
+}
+
+static void report( const char *name, const result &r ) {
+    printf("%-8s frames: %6d  packets: %7llu  syscalls/frame: %5.2f  cpu usec/frame: %6.1f  cpu usec/packet: %5.1f\n",
+           name, r.frames, (unsigned long long)r.packets,
+           (double)r.syscalls / r.frames, r.cpu * 1000000.0 / r.frames,
+           r.cpu * 1000000.0 / r.packets);
+}
+
+int main( int argc, char **argv ) {
+    double seconds = argc > 1 ? atof(argv[1]) : 10.0;
+    int hz = argc > 2 ? atoi(argv[2]) : 100;
+
+    netInit( NULL, NULL );
+
+    printf("simulated goldy2 stream: %d hz, 4 packets/frame, %.0f sec per backend\n",
+           hz, seconds);
+    result plain, batch, ring;
+    if ( run( PLAIN, seconds, hz, &plain ) ) {
+        report( "epoll", plain );
+    }
+    if ( run( BATCH, seconds, hz, &batch ) ) {
+        report( "recvmmsg", batch );
+    }
+    if ( run( RING, seconds, hz, &ring ) ) {
+        report( "io_uring", ring );
+    } else {
+        printf("io_uring backend not available on this system\n");
+    }
+    return 0;
+}
@@ -0,0 +1,558 @@
+// convert flight logs to the columnar format and pull selected
+// channels back out of them
+
+#include <fcntl.h>		// open()
+#include <stdio.h>
+#include <stdlib.h>		// exit()
+#include <string.h>
+#include <sys/mman.h>		// mmap()
+#include <sys/stat.h>
+#include <unistd.h>		// close()
+
+#include <zlib.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::map;
+using std::string;
+using std::vector;
+
+#include "comms/columnlog.hxx"
+#include "comms/seglog.hxx"
+
+void usage() {
+    printf("\nUsage:\n");
+    printf("  aura-logexport convert flight.dat.gz flight.alc\n");
+    printf("  aura-logexport unseg flight_dir flight.dat\n");
+    printf("  aura-logexport list flight.alc\n");
+    printf("  aura-logexport extract flight.alc --channels imu0.p_rad_sec,...\n");
+    printf("      [--start sec] [--end sec] [--threads n] [--raw] [--out file.csv]\n");
+    printf("\nAll channels of one extract must come from the same stream.\n");
+    printf("--raw skips the unit scaling (values as packed.)\n");
+    exit(0);
+}
+
+
+// convert a (gzipped or plain) packet stream log
+static int convert( const char *infile, const char *outfile ) {
+    gzFile gz = gzopen( infile, "rb" );
+    if ( gz == NULL ) {
+        fprintf( stderr, "cannot open %s\n", infile );
+        return 1;
+    }
+    ColumnLogWriter writer;
+    if ( !writer.open( outfile, 4096, true ) ) {
+        gzclose(gz);
+        return 1;
+    }
+
+    vector<uint8_t> buf;
+    uint8_t chunk[65536];
+    int len;
+    unsigned int pos = 0;
+    uint32_t bad_cksum = 0;
+    while ( (len = gzread(gz, chunk, sizeof(chunk))) > 0 ) {
+        buf.insert( buf.end(), chunk, chunk + len );
+        while ( pos + 6 <= buf.size() ) {
+            if ( buf[pos] != 147 || buf[pos+1] != 224 ) {
+                pos++;
+                continue;
+            }
+            unsigned int size = buf[pos+3] + 6;
+            if ( pos + size > buf.size() ) {
+                break;
+            }
+            uint8_t c0 = 0, c1 = 0;
+            for ( unsigned int i = pos + 2; i < pos + size - 2; i++ ) {
+                c0 += buf[i];
+                c1 += c0;
+            }
+            if ( c0 != buf[pos+size-2] || c1 != buf[pos+size-1] ) {
+                bad_cksum++;
+                pos++;
+                continue;
+            }
+            writer.log_packet( &buf[pos], size );
+            pos += size;
+        }
+        // drop consumed bytes
+        buf.erase( buf.begin(), buf.begin() + pos );
+        pos = 0;
+    }
+    gzclose(gz);
+    printf("packets: %u  skipped (no columnar layout): %u  bad checksum: %u\n",
+           writer.packets, writer.skipped, bad_cksum);
+    writer.close();
+    return 0;
+}
+
+
+static void write_block( const uint8_t *data, int len, double time,
+                         void *arg )
+{
+    fwrite( data, 1, len, (FILE *)arg );
+}
+
+// reassemble the packet stream from crash safe log segments
+static int unseg( const char *dir, const char *outfile ) {
+    FILE *out = fopen( outfile, "wb" );
+    if ( out == NULL ) {
+        fprintf( stderr, "cannot open %s\n", outfile );
+        return 1;
+    }
+    int blocks = 0;
+    int bad_blocks = 0;
+    int seg;
+    for ( seg = 0; ; seg++ ) {
+        char file[1024];
+        snprintf( file, sizeof(file), "%s/flight-%04d.seg", dir, seg );
+        int bad = 0;
+        int good = seglog_read( file, write_block, out, &bad );
+        if ( good < 0 ) {
+            break;
+        }
+        blocks += good;
+        bad_blocks += bad;
+    }
+    fclose(out);
+    printf("segments: %d  blocks: %d  damaged blocks: %d\n", seg, blocks,
+           bad_blocks);
+    return seg > 0 ? 0 : 1;
+}
+
+
+// memory mapped columnar log
+class ColumnLogReader {
+public:
+    const uint8_t *base;
+    size_t size;
+    map<int, alc_schema> schemas;
+    vector<alc_index_entry> index;
+
+    ColumnLogReader(): base(NULL), size(0) {}
+    ~ColumnLogReader() {
+        if ( base != NULL ) {
+            munmap( (void *)base, size );
+        }
+    }
+
+    bool open( const char *file ) {
+        int fd = ::open( file, O_RDONLY );
+        if ( fd < 0 ) {
+            fprintf( stderr, "cannot open %s\n", file );
+            return false;
+        }
+        struct stat st;
+        fstat( fd, &st );
+        size = st.st_size;
+        if ( size < 32 ) {
+            fprintf( stderr, "%s is too short\n", file );
+            ::close(fd);
+            return false;
+        }
+        base = (const uint8_t *)mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        ::close(fd);
+        if ( base == MAP_FAILED ) {
+            base = NULL;
+            fprintf( stderr, "cannot map %s\n", file );
+            return false;
+        }
+        if ( memcmp( base, "AURACOL1", 8 ) != 0 ) {
+            fprintf( stderr, "%s is not a columnar log\n", file );
+            return false;
+        }
+        if ( memcmp( base + size - 8, "AURAIDX1", 8 ) != 0 ) {
+            // never closed (crash or power loss)
+            fprintf( stderr, "%s has no index, recovering\n", file );
+            return recover();
+        }
+        return read_footer();
+    }
+
+    string stream_name( int key ) {
+        char buf[16];
+        snprintf( buf, sizeof(buf), "%d", key & 0xff );
+        return schemas[key].name + buf;
+    }
+
+private:
+    string read_string( const uint8_t **p ) {
+        uint16_t len;
+        memcpy( &len, *p, 2 );
+        string s( (const char *)*p + 2, len );
+        *p += 2 + len;
+        return s;
+    }
+
+    bool read_footer() {
+        uint64_t footer;
+        memcpy( &footer, base + size - 16, 8 );
+        const uint8_t *p = base + footer;
+        const uint8_t *end = base + size - 16;
+        uint32_t count;
+        if ( footer >= size || memcmp( p, "SCHM", 4 ) != 0 ) {
+            fprintf( stderr, "bad footer\n" );
+            return false;
+        }
+        memcpy( &count, p + 4, 4 );
+        p += 8;
+        for ( unsigned int i = 0; i < count && p < end; i++ ) {
+            uint16_t key;
+            memcpy( &key, p, 2 );
+            p += 2;
+            alc_schema s;
+            s.packet_id = key >> 8;
+            s.name = read_string(&p);
+            s.fmt = read_string(&p);
+            s.fields = read_string(&p);
+            if ( !s.parse() ) {
+                fprintf( stderr, "bad schema for %s\n", s.name.c_str() );
+                return false;
+            }
+            schemas[key] = s;
+        }
+        if ( p + 8 > end || memcmp( p, "INDX", 4 ) != 0 ) {
+            fprintf( stderr, "bad index\n" );
+            return false;
+        }
+        memcpy( &count, p + 4, 4 );
+        p += 8;
+        if ( p + count * sizeof(alc_index_entry) > end ) {
+            fprintf( stderr, "truncated index\n" );
+            return false;
+        }
+        index.resize(count);
+        memcpy( index.data(), p, count * sizeof(alc_index_entry) );
+        return true;
+    }
+
+    // rebuild the index by walking the chunk headers from the start
+    // of the file, up to the first torn or damaged chunk.  The schema
+    // went down with the footer, so the built in layouts stand in for
+    // it (as long as the column types still agree.)
+    bool recover() {
+        size_t pos = 8;
+        int bad_schema = 0;
+        while ( pos + sizeof(alc_chunk_header) <= size ) {
+            alc_index_entry entry;
+            alc_chunk_header &h = entry.header;
+            memcpy( &h, base + pos, sizeof(h) );
+            entry.offset = pos + sizeof(h);
+            if ( memcmp( h.magic, "CHNK", 4 ) != 0
+                 || h.comp_size > size - entry.offset
+                 || alc_type_size(h.type) == 0
+                 || h.raw_size != h.rows * alc_type_size(h.type)
+                 || crc32( 0L, base + entry.offset, h.comp_size ) != h.crc )
+            {
+                break;
+            }
+            pos = entry.offset + h.comp_size;
+            if ( schemas.find(h.stream) == schemas.end() ) {
+                const alc_schema *s = alc_find_schema( h.stream >> 8 );
+                if ( s == NULL ) {
+                    bad_schema++;
+                    continue;
+                }
+                schemas[h.stream] = *s;
+            }
+            const alc_schema &s = schemas[h.stream];
+            if ( h.column >= s.fmt.length() || s.fmt[h.column] != h.type ) {
+                bad_schema++;
+                continue;
+            }
+            index.push_back( entry );
+        }
+        fprintf( stderr, "recovered %d chunks (%lu of %lu bytes)",
+                 (int)index.size(), (unsigned long)pos, (unsigned long)size );
+        if ( bad_schema ) {
+            fprintf( stderr, ", %d with an unknown layout", bad_schema );
+        }
+        fprintf( stderr, "\n" );
+        return !index.empty();
+    }
+};
+
+
+static int list( const char *file ) {
+    ColumnLogReader log;
+    if ( !log.open(file) ) {
+        return 1;
+    }
+    map<int, alc_schema>::iterator it;
+    for ( it = log.schemas.begin(); it != log.schemas.end(); it++ ) {
+        int key = it->first;
+        uint64_t rows = 0;
+        double t0 = 0.0, t1 = 0.0;
+        for ( unsigned int i = 0; i < log.index.size(); i++ ) {
+            alc_chunk_header &h = log.index[i].header;
+            if ( h.stream == key && h.column == 1 ) {
+                if ( rows == 0 ) {
+                    t0 = h.t_first;
+                }
+                rows += h.rows;
+                t1 = h.t_last;
+            }
+        }
+        printf("%s: %lu rows, %.2f - %.2f sec\n", log.stream_name(key).c_str(),
+               (unsigned long)rows, t0, t1);
+        alc_schema &s = it->second;
+        for ( unsigned int i = 1; i < s.field_names.size(); i++ ) {
+            printf("  %s.%s\n", log.stream_name(key).c_str(),
+                   s.field_names[i].c_str());
+        }
+    }
+    return 0;
+}
+
+
+// one chunk to decompress
+struct extract_job {
+    const alc_index_entry *entry;
+    int block;                  // row block within the stream
+    int slot;                   // output column
+    vector<uint8_t> raw;
+    bool ok;
+};
+
+static int extract( const char *file, const string &channels,
+                    double start, double end, int threads, bool raw,
+                    const char *outfile )
+{
+    ColumnLogReader log;
+    if ( !log.open(file) ) {
+        return 1;
+    }
+
+    // resolve stream + column names (timestamp always comes first)
+    int stream_key = -1;
+    vector<int> columns;
+    columns.push_back(1);
+    size_t pos = 0;
+    while ( pos < channels.length() ) {
+        size_t comma = channels.find(',', pos);
+        if ( comma == string::npos ) {
+            comma = channels.length();
+        }
+        string channel = channels.substr(pos, comma - pos);
+        pos = comma + 1;
+        size_t dot = channel.find('.');
+        if ( dot == string::npos ) {
+            fprintf( stderr, "channel '%s' should be stream.field\n",
+                     channel.c_str() );
+            return 1;
+        }
+        string stream = channel.substr(0, dot);
+        string field = channel.substr(dot + 1);
+        int key = -1;
+        map<int, alc_schema>::iterator it;
+        for ( it = log.schemas.begin(); it != log.schemas.end(); it++ ) {
+            if ( log.stream_name(it->first) == stream
+                 || (it->second.name == stream && (it->first & 0xff) == 0) )
+            {
+                key = it->first;
+            }
+        }
+        if ( key < 0 ) {
+            fprintf( stderr, "no stream '%s' in %s\n", stream.c_str(), file );
+            return 1;
+        }
+        if ( stream_key >= 0 && key != stream_key ) {
+            fprintf( stderr, "all channels must come from one stream\n" );
+            return 1;
+        }
+        stream_key = key;
+        alc_schema &s = log.schemas[key];
+        int col = -1;
+        for ( unsigned int i = 0; i < s.field_names.size(); i++ ) {
+            if ( s.field_names[i] == field ) {
+                col = i;
+            }
+        }
+        if ( col < 0 ) {
+            fprintf( stderr, "no field '%s' in %s\n", field.c_str(),
+                     stream.c_str() );
+            return 1;
+        }
+        if ( col != 1 ) {
+            columns.push_back(col);
+        }
+    }
+    if ( stream_key < 0 ) {
+        usage();
+    }
+    alc_schema &schema = log.schemas[stream_key];
+
+    // select the chunks: blocks are numbered in file order per column
+    vector<extract_job> jobs;
+    int nblocks = 0;
+    for ( unsigned int c = 0; c < columns.size(); c++ ) {
+        int block = 0;
+        for ( unsigned int i = 0; i < log.index.size(); i++ ) {
+            const alc_chunk_header &h = log.index[i].header;
+            if ( h.stream != stream_key || h.column != columns[c] ) {
+                continue;
+            }
+            if ( h.t_last >= start && h.t_first <= end ) {
+                extract_job job;
+                job.entry = &log.index[i];
+                job.block = block;
+                job.slot = c;
+                job.ok = false;
+                jobs.push_back(job);
+            }
+            block++;
+        }
+        if ( block > nblocks ) {
+            nblocks = block;
+        }
+    }
+
+    // decompress in parallel
+    std::atomic<unsigned int> next(0);
+    auto work = [&]() {
+        unsigned int i;
+        while ( (i = next++) < jobs.size() ) {
+            extract_job &job = jobs[i];
+            const alc_chunk_header &h = job.entry->header;
+            const uint8_t *comp = log.base + job.entry->offset;
+            if ( job.entry->offset + h.comp_size > log.size
+                 || crc32( 0L, comp, h.comp_size ) != h.crc )
+            {
+                continue;
+            }
+            job.raw.resize( h.raw_size );
+            job.ok = alc_decompress( comp, h.comp_size, h.codec,
+                                     alc_type_size(h.type), job.raw.data(),
+                                     h.raw_size );
+        }
+    };
+    if ( threads < 1 ) {
+        threads = 1;
+    }
+    vector<std::thread> pool;
+    for ( int i = 1; i < threads; i++ ) {
+        pool.push_back( std::thread(work) );
+    }
+    work();
+    for ( unsigned int i = 0; i < pool.size(); i++ ) {
+        pool[i].join();
+    }
+
+    // arrange by block / column
+    vector< vector<extract_job *> > table( nblocks,
+                                           vector<extract_job *>(columns.size(), NULL) );
+    for ( unsigned int i = 0; i < jobs.size(); i++ ) {
+        if ( !jobs[i].ok ) {
+            fprintf( stderr, "chunk at offset %lu is damaged, skipping\n",
+                     (unsigned long)jobs[i].entry->offset );
+            continue;
+        }
+        table[jobs[i].block][jobs[i].slot] = &jobs[i];
+    }
+
+    FILE *out = stdout;
+    if ( outfile != NULL ) {
+        out = fopen( outfile, "w" );
+        if ( out == NULL ) {
+            fprintf( stderr, "cannot open %s\n", outfile );
+            return 1;
+        }
+    }
+    for ( unsigned int c = 0; c < columns.size(); c++ ) {
+        fprintf( out, "%s%s", c ? "," : "",
+                 schema.field_names[columns[c]].c_str() );
+    }
+    fprintf( out, "\n" );
+    uint64_t rows = 0;
+    for ( int b = 0; b < nblocks; b++ ) {
+        bool complete = true;
+        for ( unsigned int c = 0; c < columns.size(); c++ ) {
+            if ( table[b][c] == NULL ) {
+                complete = false;
+            }
+        }
+        if ( !complete ) {
+            continue;
+        }
+        int n = table[b][0]->entry->header.rows;
+        for ( int r = 0; r < n; r++ ) {
+            double t = alc_get_value( schema.fmt[1], table[b][0]->raw.data(), r );
+            if ( t < start || t > end ) {
+                continue;
+            }
+            fprintf( out, "%.6f", t );
+            for ( unsigned int c = 1; c < columns.size(); c++ ) {
+                int col = columns[c];
+                double v = alc_get_value( schema.fmt[col],
+                                          table[b][c]->raw.data(), r );
+                if ( !raw ) {
+                    v /= schema.divisors[col];
+                }
+                fprintf( out, ",%.9g", v );
+            }
+            fprintf( out, "\n" );
+            rows++;
+        }
+    }
+    if ( out != stdout ) {
+        fclose(out);
+    }
+    fprintf( stderr, "%lu rows from %d chunks\n", (unsigned long)rows,
+             (int)jobs.size() );
+    return 0;
+}
+
+
+int main( int argc, char **argv ) {
+    if ( argc < 3 ) {
+        usage();
+    }
+    string cmd = argv[1];
+    if ( cmd == "convert" ) {
+        if ( argc != 4 ) {
+            usage();
+        }
+        return convert( argv[2], argv[3] );
+    } else if ( cmd == "unseg" ) {
+        if ( argc != 4 ) {
+            usage();
+        }
+        return unseg( argv[2], argv[3] );
+    } else if ( cmd == "list" ) {
+        return list( argv[2] );
+    } else if ( cmd != "extract" ) {
+        usage();
+    }
+
+    string channels;
+    double start = -1e30;
+    double end = 1e30;
+    int threads = std::thread::hardware_concurrency();
+    bool raw = false;
+    const char *outfile = NULL;
+    for ( int iarg = 3; iarg < argc; iarg++ ) {
+        if ( !strcmp(argv[iarg], "--channels") && iarg + 1 < argc ) {
+            channels = argv[++iarg];
+        } else if ( !strcmp(argv[iarg], "--start") && iarg + 1 < argc ) {
+            start = atof( argv[++iarg] );
+        } else if ( !strcmp(argv[iarg], "--end") && iarg + 1 < argc ) {
+            end = atof( argv[++iarg] );
+        } else if ( !strcmp(argv[iarg], "--threads") && iarg + 1 < argc ) {
+            threads = atoi( argv[++iarg] );
+        } else if ( !strcmp(argv[iarg], "--out") && iarg + 1 < argc ) {
+            outfile = argv[++iarg];
+        } else if ( !strcmp(argv[iarg], "--raw") ) {
+            raw = true;
+        } else {
+            usage();
+        }
+    }
+    if ( channels.empty() ) {
+        usage();
+    }
+    return extract( argv[2], channels, start, end, threads, raw, outfile );
+}
@@ -0,0 +1,130 @@
+// Crash torture test for the segment logger.
+//
+// usage: seglog_test [dir] [rounds]
+//
+// A child process logs numbered, time stamped records as fast as a
+// flight would (1000 records/sec) through small segments so rotation
+// is exercised, and is killed with SIGKILL at a random point.  The
+// surviving segments must decode to an unbroken sequence of records
+// reaching to within the flush interval (plus scheduling slop) of the
+// moment of the kill.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "comms/seglog.hxx"
+
+static const double flush_sec = 1.0;
+
+struct record {
+    uint32_t counter;
+    double wall_time;
+    uint8_t filler[52];
+};
+
+static double wall_time() {
+    struct timespec t;
+    clock_gettime( CLOCK_REALTIME, &t );
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void child( const char *dir ) {
+    SegmentLog log;
+    if ( !log.open( dir, 256 * 1024, 16 * 1024, flush_sec, false ) ) {
+        exit(1);
+    }
+    record r;
+    memset( &r, 0x55, sizeof(r) );
+    for ( uint32_t i = 0; ; i++ ) {
+        r.counter = i;
+        r.wall_time = wall_time();
+        log.write( (uint8_t *)&r, sizeof(r) );
+        log.update();
+        usleep(1000);
+    }
+}
+
+struct check_state {
+    uint32_t next;
+    double last_time;
+    bool broken;
+    int partial;                // bytes of a record split across blocks
+    record pending;
+};
+
+static void check_block( const uint8_t *data, int len, double time, void *arg ) {
+    check_state *s = (check_state *)arg;
+    for ( int i = 0; i < len; i++ ) {
+        ((uint8_t *)&s->pending)[s->partial++] = data[i];
+        if ( s->partial == sizeof(record) ) {
+            s->partial = 0;
+            if ( s->pending.counter != s->next ) {
+                s->broken = true;
+            }
+            s->next = s->pending.counter + 1;
+            s->last_time = s->pending.wall_time;
+        }
+    }
+}
+
+static bool round_trip( const char *base, int round ) {
+    char dir[256];
+    snprintf( dir, sizeof(dir), "%s/round%02d", base, round );
+    char cmd[600];
+    snprintf( cmd, sizeof(cmd), "rm -rf %s && mkdir -p %s", dir, dir );
+    if ( system(cmd) != 0 ) {
+        return false;
+    }
+
+    pid_t pid = fork();
+    if ( pid == 0 ) {
+        child(dir);
+    }
+    usleep( 1500000 + (rand() % 3000) * 1000 );
+    double kill_time = wall_time();
+    kill( pid, SIGKILL );
+    waitpid( pid, NULL, 0 );
+
+    check_state s;
+    memset( &s, 0, sizeof(s) );
+    int blocks = 0;
+    int bad = 0;
+    for ( int seg = 0; ; seg++ ) {
+        char file[300];
+        snprintf( file, sizeof(file), "%s/flight-%04d.seg", dir, seg );
+        int b = 0;
+        int good = seglog_read( file, check_block, &s, &b );
+        if ( good < 0 ) {
+            break;
+        }
+        blocks += good;
+        bad += b;
+    }
+    double lag = kill_time - s.last_time;
+    printf("round %d: %d blocks, %d bad, %u records, last record %.3f sec before kill%s\n",
+           round, blocks, bad, s.next, lag, s.broken ? ", SEQUENCE BROKEN" : "");
+    return !s.broken && s.next > 0 && lag <= flush_sec + 0.25;
+}
+
+int main( int argc, char **argv ) {
+    const char *dir = argc > 1 ? argv[1] : "/tmp/seglog_test";
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    srand( time(NULL) );
+    int failures = 0;
+    for ( int i = 0; i < rounds; i++ ) {
+        if ( !round_trip( dir, i ) ) {
+            failures++;
+        }
+    }
+    if ( failures ) {
+        printf("FAILED (%d of %d rounds)\n", failures, rounds);
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}
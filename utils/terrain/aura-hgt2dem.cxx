@@ -0,0 +1,110 @@
+// convert SRTM .hgt tiles to the blocked .dem tiles read by
+// util/terrain for ground elevation lookups
+
+#include <stdio.h>
+#include <stdlib.h>		// exit()
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+#include "util/terrain.hxx"
+
+void usage() {
+    printf("\nUsage:\n");
+    printf("  aura-hgt2dem output_dir N44W094.hgt [...]\n");
+    printf("\n");
+    printf("SRTM1 (3601 posts) and SRTM3 (1201 posts) tiles are accepted.\n");
+    exit(-1);
+}
+
+// south west corner from the SRTM file name
+static bool parse_name( const string &file, int *lat, int *lon ) {
+    string base = file;
+    size_t slash = base.rfind('/');
+    if ( slash != string::npos ) {
+        base = base.substr(slash + 1);
+    }
+    char ns, ew;
+    if ( sscanf(base.c_str(), "%c%d%c%d", &ns, lat, &ew, lon) != 4 ) {
+        return false;
+    }
+    if ( ns == 'S' || ns == 's' ) {
+        *lat = -*lat;
+    } else if ( ns != 'N' && ns != 'n' ) {
+        return false;
+    }
+    if ( ew == 'W' || ew == 'w' ) {
+        *lon = -*lon;
+    } else if ( ew != 'E' && ew != 'e' ) {
+        return false;
+    }
+    return true;
+}
+
+static bool convert( const string &dir, const string &file ) {
+    int lat, lon;
+    if ( !parse_name(file, &lat, &lon) ) {
+        printf("%s: cannot tell the tile corner from the name\n", file.c_str());
+        return false;
+    }
+    FILE *fd = fopen( file.c_str(), "rb" );
+    if ( fd == NULL ) {
+        printf("%s: cannot open\n", file.c_str());
+        return false;
+    }
+    fseek( fd, 0, SEEK_END );
+    long size = ftell( fd );
+    fseek( fd, 0, SEEK_SET );
+    int posts;
+    if ( size == 3601L * 3601 * 2 ) {
+        posts = 3601;
+    } else if ( size == 1201L * 1201 * 2 ) {
+        posts = 1201;
+    } else {
+        printf("%s: unexpected size %ld\n", file.c_str(), size);
+        fclose( fd );
+        return false;
+    }
+    vector<unsigned char> raw( size );
+    bool ok = fread( &raw[0], size, 1, fd ) == 1;
+    fclose( fd );
+    if ( !ok ) {
+        printf("%s: read error\n", file.c_str());
+        return false;
+    }
+
+    // hgt is big endian with the north row first, tiles are stored
+    // in host order from the south west corner
+    vector<int16_t> heights( posts * posts );
+    for ( int r = 0; r < posts; r++ ) {
+        const unsigned char *src = &raw[(size_t)(posts - 1 - r) * posts * 2];
+        for ( int c = 0; c < posts; c++ ) {
+            heights[r * posts + c] = (int16_t)((src[2*c] << 8) | src[2*c + 1]);
+        }
+    }
+
+    string out = dir + "/" + dem_tile_name( lat, lon );
+    if ( !dem_write_tile(out, lat, lon, posts, &heights[0]) ) {
+        return false;
+    }
+    printf("%s -> %s (%d posts)\n", file.c_str(), out.c_str(), posts);
+    return true;
+}
+
+int main( int argc, char **argv ) {
+    if ( argc < 3 ) {
+        usage();
+    }
+    string dir = argv[1];
+    int errors = 0;
+    for ( int i = 2; i < argc; i++ ) {
+        if ( !convert(dir, argv[i]) ) {
+            errors++;
+        }
+    }
+    return errors ? 1 : 0;
+}